@@ -0,0 +1,98 @@
+/**
+ * @file    : CmdDispatch.h
+ * @brief   : Command table and dispatcher shared between 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : CmdDispatch.c
+ * @note    : Commands travel as a one byte opcode followed by binary
+ *            arguments. Text commands (written from the phone app) are
+ *            still accepted and are resolved through a perfect hash.
+*/
+
+#ifndef _CMD_DISPATCH_H
+#define _CMD_DISPATCH_H
+
+/*********************************************************INCLUDES************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************************************************MACROS**************************************************/
+#define CMD_SSID_MAX_LEN        32
+#define CMD_PWD_MAX_LEN         64
+/*Opcodes are kept below this value so they never collide with a printable text command*/
+#define CMD_OPCODE_MAX          0x20
+/*Number of slots of the text command hash, must be a power of 2*/
+#define CMD_HASH_SLOTS          8
+
+/*Hash of a text keyword, computed from its length and first character*/
+#define CMD_HASH(len, key)      ((((len) * 3u) + (uint8_t)(key)) & (CMD_HASH_SLOTS - 1))
+
+/**
+ * Command table
+ * Columns : Id, opcode on the wire, text keyword, first char of keyword, argument type
+ * Text commands take the form <keyword> or <keyword>:<arguments>
+ * The first char cannot be taken from the keyword in a constant expression,
+ * tests/cmd_dispatch checks every row
+*/
+#define PETTAP_CMD_TABLE(X)                                                 \
+    X(CMD_CONNECT,      0x01,   "CONNECT",      'C',    CMD_ARG_NONE)       \
+    X(CMD_DISCONNECT,   0x02,   "DISCONNECT",   'D',    CMD_ARG_NONE)       \
+    X(CMD_LOCATION,     0x03,   "LOCATION",     'L',    CMD_ARG_NONE)       \
+    X(CMD_WIFI_CRED,    0x04,   "ssid",         's',    CMD_ARG_WIFI_CRED)  \
+    X(CMD_WIFI_FORGET,  0x05,   "delssid",      'd',    CMD_ARG_SSID)       \
+    X(CMD_POWER_MODE,   0x06,   "POWER_MODE",   'P',    CMD_ARG_POWER)
+
+/*********************************************************TYPEDEFS************************************************/
+#define CMD_ENUM_ENTRY(Id, Opcode, Text, Key, ArgType)  Id = Opcode,
+
+typedef enum __eCmdId
+{
+    CMD_NONE = 0,
+    PETTAP_CMD_TABLE(CMD_ENUM_ENTRY)
+}_eCmdId;
+
+typedef enum __eCmdArgType
+{
+    CMD_ARG_NONE,
+    CMD_ARG_WIFI_CRED,
+    CMD_ARG_SSID,               //Password of sWifiCred left empty
+    CMD_ARG_POWER               //One byte _ePowerMode
+}_eCmdArgType;
+
+/*Power mode requested from the peer, values are sent on the wire*/
+typedef enum __ePowerMode
+{
+    POWER_ACTIVE = 0,
+    POWER_SLEEP,
+    POWER_MODE_MAX
+}_ePowerMode;
+
+typedef struct __sWifiCredArg
+{
+    char cSSID[CMD_SSID_MAX_LEN + 1];
+    char cPassword[CMD_PWD_MAX_LEN + 1];
+}_sWifiCredArg;
+
+typedef struct __sCmd
+{
+    _eCmdId eId;
+    union
+    {
+        _sWifiCredArg sWifiCred;
+        _ePowerMode ePowerMode;
+    }uArgs;
+}_sCmd;
+
+/*Handler for a decoded command, table of these is indexed by opcode*/
+typedef void (*cmdExecHandler)(const _sCmd *psCmd);
+
+/*********************************************************FUNCTION DECLARATION************************************/
+bool CmdDecode(const uint8_t *pucPayload, uint16_t usLen, _sCmd *psCmd);
+uint16_t CmdEncode(const _sCmd *psCmd, uint8_t *pucBuf, uint16_t usBufSize);
+bool CmdDispatch(const uint8_t *pucPayload, uint16_t usLen,
+                 const cmdExecHandler pHandlers[CMD_OPCODE_MAX]);
+const char *CmdGetName(_eCmdId eId);
+
+#endif
+
+//EOF
@@ -0,0 +1,101 @@
+/**
+ * @file    : LinkBaud.h
+ * @brief   : Runtime baud rate negotiation of the UART link between 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : LinkBaud.c
+ * @note    : Both sides boot at the devicetree rate. The master asks the
+ *            slave to step to the next rate of the table, verifies it with
+ *            CRC'd echo probes and commits it, until a rate fails or the
+ *            table ends. A slave on an uncommitted rate reverts on its own
+ *            when the master goes quiet. A failed rate is not tried again
+ *            for LINK_BAUD_CEILING_MS. Error bursts or silence on the
+ *            link drop both sides back to the devicetree rate.
+*/
+
+#ifndef _LINK_BAUD_H
+#define _LINK_BAUD_H
+
+/*********************************************************INCLUDES************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include "PacketFrame.h"
+#include "LinkReliable.h"
+
+/*********************************************************MACROS**************************************************/
+#define LINK_BAUD_PROBES            8       //Echo probes per rate
+#define LINK_BAUD_PROBE_LEN         64
+#define LINK_BAUD_REPLY_MS          200     //Wait for a reply from slave
+#define LINK_BAUD_REQ_RETRIES       3
+#define LINK_BAUD_TRIAL_MS          300     //Slave reverts if not committed within
+#define LINK_BAUD_RETRY_MS          10000   //Master retries when slave did not answer
+#define LINK_BAUD_CEILING_MS        60000   //Rates above a failed probe are tried again after
+#define LINK_BAUD_KEEPALIVE_MS      1000    //Master traffic on a raised rate
+#define LINK_BAUD_SILENCE_MS        3500    //No valid frame on a raised rate
+#define LINK_BAUD_ERR_WINDOW_MS     1000
+#define LINK_BAUD_ERR_BURST         8       //Errors within window forcing a fallback
+#define LINK_BAUD_RXQ_LEN           4
+
+/*********************************************************TYPEDEFS************************************************/
+
+typedef enum __eLinkBaudRole
+{
+    LINK_BAUD_MASTER,
+    LINK_BAUD_SLAVE
+}_eLinkBaudRole;
+
+typedef struct __sLinkBaudStats
+{
+    uint32_t ulBaudrate;
+    bool bFlowCtrl;
+    bool bNegotiated;
+    uint32_t ulNegotiations;
+    uint32_t ulFallbacks;
+    uint32_t ulProbesOk;
+    uint32_t ulProbesFailed;
+    uint32_t ulLineErrors;
+}_sLinkBaudStats;
+
+typedef struct __sLinkBaud
+{
+    const struct device *psUart;
+    linkTxHandler pTx;
+    const _sFrameStats *psFrameStats;
+    _eLinkBaudRole eRole;
+    struct uart_config sSafeCfg;        //Devicetree configuration
+    bool bFlowCtrl;                     //RTS/CTS wired on this side
+    bool bPeerFlowCtrl;
+    uint8_t ucIdx;                      //Current rate
+    uint8_t ucGoodIdx;                  //Last committed rate
+    uint8_t ucMaxIdx;                   //Highest rate still allowed
+    bool bTrial;                        //Slave running on uncommitted rate
+    bool bNegotiate;                    //Master handshake due
+    bool bSettle;                       //Master waiting for slave trial to expire
+    bool bIdle;                         //Link parked by low-power mode
+    uint32_t ulDeadline;
+    uint32_t ulCeilingEnd;              //Ceiling lowered by a failed probe until
+    uint32_t ulLastTx;
+    uint32_t ulLastRx;
+    uint32_t ulFramesSeen;
+    uint32_t ulErrWindowStart;
+    uint32_t ulErrBase;
+    struct k_msgq sRxQueue;
+    char cRxQueueBuf[LINK_BAUD_RXQ_LEN * sizeof(_sPacket)] __aligned(4);
+    _sLinkBaudStats sStats;
+}_sLinkBaud;
+
+/*********************************************************FUNCTION DECLARATION************************************/
+bool LinkBaudInit(_sLinkBaud *psBaud, const struct device *psUart, _eLinkBaudRole eRole,
+                  bool bFlowCtrl, linkTxHandler pTx, const _sFrameStats *psFrameStats);
+bool LinkBaudRxFromIsr(_sLinkBaud *psBaud, const _sPacket *psPacket);
+void LinkBaudPoll(_sLinkBaud *psBaud);
+bool LinkBaudNegotiate(_sLinkBaud *psBaud);
+void LinkBaudSetIdle(_sLinkBaud *psBaud, bool bIdle);
+const _sLinkBaudStats *LinkBaudGetStats(_sLinkBaud *psBaud);
+
+#endif
+
+//EOF
@@ -0,0 +1,72 @@
+/**
+ * @file    : LinkPower.h
+ * @brief   : Low-power mode of the UART link between 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : LinkPower.c
+ * @note    : Each side drives a wake line into the other. A side raises its
+ *            line before sending and keeps it up until the link has been
+ *            idle for a while. A rising edge from the peer resumes the UART
+ *            and is answered by raising the own line, which tells the peer
+ *            the receiver is running. The UART is suspended only while both
+ *            lines are low.
+*/
+
+#ifndef _LINK_POWER_H
+#define _LINK_POWER_H
+
+/*********************************************************INCLUDES************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+
+/*********************************************************MACROS**************************************************/
+#define LINK_PM_IDLE_MS             50      //Quiet time before releasing own wake line
+#define LINK_PM_WAKE_TIMEOUT_MS     20      //Wait for peer receiver before sending anyway
+
+/*********************************************************TYPEDEFS************************************************/
+
+typedef struct __sLinkPowerStats
+{
+    uint32_t ulWakeRequests;        //Peer woken by us
+    uint32_t ulWakeups;             //Woken by peer
+    uint32_t ulWakeTimeouts;
+    uint32_t ulWakeLatencyLastUs;
+    uint32_t ulWakeLatencyMaxUs;
+    uint32_t ulWakeLatencyAvgUs;
+    uint32_t ulSuspends;
+    uint32_t ulSuspendedMs;
+    uint32_t ulAwakeMs;
+}_sLinkPowerStats;
+
+typedef struct __sLinkPower
+{
+    const struct device *psUart;
+    struct gpio_dt_spec sWakeOut;
+    struct gpio_dt_spec sWakeIn;
+    struct gpio_callback sWakeInCb;
+    struct k_work sWakeWork;
+    struct k_mutex sLock;
+    struct k_sem sPeerReady;
+    bool bWakeOut;
+    bool bSuspended;
+    volatile uint32_t ulLastActivity;
+    uint32_t ulStateSince;          //Time of last suspend or resume
+    uint64_t ullLatencySumUs;
+    _sLinkPowerStats sStats;
+}_sLinkPower;
+
+/*********************************************************FUNCTION DECLARATION************************************/
+bool LinkPowerInit(_sLinkPower *psPower, const struct device *psUart,
+                   const struct gpio_dt_spec *psWakeOut, const struct gpio_dt_spec *psWakeIn);
+void LinkPowerTxBegin(_sLinkPower *psPower);
+void LinkPowerActivity(_sLinkPower *psPower);
+void LinkPowerPoll(_sLinkPower *psPower, bool bBusy);
+bool LinkPowerIsSuspended(_sLinkPower *psPower);
+const _sLinkPowerStats *LinkPowerGetStats(_sLinkPower *psPower);
+
+#endif
+
+//EOF
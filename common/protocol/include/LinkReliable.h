@@ -0,0 +1,92 @@
+/**
+ * @file    : LinkReliable.h
+ * @brief   : Reliable delivery over the UART link between 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : LinkReliable.c
+ * @note    : Go-back-N sliding window. Every CMD/RESP/DATA frame carries a
+ *            sequence number, the receiver answers with a cumulative ACK
+ *            holding the next sequence it expects. Unacknowledged frames
+ *            are retransmitted after an adaptive timeout (Jacobson/Karels).
+ *            A receiver without sequence state (after a reboot) accepts only
+ *            a SYN frame. Anything else is dropped and answered with a SYN
+ *            flagged ACK, on which the sender resends its window with SYN on
+ *            the oldest frame.
+*/
+
+#ifndef _LINK_RELIABLE_H
+#define _LINK_RELIABLE_H
+
+/*********************************************************INCLUDES************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include "PacketFrame.h"
+
+/*********************************************************MACROS**************************************************/
+/*Frames in flight, must be a power of 2 and well below half the sequence space*/
+#define LINK_WINDOW_SIZE        4
+/*Timeouts without progress before the window is dropped*/
+#define LINK_MAX_RETRIES        6
+
+#define LINK_RTO_INIT_MS        1000
+#define LINK_RTO_MIN_MS         100
+#define LINK_RTO_MAX_MS         8000
+
+/*********************************************************TYPEDEFS************************************************/
+
+/*Puts one packet on the wire*/
+typedef bool (*linkTxHandler)(const _sPacket *psPacket);
+
+typedef struct __sLinkSlot
+{
+    _sPacket sPacket;
+    uint32_t ulSentAt;
+    uint8_t ucRetries;
+}_sLinkSlot;
+
+typedef struct __sLinkStats
+{
+    uint32_t ulTxFrames;
+    uint32_t ulRetransmits;
+    uint32_t ulRxFrames;
+    uint32_t ulDuplicates;
+    uint32_t ulOutOfOrder;
+    uint32_t ulAcksSent;
+    uint32_t ulAcksRcvd;
+    uint32_t ulDropped;
+    uint32_t ulResyncs;         //Resync requests sent to the peer
+    uint32_t ulSrttMs;
+    uint32_t ulRtoMs;
+}_sLinkStats;
+
+typedef struct __sLinkReliable
+{
+    struct k_mutex sLock;
+    linkTxHandler pTx;
+    _sLinkSlot asSlots[LINK_WINDOW_SIZE];
+    uint8_t ucTxBase;           //Oldest unacknowledged sequence
+    uint8_t ucTxNext;           //Next sequence to assign
+    uint8_t ucRxExpected;       //Next sequence expected from peer
+    uint8_t ucRxSynSeq;         //Sequence of last SYN frame accepted
+    uint8_t ucTimeouts;         //Consecutive timeouts without progress
+    bool bTxSyn;                //Next frame restarts peer receive sequence
+    bool bRxSynced;
+    uint32_t ulTimerStart;      //Last (re)transmission of oldest frame
+    uint32_t ulSrtt;
+    uint32_t ulRttVar;
+    uint32_t ulRto;
+    _sLinkStats sStats;
+}_sLinkReliable;
+
+/*********************************************************FUNCTION DECLARATION************************************/
+void LinkInit(_sLinkReliable *psLink, linkTxHandler pTx);
+bool LinkSend(_sLinkReliable *psLink, _sPacket *psPacket);
+bool LinkReceive(_sLinkReliable *psLink, const _sPacket *psPacket);
+uint32_t LinkPoll(_sLinkReliable *psLink);
+bool LinkIsIdle(_sLinkReliable *psLink);
+const _sLinkStats *LinkGetStats(_sLinkReliable *psLink);
+
+#endif
+
+//EOF
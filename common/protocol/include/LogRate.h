@@ -0,0 +1,53 @@
+/**
+ * @file    : LogRate.h
+ * @brief   : Rate limited printk for repetitive messages
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @note    : Each call site prints at most once per interval, messages in
+ *            between are counted and the count is printed with the next
+ *            one. Safe from ISRs, two contexts racing on the same call site
+ *            may both print.
+*/
+
+#ifndef _LOG_RATE_H
+#define _LOG_RATE_H
+
+/*********************************************************INCLUDES************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+/*********************************************************MACROS**************************************************/
+#define PRINTK_RATELIMIT(IntervalMs, Fmt, ...)                                  \
+    do                                                                          \
+    {                                                                           \
+        static uint32_t ulRateLast;                                             \
+        static uint32_t ulRateDropped;                                          \
+        static bool bRateStarted;                                               \
+        uint32_t ulRateNow = k_uptime_get_32();                                 \
+                                                                                \
+        if (bRateStarted && (ulRateNow - ulRateLast) < (IntervalMs))            \
+        {                                                                       \
+            ulRateDropped++;                                                    \
+            break;                                                              \
+        }                                                                       \
+                                                                                \
+        bRateStarted = true;                                                    \
+        ulRateLast = ulRateNow;                                                 \
+                                                                                \
+        if (ulRateDropped)                                                      \
+        {                                                                       \
+            printk("(%u suppressed) ", ulRateDropped);                          \
+            ulRateDropped = 0;                                                  \
+        }                                                                       \
+                                                                                \
+        printk(Fmt, ##__VA_ARGS__);                                             \
+    } while (0)
+
+/*Interval for errors reported from UART interrupts*/
+#define LOG_RATE_ISR_MS         1000
+
+#endif
+
+//EOF
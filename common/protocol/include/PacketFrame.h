@@ -0,0 +1,120 @@
+/**
+ * @file    : PacketFrame.h
+ * @brief   : Packet framing for the UART link between 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : PacketFrame.c
+ * @note    : Frame on the wire
+ *            | START | TYPE | SEQ | LEN (LE16) | HCS | PAYLOAD (LEN) | CRC16 (LE16) | END |
+ *            Upper bits of TYPE carry link flags, SEQ is owned by LinkReliable.
+ *            HCS is a CRC8-CCITT of TYPE, SEQ and LEN so a corrupted LEN is
+ *            rejected before the payload is read. CRC16-CCITT covers every byte
+ *            from TYPE to the end of PAYLOAD. The receiver is driven by LEN, so
+ *            payload bytes may take any value including START/END.
+*/
+
+#ifndef _PACKET_FRAME_H
+#define _PACKET_FRAME_H
+
+/*********************************************************INCLUDES************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "CmdDispatch.h"
+
+/*********************************************************MACROS**************************************************/
+#define START_BYTE          0x2A
+#define END_BYTE            0x23
+#define DATA_SIZE           100
+
+#define FRAME_HEADER_SIZE   6       //START, TYPE, SEQ, LEN, HCS
+#define FRAME_TRAILER_SIZE  3       //CRC16, END
+#define FRAME_MAX_SIZE      (FRAME_HEADER_SIZE + DATA_SIZE + FRAME_TRAILER_SIZE)
+
+#define FRAME_TYPE_MASK     0x0F
+#define FRAME_FLAG_SYN      0x80    //Sender restarted its sequence numbering
+
+/*********************************************************TYPEDEFS************************************************/
+
+typedef enum __ePacketType
+{
+    CMD  = 0,
+    RESP,
+    DATA,
+    ACK,
+    CTRL,       //Link management, never passed to the application
+    PACKET_TYPE_MAX
+}_ePacketType;
+
+typedef struct __sPacket
+{
+    uint8_t ucStartByte;
+    _ePacketType PacketType;
+    uint8_t ucFlags;
+    uint8_t ucSeq;
+    uint8_t pucPayload[DATA_SIZE + 1];      //Room for terminator so text payloads are strings
+    uint16_t usLen;
+    uint8_t ucEndByte;
+}_sPacket;
+
+typedef enum __eFrameRxState
+{
+    FRAME_START,
+    FRAME_TYPE,
+    FRAME_SEQ,
+    FRAME_LEN_LO,
+    FRAME_LEN_HI,
+    FRAME_HCS,
+    FRAME_PAYLOAD,
+    FRAME_CRC_LO,
+    FRAME_CRC_HI,
+    FRAME_END
+}_eFrameRxState;
+
+typedef enum __eFrameStatus
+{
+    FRAME_IN_PROGRESS,
+    FRAME_COMPLETE,
+    FRAME_ERROR
+}_eFrameStatus;
+
+typedef struct __sFrameStats
+{
+    uint32_t ulFrames;
+    uint32_t ulBytes;
+    uint32_t ulCrcErrors;
+    uint32_t ulFramingErrors;
+}_sFrameStats;
+
+/*Byte-wise receiver, safe to feed from UART ISR*/
+typedef struct __sPacketDecoder
+{
+    _eFrameRxState eState;
+    uint16_t usIdx;
+    uint16_t usCrc;
+    _sPacket sPacket;
+    _sFrameStats sStats;
+}_sPacketDecoder;
+
+typedef bool (*respProcHandler)(char *pcResp);
+typedef bool (*dataProcHandler)(uint8_t *pucData, uint16_t usLen);
+
+/*Per application handlers used by PacketDispatch*/
+typedef struct __sPacketHandlers
+{
+    const cmdExecHandler *pCmdHandlers;
+    respProcHandler RespHdlr;
+    dataProcHandler DataHdlr;
+    dataProcHandler AckHdlr;
+}_sPacketHandlers;
+
+/*********************************************************FUNCTION DECLARATION************************************/
+bool BuildPacket(_sPacket *psPacket,_ePacketType PcktType,
+                uint8_t *pucPayload, uint16_t usPayloadLen);
+uint16_t SerializePacket(const _sPacket *psPacket, uint8_t *pucFrame, uint16_t usFrameSize);
+void PacketDecoderInit(_sPacketDecoder *psDecoder);
+_eFrameStatus PacketDecodeByte(_sPacketDecoder *psDecoder, uint8_t ucByte);
+bool PacketDispatch(_sPacket *psPacket, const _sPacketHandlers *psHandlers);
+
+#endif
+
+//EOF
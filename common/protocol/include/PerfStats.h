@@ -0,0 +1,102 @@
+/**
+ * @file    : PerfStats.h
+ * @brief   : Lightweight runtime counters, high-water marks and histograms
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : PerfStats.c
+ * @note    : Each subsystem defines its own metrics with the PERF_*_DEFINE
+ *            macros, storage is static and collected in iterable sections
+ *            so no registration is needed. Updating a metric is a handful
+ *            of instructions and safe from ISRs. Histograms use power of 2
+ *            buckets, percentiles are estimated from the bucket bounds.
+ *            With CONFIG_PETTAP_PERF disabled all macros compile to nothing.
+*/
+
+#ifndef _PERF_STATS_H
+#define _PERF_STATS_H
+
+/*********************************************************INCLUDES************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/iterable_sections.h>
+
+/*********************************************************MACROS**************************************************/
+/*Bucket i holds values below 2^i, last bucket takes the rest*/
+#define PERF_HIST_BUCKETS       24
+
+/*********************************************************TYPEDEFS************************************************/
+
+typedef struct __sPerfCounter
+{
+    const char *pcName;
+    atomic_t nValue;
+}_sPerfCounter;
+
+typedef struct __sPerfGauge
+{
+    const char *pcName;
+    uint32_t ulValue;
+    uint32_t ulMax;                     //High-water mark
+}_sPerfGauge;
+
+typedef struct __sPerfHist
+{
+    const char *pcName;
+    const char *pcUnit;
+    uint32_t ulCount;
+    uint32_t ulMin;
+    uint32_t ulMax;
+    uint64_t ullSum;
+    uint32_t aulBuckets[PERF_HIST_BUCKETS];
+}_sPerfHist;
+
+/*********************************************************FUNCTION DECLARATION************************************/
+void PerfGaugeSet(_sPerfGauge *psGauge, uint32_t ulValue);
+void PerfHistRecord(_sPerfHist *psHist, uint32_t ulValue);
+uint32_t PerfHistPercentile(const _sPerfHist *psHist, uint8_t ucPct);
+uint32_t PerfSecondsSinceReset(void);
+void PerfReset(void);
+int PerfToJson(char *pcBuf, size_t ulSize);
+
+/*********************************************************METRIC MACROS*******************************************/
+#if defined(CONFIG_PETTAP_PERF)
+
+#define PERF_COUNTER_DEFINE(Name)                                               \
+    STRUCT_SECTION_ITERABLE(__sPerfCounter, Name) = {.pcName = #Name}
+#define PERF_GAUGE_DEFINE(Name)                                                 \
+    STRUCT_SECTION_ITERABLE(__sPerfGauge, Name) = {.pcName = #Name}
+#define PERF_HIST_DEFINE(Name, Unit)                                            \
+    STRUCT_SECTION_ITERABLE(__sPerfHist, Name) = {.pcName = #Name, .pcUnit = Unit}
+
+#define PERF_ADD(Name, Value)       atomic_add(&(Name).nValue, (atomic_val_t)(Value))
+#define PERF_COUNT(Name)            atomic_inc(&(Name).nValue)
+#define PERF_GAUGE(Name, Value)     PerfGaugeSet(&(Name), (Value))
+#define PERF_HIST(Name, Value)      PerfHistRecord(&(Name), (Value))
+
+/*Cycle counter stamp, intervals up to the counter wrap*/
+#define PERF_STAMP()                k_cycle_get_32()
+#define PERF_HIST_SINCE_US(Name, Stamp)                                         \
+    PerfHistRecord(&(Name), k_cyc_to_us_floor32(k_cycle_get_32() - (Stamp)))
+
+#else
+
+#define PERF_COUNTER_DEFINE(Name)
+#define PERF_GAUGE_DEFINE(Name)
+#define PERF_HIST_DEFINE(Name, Unit)
+
+#define PERF_ADD(Name, Value)       do { } while (0)
+#define PERF_COUNT(Name)            do { } while (0)
+#define PERF_GAUGE(Name, Value)     do { } while (0)
+#define PERF_HIST(Name, Value)      do { } while (0)
+
+#define PERF_STAMP()                0
+#define PERF_HIST_SINCE_US(Name, Stamp)     ((void)(Stamp))
+
+#endif
+
+#endif
+
+//EOF
@@ -0,0 +1,50 @@
+/**
+ * @file    : ThreadProfile.h
+ * @brief   : Periodic sampling of thread CPU share and stack usage
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : ThreadProfile.c
+ * @note    : Every CONFIG_PETTAP_PERF_THREADS_PERIOD seconds the runtime
+ *            statistics and stack high-water mark of each thread are read
+ *            from the kernel. CPU share is over the last period, the peak
+ *            share is kept until PerfReset.
+*/
+
+#ifndef _THREAD_PROFILE_H
+#define _THREAD_PROFILE_H
+
+/*********************************************************INCLUDES************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/kernel.h>
+
+/*********************************************************MACROS**************************************************/
+#define THREAD_PROF_NAME_LEN    16
+/*Stack over 75% used, flagged by "stats threads" and reported once when sampled*/
+#define THREAD_PROF_STACK_HIGH(psProf)  ((psProf)->ulStackUsed * 4 > (psProf)->ulStackSize * 3)
+
+/*********************************************************TYPEDEFS************************************************/
+
+typedef struct __sThreadProf
+{
+    const struct k_thread *psThread;
+    char cName[THREAD_PROF_NAME_LEN];
+    uint64_t ullCycles;                 //Execution cycles at the last sample
+    uint16_t usCpuPermille;             //Share of the last period
+    uint16_t usCpuPeakPermille;
+    uint32_t ulStackSize;
+    uint32_t ulStackUsed;               //High-water mark
+    bool bSeen;                         //Found in the last sample
+    bool bStackHighReported;
+}_sThreadProf;
+
+/*********************************************************FUNCTION DECLARATION************************************/
+void ThreadProfInit(void);
+uint8_t ThreadProfGet(_sThreadProf *psOut, uint8_t ucMax);
+int ThreadProfToJson(char *pcBuf, size_t ulSize);
+void ThreadProfReset(void);
+
+#endif
+
+//EOF
@@ -0,0 +1,440 @@
+/**
+ * @file    : CmdDispatch.c
+ * @brief   : Command table and dispatcher shared between 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : CmdDispatch.h
+*/
+/*******************************************************INCLUDES***************************************************/
+#include <string.h>
+#include <zephyr/toolchain.h>
+#include "CmdDispatch.h"
+
+/*******************************************************MACROS*****************************************************/
+#define CMD_KEYWORD_SEPARATOR   ':'
+#define CMD_PWD_TAG             ",pwd:"
+
+/*******************************************************TYPEDEFS***************************************************/
+typedef struct __sCmdDesc
+{
+    const char *pcText;
+    uint8_t ucTextLen;
+    _eCmdArgType eArgType;
+}_sCmdDesc;
+
+/*******************************************************PRIVATE VARIABLES******************************************/
+#define CMD_DESC_ENTRY(Id, Opcode, Text, Key, ArgType) \
+    [Opcode] = {Text, sizeof(Text) - 1, ArgType},
+#define CMD_SLOT_ENTRY(Id, Opcode, Text, Key, ArgType) \
+    [CMD_HASH(sizeof(Text) - 1, Key)] = Opcode,
+#define CMD_SLOT_SUM(Id, Opcode, Text, Key, ArgType) \
+    + (1u << CMD_HASH(sizeof(Text) - 1, Key))
+#define CMD_SLOT_OR(Id, Opcode, Text, Key, ArgType) \
+    | (1u << CMD_HASH(sizeof(Text) - 1, Key))
+#define CMD_OPCODE_CHECK(Id, Opcode, Text, Key, ArgType) \
+    BUILD_ASSERT((Opcode) > 0 && (Opcode) < CMD_OPCODE_MAX, "Invalid opcode for " #Id);
+
+/*Descriptor of each command, indexed by opcode*/
+static const _sCmdDesc asCmdDesc[CMD_OPCODE_MAX] = {
+    PETTAP_CMD_TABLE(CMD_DESC_ENTRY)
+};
+
+/*Perfect hash of text keywords to opcode, empty slots hold CMD_NONE*/
+static const uint8_t aucTextSlot[CMD_HASH_SLOTS] = {
+    PETTAP_CMD_TABLE(CMD_SLOT_ENTRY)
+};
+
+/*Every keyword must land in its own slot for the hash to be perfect*/
+BUILD_ASSERT((0u PETTAP_CMD_TABLE(CMD_SLOT_SUM)) == (0u PETTAP_CMD_TABLE(CMD_SLOT_OR)),
+             "Text command hash collision, adjust CMD_HASH or CMD_HASH_SLOTS");
+PETTAP_CMD_TABLE(CMD_OPCODE_CHECK)
+
+/*******************************************************FUNCTION DEFINITION*****************************************/
+
+/**
+ * @brief      : Copy a length prefixed string from a binary command
+ * @param [in] : pucSrc - source buffer, usSrcLen - bytes left in source
+ *               usMaxLen - capacity of destination without terminator
+ * @param [out]: pcDst - destination string
+ * @return     : bytes consumed from source, 0 on error
+*/
+static uint16_t ReadLenPrefixed(const uint8_t *pucSrc, uint16_t usSrcLen,
+                                char *pcDst, uint16_t usMaxLen)
+{
+    uint8_t ucLen = 0;
+
+    if (usSrcLen < 1)
+    {
+        return 0;
+    }
+
+    ucLen = pucSrc[0];
+
+    if (ucLen > usMaxLen || ucLen > (usSrcLen - 1))
+    {
+        return 0;
+    }
+
+    memcpy(pcDst, &pucSrc[1], ucLen);
+    pcDst[ucLen] = '\0';
+
+    return ucLen + 1;
+}
+
+/**
+ * @brief      : Copy a string into a binary command with a length prefix
+ * @param [in] : pcSrc - source string, usSpace - space left in buffer
+ * @param [out]: pucDst - destination buffer
+ * @return     : bytes written, 0 if it does not fit
+*/
+static uint16_t WriteLenPrefixed(const char *pcSrc, uint8_t *pucDst, uint16_t usSpace)
+{
+    size_t ulLen = strlen(pcSrc);
+
+    if (ulLen > UINT8_MAX || (ulLen + 1) > usSpace)
+    {
+        return 0;
+    }
+
+    pucDst[0] = (uint8_t)ulLen;
+    memcpy(&pucDst[1], pcSrc, ulLen);
+
+    return (uint16_t)(ulLen + 1);
+}
+
+/**
+ * @brief      : Find a tag inside a text that need not be NUL terminated
+ * @param [in] : pcText - text to search, ulLen - length of text, pcTag - tag
+ * @param [out]: None
+ * @return     : pointer to the tag, NULL if not found
+*/
+static const char *FindTag(const char *pcText, size_t ulLen, const char *pcTag)
+{
+    size_t ulTagLen = strlen(pcTag);
+
+    while (ulLen >= ulTagLen)
+    {
+        if (memcmp(pcText, pcTag, ulTagLen) == 0)
+        {
+            return pcText;
+        }
+        pcText++;
+        ulLen--;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief      : Decode binary arguments of a command
+ * @param [in] : eArgType - argument type, pucArgs - arguments, usLen - length
+ * @param [out]: psCmd - decoded command
+ * @return     : true for success
+*/
+static bool DecodeBinaryArgs(_eCmdArgType eArgType, const uint8_t *pucArgs,
+                             uint16_t usLen, _sCmd *psCmd)
+{
+    bool bRetVal = false;
+    uint16_t usUsed = 0;
+
+    switch (eArgType)
+    {
+        case CMD_ARG_NONE:
+                bRetVal = true;
+                break;
+
+        case CMD_ARG_WIFI_CRED:
+                usUsed = ReadLenPrefixed(pucArgs, usLen, psCmd->uArgs.sWifiCred.cSSID,
+                                         CMD_SSID_MAX_LEN);
+                if (usUsed && ReadLenPrefixed(&pucArgs[usUsed], usLen - usUsed,
+                                              psCmd->uArgs.sWifiCred.cPassword,
+                                              CMD_PWD_MAX_LEN))
+                {
+                    bRetVal = true;
+                }
+                break;
+
+        case CMD_ARG_SSID:
+                bRetVal = ReadLenPrefixed(pucArgs, usLen, psCmd->uArgs.sWifiCred.cSSID,
+                                          CMD_SSID_MAX_LEN) > 1;
+                break;
+
+        case CMD_ARG_POWER:
+                if (usLen >= 1 && pucArgs[0] < POWER_MODE_MAX)
+                {
+                    psCmd->uArgs.ePowerMode = (_ePowerMode)pucArgs[0];
+                    bRetVal = true;
+                }
+                break;
+
+        default:
+                break;
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Decode text arguments of a command
+ * @param [in] : eArgType - argument type
+ *               pcText - full text command, usLen - length of text command
+ * @param [out]: psCmd - decoded command
+ * @return     : true for success
+*/
+static bool DecodeTextArgs(_eCmdArgType eArgType, const char *pcText,
+                           uint16_t usLen, _sCmd *psCmd)
+{
+    bool bRetVal = false;
+    const char *pcArgs = memchr(pcText, CMD_KEYWORD_SEPARATOR, usLen);
+    const char *pcPwd = NULL;
+    size_t ulSSIDLen = 0;
+    size_t ulPwdLen = 0;
+
+    switch (eArgType)
+    {
+        case CMD_ARG_NONE:
+                bRetVal = (pcArgs == NULL);
+                break;
+
+        case CMD_ARG_WIFI_CRED:
+                //Format: ssid:<ssid>,pwd:<password> (no space after comma)
+                if (pcArgs == NULL)
+                {
+                    break;
+                }
+
+                pcArgs++;
+                pcPwd = FindTag(pcArgs, (pcText + usLen) - pcArgs, CMD_PWD_TAG);
+
+                if (pcPwd == NULL)
+                {
+                    break;
+                }
+
+                ulSSIDLen = pcPwd - pcArgs;
+                pcPwd += strlen(CMD_PWD_TAG);
+                ulPwdLen = (pcText + usLen) - pcPwd;
+
+                if (ulSSIDLen == 0 || ulSSIDLen > CMD_SSID_MAX_LEN ||
+                    ulPwdLen > CMD_PWD_MAX_LEN)
+                {
+                    break;
+                }
+
+                memcpy(psCmd->uArgs.sWifiCred.cSSID, pcArgs, ulSSIDLen);
+                psCmd->uArgs.sWifiCred.cSSID[ulSSIDLen] = '\0';
+                memcpy(psCmd->uArgs.sWifiCred.cPassword, pcPwd, ulPwdLen);
+                psCmd->uArgs.sWifiCred.cPassword[ulPwdLen] = '\0';
+                bRetVal = true;
+                break;
+
+        case CMD_ARG_SSID:
+                //Format: <keyword>:<ssid>
+                if (pcArgs == NULL)
+                {
+                    break;
+                }
+
+                pcArgs++;
+                ulSSIDLen = (pcText + usLen) - pcArgs;
+
+                if (ulSSIDLen == 0 || ulSSIDLen > CMD_SSID_MAX_LEN)
+                {
+                    break;
+                }
+
+                memcpy(psCmd->uArgs.sWifiCred.cSSID, pcArgs, ulSSIDLen);
+                psCmd->uArgs.sWifiCred.cSSID[ulSSIDLen] = '\0';
+                bRetVal = true;
+                break;
+
+        case CMD_ARG_POWER:
+                //Format: <keyword>:<single digit mode>
+                if (pcArgs == NULL || (pcText + usLen) - pcArgs != 2 ||
+                    pcArgs[1] < '0' || pcArgs[1] >= ('0' + POWER_MODE_MAX))
+                {
+                    break;
+                }
+
+                psCmd->uArgs.ePowerMode = (_ePowerMode)(pcArgs[1] - '0');
+                bRetVal = true;
+                break;
+
+        default:
+                break;
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Decode a command payload, binary or text
+ * @param [in] : pucPayload - command payload
+ *               usLen - length of payload
+ * @param [out]: psCmd - decoded command with typed arguments
+ * @return     : true for success
+*/
+bool CmdDecode(const uint8_t *pucPayload, uint16_t usLen, _sCmd *psCmd)
+{
+    bool bRetVal = false;
+    const _sCmdDesc *psDesc = NULL;
+    const char *pcText = (const char *)pucPayload;
+    const char *pcSeparator = NULL;
+    uint16_t usKeyLen = 0;
+    uint8_t ucOpcode = 0;
+
+    if (pucPayload && psCmd && usLen)
+    {
+        memset(psCmd, 0, sizeof(_sCmd));
+
+        if (pucPayload[0] < CMD_OPCODE_MAX)
+        {
+            //Binary command
+            ucOpcode = pucPayload[0];
+            psDesc = &asCmdDesc[ucOpcode];
+
+            if (psDesc->pcText &&
+                DecodeBinaryArgs(psDesc->eArgType, &pucPayload[1], usLen - 1, psCmd))
+            {
+                psCmd->eId = (_eCmdId)ucOpcode;
+                bRetVal = true;
+            }
+        }
+        else
+        {
+            //Text command, payload may be NUL padded
+            usLen = strnlen(pcText, usLen);
+            pcSeparator = memchr(pcText, CMD_KEYWORD_SEPARATOR, usLen);
+            usKeyLen = pcSeparator ? (pcSeparator - pcText) : usLen;
+            ucOpcode = aucTextSlot[CMD_HASH(usKeyLen, pcText[0])];
+            psDesc = &asCmdDesc[ucOpcode];
+
+            if (ucOpcode != CMD_NONE && psDesc->ucTextLen == usKeyLen &&
+                memcmp(psDesc->pcText, pcText, usKeyLen) == 0 &&
+                DecodeTextArgs(psDesc->eArgType, pcText, usLen, psCmd))
+            {
+                psCmd->eId = (_eCmdId)ucOpcode;
+                bRetVal = true;
+            }
+        }
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Encode a command into its binary wire format
+ * @param [in] : psCmd - command to encode
+ *               usBufSize - size of output buffer
+ * @param [out]: pucBuf - encoded command
+ * @return     : length of encoded command, 0 on failure
+*/
+uint16_t CmdEncode(const _sCmd *psCmd, uint8_t *pucBuf, uint16_t usBufSize)
+{
+    uint16_t usLen = 0;
+    uint16_t usUsed = 0;
+    const _sCmdDesc *psDesc = NULL;
+
+    if (psCmd && pucBuf && usBufSize && psCmd->eId < CMD_OPCODE_MAX)
+    {
+        psDesc = &asCmdDesc[psCmd->eId];
+
+        if (psDesc->pcText == NULL)
+        {
+            return 0;
+        }
+
+        pucBuf[usLen++] = (uint8_t)psCmd->eId;
+
+        switch (psDesc->eArgType)
+        {
+            case CMD_ARG_NONE:
+                    break;
+
+            case CMD_ARG_WIFI_CRED:
+                    usUsed = WriteLenPrefixed(psCmd->uArgs.sWifiCred.cSSID,
+                                              &pucBuf[usLen], usBufSize - usLen);
+                    if (usUsed == 0)
+                    {
+                        return 0;
+                    }
+                    usLen += usUsed;
+
+                    usUsed = WriteLenPrefixed(psCmd->uArgs.sWifiCred.cPassword,
+                                              &pucBuf[usLen], usBufSize - usLen);
+                    if (usUsed == 0)
+                    {
+                        return 0;
+                    }
+                    usLen += usUsed;
+                    break;
+
+            case CMD_ARG_SSID:
+                    usUsed = WriteLenPrefixed(psCmd->uArgs.sWifiCred.cSSID,
+                                              &pucBuf[usLen], usBufSize - usLen);
+                    if (usUsed == 0)
+                    {
+                        return 0;
+                    }
+                    usLen += usUsed;
+                    break;
+
+            case CMD_ARG_POWER:
+                    if (usLen >= usBufSize)
+                    {
+                        return 0;
+                    }
+                    pucBuf[usLen++] = (uint8_t)psCmd->uArgs.ePowerMode;
+                    break;
+
+            default:
+                    return 0;
+        }
+    }
+
+    return usLen;
+}
+
+/**
+ * @brief      : Decode a command and call its handler
+ * @param [in] : pucPayload - command payload
+ *               usLen - length of payload
+ *               pHandlers - handlers indexed by opcode, NULL if not supported
+ * @param [out]: None
+ * @return     : true if a handler was called
+*/
+bool CmdDispatch(const uint8_t *pucPayload, uint16_t usLen,
+                 const cmdExecHandler pHandlers[CMD_OPCODE_MAX])
+{
+    bool bRetVal = false;
+    _sCmd sCmd;
+
+    if (pHandlers && CmdDecode(pucPayload, usLen, &sCmd))
+    {
+        if (pHandlers[sCmd.eId])
+        {
+            pHandlers[sCmd.eId](&sCmd);
+            bRetVal = true;
+        }
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Get text keyword of a command
+ * @param [in] : eId - command id
+ * @param [out]: None
+ * @return     : keyword, "UNKNOWN" if not a valid command
+*/
+const char *CmdGetName(_eCmdId eId)
+{
+    if (eId < CMD_OPCODE_MAX && asCmdDesc[eId].pcText)
+    {
+        return asCmdDesc[eId].pcText;
+    }
+
+    return "UNKNOWN";
+}
+
+//EOF
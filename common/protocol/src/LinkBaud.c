@@ -0,0 +1,554 @@
+/**
+ * @file    : LinkBaud.c
+ * @brief   : Runtime baud rate negotiation of the UART link between 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : LinkBaud.h
+*/
+/*******************************************************INCLUDES***************************************************/
+#include <string.h>
+#include "LinkBaud.h"
+
+/*******************************************************MACROS*****************************************************/
+/*Time for the last byte to leave the shift register before reconfiguring*/
+#define DRAIN_MS                2
+
+/*******************************************************TYPEDEFS***************************************************/
+typedef enum __eCtrlOp
+{
+    CTRL_BAUD_REQ = 1,      //[idx][flow ctrl]
+    CTRL_BAUD_ACK,          //[idx][flow ctrl]
+    CTRL_PROBE,             //[seq][pattern]
+    CTRL_ECHO,              //copy of probe
+    CTRL_COMMIT,            //[idx]
+    CTRL_COMMIT_ACK,        //[idx]
+    CTRL_KEEPALIVE
+}_eCtrlOp;
+
+/*******************************************************PRIVATE VARIABLES******************************************/
+/*Index 0 is the devicetree rate*/
+static const uint32_t aulBaudRates[] = {
+    115200,
+    230400,
+    460800,
+    921600,
+    1000000,
+};
+
+/*******************************************************FUNCTION DEFINITION*****************************************/
+
+/**
+ * @brief      : Send a link control packet
+ * @param [in] : pucPayload - control payload, first byte is the operation
+ *             : usLen - payload length
+ * @param [out]: psBaud - negotiation context
+ * @return     : true for success
+*/
+static bool SendCtrl(_sLinkBaud *psBaud, uint8_t *pucPayload, uint16_t usLen)
+{
+    _sPacket sPacket = {0};
+
+    if (!BuildPacket(&sPacket, CTRL, pucPayload, usLen))
+    {
+        return false;
+    }
+
+    psBaud->ulLastTx = k_uptime_get_32();
+
+    return psBaud->pTx(&sPacket);
+}
+
+/**
+ * @brief      : Wait for a control packet from peer
+ * @param [in] : eOp - operation expected
+ *             : ulTimeoutMs - time to wait
+ * @param [out]: psBaud - negotiation context
+ *             : psPacket - packet received
+ * @return     : true if received in time
+*/
+static bool WaitCtrl(_sLinkBaud *psBaud, _eCtrlOp eOp, _sPacket *psPacket, uint32_t ulTimeoutMs)
+{
+    int64_t llEnd = k_uptime_get() + ulTimeoutMs;
+    int64_t llLeft = ulTimeoutMs;
+
+    while (llLeft > 0 && 0 == k_msgq_get(&psBaud->sRxQueue, psPacket, K_MSEC(llLeft)))
+    {
+        if (psPacket->usLen > 0 && psPacket->pucPayload[0] == eOp)
+        {
+            return true;
+        }
+
+        llLeft = llEnd - k_uptime_get();
+    }
+
+    return false;
+}
+
+/**
+ * @brief      : Reconfigure UART to a rate of the table
+ * @param [in] : ucIdx - index of rate
+ * @param [out]: psBaud - negotiation context
+ * @return     : true for success
+*/
+static bool SetRate(_sLinkBaud *psBaud, uint8_t ucIdx)
+{
+    struct uart_config sCfg = psBaud->sSafeCfg;
+
+    if (ucIdx != 0)
+    {
+        sCfg.baudrate = aulBaudRates[ucIdx];
+        sCfg.flow_ctrl = (psBaud->bFlowCtrl && psBaud->bPeerFlowCtrl) ?
+                         UART_CFG_FLOW_CTRL_RTS_CTS : UART_CFG_FLOW_CTRL_NONE;
+    }
+
+    k_msleep(DRAIN_MS);
+
+    if (uart_configure(psBaud->psUart, &sCfg) != 0)
+    {
+        return false;
+    }
+
+    psBaud->ucIdx = ucIdx;
+    psBaud->ulLastRx = k_uptime_get_32();
+    psBaud->sStats.ulBaudrate = sCfg.baudrate;
+    psBaud->sStats.bFlowCtrl = (sCfg.flow_ctrl == UART_CFG_FLOW_CTRL_RTS_CTS);
+
+    return true;
+}
+
+/**
+ * @brief      : Drop both sides back to devicetree rate
+ * @param [in] : None
+ * @param [out]: psBaud - negotiation context
+ * @return     : None
+*/
+static void Fallback(_sLinkBaud *psBaud)
+{
+    psBaud->sStats.ulFallbacks++;
+    psBaud->sStats.bNegotiated = false;
+    psBaud->bTrial = false;
+    psBaud->bSettle = false;
+    psBaud->ucGoodIdx = 0;
+    SetRate(psBaud, 0);
+    //Master ramps up again, slave waits for the master
+    psBaud->bNegotiate = (psBaud->eRole == LINK_BAUD_MASTER);
+    psBaud->ulDeadline = k_uptime_get_32();
+}
+
+/**
+ * @brief      : Verify current rate with echo probes, master only
+ * @param [in] : None
+ * @param [out]: psBaud - negotiation context
+ * @return     : true if every probe came back intact
+*/
+static bool ProbeRate(_sLinkBaud *psBaud)
+{
+    uint8_t ucProbe[LINK_BAUD_PROBE_LEN] = {0};
+    _sPacket sReply = {0};
+    uint8_t ucSeq = 0;
+    uint16_t usIdx = 0;
+
+    //Slave switches after sending its ACK, give it the same margin
+    k_msleep(DRAIN_MS);
+
+    for (ucSeq = 0; ucSeq < LINK_BAUD_PROBES; ucSeq++)
+    {
+        ucProbe[0] = CTRL_PROBE;
+        ucProbe[1] = ucSeq;
+
+        //Pattern sweeps all byte values including the frame delimiters
+        for (usIdx = 2; usIdx < sizeof(ucProbe); usIdx++)
+        {
+            ucProbe[usIdx] = (uint8_t)((usIdx * 37) + (ucSeq * 11));
+        }
+
+        SendCtrl(psBaud, ucProbe, sizeof(ucProbe));
+
+        if (!WaitCtrl(psBaud, CTRL_ECHO, &sReply, LINK_BAUD_REPLY_MS) ||
+            sReply.usLen != sizeof(ucProbe) ||
+            memcmp(&sReply.pucPayload[1], &ucProbe[1], sizeof(ucProbe) - 1) != 0)
+        {
+            psBaud->sStats.ulProbesFailed++;
+            return false;
+        }
+
+        psBaud->sStats.ulProbesOk++;
+    }
+
+    return true;
+}
+
+/**
+ * @brief      : Ask slave to move to a rate, master only
+ * @param [in] : ucIdx - index of rate
+ * @param [out]: psBaud - negotiation context
+ * @return     : true if slave accepted
+*/
+static bool RequestRate(_sLinkBaud *psBaud, uint8_t ucIdx)
+{
+    uint8_t ucReq[3] = {CTRL_BAUD_REQ, ucIdx, psBaud->bFlowCtrl};
+    _sPacket sReply = {0};
+    uint8_t ucTry = 0;
+
+    for (ucTry = 0; ucTry < LINK_BAUD_REQ_RETRIES; ucTry++)
+    {
+        SendCtrl(psBaud, ucReq, sizeof(ucReq));
+
+        if (WaitCtrl(psBaud, CTRL_BAUD_ACK, &sReply, LINK_BAUD_REPLY_MS) &&
+            sReply.usLen >= 3 && sReply.pucPayload[1] == ucIdx)
+        {
+            psBaud->bPeerFlowCtrl = sReply.pucPayload[2];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief      : Commit current rate on slave, master only
+ * @param [in] : ucIdx - index of rate
+ * @param [out]: psBaud - negotiation context
+ * @return     : true if slave confirmed
+*/
+static bool CommitRate(_sLinkBaud *psBaud, uint8_t ucIdx)
+{
+    uint8_t ucCommit[2] = {CTRL_COMMIT, ucIdx};
+    _sPacket sReply = {0};
+    uint8_t ucTry = 0;
+
+    for (ucTry = 0; ucTry < LINK_BAUD_REQ_RETRIES; ucTry++)
+    {
+        SendCtrl(psBaud, ucCommit, sizeof(ucCommit));
+
+        if (WaitCtrl(psBaud, CTRL_COMMIT_ACK, &sReply, LINK_BAUD_REPLY_MS) &&
+            sReply.pucPayload[1] == ucIdx)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief      : Handle a control packet on the slave
+ * @param [in] : psPacket - control packet from master
+ * @param [out]: psBaud - negotiation context
+ * @return     : None
+*/
+static void SlaveHandleCtrl(_sLinkBaud *psBaud, _sPacket *psPacket)
+{
+    uint8_t ucReply[3] = {0};
+    uint8_t ucIdx = psPacket->pucPayload[1];
+
+    switch (psPacket->pucPayload[0])
+    {
+        case CTRL_BAUD_REQ:
+                    if (psPacket->usLen < 3 || ucIdx >= ARRAY_SIZE(aulBaudRates))
+                    {
+                        break;
+                    }
+
+                    ucReply[0] = CTRL_BAUD_ACK;
+                    ucReply[1] = ucIdx;
+                    ucReply[2] = psBaud->bFlowCtrl;
+                    SendCtrl(psBaud, ucReply, sizeof(ucReply));
+
+                    if (!psBaud->bTrial)
+                    {
+                        psBaud->ucGoodIdx = psBaud->ucIdx;
+                    }
+
+                    psBaud->bPeerFlowCtrl = psPacket->pucPayload[2];
+                    psBaud->bTrial = SetRate(psBaud, ucIdx);
+                    psBaud->ulDeadline = k_uptime_get_32() + LINK_BAUD_TRIAL_MS;
+                    break;
+
+        case CTRL_PROBE:
+                    psPacket->pucPayload[0] = CTRL_ECHO;
+                    SendCtrl(psBaud, psPacket->pucPayload, psPacket->usLen);
+                    psBaud->ulDeadline = k_uptime_get_32() + LINK_BAUD_TRIAL_MS;
+                    break;
+
+        case CTRL_COMMIT:
+                    if (ucIdx == psBaud->ucIdx)
+                    {
+                        psBaud->bTrial = false;
+                        psBaud->ucGoodIdx = ucIdx;
+                        psBaud->sStats.bNegotiated = true;
+                        ucReply[0] = CTRL_COMMIT_ACK;
+                        ucReply[1] = ucIdx;
+                        SendCtrl(psBaud, ucReply, 2);
+                    }
+                    break;
+
+        case CTRL_KEEPALIVE:
+                    SendCtrl(psBaud, psPacket->pucPayload, 1);
+                    break;
+
+        default:
+                    break;
+    }
+}
+
+/**
+ * @brief      : Detect error bursts and silence on a raised rate
+ * @param [in] : None
+ * @param [out]: psBaud - negotiation context
+ * @return     : true if link fell back to devicetree rate
+*/
+static bool CheckLinkHealth(_sLinkBaud *psBaud)
+{
+    uint32_t ulNow = k_uptime_get_32();
+    uint32_t ulErrors = 0;
+
+    if (uart_err_check(psBaud->psUart) > 0)
+    {
+        psBaud->sStats.ulLineErrors++;
+    }
+
+    if (psBaud->psFrameStats->ulFrames != psBaud->ulFramesSeen)
+    {
+        psBaud->ulFramesSeen = psBaud->psFrameStats->ulFrames;
+        psBaud->ulLastRx = ulNow;
+    }
+
+    ulErrors = psBaud->psFrameStats->ulCrcErrors + psBaud->psFrameStats->ulFramingErrors +
+               psBaud->sStats.ulLineErrors;
+
+    if ((ulNow - psBaud->ulErrWindowStart) >= LINK_BAUD_ERR_WINDOW_MS)
+    {
+        psBaud->ulErrWindowStart = ulNow;
+        psBaud->ulErrBase = ulErrors;
+    }
+
+    //Silence is expected while the link is parked
+    if (psBaud->ucIdx != 0 && !psBaud->bTrial && !psBaud->bSettle &&
+        ((ulErrors - psBaud->ulErrBase) >= LINK_BAUD_ERR_BURST ||
+         (!psBaud->bIdle && (ulNow - psBaud->ulLastRx) >= LINK_BAUD_SILENCE_MS)))
+    {
+        Fallback(psBaud);
+        psBaud->ulErrBase = ulErrors;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief      : Initialise baud rate negotiation, UART must already be initialised
+ * @param [in] : psUart - UART of the link
+ *             : eRole - master drives the handshake
+ *             : bFlowCtrl - RTS/CTS wired on this side
+ *             : pTx - function putting a packet on the wire
+ *             : psFrameStats - receiver statistics of the link
+ * @param [out]: psBaud - negotiation context
+ * @return     : true for success
+*/
+bool LinkBaudInit(_sLinkBaud *psBaud, const struct device *psUart, _eLinkBaudRole eRole,
+                  bool bFlowCtrl, linkTxHandler pTx, const _sFrameStats *psFrameStats)
+{
+    if (!psBaud || !psUart || !pTx || !psFrameStats)
+    {
+        return false;
+    }
+
+    memset(psBaud, 0, sizeof(_sLinkBaud));
+
+    if (uart_config_get(psUart, &psBaud->sSafeCfg) != 0)
+    {
+        return false;
+    }
+
+    k_msgq_init(&psBaud->sRxQueue, psBaud->cRxQueueBuf, sizeof(_sPacket), LINK_BAUD_RXQ_LEN);
+    psBaud->psUart = psUart;
+    psBaud->eRole = eRole;
+    psBaud->bFlowCtrl = bFlowCtrl;
+    psBaud->pTx = pTx;
+    psBaud->psFrameStats = psFrameStats;
+    psBaud->ucMaxIdx = ARRAY_SIZE(aulBaudRates) - 1;
+    psBaud->bNegotiate = (eRole == LINK_BAUD_MASTER);
+    psBaud->ulDeadline = k_uptime_get_32();
+    psBaud->sStats.ulBaudrate = psBaud->sSafeCfg.baudrate;
+    psBaud->sStats.bFlowCtrl = (psBaud->sSafeCfg.flow_ctrl == UART_CFG_FLOW_CTRL_RTS_CTS);
+
+    return true;
+}
+
+/**
+ * @brief      : Take control packets out of the receive path, call from UART ISR
+ * @param [in] : psPacket - packet decoded from UART
+ * @param [out]: psBaud - negotiation context
+ * @return     : true if the packet was consumed
+*/
+bool LinkBaudRxFromIsr(_sLinkBaud *psBaud, const _sPacket *psPacket)
+{
+    if (psPacket->PacketType != CTRL)
+    {
+        return false;
+    }
+
+    if (psBaud->psUart)
+    {
+        k_msgq_put(&psBaud->sRxQueue, psPacket, K_NO_WAIT);
+    }
+
+    return true;
+}
+
+/**
+ * @brief      : Run negotiation state, call periodically from thread context
+ * @param [in] : None
+ * @param [out]: psBaud - negotiation context
+ * @return     : None
+*/
+void LinkBaudPoll(_sLinkBaud *psBaud)
+{
+    _sPacket sPacket = {0};
+    uint8_t ucKeepAlive = CTRL_KEEPALIVE;
+    uint32_t ulNow = 0;
+
+    if (!psBaud || !psBaud->psUart)
+    {
+        return;
+    }
+
+    CheckLinkHealth(psBaud);
+    ulNow = k_uptime_get_32();
+
+    if (psBaud->eRole == LINK_BAUD_SLAVE)
+    {
+        while (0 == k_msgq_get(&psBaud->sRxQueue, &sPacket, K_NO_WAIT))
+        {
+            if (sPacket.usLen > 0)
+            {
+                SlaveHandleCtrl(psBaud, &sPacket);
+            }
+        }
+
+        //Master never committed, go back to the rate that worked
+        if (psBaud->bTrial && (int32_t)(k_uptime_get_32() - psBaud->ulDeadline) >= 0)
+        {
+            psBaud->bTrial = false;
+            SetRate(psBaud, psBaud->ucGoodIdx);
+        }
+    }
+    else
+    {
+        //Replies outside a handshake carry no information
+        k_msgq_purge(&psBaud->sRxQueue);
+
+        if (psBaud->bSettle)
+        {
+            //Slave trial expired, meet it on the last good rate
+            if ((int32_t)(ulNow - psBaud->ulDeadline) >= 0)
+            {
+                psBaud->bSettle = false;
+                SetRate(psBaud, psBaud->ucGoodIdx);
+            }
+        }
+        else if (psBaud->bNegotiate && (int32_t)(ulNow - psBaud->ulDeadline) >= 0)
+        {
+            LinkBaudNegotiate(psBaud);
+        }
+        else if (psBaud->ucMaxIdx < (ARRAY_SIZE(aulBaudRates) - 1) &&
+                 (int32_t)(ulNow - psBaud->ulCeilingEnd) >= 0)
+        {
+            //A single noisy probe must not cap the link for good
+            psBaud->ucMaxIdx = ARRAY_SIZE(aulBaudRates) - 1;
+            psBaud->bNegotiate = true;
+            psBaud->ulDeadline = ulNow;
+        }
+        else if (psBaud->ucIdx != 0 && !psBaud->bIdle &&
+                 (ulNow - psBaud->ulLastTx) >= LINK_BAUD_KEEPALIVE_MS)
+        {
+            SendCtrl(psBaud, &ucKeepAlive, 1);
+        }
+    }
+}
+
+/**
+ * @brief      : Raise link to the fastest rate both sides handle, master only.
+ *               Blocks for the duration of the probes, the wait for the slave
+ *               to revert after a failed rate is left to LinkBaudPoll.
+ * @param [in] : None
+ * @param [out]: psBaud - negotiation context
+ * @return     : true if the slave took part in the handshake
+*/
+bool LinkBaudNegotiate(_sLinkBaud *psBaud)
+{
+    uint8_t ucNext = 0;
+    bool bRetVal = false;
+
+    if (!psBaud || psBaud->eRole != LINK_BAUD_MASTER || !psBaud->psUart)
+    {
+        return false;
+    }
+
+    psBaud->sStats.ulNegotiations++;
+    psBaud->bNegotiate = false;
+    bRetVal = (psBaud->ucIdx == psBaud->ucMaxIdx);
+
+    for (ucNext = psBaud->ucIdx + 1; ucNext <= psBaud->ucMaxIdx; ucNext++)
+    {
+        if (!RequestRate(psBaud, ucNext))
+        {
+            //Slave not answering, try again later unless it already stepped up
+            psBaud->bNegotiate = !bRetVal;
+            psBaud->ulDeadline = k_uptime_get_32() + LINK_BAUD_RETRY_MS;
+            break;
+        }
+
+        bRetVal = true;
+        SetRate(psBaud, ucNext);
+
+        if (ProbeRate(psBaud) && CommitRate(psBaud, ucNext))
+        {
+            psBaud->ucGoodIdx = ucNext;
+            continue;
+        }
+
+        //Let the slave trial expire, LinkBaudPoll then moves back to the last good rate
+        psBaud->bSettle = true;
+        psBaud->ulDeadline = k_uptime_get_32() + (2 * LINK_BAUD_TRIAL_MS);
+        psBaud->ucMaxIdx = psBaud->ucGoodIdx;
+        psBaud->ulCeilingEnd = k_uptime_get_32() + LINK_BAUD_CEILING_MS;
+        break;
+    }
+
+    psBaud->sStats.bNegotiated = bRetVal;
+    psBaud->ulLastRx = k_uptime_get_32();
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Tell negotiation the link is parked, suspends keepalive and
+ *               silence detection until the link is active again
+ * @param [in] : bIdle - true while the UART is suspended
+ * @param [out]: psBaud - negotiation context
+ * @return     : None
+*/
+void LinkBaudSetIdle(_sLinkBaud *psBaud, bool bIdle)
+{
+    if (psBaud && psBaud->bIdle != bIdle)
+    {
+        psBaud->bIdle = bIdle;
+        psBaud->ulLastRx = k_uptime_get_32();
+        psBaud->ulLastTx = psBaud->ulLastRx;
+    }
+}
+
+/**
+ * @brief      : Get handshake result and error counters
+ * @param [in] : psBaud - negotiation context
+ * @param [out]: None
+ * @return     : statistics of the negotiation
+*/
+const _sLinkBaudStats *LinkBaudGetStats(_sLinkBaud *psBaud)
+{
+    return psBaud ? &psBaud->sStats : NULL;
+}
+
+//EOF
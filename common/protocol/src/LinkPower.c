@@ -0,0 +1,306 @@
+/**
+ * @file    : LinkPower.c
+ * @brief   : Low-power mode of the UART link between 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : LinkPower.h
+*/
+/*******************************************************INCLUDES***************************************************/
+#include <string.h>
+#include <zephyr/pm/device.h>
+#include "LinkPower.h"
+
+/*******************************************************FUNCTION DEFINITION*****************************************/
+
+/**
+ * @brief      : Account time spent in the current state
+ * @param [in] : None
+ * @param [out]: psPower - link power context
+ * @return     : None
+*/
+static void AccountTime(_sLinkPower *psPower)
+{
+    uint32_t ulNow = k_uptime_get_32();
+
+    if (psPower->bSuspended)
+    {
+        psPower->sStats.ulSuspendedMs += ulNow - psPower->ulStateSince;
+    }
+    else
+    {
+        psPower->sStats.ulAwakeMs += ulNow - psPower->ulStateSince;
+    }
+
+    psPower->ulStateSince = ulNow;
+}
+
+/**
+ * @brief      : Resume UART if suspended, call with lock held
+ * @param [in] : None
+ * @param [out]: psPower - link power context
+ * @return     : None
+*/
+static void Resume(_sLinkPower *psPower)
+{
+    if (psPower->bSuspended)
+    {
+        AccountTime(psPower);
+
+        if (pm_device_action_run(psPower->psUart, PM_DEVICE_ACTION_RESUME) == 0)
+        {
+            psPower->bSuspended = false;
+        }
+    }
+
+    psPower->ulLastActivity = k_uptime_get_32();
+}
+
+/**
+ * @brief      : Drive own wake line, call with lock held
+ * @param [in] : bLevel - line level
+ * @param [out]: psPower - link power context
+ * @return     : None
+*/
+static void SetWakeOut(_sLinkPower *psPower, bool bLevel)
+{
+    if (psPower->bWakeOut != bLevel)
+    {
+        gpio_pin_set_dt(&psPower->sWakeOut, bLevel);
+        psPower->bWakeOut = bLevel;
+    }
+}
+
+/**
+ * @brief      : Peer raised its wake line, resume and answer
+ * @param [in] : psWork - work item
+ * @param [out]: None
+ * @return     : None
+*/
+static void WakeWorkHandler(struct k_work *psWork)
+{
+    _sLinkPower *psPower = CONTAINER_OF(psWork, _sLinkPower, sWakeWork);
+
+    k_mutex_lock(&psPower->sLock, K_FOREVER);
+
+    if (psPower->bSuspended)
+    {
+        psPower->sStats.ulWakeups++;
+    }
+
+    Resume(psPower);
+    SetWakeOut(psPower, true);
+
+    k_mutex_unlock(&psPower->sLock);
+}
+
+/**
+ * @brief      : Interrupt on rising edge of peer wake line
+ * @param [in] : psPort - GPIO port
+ *             : psCb - callback registered
+ *             : ulPins - pins that triggered
+ * @param [out]: None
+ * @return     : None
+*/
+static void WakeInIsr(const struct device *psPort, struct gpio_callback *psCb, uint32_t ulPins)
+{
+    _sLinkPower *psPower = CONTAINER_OF(psCb, _sLinkPower, sWakeInCb);
+
+    k_sem_give(&psPower->sPeerReady);
+    k_work_submit(&psPower->sWakeWork);
+}
+
+/**
+ * @brief      : Initialise low-power link
+ * @param [in] : psUart - UART of the link
+ *             : psWakeOut - wake line driven towards peer
+ *             : psWakeIn - wake line driven by peer
+ * @param [out]: psPower - link power context
+ * @return     : true for success
+*/
+bool LinkPowerInit(_sLinkPower *psPower, const struct device *psUart,
+                   const struct gpio_dt_spec *psWakeOut, const struct gpio_dt_spec *psWakeIn)
+{
+    bool bRetVal = false;
+
+    do
+    {
+        if (!psPower || !psUart || !psWakeOut || !psWakeIn)
+        {
+            break;
+        }
+
+        memset(psPower, 0, sizeof(_sLinkPower));
+        psPower->psUart = psUart;
+        psPower->sWakeOut = *psWakeOut;
+        psPower->sWakeIn = *psWakeIn;
+        k_mutex_init(&psPower->sLock);
+        k_sem_init(&psPower->sPeerReady, 0, 1);
+        k_work_init(&psPower->sWakeWork, WakeWorkHandler);
+
+        if (!gpio_is_ready_dt(&psPower->sWakeOut) || !gpio_is_ready_dt(&psPower->sWakeIn))
+        {
+            printk("ERR: Link wake GPIO not ready\n\r");
+            break;
+        }
+
+        //Start awake so the peer finds a running receiver after boot
+        if (gpio_pin_configure_dt(&psPower->sWakeOut, GPIO_OUTPUT_ACTIVE) != 0 ||
+            gpio_pin_configure_dt(&psPower->sWakeIn, GPIO_INPUT) != 0 ||
+            gpio_pin_interrupt_configure_dt(&psPower->sWakeIn, GPIO_INT_EDGE_TO_ACTIVE) != 0)
+        {
+            printk("ERR: Link wake GPIO config failed\n\r");
+            break;
+        }
+
+        gpio_init_callback(&psPower->sWakeInCb, WakeInIsr, BIT(psPower->sWakeIn.pin));
+
+        if (gpio_add_callback(psPower->sWakeIn.port, &psPower->sWakeInCb) != 0)
+        {
+            break;
+        }
+
+        psPower->bWakeOut = true;
+        psPower->ulLastActivity = k_uptime_get_32();
+        psPower->ulStateSince = psPower->ulLastActivity;
+        bRetVal = true;
+    } while (0);
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Make sure peer receiver runs before transmitting, blocks up to
+ *               LINK_PM_WAKE_TIMEOUT_MS when the peer has to be woken
+ * @param [in] : None
+ * @param [out]: psPower - link power context
+ * @return     : None
+*/
+void LinkPowerTxBegin(_sLinkPower *psPower)
+{
+    bool bWakePeer = false;
+    uint32_t ulStart = 0;
+    uint32_t ulLatencyUs = 0;
+
+    if (!psPower || !psPower->psUart)
+    {
+        return;
+    }
+
+    k_mutex_lock(&psPower->sLock, K_FOREVER);
+
+    Resume(psPower);
+
+    //Peer only sleeps while both lines are low, so raising ours from low
+    //with the peer line low is the only case that needs waiting
+    if (!psPower->bWakeOut && gpio_pin_get_dt(&psPower->sWakeIn) == 0)
+    {
+        bWakePeer = true;
+        k_sem_reset(&psPower->sPeerReady);
+    }
+
+    SetWakeOut(psPower, true);
+
+    k_mutex_unlock(&psPower->sLock);
+
+    if (bWakePeer)
+    {
+        psPower->sStats.ulWakeRequests++;
+        ulStart = k_cycle_get_32();
+
+        if (k_sem_take(&psPower->sPeerReady, K_MSEC(LINK_PM_WAKE_TIMEOUT_MS)) != 0)
+        {
+            psPower->sStats.ulWakeTimeouts++;
+        }
+        else
+        {
+            ulLatencyUs = k_cyc_to_us_floor32(k_cycle_get_32() - ulStart);
+            psPower->ullLatencySumUs += ulLatencyUs;
+            psPower->sStats.ulWakeLatencyLastUs = ulLatencyUs;
+            psPower->sStats.ulWakeLatencyMaxUs = MAX(psPower->sStats.ulWakeLatencyMaxUs, ulLatencyUs);
+            psPower->sStats.ulWakeLatencyAvgUs = (uint32_t)(psPower->ullLatencySumUs /
+                (psPower->sStats.ulWakeRequests - psPower->sStats.ulWakeTimeouts));
+        }
+    }
+}
+
+/**
+ * @brief      : Note traffic on the link, safe to call from ISR
+ * @param [in] : None
+ * @param [out]: psPower - link power context
+ * @return     : None
+*/
+void LinkPowerActivity(_sLinkPower *psPower)
+{
+    if (psPower)
+    {
+        psPower->ulLastActivity = k_uptime_get_32();
+    }
+}
+
+/**
+ * @brief      : Release wake line and suspend UART when idle, call periodically
+ * @param [in] : bBusy - frames still waiting for acknowledgement
+ * @param [out]: psPower - link power context
+ * @return     : None
+*/
+void LinkPowerPoll(_sLinkPower *psPower, bool bBusy)
+{
+    if (!psPower || !psPower->psUart)
+    {
+        return;
+    }
+
+    k_mutex_lock(&psPower->sLock, K_FOREVER);
+
+    if (psPower->bWakeOut && !bBusy &&
+        (k_uptime_get_32() - psPower->ulLastActivity) >= LINK_PM_IDLE_MS)
+    {
+        SetWakeOut(psPower, false);
+    }
+
+    if (!psPower->bWakeOut && !psPower->bSuspended && gpio_pin_get_dt(&psPower->sWakeIn) == 0)
+    {
+        AccountTime(psPower);
+
+        if (pm_device_action_run(psPower->psUart, PM_DEVICE_ACTION_SUSPEND) == 0)
+        {
+            psPower->bSuspended = true;
+            psPower->sStats.ulSuspends++;
+        }
+    }
+
+    k_mutex_unlock(&psPower->sLock);
+}
+
+/**
+ * @brief      : Check if UART of the link is suspended
+ * @param [in] : psPower - link power context
+ * @param [out]: None
+ * @return     : true while suspended
+*/
+bool LinkPowerIsSuspended(_sLinkPower *psPower)
+{
+    return psPower && psPower->bSuspended;
+}
+
+/**
+ * @brief      : Get wake latency and suspended time of the link
+ * @param [in] : psPower - link power context
+ * @param [out]: None
+ * @return     : statistics of the low-power link
+*/
+const _sLinkPowerStats *LinkPowerGetStats(_sLinkPower *psPower)
+{
+    if (!psPower)
+    {
+        return NULL;
+    }
+
+    k_mutex_lock(&psPower->sLock, K_FOREVER);
+    AccountTime(psPower);
+    k_mutex_unlock(&psPower->sLock);
+
+    return &psPower->sStats;
+}
+
+//EOF
@@ -0,0 +1,383 @@
+/**
+ * @file    : LinkReliable.c
+ * @brief   : Reliable delivery over the UART link between 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : LinkReliable.h
+*/
+/*******************************************************INCLUDES***************************************************/
+#include <string.h>
+#include "LinkReliable.h"
+
+/*******************************************************MACROS*****************************************************/
+#define SLOT_OF(seq)            (&psLink->asSlots[(seq) & (LINK_WINDOW_SIZE - 1)])
+#define IN_FLIGHT(psLink)       ((uint8_t)((psLink)->ucTxNext - (psLink)->ucTxBase))
+
+/*******************************************************FUNCTION DEFINITION*****************************************/
+
+/**
+ * @brief      : Update retransmit timeout with a new round trip sample
+ * @param [in] : ulRtt - measured round trip time in ms
+ * @param [out]: psLink - link
+ * @return     : None
+*/
+static void UpdateRto(_sLinkReliable *psLink, uint32_t ulRtt)
+{
+    uint32_t ulDelta = 0;
+
+    if (psLink->ulSrtt == 0)
+    {
+        psLink->ulSrtt = ulRtt;
+        psLink->ulRttVar = ulRtt / 2;
+    }
+    else
+    {
+        ulDelta = (psLink->ulSrtt > ulRtt) ? (psLink->ulSrtt - ulRtt) : (ulRtt - psLink->ulSrtt);
+        psLink->ulRttVar = ((3 * psLink->ulRttVar) + ulDelta) / 4;
+        psLink->ulSrtt = ((7 * psLink->ulSrtt) + ulRtt) / 8;
+    }
+
+    psLink->ulRto = CLAMP(psLink->ulSrtt + (4 * psLink->ulRttVar), LINK_RTO_MIN_MS, LINK_RTO_MAX_MS);
+    psLink->sStats.ulSrttMs = psLink->ulSrtt;
+    psLink->sStats.ulRtoMs = psLink->ulRto;
+}
+
+/**
+ * @brief      : Send cumulative acknowledgement to peer
+ * @param [in] : ucFlags - FRAME_FLAG_SYN to ask the peer to resynchronise
+ * @param [out]: psLink - link
+ * @return     : None
+*/
+static void SendAck(_sLinkReliable *psLink, uint8_t ucFlags)
+{
+    _sPacket sAck = {0};
+
+    sAck.ucStartByte = START_BYTE;
+    sAck.PacketType = ACK;
+    sAck.ucFlags = ucFlags;
+    sAck.ucSeq = psLink->ucRxExpected;
+    sAck.ucEndByte = END_BYTE;
+
+    psLink->pTx(&sAck);
+    psLink->sStats.ulAcksSent++;
+}
+
+/**
+ * @brief      : Release frames covered by a cumulative acknowledgement
+ * @param [in] : ucAck - next sequence expected by peer
+ * @param [out]: psLink - link
+ * @return     : None
+*/
+static void ProcessAck(_sLinkReliable *psLink, uint8_t ucAck)
+{
+    uint8_t ucAcked = (uint8_t)(ucAck - psLink->ucTxBase);
+    _sLinkSlot *psNewest = NULL;
+    uint32_t ulNow = k_uptime_get_32();
+
+    psLink->sStats.ulAcksRcvd++;
+
+    //Stale or duplicate ACK
+    if (ucAcked == 0 || ucAcked > IN_FLIGHT(psLink))
+    {
+        return;
+    }
+
+    //Karn: only frames sent exactly once give a valid sample
+    psNewest = SLOT_OF(ucAck - 1);
+
+    if (psNewest->ucRetries == 0)
+    {
+        UpdateRto(psLink, ulNow - psNewest->ulSentAt);
+    }
+    else if (psLink->ulSrtt)
+    {
+        //Peer is answering again, undo the backoff
+        psLink->ulRto = CLAMP(psLink->ulSrtt + (4 * psLink->ulRttVar), LINK_RTO_MIN_MS, LINK_RTO_MAX_MS);
+        psLink->sStats.ulRtoMs = psLink->ulRto;
+    }
+
+    psLink->ucTxBase = ucAck;
+    psLink->ucTimeouts = 0;
+    psLink->ulTimerStart = ulNow;
+}
+
+/**
+ * @brief      : Go-back-N, resend every frame in flight
+ * @param [in] : ulNow - uptime in ms
+ * @param [out]: psLink - link
+ * @return     : None
+*/
+static void Retransmit(_sLinkReliable *psLink, uint32_t ulNow)
+{
+    _sLinkSlot *psSlot = NULL;
+    uint8_t ucSeq = 0;
+
+    for (ucSeq = psLink->ucTxBase; ucSeq != psLink->ucTxNext; ucSeq++)
+    {
+        psSlot = SLOT_OF(ucSeq);
+        psSlot->ucRetries++;
+        psSlot->ulSentAt = ulNow;
+        psLink->sStats.ulRetransmits++;
+        psLink->pTx(&psSlot->sPacket);
+    }
+
+    psLink->ulTimerStart = ulNow;
+}
+
+/**
+ * @brief      : Peer lost its receive state, restart it at the window base
+ * @param [in] : None
+ * @param [out]: psLink - link
+ * @return     : None
+*/
+static void ProcessResync(_sLinkReliable *psLink)
+{
+    _sLinkSlot *psBase = NULL;
+
+    if (IN_FLIGHT(psLink) == 0)
+    {
+        psLink->bTxSyn = true;
+        return;
+    }
+
+    psBase = SLOT_OF(psLink->ucTxBase);
+
+    //Peer asks once per frame in flight, the retransmit timer covers a lost SYN
+    if (psBase->sPacket.ucFlags & FRAME_FLAG_SYN)
+    {
+        return;
+    }
+
+    psBase->sPacket.ucFlags |= FRAME_FLAG_SYN;
+    Retransmit(psLink, k_uptime_get_32());
+}
+
+/**
+ * @brief      : Initialise reliable link
+ * @param [in] : pTx - function putting a packet on the wire
+ * @param [out]: psLink - link to initialise
+ * @return     : None
+*/
+void LinkInit(_sLinkReliable *psLink, linkTxHandler pTx)
+{
+    if (psLink && pTx)
+    {
+        memset(psLink, 0, sizeof(_sLinkReliable));
+        k_mutex_init(&psLink->sLock);
+        psLink->pTx = pTx;
+        //Start away from 0 so a reboot is unlikely to look like a retransmission
+        psLink->ucTxNext = (uint8_t)k_cycle_get_32();
+        psLink->ucTxBase = psLink->ucTxNext;
+        psLink->bTxSyn = true;
+        psLink->ulRto = LINK_RTO_INIT_MS;
+        psLink->sStats.ulRtoMs = LINK_RTO_INIT_MS;
+    }
+}
+
+/**
+ * @brief      : Queue packet for reliable delivery and transmit it
+ * @param [in] : psPacket - packet to send, sequence is assigned here
+ * @param [out]: psLink - link
+ * @return     : true if queued, false when the window is full
+*/
+bool LinkSend(_sLinkReliable *psLink, _sPacket *psPacket)
+{
+    bool bRetVal = false;
+    _sLinkSlot *psSlot = NULL;
+
+    if (!psLink || !psLink->pTx || !psPacket || psPacket->PacketType == ACK)
+    {
+        return false;
+    }
+
+    k_mutex_lock(&psLink->sLock, K_FOREVER);
+
+    if (IN_FLIGHT(psLink) < LINK_WINDOW_SIZE)
+    {
+        psPacket->ucSeq = psLink->ucTxNext;
+        psPacket->ucFlags = psLink->bTxSyn ? FRAME_FLAG_SYN : 0;
+
+        psSlot = SLOT_OF(psLink->ucTxNext);
+        memcpy(&psSlot->sPacket, psPacket, sizeof(_sPacket));
+        psSlot->ucRetries = 0;
+        psSlot->ulSentAt = k_uptime_get_32();
+
+        if (IN_FLIGHT(psLink) == 0)
+        {
+            psLink->ulTimerStart = psSlot->ulSentAt;
+        }
+
+        psLink->ucTxNext++;
+        psLink->bTxSyn = false;
+        psLink->sStats.ulTxFrames++;
+        psLink->pTx(&psSlot->sPacket);
+        bRetVal = true;
+    }
+
+    k_mutex_unlock(&psLink->sLock);
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Run received packet through the link layer
+ * @param [in] : psPacket - packet received from peer
+ * @param [out]: psLink - link
+ * @return     : true if the packet is new and must be passed to the application
+*/
+bool LinkReceive(_sLinkReliable *psLink, const _sPacket *psPacket)
+{
+    bool bRetVal = false;
+    bool bDuplicate = false;
+
+    if (!psLink || !psPacket)
+    {
+        return false;
+    }
+
+    k_mutex_lock(&psLink->sLock, K_FOREVER);
+
+    if (psPacket->PacketType == ACK)
+    {
+        if (psPacket->ucFlags & FRAME_FLAG_SYN)
+        {
+            ProcessResync(psLink);
+        }
+        else
+        {
+            ProcessAck(psLink, psPacket->ucSeq);
+        }
+    }
+    else
+    {
+        //Within the window just behind the expected sequence, already delivered
+        bDuplicate = psLink->bRxSynced &&
+                     (uint8_t)(psLink->ucRxExpected - psPacket->ucSeq - 1) < LINK_WINDOW_SIZE;
+
+        if ((psPacket->ucFlags & FRAME_FLAG_SYN) &&
+            !(bDuplicate && psPacket->ucSeq == psLink->ucRxSynSeq))
+        {
+            //Peer restarted numbering
+            psLink->ucRxSynSeq = psPacket->ucSeq;
+            psLink->ucRxExpected = psPacket->ucSeq;
+            psLink->bRxSynced = true;
+        }
+        else if (!psLink->bRxSynced)
+        {
+            //We restarted, earlier frames of the peer may be missing. Drop
+            //this one and have the peer restart from its window base.
+            psLink->sStats.ulResyncs++;
+            SendAck(psLink, FRAME_FLAG_SYN);
+            k_mutex_unlock(&psLink->sLock);
+
+            return false;
+        }
+
+        if (psPacket->ucSeq == psLink->ucRxExpected)
+        {
+            psLink->ucRxExpected++;
+            psLink->sStats.ulRxFrames++;
+            bRetVal = true;
+        }
+        else if (bDuplicate)
+        {
+            psLink->sStats.ulDuplicates++;
+        }
+        else
+        {
+            psLink->sStats.ulOutOfOrder++;
+        }
+
+        SendAck(psLink, 0);
+    }
+
+    k_mutex_unlock(&psLink->sLock);
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Retransmit frames whose timeout expired, call periodically
+ * @param [in] : None
+ * @param [out]: psLink - link
+ * @return     : ms until the next retransmission is due, UINT32_MAX when idle
+*/
+uint32_t LinkPoll(_sLinkReliable *psLink)
+{
+    uint32_t ulNow = k_uptime_get_32();
+    uint32_t ulElapsed = 0;
+    uint32_t ulRetVal = UINT32_MAX;
+
+    if (!psLink)
+    {
+        return ulRetVal;
+    }
+
+    k_mutex_lock(&psLink->sLock, K_FOREVER);
+
+    do
+    {
+        if (IN_FLIGHT(psLink) == 0)
+        {
+            break;
+        }
+
+        ulElapsed = ulNow - psLink->ulTimerStart;
+
+        if (ulElapsed < psLink->ulRto)
+        {
+            ulRetVal = psLink->ulRto - ulElapsed;
+            break;
+        }
+
+        if (psLink->ucTimeouts >= LINK_MAX_RETRIES)
+        {
+            //Peer is gone, drop the window and resynchronise with the next frame.
+            //Skip ahead so the peer cannot mistake the SYN for a duplicate.
+            psLink->sStats.ulDropped += IN_FLIGHT(psLink);
+            psLink->ucTxNext += 2 * LINK_WINDOW_SIZE;
+            psLink->ucTxBase = psLink->ucTxNext;
+            psLink->ucTimeouts = 0;
+            psLink->bTxSyn = true;
+            psLink->ulSrtt = 0;
+            psLink->ulRto = LINK_RTO_INIT_MS;
+            psLink->sStats.ulRtoMs = psLink->ulRto;
+            break;
+        }
+
+        Retransmit(psLink, ulNow);
+
+        psLink->ucTimeouts++;
+        psLink->ulRto = MIN(psLink->ulRto * 2, LINK_RTO_MAX_MS);
+        psLink->sStats.ulRtoMs = psLink->ulRto;
+        ulRetVal = psLink->ulRto;
+    } while (0);
+
+    k_mutex_unlock(&psLink->sLock);
+
+    return ulRetVal;
+}
+
+/**
+ * @brief      : Check whether all sent frames are acknowledged
+ * @param [in] : psLink - link
+ * @param [out]: None
+ * @return     : true if nothing is in flight
+*/
+bool LinkIsIdle(_sLinkReliable *psLink)
+{
+    return psLink && IN_FLIGHT(psLink) == 0;
+}
+
+/**
+ * @brief      : Get link statistics
+ * @param [in] : psLink - link
+ * @param [out]: None
+ * @return     : statistics of the link
+*/
+const _sLinkStats *LinkGetStats(_sLinkReliable *psLink)
+{
+    return psLink ? &psLink->sStats : NULL;
+}
+
+//EOF
@@ -0,0 +1,303 @@
+/**
+ * @file    : PacketFrame.c
+ * @brief   : Packet framing for the UART link between 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : PacketFrame.h
+*/
+/*******************************************************INCLUDES***************************************************/
+#include <string.h>
+#include <zephyr/sys/crc.h>
+#include "PacketFrame.h"
+
+/*******************************************************MACROS*****************************************************/
+#define CRC_SEED        0xFFFF
+#define HCS_SEED        0xFF
+
+/*******************************************************FUNCTION DEFINITION*****************************************/
+
+/**
+ * @brief      : Header check sequence of a frame
+ * @param [in] : ucTypeFlags - TYPE byte, ucSeq - sequence, usLen - payload length
+ * @param [out]: None
+ * @return     : HCS byte
+*/
+static uint8_t HeaderCheck(uint8_t ucTypeFlags, uint8_t ucSeq, uint16_t usLen)
+{
+    uint8_t ucHeader[4] = {ucTypeFlags, ucSeq, (uint8_t)(usLen & 0xFF), (uint8_t)(usLen >> 8)};
+
+    return crc8_ccitt(HCS_SEED, ucHeader, sizeof(ucHeader));
+}
+
+/**
+ * @brief      : Build Packet to send
+ * @param [in] : usPayloadLen - Length of the payload
+ *             : PcktType - PacketType
+ *             : pucPayload - Payload to send
+ * @param [out]: psPacket - Packet to build
+ * @return     : returns true on success
+*/
+bool BuildPacket(_sPacket *psPacket,_ePacketType PcktType,
+                uint8_t *pucPayload, uint16_t usPayloadLen)
+{
+    bool bRetVal = false;
+
+    if (psPacket && pucPayload && usPayloadLen <= DATA_SIZE)
+    {
+        psPacket->ucStartByte = START_BYTE;
+        psPacket->PacketType = PcktType;
+        psPacket->ucFlags = 0;
+        psPacket->ucSeq = 0;
+        memcpy(psPacket->pucPayload, pucPayload, usPayloadLen);
+        psPacket->pucPayload[usPayloadLen] = '\0';
+        psPacket->usLen = usPayloadLen;
+        psPacket->ucEndByte = END_BYTE;
+        bRetVal = true;
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Serialize packet into a frame for the UART
+ * @param [in] : psPacket - Packet to send
+ *             : usFrameSize - size of frame buffer
+ * @param [out]: pucFrame - frame to transmit
+ * @return     : length of frame, 0 on failure
+*/
+uint16_t SerializePacket(const _sPacket *psPacket, uint8_t *pucFrame, uint16_t usFrameSize)
+{
+    uint16_t usIdx = 0;
+    uint16_t usCrc = 0;
+
+    if (!psPacket || !pucFrame || psPacket->usLen > DATA_SIZE ||
+        usFrameSize < (FRAME_HEADER_SIZE + psPacket->usLen + FRAME_TRAILER_SIZE))
+    {
+        return 0;
+    }
+
+    pucFrame[usIdx++] = START_BYTE;
+    pucFrame[usIdx++] = (uint8_t)psPacket->PacketType | psPacket->ucFlags;
+    pucFrame[usIdx++] = psPacket->ucSeq;
+    pucFrame[usIdx++] = (uint8_t)(psPacket->usLen & 0xFF);
+    pucFrame[usIdx++] = (uint8_t)(psPacket->usLen >> 8);
+    pucFrame[usIdx] = HeaderCheck(pucFrame[1], pucFrame[2], psPacket->usLen);
+    usIdx++;
+    memcpy(&pucFrame[usIdx], psPacket->pucPayload, psPacket->usLen);
+    usIdx += psPacket->usLen;
+
+    usCrc = crc16_ccitt(CRC_SEED, &pucFrame[1], usIdx - 1);
+    pucFrame[usIdx++] = (uint8_t)(usCrc & 0xFF);
+    pucFrame[usIdx++] = (uint8_t)(usCrc >> 8);
+    pucFrame[usIdx++] = END_BYTE;
+
+    return usIdx;
+}
+
+/**
+ * @brief      : Initialise packet decoder
+ * @param [in] : None
+ * @param [out]: psDecoder - decoder to initialise
+ * @return     : None
+*/
+void PacketDecoderInit(_sPacketDecoder *psDecoder)
+{
+    if (psDecoder)
+    {
+        memset(psDecoder, 0, sizeof(_sPacketDecoder));
+        psDecoder->eState = FRAME_START;
+    }
+}
+
+/**
+ * @brief      : Feed one received byte to the decoder
+ * @param [in] : ucByte - byte received from UART
+ * @param [out]: psDecoder - decoder, holds the packet once complete
+ * @return     : FRAME_COMPLETE once a valid packet is available in
+ *               psDecoder->sPacket, FRAME_ERROR on a corrupted frame
+*/
+_eFrameStatus PacketDecodeByte(_sPacketDecoder *psDecoder, uint8_t ucByte)
+{
+    _eFrameStatus eStatus = FRAME_IN_PROGRESS;
+    _sPacket *psPacket = &psDecoder->sPacket;
+
+    psDecoder->sStats.ulBytes++;
+
+    switch (psDecoder->eState)
+    {
+        case FRAME_START:
+                    if (ucByte == START_BYTE)
+                    {
+                        psDecoder->usIdx = 0;
+                        psDecoder->usCrc = CRC_SEED;
+                        psPacket->ucStartByte = ucByte;
+                        psDecoder->eState = FRAME_TYPE;
+                    }
+                    break;
+
+        case FRAME_TYPE:
+                    if ((ucByte & FRAME_TYPE_MASK) < PACKET_TYPE_MAX)
+                    {
+                        psDecoder->usCrc = crc16_ccitt(psDecoder->usCrc, &ucByte, 1);
+                        psPacket->PacketType = (_ePacketType)(ucByte & FRAME_TYPE_MASK);
+                        psPacket->ucFlags = ucByte & ~FRAME_TYPE_MASK;
+                        psDecoder->eState = FRAME_SEQ;
+                    }
+                    else
+                    {
+                        eStatus = FRAME_ERROR;
+                    }
+                    break;
+
+        case FRAME_SEQ:
+                    psDecoder->usCrc = crc16_ccitt(psDecoder->usCrc, &ucByte, 1);
+                    psPacket->ucSeq = ucByte;
+                    psDecoder->eState = FRAME_LEN_LO;
+                    break;
+
+        case FRAME_LEN_LO:
+                    psDecoder->usCrc = crc16_ccitt(psDecoder->usCrc, &ucByte, 1);
+                    psPacket->usLen = ucByte;
+                    psDecoder->eState = FRAME_LEN_HI;
+                    break;
+
+        case FRAME_LEN_HI:
+                    psDecoder->usCrc = crc16_ccitt(psDecoder->usCrc, &ucByte, 1);
+                    psPacket->usLen |= (uint16_t)ucByte << 8;
+
+                    if (psPacket->usLen > DATA_SIZE)
+                    {
+                        eStatus = FRAME_ERROR;
+                    }
+                    else
+                    {
+                        psDecoder->eState = FRAME_HCS;
+                    }
+                    break;
+
+        case FRAME_HCS:
+                    //Reject a corrupted LEN now rather than after reading LEN bytes
+                    if (ucByte == HeaderCheck((uint8_t)psPacket->PacketType | psPacket->ucFlags,
+                                              psPacket->ucSeq, psPacket->usLen))
+                    {
+                        psDecoder->usCrc = crc16_ccitt(psDecoder->usCrc, &ucByte, 1);
+                        psDecoder->eState = psPacket->usLen ? FRAME_PAYLOAD : FRAME_CRC_LO;
+                    }
+                    else
+                    {
+                        eStatus = FRAME_ERROR;
+                    }
+                    break;
+
+        case FRAME_PAYLOAD:
+                    psDecoder->usCrc = crc16_ccitt(psDecoder->usCrc, &ucByte, 1);
+                    psPacket->pucPayload[psDecoder->usIdx++] = ucByte;
+
+                    if (psDecoder->usIdx >= psPacket->usLen)
+                    {
+                        psDecoder->eState = FRAME_CRC_LO;
+                    }
+                    break;
+
+        case FRAME_CRC_LO:
+                    psDecoder->usCrc ^= ucByte;
+                    psDecoder->eState = FRAME_CRC_HI;
+                    break;
+
+        case FRAME_CRC_HI:
+                    psDecoder->usCrc ^= (uint16_t)ucByte << 8;
+
+                    if (psDecoder->usCrc == 0)
+                    {
+                        psDecoder->eState = FRAME_END;
+                    }
+                    else
+                    {
+                        psDecoder->sStats.ulCrcErrors++;
+                        psDecoder->eState = FRAME_START;
+                        return FRAME_ERROR;
+                    }
+                    break;
+
+        case FRAME_END:
+                    if (ucByte == END_BYTE)
+                    {
+                        psPacket->pucPayload[psPacket->usLen] = '\0';
+                        psPacket->ucEndByte = ucByte;
+                        psDecoder->sStats.ulFrames++;
+                        psDecoder->eState = FRAME_START;
+                        eStatus = FRAME_COMPLETE;
+                    }
+                    else
+                    {
+                        eStatus = FRAME_ERROR;
+                    }
+                    break;
+
+        default:
+                    eStatus = FRAME_ERROR;
+                    break;
+    }
+
+    if (eStatus == FRAME_ERROR)
+    {
+        psDecoder->sStats.ulFramingErrors++;
+        //Resynchronise, the byte may itself be the start of the next frame
+        psDecoder->eState = FRAME_START;
+
+        if (ucByte == START_BYTE)
+        {
+            psDecoder->usIdx = 0;
+            psDecoder->usCrc = CRC_SEED;
+            psPacket->ucStartByte = ucByte;
+            psDecoder->eState = FRAME_TYPE;
+        }
+    }
+
+    return eStatus;
+}
+
+/**
+ * @brief      : Route a received packet to the application handlers
+ * @param [in] : psHandlers - handlers of the application
+ * @param [out]: psPacket - Packet received
+ * @return     : true for success
+*/
+bool PacketDispatch(_sPacket *psPacket, const _sPacketHandlers *psHandlers)
+{
+    bool bRetVal = false;
+
+    if (psPacket && psHandlers)
+    {
+        switch (psPacket->PacketType)
+        {
+            case CMD : if (psHandlers->pCmdHandlers)
+                       {
+                           bRetVal = CmdDispatch(psPacket->pucPayload, psPacket->usLen,
+                                                 psHandlers->pCmdHandlers);
+                       }
+                    break;
+            case RESP: if (psHandlers->RespHdlr)
+                       {
+                           bRetVal = psHandlers->RespHdlr((char *)psPacket->pucPayload);
+                       }
+                    break;
+            case DATA: if (psHandlers->DataHdlr)
+                       {
+                           bRetVal = psHandlers->DataHdlr(psPacket->pucPayload, psPacket->usLen);
+                       }
+                    break;
+            case ACK:  if (psHandlers->AckHdlr)
+                       {
+                           bRetVal = psHandlers->AckHdlr(psPacket->pucPayload, psPacket->usLen);
+                       }
+                    break;
+            default  :
+                    break;
+        }
+    }
+
+    return bRetVal;
+}
+
+//EOF
@@ -0,0 +1,339 @@
+/**
+ * @file    : PerfStats.c
+ * @brief   : Lightweight runtime counters, high-water marks and histograms
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : PerfStats.h
+*/
+/*******************************************************INCLUDES***************************************************/
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include "PerfStats.h"
+#if defined(CONFIG_PETTAP_PERF_THREADS)
+#include "ThreadProfile.h"
+#endif
+
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+/*******************************************************MACROS*****************************************************/
+
+/*******************************************************PRIVATE VARIABLES******************************************/
+static struct k_spinlock sPerfLock;
+static uint32_t ulResetAt = 0;
+
+/*******************************************************FUNCTION DEFINITION*****************************************/
+
+/**
+ * @brief      : Update a gauge and its high-water mark
+ * @param [in] : ulValue - current value
+ * @param [out]: psGauge - gauge
+ * @return     : None
+*/
+void PerfGaugeSet(_sPerfGauge *psGauge, uint32_t ulValue)
+{
+    k_spinlock_key_t sKey = k_spin_lock(&sPerfLock);
+
+    psGauge->ulValue = ulValue;
+    psGauge->ulMax = MAX(psGauge->ulMax, ulValue);
+
+    k_spin_unlock(&sPerfLock, sKey);
+}
+
+/**
+ * @brief      : Add a sample to a histogram
+ * @param [in] : ulValue - sample
+ * @param [out]: psHist - histogram
+ * @return     : None
+*/
+void PerfHistRecord(_sPerfHist *psHist, uint32_t ulValue)
+{
+    //Number of significant bits selects the bucket
+    uint8_t ucBucket = MIN(ulValue ? 32 - __builtin_clz(ulValue) : 0, PERF_HIST_BUCKETS - 1);
+    k_spinlock_key_t sKey = k_spin_lock(&sPerfLock);
+
+    psHist->ulMin = psHist->ulCount ? MIN(psHist->ulMin, ulValue) : ulValue;
+    psHist->ulMax = MAX(psHist->ulMax, ulValue);
+    psHist->ullSum += ulValue;
+    psHist->ulCount++;
+    psHist->aulBuckets[ucBucket]++;
+
+    k_spin_unlock(&sPerfLock, sKey);
+}
+
+/**
+ * @brief      : Estimate a percentile, upper bound of the bucket it falls in
+ * @param [in] : psHist - histogram
+ *               ucPct - percentile, 1 to 100
+ * @param [out]: None
+ * @return     : value, never above the largest sample
+*/
+uint32_t PerfHistPercentile(const _sPerfHist *psHist, uint8_t ucPct)
+{
+    uint32_t ulRank = ((uint64_t)psHist->ulCount * ucPct + 99) / 100;
+    uint32_t ulSeen = 0;
+
+    for (uint8_t ucBucket = 0; ucBucket < PERF_HIST_BUCKETS; ucBucket++)
+    {
+        ulSeen += psHist->aulBuckets[ucBucket];
+
+        if (ulSeen >= ulRank && ulSeen)
+        {
+            return (ucBucket < PERF_HIST_BUCKETS - 1) ?
+                   MIN((1u << ucBucket) - 1, psHist->ulMax) : psHist->ulMax;
+        }
+    }
+
+    return psHist->ulMax;
+}
+
+/**
+ * @brief      : Time covered by the metrics
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : seconds since boot or last reset
+*/
+uint32_t PerfSecondsSinceReset(void)
+{
+    return (k_uptime_get_32() - ulResetAt) / MSEC_PER_SEC;
+}
+
+/**
+ * @brief      : Clear all metrics
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : None
+*/
+void PerfReset(void)
+{
+    k_spinlock_key_t sKey;
+
+#if defined(CONFIG_PETTAP_PERF_THREADS)
+    ThreadProfReset();
+#endif
+
+    sKey = k_spin_lock(&sPerfLock);
+
+    STRUCT_SECTION_FOREACH(__sPerfCounter, psCounter)
+    {
+        atomic_clear(&psCounter->nValue);
+    }
+
+    STRUCT_SECTION_FOREACH(__sPerfGauge, psGauge)
+    {
+        psGauge->ulMax = psGauge->ulValue;
+    }
+
+    STRUCT_SECTION_FOREACH(__sPerfHist, psHist)
+    {
+        const char *pcName = psHist->pcName;
+        const char *pcUnit = psHist->pcUnit;
+
+        memset(psHist, 0, sizeof(*psHist));
+        psHist->pcName = pcName;
+        psHist->pcUnit = pcUnit;
+    }
+
+    ulResetAt = k_uptime_get_32();
+
+    k_spin_unlock(&sPerfLock, sKey);
+}
+
+/**
+ * @brief      : Append formatted text, tracks overflow
+ * @param [in] : pcFmt - format
+ * @param [out]: pcBuf - buffer
+ *               pulOff - write offset, set past the end on overflow
+ *               ulSize - buffer size
+ * @return     : None
+*/
+static void JsonAppend(char *pcBuf, size_t *pulOff, size_t ulSize, const char *pcFmt, ...)
+{
+    va_list sArgs;
+    int nLen = 0;
+
+    if (*pulOff >= ulSize)
+    {
+        return;
+    }
+
+    va_start(sArgs, pcFmt);
+    nLen = vsnprintf(pcBuf + *pulOff, ulSize - *pulOff, pcFmt, sArgs);
+    va_end(sArgs);
+
+    *pulOff = (nLen < 0) ? ulSize : *pulOff + nLen;
+}
+
+/**
+ * @brief      : Serialize all metrics for the diagnostic topic
+ *               {"s":secs,"c":{name:n},"g":{name:[cur,max]},
+ *                "h":{name:[count,avg,p50,p90,max]},
+ *                "t":{name:[cpu,peak cpu,stack used,stack size]}}
+ *               "t" only with CONFIG_PETTAP_PERF_THREADS, CPU in permille
+ * @param [in] : ulSize - buffer size
+ * @param [out]: pcBuf - JSON text
+ * @return     : length, -ENOMEM if the buffer is too small
+*/
+int PerfToJson(char *pcBuf, size_t ulSize)
+{
+    size_t ulOff = 0;
+    bool bFirst = true;
+#if defined(CONFIG_PETTAP_PERF_THREADS)
+    int nLen = 0;
+#endif
+
+    JsonAppend(pcBuf, &ulOff, ulSize, "{\"s\":%u,\"c\":{", PerfSecondsSinceReset());
+
+    STRUCT_SECTION_FOREACH(__sPerfCounter, psCounter)
+    {
+        JsonAppend(pcBuf, &ulOff, ulSize, "%s\"%s\":%u", bFirst ? "" : ",", psCounter->pcName,
+                   (uint32_t)atomic_get(&psCounter->nValue));
+        bFirst = false;
+    }
+
+    JsonAppend(pcBuf, &ulOff, ulSize, "},\"g\":{");
+    bFirst = true;
+
+    STRUCT_SECTION_FOREACH(__sPerfGauge, psGauge)
+    {
+        JsonAppend(pcBuf, &ulOff, ulSize, "%s\"%s\":[%u,%u]", bFirst ? "" : ",",
+                   psGauge->pcName, psGauge->ulValue, psGauge->ulMax);
+        bFirst = false;
+    }
+
+    JsonAppend(pcBuf, &ulOff, ulSize, "},\"h\":{");
+    bFirst = true;
+
+    STRUCT_SECTION_FOREACH(__sPerfHist, psHist)
+    {
+        JsonAppend(pcBuf, &ulOff, ulSize, "%s\"%s\":[%u,%u,%u,%u,%u]", bFirst ? "" : ",",
+                   psHist->pcName, psHist->ulCount,
+                   psHist->ulCount ? (uint32_t)(psHist->ullSum / psHist->ulCount) : 0,
+                   PerfHistPercentile(psHist, 50), PerfHistPercentile(psHist, 90),
+                   psHist->ulMax);
+        bFirst = false;
+    }
+
+#if defined(CONFIG_PETTAP_PERF_THREADS)
+    JsonAppend(pcBuf, &ulOff, ulSize, "},\"t\":{");
+
+    if (ulOff < ulSize)
+    {
+        nLen = ThreadProfToJson(pcBuf + ulOff, ulSize - ulOff);
+        ulOff = (nLen < 0) ? ulSize : ulOff + nLen;
+    }
+#endif
+
+    JsonAppend(pcBuf, &ulOff, ulSize, "}}");
+
+    return (ulOff < ulSize) ? (int)ulOff : -ENOMEM;
+}
+
+#if defined(CONFIG_SHELL)
+/**
+ * @brief      : stats, print all metrics
+*/
+static int CmdStatsShow(const struct shell *psShell, size_t argc, char **argv)
+{
+    uint32_t ulSecs = MAX(PerfSecondsSinceReset(), 1);
+    uint32_t ulValue = 0;
+
+    shell_print(psShell, "Counters over %u s", ulSecs);
+
+    STRUCT_SECTION_FOREACH(__sPerfCounter, psCounter)
+    {
+        ulValue = (uint32_t)atomic_get(&psCounter->nValue);
+        shell_print(psShell, "  %-22s %10u  %8u/s", psCounter->pcName, ulValue, ulValue / ulSecs);
+    }
+
+    shell_print(psShell, "High-water marks");
+
+    STRUCT_SECTION_FOREACH(__sPerfGauge, psGauge)
+    {
+        shell_print(psShell, "  %-22s now %6u  max %6u", psGauge->pcName, psGauge->ulValue,
+                    psGauge->ulMax);
+    }
+
+    shell_print(psShell, "Histograms");
+
+    STRUCT_SECTION_FOREACH(__sPerfHist, psHist)
+    {
+        shell_print(psShell, "  %-22s n %6u  min %8u  avg %8u  p50 %8u  p90 %8u  p99 %8u  max %8u %s",
+                    psHist->pcName, psHist->ulCount, psHist->ulCount ? psHist->ulMin : 0,
+                    psHist->ulCount ? (uint32_t)(psHist->ullSum / psHist->ulCount) : 0,
+                    PerfHistPercentile(psHist, 50), PerfHistPercentile(psHist, 90),
+                    PerfHistPercentile(psHist, 99), psHist->ulMax, psHist->pcUnit);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      : stats reset, clear all metrics
+*/
+static int CmdStatsReset(const struct shell *psShell, size_t argc, char **argv)
+{
+    PerfReset();
+    shell_print(psShell, "Statistics cleared");
+
+    return 0;
+}
+
+#if defined(CONFIG_PETTAP_PERF_THREADS)
+/**
+ * @brief      : stats threads, CPU share and stack usage per thread
+*/
+static int CmdStatsThreads(const struct shell *psShell, size_t argc, char **argv)
+{
+    static _sThreadProf sThreads[CONFIG_PETTAP_PERF_THREADS_MAX];
+    uint8_t ucCount = ThreadProfGet(sThreads, ARRAY_SIZE(sThreads));
+
+    shell_print(psShell, "  %-16s %7s %7s %13s", "Thread", "CPU %", "Peak %", "Stack");
+
+    for (uint8_t ucIdx = 0; ucIdx < ucCount; ucIdx++)
+    {
+        shell_print(psShell, "  %-16s %5u.%u %5u.%u %6u/%-6u%s", sThreads[ucIdx].cName,
+                    sThreads[ucIdx].usCpuPermille / 10, sThreads[ucIdx].usCpuPermille % 10,
+                    sThreads[ucIdx].usCpuPeakPermille / 10, sThreads[ucIdx].usCpuPeakPermille % 10,
+                    sThreads[ucIdx].ulStackUsed, sThreads[ucIdx].ulStackSize,
+                    THREAD_PROF_STACK_HIGH(&sThreads[ucIdx]) ? " !" : "");
+    }
+
+    return 0;
+}
+#endif
+
+/**
+ * @brief      : stats json, print the diagnostic payload
+*/
+static int CmdStatsJson(const struct shell *psShell, size_t argc, char **argv)
+{
+    static char cJson[CONFIG_PETTAP_PERF_JSON_SIZE];
+
+    if (PerfToJson(cJson, sizeof(cJson)) < 0)
+    {
+        shell_error(psShell, "Statistics do not fit in %d bytes", CONFIG_PETTAP_PERF_JSON_SIZE);
+        return -ENOMEM;
+    }
+
+    shell_print(psShell, "%s", cJson);
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sStatsCmds,
+    SHELL_CMD(reset, NULL, "Clear all statistics", CmdStatsReset),
+    SHELL_CMD(json, NULL, "Print statistics as published", CmdStatsJson),
+#if defined(CONFIG_PETTAP_PERF_THREADS)
+    SHELL_CMD(threads, NULL, "CPU share and stack usage per thread", CmdStatsThreads),
+#endif
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(stats, &sStatsCmds, "Runtime statistics", CmdStatsShow);
+#endif
+
+//EOF
@@ -0,0 +1,282 @@
+/**
+ * @file    : ThreadProfile.c
+ * @brief   : Periodic sampling of thread CPU share and stack usage
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : ThreadProfile.h
+*/
+/*******************************************************INCLUDES***************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "ThreadProfile.h"
+
+/*******************************************************MACROS*****************************************************/
+#define THREAD_PROF_PERIOD      K_SECONDS(CONFIG_PETTAP_PERF_THREADS_PERIOD)
+
+/*******************************************************PRIVATE VARIABLES******************************************/
+static _sThreadProf sThreads[CONFIG_PETTAP_PERF_THREADS_MAX] = {0};
+/*Threads that did not fit in the table during the last sample*/
+static uint8_t ucUntracked = 0;
+static uint32_t ulLastSampleAt = 0;
+static uint32_t ulWindowCycles = 0;
+
+K_MUTEX_DEFINE(ThreadProfLock);
+
+/*******************************************************FUNCTION DEFINITION*****************************************/
+static void ThreadProfWorkFn(struct k_work *psWork);
+
+K_WORK_DELAYABLE_DEFINE(ThreadProfWork, ThreadProfWorkFn);
+
+/**
+ * @brief      : Find the entry of a thread, or a free one
+ * @param [in] : psThread - thread
+ * @param [out]: None
+ * @return     : entry, NULL if the table is full
+*/
+static _sThreadProf *FindEntry(const struct k_thread *psThread)
+{
+    _sThreadProf *psFree = NULL;
+
+    for (uint8_t ucIdx = 0; ucIdx < CONFIG_PETTAP_PERF_THREADS_MAX; ucIdx++)
+    {
+        if (sThreads[ucIdx].psThread == psThread)
+        {
+            return &sThreads[ucIdx];
+        }
+
+        if (!sThreads[ucIdx].psThread && !psFree)
+        {
+            psFree = &sThreads[ucIdx];
+        }
+    }
+
+    return psFree;
+}
+
+/**
+ * @brief      : Sample one thread, called for each thread by the kernel
+ * @param [in] : psThread - thread
+ *               pvUser - unused
+ * @param [out]: None
+ * @return     : None
+*/
+static void SampleThread(const struct k_thread *psThread, void *pvUser)
+{
+    _sThreadProf *psEntry = FindEntry(psThread);
+    k_thread_runtime_stats_t sStats = {0};
+    const char *pcName = NULL;
+    size_t ulUnused = 0;
+    uint64_t ullDelta = 0;
+    bool bNew = false;
+
+    ARG_UNUSED(pvUser);
+
+    if (!psEntry)
+    {
+        ucUntracked++;
+        return;
+    }
+
+    if (!psEntry->psThread)
+    {
+        bNew = true;
+        memset(psEntry, 0, sizeof(*psEntry));
+        psEntry->psThread = psThread;
+        pcName = k_thread_name_get((k_tid_t)psThread);
+
+        if (pcName && pcName[0])
+        {
+            strncpy(psEntry->cName, pcName, sizeof(psEntry->cName) - 1);
+        }
+        else
+        {
+            snprintf(psEntry->cName, sizeof(psEntry->cName), "%p", (void *)psThread);
+        }
+    }
+
+    psEntry->bSeen = true;
+
+    if (k_thread_runtime_stats_get((k_tid_t)psThread, &sStats) == 0)
+    {
+        //First sample only sets the baseline
+        if (!bNew && ulWindowCycles)
+        {
+            ullDelta = sStats.execution_cycles - psEntry->ullCycles;
+            psEntry->usCpuPermille = (uint16_t)MIN((ullDelta * 1000) / ulWindowCycles, 1000);
+            psEntry->usCpuPeakPermille = MAX(psEntry->usCpuPeakPermille, psEntry->usCpuPermille);
+        }
+
+        psEntry->ullCycles = sStats.execution_cycles;
+    }
+
+    psEntry->ulStackSize = psThread->stack_info.size;
+
+    if (k_thread_stack_space_get(psThread, &ulUnused) == 0)
+    {
+        psEntry->ulStackUsed = MAX(psEntry->ulStackUsed, psEntry->ulStackSize - ulUnused);
+    }
+
+    if (THREAD_PROF_STACK_HIGH(psEntry) && !psEntry->bStackHighReported)
+    {
+        psEntry->bStackHighReported = true;
+        printk("WARN: %s stack %u of %u bytes used\n\r", psEntry->cName, psEntry->ulStackUsed,
+               psEntry->ulStackSize);
+    }
+}
+
+/**
+ * @brief      : Sample all threads, drop the ones that have exited
+ * @param [in] : psWork - work item
+ * @param [out]: None
+ * @return     : None
+*/
+static void ThreadProfWorkFn(struct k_work *psWork)
+{
+    uint32_t ulNow = k_cycle_get_32();
+
+    k_mutex_lock(&ThreadProfLock, K_FOREVER);
+
+    ulWindowCycles = ulLastSampleAt ? ulNow - ulLastSampleAt : 0;
+    ulLastSampleAt = ulNow;
+    ucUntracked = 0;
+
+    for (uint8_t ucIdx = 0; ucIdx < CONFIG_PETTAP_PERF_THREADS_MAX; ucIdx++)
+    {
+        sThreads[ucIdx].bSeen = false;
+    }
+
+    k_thread_foreach_unlocked(SampleThread, NULL);
+
+    for (uint8_t ucIdx = 0; ucIdx < CONFIG_PETTAP_PERF_THREADS_MAX; ucIdx++)
+    {
+        if (sThreads[ucIdx].psThread && !sThreads[ucIdx].bSeen)
+        {
+            memset(&sThreads[ucIdx], 0, sizeof(sThreads[ucIdx]));
+        }
+    }
+
+    k_mutex_unlock(&ThreadProfLock);
+
+    if (ucUntracked)
+    {
+        printk("ERR: %u threads not profiled, raise CONFIG_PETTAP_PERF_THREADS_MAX\n\r", ucUntracked);
+    }
+
+    k_work_schedule(&ThreadProfWork, THREAD_PROF_PERIOD);
+}
+
+/**
+ * @brief      : Start periodic sampling on the system work queue
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : None
+*/
+void ThreadProfInit(void)
+{
+    k_work_schedule(&ThreadProfWork, K_NO_WAIT);
+}
+
+/**
+ * @brief      : Copy the profiled threads, highest CPU share first
+ * @param [in] : ucMax - entries in psOut
+ * @param [out]: psOut - threads
+ * @return     : number of entries copied
+*/
+uint8_t ThreadProfGet(_sThreadProf *psOut, uint8_t ucMax)
+{
+    _sThreadProf sTmp;
+    uint8_t ucCount = 0;
+    uint8_t ucPos = 0;
+
+    k_mutex_lock(&ThreadProfLock, K_FOREVER);
+
+    for (uint8_t ucIdx = 0; ucIdx < CONFIG_PETTAP_PERF_THREADS_MAX; ucIdx++)
+    {
+        if (!sThreads[ucIdx].psThread)
+        {
+            continue;
+        }
+
+        //Insertion keeps psOut sorted, the lowest share falls off the end
+        sTmp = sThreads[ucIdx];
+        ucPos = ucCount;
+
+        while (ucPos > 0 && psOut[ucPos - 1].usCpuPermille < sTmp.usCpuPermille)
+        {
+            if (ucPos < ucMax)
+            {
+                psOut[ucPos] = psOut[ucPos - 1];
+            }
+            ucPos--;
+        }
+
+        if (ucPos < ucMax)
+        {
+            psOut[ucPos] = sTmp;
+            ucCount = MIN(ucCount + 1, ucMax);
+        }
+    }
+
+    k_mutex_unlock(&ThreadProfLock);
+
+    return ucCount;
+}
+
+/**
+ * @brief      : Serialize the top CPU consumers for the diagnostic topic,
+ *               name:[cpu permille,peak permille,stack used,stack size]
+ * @param [in] : ulSize - buffer size
+ * @param [out]: pcBuf - JSON members, without braces
+ * @return     : length, -ENOMEM if the buffer is too small
+*/
+int ThreadProfToJson(char *pcBuf, size_t ulSize)
+{
+    _sThreadProf sTop[CONFIG_PETTAP_PERF_THREADS_TOP];
+    uint8_t ucCount = ThreadProfGet(sTop, ARRAY_SIZE(sTop));
+    size_t ulOff = 0;
+    int nLen = 0;
+
+    if (ulSize)
+    {
+        pcBuf[0] = '\0';
+    }
+
+    for (uint8_t ucIdx = 0; ucIdx < ucCount; ucIdx++)
+    {
+        nLen = snprintf(pcBuf + ulOff, ulSize - ulOff, "%s\"%s\":[%u,%u,%u,%u]",
+                        ucIdx ? "," : "", sTop[ucIdx].cName, sTop[ucIdx].usCpuPermille,
+                        sTop[ucIdx].usCpuPeakPermille, sTop[ucIdx].ulStackUsed,
+                        sTop[ucIdx].ulStackSize);
+
+        if (nLen < 0 || (size_t)nLen >= ulSize - ulOff)
+        {
+            return -ENOMEM;
+        }
+
+        ulOff += nLen;
+    }
+
+    return (int)ulOff;
+}
+
+/**
+ * @brief      : Clear peak CPU share. Stack high-water marks come from the
+ *               stack fill pattern and cannot be cleared.
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : None
+*/
+void ThreadProfReset(void)
+{
+    k_mutex_lock(&ThreadProfLock, K_FOREVER);
+
+    for (uint8_t ucIdx = 0; ucIdx < CONFIG_PETTAP_PERF_THREADS_MAX; ucIdx++)
+    {
+        sThreads[ucIdx].usCpuPeakPermille = sThreads[ucIdx].usCpuPermille;
+    }
+
+    k_mutex_unlock(&ThreadProfLock);
+}
+
+//EOF
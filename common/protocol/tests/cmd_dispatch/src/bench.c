@@ -0,0 +1,123 @@
+/**
+ * @file    : bench.c
+ * @brief   : Dispatch benchmark, table lookup against the old strcmp chain
+ * @author  : Adhil
+ * @date    : 19-10-2026
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+#include "CmdDispatch.h"
+#include "BenchClock.h"
+
+/*******************************************MACROS**********************************************************/
+#define BENCH_ROUNDS        100000
+
+/******************************************GLOBALS VARIABLES**********************************************/
+static volatile uint32_t ulSink = 0;
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+static void CountHandler(const _sCmd *psCmd)
+{
+    ulSink += psCmd->eId;
+}
+
+static const cmdExecHandler pHandlers[CMD_OPCODE_MAX] = {
+    [CMD_CONNECT]       = CountHandler,
+    [CMD_DISCONNECT]    = CountHandler,
+    [CMD_LOCATION]      = CountHandler,
+    [CMD_WIFI_CRED]     = CountHandler,
+    [CMD_WIFI_FORGET]   = CountHandler,
+    [CMD_POWER_MODE]    = CountHandler,
+};
+
+/*Lookup as done by ProcessCmd before the command table*/
+static void LegacyDispatch(const char *pcCmd)
+{
+    char cSSID[20] = {0};
+    char cPassword[50] = {0};
+
+    if (strcmp(pcCmd, "CONNECT") == 0)
+    {
+        ulSink += CMD_CONNECT;
+    }
+    else if (strcmp(pcCmd, "DISCONNECT") == 0)
+    {
+        ulSink += CMD_DISCONNECT;
+    }
+    else if (strcmp(pcCmd, "LOCATION") == 0)
+    {
+        ulSink += CMD_LOCATION;
+    }
+    else if (strcmp(pcCmd, "POWER_MODE:1") == 0)
+    {
+        ulSink += CMD_POWER_MODE;
+    }
+    else if (strstr(pcCmd, "ssid") &&
+             sscanf(pcCmd, "ssid:%19[^,],pwd:%49s", cSSID, cPassword) == 2)
+    {
+        ulSink += CMD_WIFI_CRED;
+    }
+}
+
+static void Report(const char *pcName, uint64_t ullStart, uint32_t ulOps)
+{
+    uint64_t ullNs = BenchNowNs() - ullStart;
+
+    TC_PRINT("%-8s %u dispatches in %u us, %u ns each\n", pcName, ulOps,
+             (uint32_t)(ullNs / NSEC_PER_USEC), (uint32_t)(ullNs / ulOps));
+}
+
+ZTEST(cmd_dispatch_bench, test_bench)
+{
+    static const char *const pcText[] = {
+        "CONNECT", "DISCONNECT", "LOCATION", "POWER_MODE:1", "ssid:home,pwd:secret"
+    };
+    uint8_t aucBinary[ARRAY_SIZE(pcText)][48];
+    uint16_t ausBinaryLen[ARRAY_SIZE(pcText)];
+    uint16_t ausTextLen[ARRAY_SIZE(pcText)];
+    _sCmd sCmd;
+    uint64_t ullStart = 0;
+    uint32_t ulIdx = 0;
+    uint32_t ulRound = 0;
+    uint32_t ulMissed = 0;
+
+    for (ulIdx = 0; ulIdx < ARRAY_SIZE(pcText); ulIdx++)
+    {
+        ausTextLen[ulIdx] = strlen(pcText[ulIdx]);
+        zassert_true(CmdDecode((const uint8_t *)pcText[ulIdx], ausTextLen[ulIdx], &sCmd));
+        ausBinaryLen[ulIdx] = CmdEncode(&sCmd, aucBinary[ulIdx], sizeof(aucBinary[ulIdx]));
+        zassert_true(ausBinaryLen[ulIdx] > 0);
+    }
+
+    ullStart = BenchNowNs();
+    for (ulRound = 0; ulRound < BENCH_ROUNDS; ulRound++)
+    {
+        ulIdx = ulRound % ARRAY_SIZE(pcText);
+        ulMissed += !CmdDispatch(aucBinary[ulIdx], ausBinaryLen[ulIdx], pHandlers);
+    }
+    Report("binary", ullStart, BENCH_ROUNDS);
+
+    ullStart = BenchNowNs();
+    for (ulRound = 0; ulRound < BENCH_ROUNDS; ulRound++)
+    {
+        ulIdx = ulRound % ARRAY_SIZE(pcText);
+        ulMissed += !CmdDispatch((const uint8_t *)pcText[ulIdx], ausTextLen[ulIdx], pHandlers);
+    }
+    Report("text", ullStart, BENCH_ROUNDS);
+
+    ullStart = BenchNowNs();
+    for (ulRound = 0; ulRound < BENCH_ROUNDS; ulRound++)
+    {
+        LegacyDispatch(pcText[ulRound % ARRAY_SIZE(pcText)]);
+    }
+    Report("strcmp", ullStart, BENCH_ROUNDS);
+
+    zassert_equal(ulMissed, 0, "Command not dispatched");
+}
+
+ZTEST_SUITE(cmd_dispatch_bench, NULL, NULL, NULL, NULL, NULL);
+
+//EOF
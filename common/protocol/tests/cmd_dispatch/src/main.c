@@ -0,0 +1,173 @@
+/**
+ * @file    : main.c
+ * @brief   : Unit tests of the command table and dispatcher
+ * @author  : Adhil
+ * @date    : 19-10-2026
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <string.h>
+#include <zephyr/ztest.h>
+#include "CmdDispatch.h"
+
+/******************************************GLOBALS VARIABLES**********************************************/
+static _sCmd sLastCmd;
+static uint32_t ulCalls = 0;
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+static void RecordHandler(const _sCmd *psCmd)
+{
+    memcpy(&sLastCmd, psCmd, sizeof(_sCmd));
+    ulCalls++;
+}
+
+static const cmdExecHandler pHandlers[CMD_OPCODE_MAX] = {
+    [CMD_CONNECT]       = RecordHandler,
+    [CMD_WIFI_CRED]     = RecordHandler,
+    [CMD_WIFI_FORGET]   = RecordHandler,
+    [CMD_POWER_MODE]    = RecordHandler,
+};
+
+static void Before(void *pvFixture)
+{
+    ARG_UNUSED(pvFixture);
+
+    memset(&sLastCmd, 0, sizeof(sLastCmd));
+    ulCalls = 0;
+}
+
+static bool DecodeText(const char *pcText, _sCmd *psCmd)
+{
+    return CmdDecode((const uint8_t *)pcText, strlen(pcText), psCmd);
+}
+
+/*The hash is computed from the Key column, a typo there breaks text lookup*/
+#define CHECK_ROW(Id, Opcode, Text, Key, ArgType)                                   \
+    zassert_equal(Text[0], Key, "Key of " #Id " is not the first char of " Text);  \
+    zassert_equal(strcmp(CmdGetName(Id), Text), 0);
+
+ZTEST(cmd_dispatch, test_table_rows)
+{
+    PETTAP_CMD_TABLE(CHECK_ROW)
+}
+
+#define CHECK_KEYWORD(Id, Opcode, Text, Key, ArgType)                               \
+    if (ArgType == CMD_ARG_NONE)                                                    \
+    {                                                                               \
+        zassert_true(DecodeText(Text, &sCmd), "Text lookup of " Text);              \
+        zassert_equal(sCmd.eId, Id);                                                \
+    }
+
+ZTEST(cmd_dispatch, test_text_keywords)
+{
+    _sCmd sCmd;
+
+    PETTAP_CMD_TABLE(CHECK_KEYWORD)
+}
+
+ZTEST(cmd_dispatch, test_text_unknown)
+{
+    _sCmd sCmd;
+
+    zassert_false(DecodeText("CONNECTX", &sCmd));
+    zassert_false(DecodeText("connect", &sCmd));
+    zassert_false(DecodeText("CONNECT:1", &sCmd), "Keyword without arguments");
+    zassert_false(DecodeText("POWER_MODE:7", &sCmd));
+    zassert_false(DecodeText("ssid:home", &sCmd), "Password tag missing");
+}
+
+ZTEST(cmd_dispatch, test_text_wifi_cred)
+{
+    _sCmd sCmd;
+
+    zassert_true(DecodeText("ssid:myssid,pwd:secret", &sCmd));
+    zassert_equal(sCmd.eId, CMD_WIFI_CRED);
+    zassert_equal(strcmp(sCmd.uArgs.sWifiCred.cSSID, "myssid"), 0);
+    zassert_equal(strcmp(sCmd.uArgs.sWifiCred.cPassword, "secret"), 0);
+
+    //Keyword inside the SSID used to misroute the command
+    zassert_true(DecodeText("delssid:ssid", &sCmd));
+    zassert_equal(sCmd.eId, CMD_WIFI_FORGET);
+    zassert_equal(strcmp(sCmd.uArgs.sWifiCred.cSSID, "ssid"), 0);
+}
+
+ZTEST(cmd_dispatch, test_text_nul_padded)
+{
+    uint8_t ucBuf[64] = "POWER_MODE:1";
+    _sCmd sCmd;
+
+    zassert_true(CmdDecode(ucBuf, sizeof(ucBuf), &sCmd));
+    zassert_equal(sCmd.eId, CMD_POWER_MODE);
+    zassert_equal(sCmd.uArgs.ePowerMode, POWER_SLEEP);
+}
+
+ZTEST(cmd_dispatch, test_binary_round_trip)
+{
+    _sCmd sIn = {0};
+    _sCmd sOut;
+    uint8_t ucBuf[CMD_SSID_MAX_LEN + CMD_PWD_MAX_LEN + 3];
+    uint16_t usLen = 0;
+
+    sIn.eId = CMD_WIFI_CRED;
+    strcpy(sIn.uArgs.sWifiCred.cSSID, "a,pwd:b");
+    strcpy(sIn.uArgs.sWifiCred.cPassword, "p:w,d");
+    usLen = CmdEncode(&sIn, ucBuf, sizeof(ucBuf));
+    zassert_equal(usLen, 1 + 1 + 7 + 1 + 5);
+    zassert_true(CmdDecode(ucBuf, usLen, &sOut));
+    zassert_mem_equal(&sIn, &sOut, sizeof(_sCmd));
+
+    memset(&sIn, 0, sizeof(sIn));
+    sIn.eId = CMD_POWER_MODE;
+    sIn.uArgs.ePowerMode = POWER_SLEEP;
+    usLen = CmdEncode(&sIn, ucBuf, sizeof(ucBuf));
+    zassert_equal(usLen, 2);
+    zassert_true(CmdDecode(ucBuf, usLen, &sOut));
+    zassert_mem_equal(&sIn, &sOut, sizeof(_sCmd));
+}
+
+ZTEST(cmd_dispatch, test_binary_length)
+{
+    _sCmd sIn = {0};
+    _sCmd sOut;
+    uint8_t ucBuf[64];
+    uint16_t usLen = 0;
+
+    //Stale bytes after the command must not be read as arguments
+    memset(ucBuf, 0x05, sizeof(ucBuf));
+    sIn.eId = CMD_WIFI_FORGET;
+    strcpy(sIn.uArgs.sWifiCred.cSSID, "home");
+    usLen = CmdEncode(&sIn, ucBuf, sizeof(ucBuf));
+    zassert_true(CmdDecode(ucBuf, usLen, &sOut));
+    zassert_equal(strcmp(sOut.uArgs.sWifiCred.cSSID, "home"), 0);
+
+    //Truncated arguments
+    zassert_false(CmdDecode(ucBuf, usLen - 1, &sOut));
+    //Encoder must respect the buffer size
+    zassert_equal(CmdEncode(&sIn, ucBuf, 4), 0);
+    //Unknown opcode
+    ucBuf[0] = CMD_OPCODE_MAX - 1;
+    zassert_false(CmdDecode(ucBuf, 1, &sOut));
+}
+
+ZTEST(cmd_dispatch, test_dispatch)
+{
+    uint8_t ucBuf[] = {CMD_POWER_MODE, POWER_SLEEP};
+    uint8_t ucDisconnect[] = {CMD_DISCONNECT};
+
+    zassert_true(CmdDispatch(ucBuf, sizeof(ucBuf), pHandlers));
+    zassert_equal(ulCalls, 1);
+    zassert_equal(sLastCmd.eId, CMD_POWER_MODE);
+    zassert_equal(sLastCmd.uArgs.ePowerMode, POWER_SLEEP);
+
+    //Valid command without a handler
+    zassert_false(CmdDispatch(ucDisconnect, sizeof(ucDisconnect), pHandlers));
+    zassert_equal(ulCalls, 1);
+
+    zassert_true(CmdDispatch((const uint8_t *)"CONNECT", 7, pHandlers));
+    zassert_equal(sLastCmd.eId, CMD_CONNECT);
+    zassert_false(CmdDispatch(NULL, 0, pHandlers));
+}
+
+ZTEST_SUITE(cmd_dispatch, NULL, NULL, Before, NULL, NULL);
+
+//EOF
@@ -0,0 +1,45 @@
+/**
+ * @file    : BenchClock.h
+ * @brief   : Wall clock for the protocol benchmarks
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @note    : Simulated time of native_sim does not advance while code
+ *            runs, so benchmarks read the host monotonic clock there. The
+ *            board configuration must select CONFIG_EXTERNAL_LIBC.
+*/
+
+#ifndef _BENCH_CLOCK_H
+#define _BENCH_CLOCK_H
+
+/*********************************************INCLUDES***************************************************/
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#if defined(CONFIG_ARCH_POSIX)
+#include <time.h>
+#endif
+
+/***********************************************FUNCTION DEFINITION****************************************/
+/**
+ * @brief      : Current time for interval measurement
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : time in ns, only differences are meaningful
+*/
+static inline uint64_t BenchNowNs(void)
+{
+#if defined(CONFIG_ARCH_POSIX)
+    struct timespec sTs;
+
+    clock_gettime(CLOCK_MONOTONIC, &sTs);
+
+    return ((uint64_t)sTs.tv_sec * NSEC_PER_SEC) + (uint64_t)sTs.tv_nsec;
+#else
+    //Intervals must stay below one wrap of the cycle counter
+    return k_cyc_to_ns_floor64(k_cycle_get_32());
+#endif
+}
+
+#endif
+
+//EOF
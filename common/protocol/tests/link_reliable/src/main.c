@@ -0,0 +1,285 @@
+/**
+ * @file    : main.c
+ * @brief   : Reliable link driven over a simulated lossy UART
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @note    : Frames are serialized, corrupted at a given rate and decoded
+ *            again on the other side, so the link sees the same failures
+ *            as on the wire: lost frames, lost ACKs and lost resyncs.
+ *            Retransmit timeouts run on simulated time.
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <string.h>
+#include <zephyr/ztest.h>
+#include "LinkReliable.h"
+
+/*******************************************MACROS**********************************************************/
+#define CHAN_SIZE           2048
+#define TEST_FRAMES         300
+#define TEST_PAYLOAD        64
+#define TEST_TIMEOUT_MS     (10 * 60 * MSEC_PER_SEC)
+#define IDLE_STEP_MS        5
+
+/**********************************************TYPEDEFS***************************************************/
+/*One direction of the UART*/
+typedef struct __sChannel
+{
+    uint8_t ucBuf[CHAN_SIZE];
+    uint16_t usHead;
+    uint16_t usTail;
+    uint32_t ulWireBytes;
+    uint32_t ulFrames;
+    uint32_t ulCorrupted;
+    uint32_t ulPermille;        //Share of frames hit by a corrupted byte
+    uint32_t ulDropNext;        //Frames to drop entirely, as if never sent
+    _sPacketDecoder sDecoder;
+}_sChannel;
+
+/******************************************GLOBALS VARIABLES**********************************************/
+static _sLinkReliable sLinkA;       //Sender
+static _sLinkReliable sLinkB;       //Receiver
+static _sChannel sChanAB;
+static _sChannel sChanBA;
+static uint32_t ulRand = 1;
+static uint32_t ulDelivered = 0;
+static uint32_t ulPayloadBytes = 0;
+static bool bInOrder = true;
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/*Reproducible across runs and platforms*/
+static uint32_t NextRand(void)
+{
+    ulRand = (ulRand * 1103515245u) + 12345u;
+
+    return ulRand >> 8;
+}
+
+/**
+ * @brief      : Put a packet on a simulated wire
+ * @param [in] : psPacket - packet
+ * @param [out]: psChan - channel
+ * @return     : true, a UART never refuses bytes
+*/
+static bool ChannelTx(_sChannel *psChan, const _sPacket *psPacket)
+{
+    uint8_t ucFrame[FRAME_MAX_SIZE];
+    uint16_t usLen = SerializePacket(psPacket, ucFrame, sizeof(ucFrame));
+    uint16_t usIdx = 0;
+
+    psChan->ulFrames++;
+
+    if (psChan->ulDropNext)
+    {
+        psChan->ulDropNext--;
+        return true;
+    }
+
+    if ((NextRand() % 1000) < psChan->ulPermille)
+    {
+        ucFrame[NextRand() % usLen] ^= (uint8_t)(1 + (NextRand() % 255));
+        psChan->ulCorrupted++;
+    }
+
+    for (usIdx = 0; usIdx < usLen; usIdx++)
+    {
+        //Full channel loses bytes like a UART overrun
+        if (((psChan->usHead + 1) % CHAN_SIZE) == psChan->usTail)
+        {
+            break;
+        }
+
+        psChan->ucBuf[psChan->usHead] = ucFrame[usIdx];
+        psChan->usHead = (psChan->usHead + 1) % CHAN_SIZE;
+    }
+
+    psChan->ulWireBytes += usLen;
+
+    return true;
+}
+
+static bool TxA(const _sPacket *psPacket)
+{
+    return ChannelTx(&sChanAB, psPacket);
+}
+
+static bool TxB(const _sPacket *psPacket)
+{
+    return ChannelTx(&sChanBA, psPacket);
+}
+
+/**
+ * @brief      : Deliver the bytes of a channel to the receiving link
+ * @param [in] : psChan - channel
+ * @param [out]: psLink - receiving link
+ * @return     : true if any byte was moved
+*/
+static bool ChannelPump(_sChannel *psChan, _sLinkReliable *psLink)
+{
+    _sPacket sPacket;
+    bool bMoved = false;
+    uint32_t ulIdx = 0;
+
+    while (psChan->usTail != psChan->usHead)
+    {
+        bMoved = true;
+
+        if (PacketDecodeByte(&psChan->sDecoder, psChan->ucBuf[psChan->usTail]) == FRAME_COMPLETE)
+        {
+            //Copy out, the receiving link may transmit and refill the decoder
+            memcpy(&sPacket, &psChan->sDecoder.sPacket, sizeof(_sPacket));
+
+            if (LinkReceive(psLink, &sPacket) && psLink == &sLinkB)
+            {
+                //Payload carries the index of the frame
+                memcpy(&ulIdx, sPacket.pucPayload, sizeof(ulIdx));
+                bInOrder &= (ulIdx == ulDelivered);
+                ulDelivered++;
+                ulPayloadBytes += sPacket.usLen;
+            }
+        }
+
+        psChan->usTail = (psChan->usTail + 1) % CHAN_SIZE;
+    }
+
+    return bMoved;
+}
+
+/**
+ * @brief      : Queue frame number ulIdx on the sender
+ * @param [in] : ulIdx - frame number
+ * @param [out]: None
+ * @return     : true if the window had room
+*/
+static bool SendFrame(uint32_t ulIdx)
+{
+    _sPacket sPacket;
+    uint8_t ucPayload[TEST_PAYLOAD] = {0};
+
+    memcpy(ucPayload, &ulIdx, sizeof(ulIdx));
+    BuildPacket(&sPacket, DATA, ucPayload, sizeof(ucPayload));
+
+    return LinkSend(&sLinkA, &sPacket);
+}
+
+/**
+ * @brief      : Run the link until ulFrames frames starting at ulFirst are
+ *               delivered or the time runs out
+ * @param [in] : ulFirst - first frame number, ulFrames - frames to send
+ * @param [out]: None
+ * @return     : simulated time taken in ms
+*/
+static uint32_t RunLink(uint32_t ulFirst, uint32_t ulFrames)
+{
+    uint32_t ulStart = k_uptime_get_32();
+    uint32_t ulNext = ulFirst;
+    bool bBusy = false;
+
+    while ((ulDelivered < ulFirst + ulFrames || !LinkIsIdle(&sLinkA)) &&
+           (k_uptime_get_32() - ulStart) < TEST_TIMEOUT_MS)
+    {
+        while (ulNext < ulFirst + ulFrames && SendFrame(ulNext))
+        {
+            ulNext++;
+        }
+
+        bBusy = ChannelPump(&sChanAB, &sLinkB);
+        bBusy |= ChannelPump(&sChanBA, &sLinkA);
+        LinkPoll(&sLinkA);
+        LinkPoll(&sLinkB);
+
+        if (!bBusy)
+        {
+            k_sleep(K_MSEC(IDLE_STEP_MS));
+        }
+    }
+
+    return k_uptime_get_32() - ulStart;
+}
+
+static void Before(void *pvFixture)
+{
+    ARG_UNUSED(pvFixture);
+
+    memset(&sChanAB, 0, sizeof(sChanAB));
+    memset(&sChanBA, 0, sizeof(sChanBA));
+    PacketDecoderInit(&sChanAB.sDecoder);
+    PacketDecoderInit(&sChanBA.sDecoder);
+    LinkInit(&sLinkA, TxA);
+    LinkInit(&sLinkB, TxB);
+    ulRand = 1;
+    ulDelivered = 0;
+    ulPayloadBytes = 0;
+    bInOrder = true;
+}
+
+ZTEST(link_reliable, test_clean_link)
+{
+    RunLink(0, TEST_FRAMES);
+
+    zassert_equal(ulDelivered, TEST_FRAMES);
+    zassert_true(bInOrder);
+    zassert_equal(LinkGetStats(&sLinkA)->ulRetransmits, 0);
+    zassert_equal(LinkGetStats(&sLinkB)->ulDuplicates, 0);
+}
+
+ZTEST(link_reliable, test_lossy_goodput)
+{
+    static const uint32_t ulRates[] = {10, 20, 50, 100};
+    const _sLinkStats *psStats = LinkGetStats(&sLinkA);
+    uint32_t ulIdx = 0;
+    uint32_t ulMs = 0;
+
+    for (ulIdx = 0; ulIdx < ARRAY_SIZE(ulRates); ulIdx++)
+    {
+        Before(NULL);
+        sChanAB.ulPermille = ulRates[ulIdx];
+        sChanBA.ulPermille = ulRates[ulIdx];
+
+        ulMs = RunLink(0, TEST_FRAMES);
+
+        TC_PRINT("%2u%% corrupted: %u/%u frames in %u ms, %u retransmits, "
+                 "goodput %u%% of wire bytes\n",
+                 ulRates[ulIdx] / 10, ulDelivered, TEST_FRAMES, ulMs, psStats->ulRetransmits,
+                 (100 * ulPayloadBytes) / (sChanAB.ulWireBytes + sChanBA.ulWireBytes));
+
+        zassert_true(sChanAB.ulCorrupted > 0);
+        zassert_equal(ulDelivered, TEST_FRAMES, "Delivery incomplete at %u permille",
+                      ulRates[ulIdx]);
+        zassert_true(bInOrder, "Out of order at %u permille", ulRates[ulIdx]);
+        zassert_equal(psStats->ulDropped, 0);
+    }
+}
+
+ZTEST(link_reliable, test_receiver_restart)
+{
+    RunLink(0, 3);
+    zassert_equal(ulDelivered, 3);
+
+    //Receiver reboots and the next frame is lost on the wire
+    LinkInit(&sLinkB, TxB);
+    sChanAB.ulDropNext = 1;
+
+    RunLink(3, 4);
+
+    //Frame 3 must not be skipped by syncing on frame 4
+    zassert_equal(ulDelivered, 7);
+    zassert_true(bInOrder);
+    zassert_true(LinkGetStats(&sLinkB)->ulResyncs > 0);
+}
+
+ZTEST(link_reliable, test_duplicates)
+{
+    //All ACKs lost for a while, the sender resends frames already delivered
+    sChanBA.ulDropNext = 8;
+
+    RunLink(0, 8);
+
+    zassert_equal(ulDelivered, 8);
+    zassert_true(bInOrder);
+    zassert_true(LinkGetStats(&sLinkB)->ulDuplicates > 0);
+}
+
+ZTEST_SUITE(link_reliable, NULL, NULL, Before, NULL, NULL);
+
+//EOF
@@ -0,0 +1,327 @@
+/**
+ * @file    : main.c
+ * @brief   : Tests of the packet framing shared by 9160 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <string.h>
+#include <zephyr/ztest.h>
+#include "PacketFrame.h"
+#include "BenchClock.h"
+
+/*******************************************MACROS**********************************************************/
+#define STREAM_FRAMES       200
+#define STREAM_SIZE         (STREAM_FRAMES * FRAME_MAX_SIZE)
+#define BENCH_FRAMES        20000
+
+/******************************************GLOBALS VARIABLES**********************************************/
+static _sPacketDecoder sDecoder;
+static uint8_t ucStream[STREAM_SIZE];
+static uint32_t ulRand = 1;
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/*Reproducible across runs and platforms*/
+static uint32_t NextRand(void)
+{
+    ulRand = (ulRand * 1103515245u) + 12345u;
+
+    return ulRand >> 8;
+}
+
+static void Before(void *pvFixture)
+{
+    ARG_UNUSED(pvFixture);
+
+    PacketDecoderInit(&sDecoder);
+    ulRand = 1;
+}
+
+/**
+ * @brief      : Serialize frame number ucSeq, the payload is derived from it
+ * @param [in] : ucSeq - frame number, usLen - payload length, usSize - space left
+ * @param [out]: pucFrame - frame
+ * @return     : frame length, 0 on failure
+*/
+static uint16_t MakeFrame(uint8_t ucSeq, uint16_t usLen, uint8_t *pucFrame, uint16_t usSize)
+{
+    _sPacket sPacket;
+    uint8_t ucPayload[DATA_SIZE];
+    uint16_t usIdx = 0;
+
+    for (usIdx = 0; usIdx < usLen; usIdx++)
+    {
+        //Includes START and END bytes, which must pass through the payload
+        ucPayload[usIdx] = (uint8_t)(ucSeq + (usIdx * 7));
+    }
+
+    if (!BuildPacket(&sPacket, DATA, ucPayload, usLen))
+    {
+        return 0;
+    }
+
+    sPacket.ucSeq = ucSeq;
+
+    return SerializePacket(&sPacket, pucFrame, usSize);
+}
+
+/**
+ * @brief      : Check a decoded packet against the frame MakeFrame built
+ * @param [in] : psPacket - decoded packet
+ * @param [out]: None
+ * @return     : true if the payload matches its sequence number
+*/
+static bool PacketIsIntact(const _sPacket *psPacket)
+{
+    uint16_t usIdx = 0;
+
+    for (usIdx = 0; usIdx < psPacket->usLen; usIdx++)
+    {
+        if (psPacket->pucPayload[usIdx] != (uint8_t)(psPacket->ucSeq + (usIdx * 7)))
+        {
+            return false;
+        }
+    }
+
+    return psPacket->PacketType == DATA;
+}
+
+/**
+ * @brief      : Feed bytes to the decoder
+ * @param [in] : pucData - bytes, ulLen - number of bytes
+ * @param [out]: pucSeqs - sequence of each complete frame, may be NULL
+ * @return     : number of complete frames
+*/
+static uint32_t Feed(const uint8_t *pucData, uint32_t ulLen, uint8_t *pucSeqs)
+{
+    uint32_t ulFrames = 0;
+    uint32_t ulIdx = 0;
+
+    for (ulIdx = 0; ulIdx < ulLen; ulIdx++)
+    {
+        if (PacketDecodeByte(&sDecoder, pucData[ulIdx]) == FRAME_COMPLETE)
+        {
+            if (pucSeqs)
+            {
+                pucSeqs[ulFrames] = sDecoder.sPacket.ucSeq;
+            }
+            ulFrames++;
+        }
+    }
+
+    return ulFrames;
+}
+
+ZTEST(packet_frame, test_round_trip)
+{
+    static const uint16_t usLens[] = {0, 1, 2, 17, DATA_SIZE - 1, DATA_SIZE};
+    uint8_t ucFrame[FRAME_MAX_SIZE];
+    uint16_t usFrameLen = 0;
+    uint32_t ulIdx = 0;
+
+    for (ulIdx = 0; ulIdx < ARRAY_SIZE(usLens); ulIdx++)
+    {
+        usFrameLen = MakeFrame(START_BYTE + ulIdx, usLens[ulIdx], ucFrame, sizeof(ucFrame));
+        zassert_equal(usFrameLen, FRAME_HEADER_SIZE + usLens[ulIdx] + FRAME_TRAILER_SIZE);
+        zassert_equal(Feed(ucFrame, usFrameLen, NULL), 1, "Length %u", usLens[ulIdx]);
+        zassert_equal(sDecoder.sPacket.usLen, usLens[ulIdx]);
+        zassert_equal(sDecoder.sPacket.ucSeq, START_BYTE + ulIdx);
+        zassert_true(PacketIsIntact(&sDecoder.sPacket));
+        //Text payloads are terminated
+        zassert_equal(sDecoder.sPacket.pucPayload[usLens[ulIdx]], '\0');
+    }
+
+    zassert_equal(sDecoder.sStats.ulFrames, ARRAY_SIZE(usLens));
+    zassert_equal(sDecoder.sStats.ulCrcErrors, 0);
+    zassert_equal(sDecoder.sStats.ulFramingErrors, 0);
+}
+
+ZTEST(packet_frame, test_type_and_flags)
+{
+    _sPacket sPacket;
+    uint8_t ucFrame[FRAME_MAX_SIZE];
+    uint16_t usFrameLen = 0;
+
+    zassert_true(BuildPacket(&sPacket, RESP, (uint8_t *)"ACK", 3));
+    sPacket.ucFlags = FRAME_FLAG_SYN;
+    sPacket.ucSeq = 0xFF;
+    usFrameLen = SerializePacket(&sPacket, ucFrame, sizeof(ucFrame));
+
+    zassert_equal(Feed(ucFrame, usFrameLen, NULL), 1);
+    zassert_equal(sDecoder.sPacket.PacketType, RESP);
+    zassert_equal(sDecoder.sPacket.ucFlags, FRAME_FLAG_SYN);
+    zassert_equal(sDecoder.sPacket.ucSeq, 0xFF);
+    zassert_equal(strcmp((char *)sDecoder.sPacket.pucPayload, "ACK"), 0);
+}
+
+ZTEST(packet_frame, test_serialize_bounds)
+{
+    _sPacket sPacket;
+    uint8_t ucPayload[DATA_SIZE + 1] = {0};
+    uint8_t ucFrame[FRAME_MAX_SIZE];
+
+    zassert_false(BuildPacket(&sPacket, DATA, ucPayload, DATA_SIZE + 1));
+    zassert_true(BuildPacket(&sPacket, DATA, ucPayload, 10));
+    zassert_equal(SerializePacket(&sPacket, ucFrame, FRAME_HEADER_SIZE + 10 + FRAME_TRAILER_SIZE - 1), 0);
+    zassert_equal(SerializePacket(&sPacket, ucFrame, FRAME_HEADER_SIZE + 10 + FRAME_TRAILER_SIZE),
+                  FRAME_HEADER_SIZE + 10 + FRAME_TRAILER_SIZE);
+}
+
+ZTEST(packet_frame, test_fragmented)
+{
+    uint8_t ucSeqs[STREAM_FRAMES];
+    uint32_t ulLen = 0;
+    uint32_t ulOff = 0;
+    uint32_t ulChunk = 0;
+    uint32_t ulFrames = 0;
+    uint32_t ulIdx = 0;
+
+    for (ulIdx = 0; ulIdx < STREAM_FRAMES; ulIdx++)
+    {
+        ulLen += MakeFrame(ulIdx, NextRand() % (DATA_SIZE + 1), &ucStream[ulLen], STREAM_SIZE - ulLen);
+    }
+
+    //UART reads split frames at arbitrary points
+    while (ulOff < ulLen)
+    {
+        ulChunk = MIN(1 + (NextRand() % 23), ulLen - ulOff);
+        ulFrames += Feed(&ucStream[ulOff], ulChunk, &ucSeqs[ulFrames]);
+        ulOff += ulChunk;
+    }
+
+    zassert_equal(ulFrames, STREAM_FRAMES);
+
+    for (ulIdx = 0; ulIdx < STREAM_FRAMES; ulIdx++)
+    {
+        zassert_equal(ucSeqs[ulIdx], (uint8_t)ulIdx);
+    }
+}
+
+ZTEST(packet_frame, test_noise_between_frames)
+{
+    static const uint8_t ucNoise[] = {0x00, END_BYTE, 0xFF, START_BYTE, 0x7F, START_BYTE};
+    uint8_t ucFrame[FRAME_MAX_SIZE];
+    uint16_t usFrameLen = MakeFrame(9, 20, ucFrame, sizeof(ucFrame));
+
+    zassert_equal(Feed(ucNoise, sizeof(ucNoise), NULL), 0);
+    zassert_equal(Feed(ucFrame, usFrameLen, NULL), 1);
+    zassert_equal(sDecoder.sPacket.ucSeq, 9);
+}
+
+ZTEST(packet_frame, test_corrupted_len)
+{
+    uint8_t ucFrames[2 * FRAME_MAX_SIZE];
+    uint8_t ucSeqs[2];
+    uint16_t usFirst = MakeFrame(1, 10, ucFrames, sizeof(ucFrames));
+    uint16_t usSecond = MakeFrame(2, 10, &ucFrames[usFirst], sizeof(ucFrames) - usFirst);
+
+    //LEN_LO of the first frame grows, the decoder must not eat the second frame
+    ucFrames[3] = 90;
+
+    zassert_equal(Feed(ucFrames, usFirst + usSecond, ucSeqs), 1);
+    zassert_equal(ucSeqs[0], 2);
+    zassert_true(PacketIsIntact(&sDecoder.sPacket));
+    zassert_equal(sDecoder.sStats.ulFramingErrors, 1);
+
+    //LEN beyond DATA_SIZE
+    ucFrames[3] = 10;
+    ucFrames[4] = 0x01;
+    zassert_equal(Feed(ucFrames, usFirst + usSecond, ucSeqs), 1);
+    zassert_equal(ucSeqs[0], 2);
+}
+
+ZTEST(packet_frame, test_crc_error)
+{
+    uint8_t ucFrames[2 * FRAME_MAX_SIZE];
+    uint8_t ucSeqs[2];
+    uint16_t usFirst = MakeFrame(1, 30, ucFrames, sizeof(ucFrames));
+    uint16_t usSecond = MakeFrame(2, 30, &ucFrames[usFirst], sizeof(ucFrames) - usFirst);
+
+    ucFrames[FRAME_HEADER_SIZE + 12] ^= 0x10;
+
+    zassert_equal(Feed(ucFrames, usFirst + usSecond, ucSeqs), 1);
+    zassert_equal(ucSeqs[0], 2);
+    zassert_equal(sDecoder.sStats.ulCrcErrors, 1);
+
+    //Bad END byte
+    ucFrames[FRAME_HEADER_SIZE + 12] ^= 0x10;
+    ucFrames[usFirst - 1] = 0x00;
+    zassert_equal(Feed(ucFrames, usFirst + usSecond, ucSeqs), 1);
+    zassert_equal(ucSeqs[0], 2);
+}
+
+ZTEST(packet_frame, test_random_corruption)
+{
+    uint32_t ulLen = 0;
+    uint32_t ulIdx = 0;
+    uint32_t ulFrames = 0;
+    uint32_t ulIntact = 0;
+    uint32_t ulCorrupted = 0;
+
+    for (ulIdx = 0; ulIdx < STREAM_FRAMES; ulIdx++)
+    {
+        ulLen += MakeFrame(ulIdx, 1 + (NextRand() % DATA_SIZE), &ucStream[ulLen], STREAM_SIZE - ulLen);
+    }
+
+    //About one byte in a hundred, most frames carry one hit
+    for (ulIdx = 0; ulIdx < ulLen; ulIdx++)
+    {
+        if ((NextRand() % 100) == 0)
+        {
+            ucStream[ulIdx] ^= (uint8_t)(1 + (NextRand() % 255));
+            ulCorrupted++;
+        }
+    }
+
+    for (ulIdx = 0; ulIdx < ulLen; ulIdx++)
+    {
+        if (PacketDecodeByte(&sDecoder, ucStream[ulIdx]) == FRAME_COMPLETE)
+        {
+            ulFrames++;
+            ulIntact += PacketIsIntact(&sDecoder.sPacket);
+        }
+    }
+
+    TC_PRINT("%u bytes corrupted, %u of %u frames recovered\n", ulCorrupted, ulFrames, STREAM_FRAMES);
+    zassert_true(ulCorrupted > 0);
+    zassert_equal(ulIntact, ulFrames, "Corrupted frame accepted");
+    //Each hit costs its own frame and at most the frame after it
+    zassert_true(ulFrames + (2 * ulCorrupted) >= STREAM_FRAMES);
+}
+
+ZTEST(packet_frame, test_throughput)
+{
+    uint8_t ucFrame[FRAME_MAX_SIZE];
+    uint16_t usFrameLen = 0;
+    uint32_t ulFrames = 0;
+    uint32_t ulIdx = 0;
+    uint64_t ullStart = 0;
+    uint64_t ullEncodeNs = 0;
+    uint64_t ullDecodeNs = 0;
+
+    ullStart = BenchNowNs();
+    for (ulIdx = 0; ulIdx < BENCH_FRAMES; ulIdx++)
+    {
+        usFrameLen = MakeFrame(ulIdx, DATA_SIZE, ucFrame, sizeof(ucFrame));
+    }
+    ullEncodeNs = BenchNowNs() - ullStart;
+
+    ullStart = BenchNowNs();
+    for (ulIdx = 0; ulIdx < BENCH_FRAMES; ulIdx++)
+    {
+        ulFrames += Feed(ucFrame, usFrameLen, NULL);
+    }
+    ullDecodeNs = BenchNowNs() - ullStart;
+
+    zassert_equal(ulFrames, BENCH_FRAMES);
+    TC_PRINT("encode %u ns/frame, decode %u ns/frame, decode %u kB/s for %u byte frames\n",
+             (uint32_t)(ullEncodeNs / BENCH_FRAMES), (uint32_t)(ullDecodeNs / BENCH_FRAMES),
+             (uint32_t)(((uint64_t)BENCH_FRAMES * usFrameLen * NSEC_PER_SEC) /
+                        (MAX(ullDecodeNs, 1) * 1024)),
+             usFrameLen);
+}
+
+ZTEST_SUITE(packet_frame, NULL, NULL, Before, NULL, NULL);
+
+//EOF
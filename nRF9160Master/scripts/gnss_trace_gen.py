@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+"""Builds a GNSS replay trace from an NMEA capture.
+
+The input is any text containing NMEA sentences, for example a console
+capture of the sample in NMEA output mode. Lines may carry prefixes such as
+terminal timestamps, sentences with a bad checksum are dropped. Sentences
+are grouped into epochs by their UTC time and each epoch becomes one PVT
+record followed by its NMEA records. Trace time is taken from the NMEA
+time, so gaps in the capture are replayed as gaps.
+
+NMEA has no accuracy estimate, it is approximated as HDOP times
+--uere meters.
+
+Trace layout, all fields little-endian (see src/gnss_replay.c):
+  header:  u32 magic "GTRC", u8 version, u8[3] reserved
+  record:  u32 time_ms, u8 type, u8 reserved, u16 len, payload
+  PVT:     f64 lat, f64 lon, f32 alt, acc, speed, heading, pdop, hdop, vdop,
+           u16 year, u8 month, day, hour, minute, second, u16 ms, u8 flags,
+           u8 sv_count, sv_count * (u16 sv, u16 cn0, i16 elev, i16 az, u8 flags,
+           u8 signal)
+  NMEA:    sentence without line end
+  AGPS:    u32 sv_mask_ephe, u32 sv_mask_alm, u32 data_flags
+"""
+
+import argparse
+import datetime
+import re
+import struct
+import sys
+
+MAGIC = 0x43525447
+VERSION = 1
+
+TYPE_PVT = 1
+TYPE_NMEA = 2
+TYPE_AGPS_REQ = 3
+
+PVT_FLAG_FIX_VALID = 0x01
+SV_FLAG_USED_IN_FIX = 0x02
+SIGNAL_GPS_L1_CA = 1
+
+# GPS UTC, Klobuchar, NeQuick, system time, position and integrity requests.
+AGPS_ALL_FLAGS = 0x3f
+
+KNOTS_TO_MS = 0.514444
+
+SENTENCE = re.compile(r"(\$(G[PLNA])([A-Z]{3}),[^*]*)\*([0-9A-Fa-f]{2})")
+
+
+def checksum_ok(body, checksum):
+    value = 0
+    for c in body[1:]:
+        value ^= ord(c)
+    return value == int(checksum, 16)
+
+
+def to_degrees(value, hemisphere):
+    if not value:
+        return 0.0
+    dot = value.index(".")
+    degrees = float(value[:dot - 2]) + float(value[dot - 2:]) / 60
+    return -degrees if hemisphere in ("S", "W") else degrees
+
+
+def to_float(value, default=0.0):
+    try:
+        return float(value)
+    except ValueError:
+        return default
+
+
+def utc_ms(value):
+    if len(value) < 6:
+        return None
+    return (int(value[0:2]) * 3600 + int(value[2:4]) * 60) * 1000 + \
+        round(float(value[4:]) * 1000)
+
+
+class Epoch:
+    def __init__(self, time_ms):
+        self.time_ms = time_ms
+        self.sentences = []
+        self.lat = self.lon = 0.0
+        self.alt = self.speed = self.heading = 0.0
+        self.pdop = self.hdop = self.vdop = 0.0
+        self.date = None
+        self.fix = False
+        self.used = set()
+        self.svs = {}
+
+    def parse(self, name, fields):
+        if name == "GGA" and len(fields) >= 10:
+            self.lat = to_degrees(fields[2], fields[3])
+            self.lon = to_degrees(fields[4], fields[5])
+            self.fix = fields[6] not in ("", "0")
+            self.hdop = to_float(fields[8], self.hdop)
+            self.alt = to_float(fields[9])
+        elif name == "RMC" and len(fields) >= 10:
+            self.fix = self.fix or fields[2] == "A"
+            self.speed = to_float(fields[7]) * KNOTS_TO_MS
+            self.heading = to_float(fields[8])
+            if len(fields[9]) == 6:
+                self.date = (2000 + int(fields[9][4:6]), int(fields[9][2:4]),
+                             int(fields[9][0:2]))
+        elif name == "GSA" and len(fields) >= 18:
+            self.used.update(int(sv) for sv in fields[3:15] if sv)
+            self.pdop = to_float(fields[15])
+            self.hdop = to_float(fields[16], self.hdop)
+            self.vdop = to_float(fields[17])
+        elif name == "GSV":
+            for i in range(4, len(fields) - 3, 4):
+                if not fields[i]:
+                    continue
+                self.svs[int(fields[i])] = (int(to_float(fields[i + 1])),
+                                            int(to_float(fields[i + 2])),
+                                            int(to_float(fields[i + 3]) * 10))
+
+    def pvt(self, uere):
+        millis = self.time_ms % 86400000
+        hour, rest = divmod(millis, 3600000)
+        minute, rest = divmod(rest, 60000)
+        second, ms = divmod(rest, 1000)
+        year, month, day = self.date or (1980, 1, 6)
+
+        svs = sorted(self.svs.items())[:12]
+        data = struct.pack("<ddfffffffHBBBBBHBB", self.lat, self.lon, self.alt,
+                           self.hdop * uere if self.fix else 0.0, self.speed,
+                           self.heading, self.pdop, self.hdop, self.vdop,
+                           year, month, day, hour, minute, second, ms,
+                           PVT_FLAG_FIX_VALID if self.fix else 0, len(svs))
+
+        for sv, (elevation, azimuth, cn0) in svs:
+            flags = SV_FLAG_USED_IN_FIX if sv in self.used else 0
+            data += struct.pack("<HHhhBB", sv, cn0, elevation, azimuth, flags,
+                                SIGNAL_GPS_L1_CA)
+
+        return data
+
+
+def read_epochs(path):
+    epochs = []
+    epoch = None
+    day_offset = 0
+    last_time = None
+
+    with open(path, errors="replace") as f:
+        for line in f:
+            for match in SENTENCE.finditer(line):
+                body, _, name, checksum = match.groups()
+                if not checksum_ok(body, checksum):
+                    continue
+
+                fields = body.split(",")
+                time_ms = None
+                if name in ("GGA", "RMC", "GLL"):
+                    index = 5 if name == "GLL" else 1
+                    if len(fields) > index:
+                        time_ms = utc_ms(fields[index])
+
+                if time_ms is not None:
+                    # Midnight rollover.
+                    if last_time is not None and time_ms + day_offset < last_time - 3600000:
+                        day_offset += 86400000
+                    time_ms += day_offset
+                    last_time = time_ms
+
+                    if epoch is None or time_ms != epoch.time_ms:
+                        epoch = Epoch(time_ms)
+                        epochs.append(epoch)
+
+                if epoch is None:
+                    continue
+
+                epoch.sentences.append(f"{body}*{checksum.upper()}")
+                epoch.parse(name, fields)
+
+    return epochs
+
+
+def record(time_ms, record_type, payload):
+    return struct.pack("<IBBH", time_ms, record_type, 0, len(payload)) + payload
+
+
+def main():
+    parser = argparse.ArgumentParser(description="GNSS replay trace generator.")
+    parser.add_argument("nmea", help="Text file containing NMEA sentences")
+    parser.add_argument("trace", help="Output trace file")
+    parser.add_argument("--agps-request", action="store_true",
+                        help="Start the trace with a request for all A-GPS data")
+    parser.add_argument("--uere", type=float, default=4.0,
+                        help="Range error in meters for the accuracy estimate (default 4)")
+    args = parser.parse_args()
+
+    epochs = read_epochs(args.nmea)
+    if not epochs:
+        raise SystemExit(f"{args.nmea}: no NMEA epochs found")
+
+    start = epochs[0].time_ms
+    data = struct.pack("<IB3x", MAGIC, VERSION)
+
+    if args.agps_request:
+        data += record(0, TYPE_AGPS_REQ,
+                       struct.pack("<III", 0xffffffff, 0xffffffff, AGPS_ALL_FLAGS))
+
+    for epoch in epochs:
+        time_ms = epoch.time_ms - start
+        data += record(time_ms, TYPE_PVT, epoch.pvt(args.uere))
+        for sentence in epoch.sentences:
+            data += record(time_ms, TYPE_NMEA, sentence.encode())
+
+    with open(args.trace, "wb") as f:
+        f.write(data)
+
+    fixes = sum(1 for epoch in epochs if epoch.fix)
+    duration = datetime.timedelta(milliseconds=epochs[-1].time_ms - start)
+    print(f"{len(epochs)} epochs, {fixes} with a fix, {duration} long, {len(data)} bytes")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
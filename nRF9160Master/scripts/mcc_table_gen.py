@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+"""Generates the packed MCC location table from a CSV file.
+
+Rows are sorted by MCC. Latitude and longitude are stored already
+converted to the GNSS integer representation, as produced by
+lat_convert() and lon_convert(), in 3 bytes each. Confidence,
+uncertainty and orientation combinations are shared between rows
+through a small lookup table.
+
+For the lookup, either a sorted key array (binary search) or a dense
+index from MCC to row (direct lookup) is compiled in, selected by
+CONFIG_GNSS_SAMPLE_MCC_TABLE_DENSE.
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+
+# Same constants as mcc_location_table.c, evaluated in single precision.
+LAT_CONV = 8388608.0 / 90.0
+LON_CONV = 16777216.0 / 360.0
+INT24_MIN = -(1 << 23)
+INT24_MAX = (1 << 23) - 1
+ROWS_MAX = 255  # Dense index stores row + 1 in a byte
+
+
+def f32(value):
+    return struct.unpack("f", struct.pack("f", value))[0]
+
+
+def convert(degrees, factor):
+    """Matches (int32_t)(float * float) in C."""
+    return int(f32(f32(degrees) * f32(factor)))
+
+
+def int24_bytes(value):
+    return [(value >> shift) & 0xff for shift in (0, 8, 16)]
+
+
+def read_rows(filename):
+    rows = []
+
+    with open(filename, newline="") as f:
+        for line, row in enumerate(csv.DictReader(f), start=2):
+            try:
+                entry = {
+                    "mcc": int(row["mcc"]),
+                    "unc": (int(row["confidence"]), int(row["unc_semiminor"]),
+                            int(row["unc_semimajor"]), int(row["orientation"])),
+                    "lat": convert(float(row["latitude"]), LAT_CONV),
+                    "lon": convert(float(row["longitude"]), LON_CONV),
+                    "country": row["country"].replace("*/", ""),
+                }
+            except (KeyError, ValueError) as e:
+                raise SystemExit(f"{filename}:{line}: invalid row: {e}")
+
+            confidence, semiminor, semimajor, orientation = entry["unc"]
+
+            if not 0 < entry["mcc"] < 1000:
+                raise SystemExit(f"{filename}:{line}: MCC out of range")
+            if confidence > 100 or semiminor > 127 or semimajor > 127 or orientation > 179:
+                raise SystemExit(f"{filename}:{line}: uncertainty out of range")
+            if not (INT24_MIN <= entry["lat"] <= INT24_MAX and
+                    INT24_MIN <= entry["lon"] <= INT24_MAX):
+                raise SystemExit(f"{filename}:{line}: position does not fit 24 bits")
+
+            rows.append(entry)
+
+    rows.sort(key=lambda entry: entry["mcc"])
+
+    for prev, cur in zip(rows, rows[1:]):
+        if prev["mcc"] == cur["mcc"]:
+            raise SystemExit(f"{filename}: duplicate MCC {cur['mcc']}")
+
+    if not rows or len(rows) > ROWS_MAX:
+        raise SystemExit(f"{filename}: 1 to {ROWS_MAX} rows supported")
+
+    return rows
+
+
+def write_table(rows, source, out):
+    uncs = sorted(set(entry["unc"] for entry in rows))
+    unc_index = {unc: i for i, unc in enumerate(uncs)}
+    mcc_min = rows[0]["mcc"]
+    mcc_max = rows[-1]["mcc"]
+    dense = [0] * (mcc_max - mcc_min + 1)
+
+    for i, entry in enumerate(rows):
+        dense[entry["mcc"] - mcc_min] = i + 1
+
+    out.write("/*\n"
+              f" * Generated by {os.path.basename(sys.argv[0])} from {source}, do not edit.\n"
+              f" * {len(rows)} rows, {len(uncs)} uncertainty entries.\n"
+              " */\n\n"
+              "#include <stdint.h>\n\n"
+              "#include \"mcc_location_data.h\"\n\n")
+
+    out.write("const struct mcc_unc mcc_unc[] = {\n")
+    for confidence, semiminor, semimajor, orientation in uncs:
+        out.write(f"\t{{ {confidence:3}, {semiminor:3}, {semimajor:3}, {orientation:3} }},\n")
+    out.write("};\n\n")
+
+    out.write("const struct mcc_row mcc_rows[] = {\n")
+    for entry in rows:
+        lat = ", ".join(f"0x{b:02x}" for b in int24_bytes(entry["lat"]))
+        lon = ", ".join(f"0x{b:02x}" for b in int24_bytes(entry["lon"]))
+        out.write(f"\t{{ {{ {lat} }}, {{ {lon} }}, {unc_index[entry['unc']]:2} }}, "
+                  f"/* {entry['mcc']} {entry['country']} */\n")
+    out.write("};\n\n")
+
+    out.write(f"const uint16_t mcc_rows_count = {len(rows)};\n\n")
+
+    out.write("#if defined(CONFIG_GNSS_SAMPLE_MCC_TABLE_DENSE)\n"
+              f"const uint16_t mcc_index_base = {mcc_min};\n"
+              f"const uint16_t mcc_index_count = {len(dense)};\n\n"
+              "/* Row + 1 for each MCC from mcc_index_base, 0 if not in table. */\n"
+              "const uint8_t mcc_index[] = {")
+    for i, row in enumerate(dense):
+        out.write(("\n\t" if i % 16 == 0 else " ") + f"{row:3},")
+    out.write("\n};\n"
+              "#else\n"
+              "/* MCC of each row, sorted. */\n"
+              "const uint16_t mcc_keys[] = {")
+    for i, entry in enumerate(rows):
+        out.write(("\n\t" if i % 12 == 0 else " ") + f"{entry['mcc']:3},")
+    out.write("\n};\n"
+              "#endif /* CONFIG_GNSS_SAMPLE_MCC_TABLE_DENSE */\n")
+
+    row_size = 7
+    sparse = len(rows) * (row_size + 2) + len(uncs) * 4
+    print(f"MCC table: {len(rows)} rows, {sparse} bytes sorted, "
+          f"{len(rows) * row_size + len(dense) + len(uncs) * 4} bytes dense")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the packed MCC location table.")
+    parser.add_argument("csv", help="MCC location CSV file")
+    parser.add_argument("output", help="Generated C file")
+    args = parser.parse_args()
+
+    rows = read_rows(args.csv)
+
+    with open(args.output, "w") as out:
+        write_table(rows, os.path.basename(args.csv), out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+"""Local SUPL stub server for measuring session latency without a real server.
+
+ULP messages start with a 2-byte big-endian length. The server reads one
+client message at a time and answers with the next message from a replay
+file, after an optional delay. The replay file holds the raw server side
+of a recorded session, for example exported from a packet capture.
+
+Without a replay file the server accepts the connection and stays silent,
+which exercises the session time limit of the device.
+
+Point CONFIG_GNSS_SAMPLE_SUPL_HOSTNAME and CONFIG_GNSS_SAMPLE_SUPL_PORT to
+the host running this script.
+"""
+
+import argparse
+import socket
+import time
+
+
+def split_messages(data):
+    messages = []
+
+    while len(data) >= 2:
+        length = int.from_bytes(data[:2], "big")
+        if length < 2 or length > len(data):
+            raise SystemExit("Replay file is not a sequence of ULP messages")
+        messages.append(data[:length])
+        data = data[length:]
+
+    return messages
+
+
+def recv_exact(conn, size):
+    data = b""
+
+    while len(data) < size:
+        chunk = conn.recv(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+
+    return data
+
+
+def recv_message(conn):
+    header = recv_exact(conn, 2)
+    if header is None:
+        return None
+
+    body = recv_exact(conn, int.from_bytes(header, "big") - 2)
+    if body is None:
+        return None
+
+    return header + body
+
+
+def serve(conn, messages, delay):
+    start = time.monotonic()
+    replies = list(messages)
+
+    while True:
+        message = recv_message(conn)
+        if message is None:
+            break
+
+        print(f"  {time.monotonic() - start:7.3f} s: client message, {len(message)} bytes")
+
+        if not replies:
+            continue
+
+        time.sleep(delay)
+        reply = replies.pop(0)
+        conn.sendall(reply)
+        print(f"  {time.monotonic() - start:7.3f} s: sent reply, {len(reply)} bytes")
+
+    print(f"  session closed by client after {time.monotonic() - start:.3f} s")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="SUPL stub server.")
+    parser.add_argument("--port", type=int, default=7276, help="TCP port (default 7276)")
+    parser.add_argument("--replay", help="Raw server side of a recorded SUPL session")
+    parser.add_argument("--delay", type=float, default=0.0,
+                        help="Seconds to wait before each reply")
+    args = parser.parse_args()
+
+    messages = []
+    if args.replay:
+        with open(args.replay, "rb") as f:
+            messages = split_messages(f.read())
+
+    with socket.create_server(("", args.port)) as server:
+        print(f"Listening on port {args.port}, {len(messages)} replies, "
+              f"{args.delay} s delay")
+
+        while True:
+            conn, addr = server.accept()
+            print(f"Connection from {addr[0]}")
+            with conn:
+                serve(conn, messages, args.delay)
+
+
+if __name__ == "__main__":
+    main()
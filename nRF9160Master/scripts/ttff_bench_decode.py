@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+
+"""Decodes TTFF benchmark logs from console captures and compares builds.
+
+The sample prints the binary benchmark log as lines starting with
+"ttff_bench:" when CONFIG_GNSS_SAMPLE_TTFF_BENCH is enabled. Give one
+capture per build, the script prints the percentiles of each build side
+by side. With --csv the individual iterations are printed instead.
+"""
+
+import argparse
+import math
+import re
+import struct
+import sys
+
+MAGIC = 0x42465454
+HEADER = struct.Struct("<IBBBB")
+RECORD = struct.Struct("<BBHHHHHHH")
+
+ASSISTANCE = ["none", "minimal", "supl", "nrf_cloud"]
+FLAGS = [(0x01, "agps"), (0x02, "pgps"), (0x04, "cache")]
+STARTS = ["cold", "warm", "hot"]
+NO_VALUE = 0xffff
+
+
+def read_log(path):
+    data = b""
+
+    with open(path, errors="replace") as f:
+        for line in f:
+            match = re.search(r"ttff_bench: ([0-9a-f]+)", line)
+            if match:
+                data += bytes.fromhex(match.group(1))
+
+    if len(data) < HEADER.size:
+        raise SystemExit(f"{path}: no benchmark log found")
+
+    magic, version, assistance, flags, count = HEADER.unpack_from(data)
+    if magic != MAGIC or version != 1:
+        raise SystemExit(f"{path}: unsupported log")
+
+    name = ASSISTANCE[assistance] if assistance < len(ASSISTANCE) else str(assistance)
+    extras = [flag_name for flag, flag_name in FLAGS if flags & flag]
+    if extras:
+        name += "+" + "+".join(extras)
+
+    records = []
+    for i in range(count):
+        start, rflags, ttff_ds, blocked, acc, err, net, cache, _ = \
+            RECORD.unpack_from(data, HEADER.size + i * RECORD.size)
+        records.append({
+            "start": STARTS[start] if start < len(STARTS) else str(start),
+            "timeout": bool(rflags & 0x01),
+            "ttff_s": ttff_ds / 10,
+            "blocked_s": blocked,
+            "accuracy_m": None if acc == NO_VALUE else acc / 10,
+            "error_m": None if err == NO_VALUE else err / 10,
+            "download_b": net,
+            "cache_b": cache,
+        })
+
+    return name, records
+
+
+def percentile(values, pct):
+    if not values:
+        return None
+
+    values = sorted(values)
+    return values[max(math.ceil(len(values) * pct / 100) - 1, 0)]
+
+
+def fmt(value):
+    if value is None:
+        return "-"
+    return f"{value:g}"
+
+
+def summary(builds):
+    fields = [("ttff_s", "TTFF s"), ("blocked_s", "blocked s"),
+              ("download_b", "download B"), ("accuracy_m", "accuracy m"),
+              ("error_m", "error m")]
+
+    print(f"{'':24}" + "".join(f"{name:>24}" for name, _ in builds))
+
+    for start in STARTS:
+        rows = [[] for _ in builds]
+
+        for col, (_, records) in enumerate(builds):
+            runs = [r for r in records if r["start"] == start]
+            fixes = [r for r in runs if not r["timeout"]]
+            rows[col].append(f"{len(fixes)}/{len(runs)} fixes")
+
+            for field, _ in fields:
+                values = [r[field] for r in fixes if r[field] is not None]
+                rows[col].append(f"{fmt(percentile(values, 50))} / "
+                                 f"{fmt(percentile(values, 90))}")
+
+        labels = [f"{start}"] + [f"  {label} p50/p90" for _, label in fields]
+        for i, label in enumerate(labels):
+            print(f"{label:24}" + "".join(f"{row[i]:>24}" for row in rows))
+
+
+def csv(builds):
+    print("build,start,timeout,ttff_s,blocked_s,download_b,cache_b,accuracy_m,error_m")
+
+    for name, records in builds:
+        for r in records:
+            print(f"{name},{r['start']},{int(r['timeout'])},{r['ttff_s']},{r['blocked_s']},"
+                  f"{r['download_b']},{r['cache_b']},{fmt(r['accuracy_m'])},"
+                  f"{fmt(r['error_m'])}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="TTFF benchmark log decoder.")
+    parser.add_argument("captures", nargs="+", help="Console captures, one per build")
+    parser.add_argument("--csv", action="store_true", help="Print all iterations as CSV")
+    args = parser.parse_args()
+
+    builds = [read_log(path) for path in args.captures]
+
+    if args.csv:
+        csv(builds)
+    else:
+        summary(builds)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -10,25 +10,43 @@
 #include "../System/SystemHandler.h"
 #include "../PacketHandler/PacketHandler.h"
 #include "BleHandler.h"
+#include "PerfStats.h"
+#include "LogRate.h"
+#include <zephyr/logging/log.h>
 
 /*******************************************MACROS**********************************************************/
-#define MSG_SIZE        255
 #define PAYLOAD_SIZE    75
+#define RX_WAIT_MS      100     //Link poll while the UART is up
 
 /******************************************TYPEDEFS*********************************************************/
 
 /******************************************PRIVATE GLOBALS**************************************************/
 static const struct device *BleUart = DEVICE_DT_GET(DT_NODELABEL(uart2));
-/*Buffer for UART receive data*/
-static uint8_t cRxBuffer[BUFFER_SIZE] = {0};
-/*State of UART receive*/
-static _eUartRxState eUartRxState = START;
-/*Index of LoRa packet receive*/
-static uint16_t usRxBufferIdx = 0;
-/*Flag for LORA packet receive completion*/
-static bool bRxCmplt = false;
-
-K_MSGQ_DEFINE(BleMsgQueue, MSG_SIZE, 10, 4);
+/*Frame decoder fed from UART ISR*/
+static _sPacketDecoder sRxDecoder = {.eState = FRAME_START};
+/*Sequencing and retransmission towards 52840*/
+static _sLinkReliable sBleLink;
+/*Rate negotiation, 9160 drives the handshake*/
+static _sLinkBaud sBleBaud;
+#if defined(CONFIG_PETTAP_LINK_PM)
+/*Wake lines and UART suspend between transfers*/
+static _sLinkPower sBlePower;
+static const struct gpio_dt_spec sWakeOut = GPIO_DT_SPEC_GET(DT_PATH(zephyr_user), link_wake_out_gpios);
+static const struct gpio_dt_spec sWakeIn = GPIO_DT_SPEC_GET(DT_PATH(zephyr_user), link_wake_in_gpios);
+#endif
+
+K_MSGQ_DEFINE(BleMsgQueue, sizeof(_sPacket), 10, 4);
+
+PERF_COUNTER_DEFINE(ble_rx_bytes);
+PERF_COUNTER_DEFINE(ble_rx_frames);
+PERF_COUNTER_DEFINE(ble_rx_errors);
+PERF_COUNTER_DEFINE(ble_rx_drops);
+PERF_COUNTER_DEFINE(ble_tx_bytes);
+PERF_COUNTER_DEFINE(ble_tx_frames);
+PERF_GAUGE_DEFINE(ble_rx_queue);
+PERF_HIST_DEFINE(ble_isr, "us");
+
+LOG_MODULE_REGISTER(ble_handler, CONFIG_PETTAP_LOG_LEVEL);
 /*****************************************FUNCTION DEFINITION***********************************************/
 /**
  * @brief       : Callback function for UART reception
@@ -39,23 +57,27 @@ K_MSGQ_DEFINE(BleMsgQueue, MSG_SIZE, 10, 4);
 void BleReceptionCb(const struct device *dev, void *user_data)
 {
     uint8_t c;
+    uint32_t ulStamp = PERF_STAMP();
 
     if (!uart_irq_update(BleUart))
     {
-        printk("UART IRQ update failed\n\r");
+        PRINTK_RATELIMIT(LOG_RATE_ISR_MS, "UART IRQ update failed\n\r");
         return;
     }
 
     if (!uart_irq_rx_ready(BleUart))
     {
-        printk("UART IRQ RX not ready\n\r");
+        PRINTK_RATELIMIT(LOG_RATE_ISR_MS, "UART IRQ RX not ready\n\r");
         return;
     }
 
     if (!ReadBuffer())
     {
-        printk("Uart reception failed\n\r");
+        PRINTK_RATELIMIT(LOG_RATE_ISR_MS, "Uart reception failed\n\r");
+        return;
     }
+
+    PERF_HIST_SINCE_US(ble_isr, ulStamp);
 }
 
 
@@ -68,45 +90,74 @@ bool ReadBuffer(void)
 {
     uint8_t ucByte = 0;
     bool bRetval = false;
+    _eFrameStatus eStatus = FRAME_IN_PROGRESS;
 
-    if (uart_fifo_read(BleUart, &ucByte, 1) == 1)
+    while (uart_fifo_read(BleUart, &ucByte, 1) == 1)
     {
+        bRetval = true;
+        PERF_COUNT(ble_rx_bytes);
+        eStatus = PacketDecodeByte(&sRxDecoder, ucByte);
 
-        switch(eUartRxState)
+        if (eStatus == FRAME_ERROR)
         {
-            case START: if (ucByte == '*')
-                        {
-                            usRxBufferIdx = 0;
-                            memset(cRxBuffer, 0, sizeof(cRxBuffer));
-                            cRxBuffer[usRxBufferIdx++] = ucByte;
-                            eUartRxState = RCV;
-                        }
-                        break;
-
-            case RCV:   if (ucByte == '#')
-                        {
-                            cRxBuffer[usRxBufferIdx++] = ucByte;
-                            cRxBuffer[usRxBufferIdx++] = '\0';
-                            bRxCmplt = true;
-                            k_msgq_put(&BleMsgQueue, &cRxBuffer, K_NO_WAIT);
-                            eUartRxState = START;
-                            printk(".\n\r");
-                        }
-                        cRxBuffer[usRxBufferIdx++] = ucByte;
-                        break;
-
-            case END:   eUartRxState = START;
-                        usRxBufferIdx = 0;
-                        break;
-
-            default:    break;            
+            PERF_COUNT(ble_rx_errors);
+        }
+
+        if (eStatus != FRAME_COMPLETE)
+        {
+            continue;
+        }
+
+        PERF_COUNT(ble_rx_frames);
+
+#if defined(CONFIG_PETTAP_LINK_PM)
+        LinkPowerActivity(&sBlePower);
+#endif
+
+        if (!LinkBaudRxFromIsr(&sBleBaud, &sRxDecoder.sPacket))
+        {
+            //Dropped frames are recovered by retransmission from 52840
+            if (k_msgq_put(&BleMsgQueue, &sRxDecoder.sPacket, K_NO_WAIT) != 0)
+            {
+                PERF_COUNT(ble_rx_drops);
+            }
+
+            PERF_GAUGE(ble_rx_queue, k_msgq_num_used_get(&BleMsgQueue));
+            SystemWake();
         }
-        bRetval = true;
     }
  
     return bRetval;
 }
 
+/**
+ * @brief       : Serialize packet and put it on the UART, used by the link layer
+ * @param [in]  : psPacket - packet to transmit
+ * @param [out] : None
+ * @return      : true for success
+*/
+static bool TransmitFrame(const _sPacket *psPacket)
+{
+    uint8_t ucFrame[FRAME_MAX_SIZE] = {0};
+    uint16_t usLen = 0;
+
+    usLen = SerializePacket(psPacket, ucFrame, sizeof(ucFrame));
+
+    if (usLen)
+    {
+        PERF_COUNT(ble_tx_frames);
+#if defined(CONFIG_PETTAP_LINK_PM)
+        LinkPowerTxBegin(&sBlePower);
+#endif
+        SendBleMsg(ucFrame, usLen);
+#if defined(CONFIG_PETTAP_LINK_PM)
+        LinkPowerActivity(&sBlePower);
+#endif
+    }
+
+    return (usLen != 0);
+}
+
 /**
  * @brief       : Initialise UART channel for WIFI interfacing
  * @param [in]  : None
@@ -147,6 +198,22 @@ bool InitBleUart(void)
             }
         }
 
+        LinkInit(&sBleLink, TransmitFrame);
+
+        if (!LinkBaudInit(&sBleBaud, BleUart, LINK_BAUD_MASTER,
+                          DT_PROP(DT_NODELABEL(uart2), hw_flow_control),
+                          TransmitFrame, &sRxDecoder.sStats))
+        {
+            printk("WARN: UART rate negotiation unavailable\n\r");
+        }
+
+#if defined(CONFIG_PETTAP_LINK_PM)
+        if (!LinkPowerInit(&sBlePower, BleUart, &sWakeOut, &sWakeIn))
+        {
+            printk("WARN: Low-power link unavailable\n\r");
+        }
+#endif
+
         uart_irq_rx_enable(BleUart);
         printk("UART initialised\n\r");
         bRetVal = true;
@@ -163,15 +230,26 @@ bool InitBleUart(void)
 */
 void SendBleMsg(uint8_t *pucBuff, uint16_t usLen)
 {
-    printk("MsgLen: %d\n\r", usLen);
+    LOG_DBG("MsgLen: %d", usLen);
+    PERF_ADD(ble_tx_bytes, usLen);
 
-    for (int i = 0; i <= usLen; i++)
+    for (int i = 0; i < usLen; i++)
     {
         uart_poll_out(BleUart, pucBuff[i]);
-        k_msleep(5); //delay 5ms
     }
 }
 
+/**
+ * @brief       : Send packet to 52840, retransmitted until acknowledged
+ * @param [in]  : psPacket - packet to send
+ * @param [out] : None
+ * @return      : true if queued, false when the window is full
+*/
+bool SendPacket(_sPacket *psPacket)
+{
+    return LinkSend(&sBleLink, psPacket);
+}
+
 /**
  * @brief       : Process AT command response from WiFi module
  * @param [in]  : pcResp - AT command response
@@ -191,24 +269,57 @@ void ProcessBleResponse(const char *pcResp, bool *pbStatus)
 }
 
 /**
- * @brief       : Read BLE packet
+ * @brief       : Read BLE packet, does not wait
  * @param [in]  : None
- * @param [out] : pucBuffer : BLE packet buffer
- * @return      : true for success
+ * @param [out] : psPacket : packet received from 52840
+ * @return      : true for success, false when none is queued
 */
-bool ReadPacket(uint8_t *pucBuffer)
+bool ReadPacket(_sPacket *psPacket)
 {
     bool bRetVal = false;
 
-    if (0 == k_msgq_get(&BleMsgQueue, pucBuffer, K_MSEC(100)))
+    LinkBaudPoll(&sBleBaud);
+
+    //Retransmit anything overdue
+    (void)LinkPoll(&sBleLink);
+
+#if defined(CONFIG_PETTAP_LINK_PM)
+    LinkPowerPoll(&sBlePower, !LinkIsIdle(&sBleLink));
+    LinkBaudSetIdle(&sBleBaud, LinkPowerIsSuspended(&sBlePower));
+#endif
+
+    while (!bRetVal && 0 == k_msgq_get(&BleMsgQueue, psPacket, K_NO_WAIT))
     {
-        printk("Data Received\n\r");
-        bRetVal = true;
+        //ACKs and duplicates are consumed by the link layer
+        bRetVal = LinkReceive(&sBleLink, psPacket);
     }
 
     return bRetVal;
 }
 
+/**
+ * @brief       : Time the link layer can be left alone, received frames
+ *                wake the system task through SystemWake
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : ms until ReadPacket is due, UINT32_MAX if not needed
+*/
+uint32_t BleLinkWaitMs(void)
+{
+    //Retransmit anything overdue, the next one is due in the time returned
+    uint32_t ulWait = LinkPoll(&sBleLink);
+
+#if defined(CONFIG_PETTAP_LINK_PM)
+    //Wake line release and rate keepalive are polled until the UART is suspended
+    if (!LinkPowerIsSuspended(&sBlePower))
+#endif
+    {
+        ulWait = MIN(ulWait, RX_WAIT_MS);
+    }
+
+    return ulWait;
+}
+
 /**
  * @brief       : Send location data to BLE
  * @param [in]  : None
@@ -227,13 +338,60 @@ bool SendLocationToBle()
     if (psLocationData)
     {
         sprintf(cPayload,"%.6f,%.6f", psLocationData->dLatitude, psLocationData->dLongitude);
-        printk("sending data: %s\n\r", cPayload);
+        LOG_DBG("sending data: %s", cPayload);
         BuildPacket(&sPacket, RESP, (uint8_t *)cPayload, strlen(cPayload));
-        SendBleMsg(&sPacket, sizeof(_sPacket));
-        bRetVal = true;
+        bRetVal = SendPacket(&sPacket);
     }
 
     return bRetVal;
 }
 
+/**
+ * @brief       : Get statistics of the BLE UART link
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : frame statistics of the receiver
+*/
+const _sFrameStats *GetBleFrameStats(void)
+{
+    return &sRxDecoder.sStats;
+}
+
+/**
+ * @brief       : Get statistics of the reliable link to 52840
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : link statistics
+*/
+const _sLinkStats *GetBleLinkStats(void)
+{
+    return LinkGetStats(&sBleLink);
+}
+
+/**
+ * @brief       : Get negotiated rate and error counters of the link to 52840
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : rate negotiation statistics
+*/
+const _sLinkBaudStats *GetBleBaudStats(void)
+{
+    return LinkBaudGetStats(&sBleBaud);
+}
+
+/**
+ * @brief       : Get wake latency and suspended time of the link to 52840
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : low-power link statistics, NULL when not enabled
+*/
+const _sLinkPowerStats *GetBlePowerStats(void)
+{
+#if defined(CONFIG_PETTAP_LINK_PM)
+    return LinkPowerGetStats(&sBlePower);
+#else
+    return NULL;
+#endif
+}
+
 //EOF
\ No newline at end of file
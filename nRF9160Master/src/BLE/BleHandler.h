@@ -17,18 +17,10 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-
-/*********************************************************MACROS**************************************************/
-#define BUFFER_SIZE           1024
-
-/*********************************************************TYPEDEFS************************************************/
-
-typedef enum __eUartRxState
-{
-    START,
-    RCV,
-    END
-}_eUartRxState;
+#include "PacketFrame.h"
+#include "LinkReliable.h"
+#include "LinkBaud.h"
+#include "LinkPower.h"
 
 /**********************************************TYPEDEFS***************************************************/
 
@@ -36,8 +28,14 @@ typedef enum __eUartRxState
 /***********************************************FUNCTION DECLARATIONS**************************************/
 bool InitBleUart(void);
 void SendBleMsg(uint8_t *pucBuff, uint16_t usLen);
-bool ReadPacket(uint8_t *pucBuffer);
+bool SendPacket(_sPacket *psPacket);
+bool ReadPacket(_sPacket *psPacket);
+uint32_t BleLinkWaitMs(void);
 bool ReadBuffer(void);
+const _sFrameStats *GetBleFrameStats(void);
+const _sLinkStats *GetBleLinkStats(void);
+const _sLinkBaudStats *GetBleBaudStats(void);
+const _sLinkPowerStats *GetBlePowerStats(void);
 bool SendLocationToBle();
 #endif
 
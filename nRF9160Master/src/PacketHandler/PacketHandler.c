@@ -9,6 +9,7 @@
 #include "../WiFi/WiFiHandler.h"
 #include "../BLE/BleHandler.h"
 #include "../System/SystemHandler.h"
+#include "../System/PowerPolicy.h"
 #include "zephyr/kernel.h"
 #include <sys/_stdint.h>
 
@@ -17,6 +18,25 @@
 /*******************************************************TYPEDEFS***************************************************/
 
 /*******************************************************PRIVATE VARIABLES******************************************/
+static void HandleDisconnect(const _sCmd *psCmd);
+static void HandleLocation(const _sCmd *psCmd);
+static void HandleWifiCred(const _sCmd *psCmd);
+static void HandleWifiForget(const _sCmd *psCmd);
+static void HandlePowerMode(const _sCmd *psCmd);
+
+/*Commands accepted by the 9160, indexed by opcode*/
+static const cmdExecHandler pCmdHandlers[CMD_OPCODE_MAX] = {
+    [CMD_DISCONNECT]    = HandleDisconnect,
+    [CMD_LOCATION]      = HandleLocation,
+    [CMD_WIFI_CRED]     = HandleWifiCred,
+    [CMD_WIFI_FORGET]   = HandleWifiForget,
+    [CMD_POWER_MODE]    = HandlePowerMode,
+};
+
+static const _sPacketHandlers sPacketHandlers = {
+    .pCmdHandlers       = pCmdHandlers,
+    .RespHdlr           = ProcessResp,
+};
 
 /*******************************************************PUBLIC VARIABLES*******************************************/
 
@@ -24,26 +44,22 @@
 
 
 /**
- * @brief      : Build Packet to send
- * @param [in] : usLen - Length of the packet
- *             : PcktType - PacketType
- * @param [out]: psPacket - Packet to build
- *             : pucPayload - Payload to send
- * @return     : returns true on success
+ * @brief      : Process packet received
+ * @param [in] : None
+ * @param [out]: psPacket - Packet received
+ * @return     : true for success
 */
-bool BuildPacket(_sPacket *psPacket,_ePacketType PcktType, 
-                uint8_t *pucPayload, uint16_t usPayloadLen)
+bool ProcessRcvdPacket(_sPacket *psPacket)
 {
     bool bRetVal = false;
-    
-    // printk("Length of payload: %d\n\r", usPayloadLen);
-    if (psPacket && pucPayload)
+
+    if (psPacket)
     {
-        psPacket->ucStartByte = START_BYTE;
-        psPacket->PacketType = PcktType;
-        memcpy(psPacket->pucPayload, pucPayload, usPayloadLen);
-        psPacket->usLen = usPayloadLen;
-        psPacket->ucEndByte = END_BYTE;
+        if (!PacketDispatch(psPacket, &sPacketHandlers) && psPacket->PacketType == CMD)
+        {
+            printk("ERR: Unsupported command\n\r");
+        }
+
         bRetVal = true;
     }
 
@@ -51,123 +67,89 @@ bool BuildPacket(_sPacket *psPacket,_ePacketType PcktType,
 }
 
 /**
- * @brief      : Parse packet received
- * @param [in] : None
- * @param [out]: pucRcvdBuffer - Receieved Buffer
- *             : psPacket - Packet received
- * @return     : true for success
+ * @brief      : Handle DISCONNECT command
+ * @param [in] : psCmd - decoded command
+ * @param [out]: None
+ * @return     : None
 */
-bool ParsePacket(uint8_t *pucRcvdBuffer, _sPacket *psPacket)
+static void HandleDisconnect(const _sCmd *psCmd)
 {
-    bool bRetVal = false;
+    _eDevState eState = *GetDeviceState();
+
+    PowerPolicySetCentral(false);
 
-    if (pucRcvdBuffer && psPacket)
+    //Sleep is left through the power policy only
+    if (eState != DEV_SLEEP && eState != DEV_SLEEPING)
     {
-        memcpy(psPacket, pucRcvdBuffer, sizeof(_sPacket));
-        bRetVal = true;
+        SetDeviceState(WAIT_CONNECTION);
     }
-
-    return bRetVal;
 }
 
 /**
- * @brief      : Parse packet received
- * @param [in] : None
- * @param [out]: pucRcvdBuffer - Receieved Buffer
- *             : psPacket - Packet received
- * @return     : true for success
+ * @brief      : Handle LOCATION command
+ * @param [in] : psCmd - decoded command
+ * @param [out]: None
+ * @return     : None
 */
-bool ProcessRcvdPacket(_sPacket *psPacket)
+static void HandleLocation(const _sCmd *psCmd)
 {
-    bool bRetVal = false;
-
-    if (psPacket)
+    if (IsLocationDataOK())
     {
-        switch (psPacket->PacketType)
-        {
-            case CMD : ProcessCmd(psPacket->pucPayload);
-                    break;
-            case RESP: ProcessResp(psPacket->pucPayload);
-                    break;
-            case DATA: //ProcessData
-                    break;
-            case ACK:  //ProcessAcknowlodge
-                    break;
-            default  :
-                    break;
-        }
-
-        bRetVal = true;
+        SendLocationToBle();
+    }
+    else
+    {
+        printk("Didnt get location fix\n\r");
     }
-
-    return bRetVal;
 }
 
 /**
- * @brief      : parseWifiCred
- * @param [in] : pcCmd
- * @param [out]: pcCredential
+ * @brief      : Handle WiFi credential command, adds AP to the known APs
+ * @param [in] : psCmd - decoded command
+ * @param [out]: None
  * @return     : None
 */
-void parseWifiCred(const char *pcCmd, char *pcCredential)
+static void HandleWifiCred(const _sCmd *psCmd)
 {
-    char cSSID[20] = {0};
-    char cPassword[50] = {0};
-    if (sscanf(pcCmd, "ssid:%[^,],pwd:%s", cSSID, cPassword) == 2)
-    {
-        sprintf(pcCredential, "%s,%s", cSSID, cPassword);
-    }
-    else
+    printk("Config: ssid %s\n\r", psCmd->uArgs.sWifiCred.cSSID);
+
+    //An AP already joined is kept, the new one is ranked at next scan
+    if (AddWiFiAP(psCmd->uArgs.sWifiCred.cSSID, psCmd->uArgs.sWifiCred.cPassword) && !IsAPJoined())
     {
-        printf("Error: Enter ssid and pwd in the format- ssid:<username>,pwd:<password>");  //no space after comma
-        pcCredential[0] = '\0';
+        SetDeviceState(DEV_IDLE);
     }
-    
 }
 
 /**
- * @brief      : Process command
- * @param [in] : 
+ * @brief      : Handle WiFi forget command, removes AP from the known APs
+ * @param [in] : psCmd - decoded command
  * @param [out]: None
- * @return     : true for success
+ * @return     : None
 */
-bool ProcessCmd(char *pcCmd)
+static void HandleWifiForget(const _sCmd *psCmd)
 {
-    bool bRetVal = false;
-    char cBuffer[80] = {0};
+    printk("Config: forget ssid %s\n\r", psCmd->uArgs.sWifiCred.cSSID);
 
-    if (pcCmd)
+    if (RemoveWiFiAP(psCmd->uArgs.sWifiCred.cSSID) &&
+        strcmp(GetWiFiSSID(), psCmd->uArgs.sWifiCred.cSSID) == 0 && IsAPJoined())
     {
-#ifdef nRF52840    
-        if (strcmp(pcCmd, "CONNECT") == 0)
-        {        
-            SetDeviceState(DEVICE_CONNECTED);
+        DisconnectFromWiFi();
+        SetDeviceState(DEV_IDLE);
+    }
+}
 
-        }
-#endif
-        if (strcmp(pcCmd, "DISCONNECT") == 0)
-        {
-            SetDeviceState(WAIT_CONNECTION);
-        }
-        else if(strcmp(pcCmd, "LOCATION") == 0)
-        {
-            if (IsLocationDataOK())
-            {
-                SendLocationToBle();
-            }
-            else
-            {
-                printk("Didnt get location fix\n\r");
-            }
-        }
-        else if(strstr(pcCmd, "ssid") != NULL)
-        {
-            printk("Config: %s\n\r", pcCmd);
-            parseWifiCred(pcCmd, cBuffer);
-            SetAPCredentials(cBuffer);
-            DisconnectFromWiFi();
-            SetDeviceState(DEV_IDLE);
-        }
+/**
+ * @brief      : Handle POWER_MODE command, 52840 asks to leave sleep when a
+ *               central connects while advertising slowly
+ * @param [in] : psCmd - decoded command
+ * @param [out]: None
+ * @return     : None
+*/
+static void HandlePowerMode(const _sCmd *psCmd)
+{
+    if (psCmd->uArgs.ePowerMode == POWER_ACTIVE)
+    {
+        PowerPolicySetCentral(true);
     }
 }
 
@@ -209,10 +191,12 @@ bool ProcessResp(char *pcResp)
     {
         if (strcmp(pcResp, "ACK") == 0)
         {
+            PowerPolicySetCentral(true);
             UpdateStateAfterResponse(true);
         }
         else if (strcmp(pcResp, "NACK") == 0)
         {
+            PowerPolicySetCentral(false);
             UpdateStateAfterResponse(false);
         }
 
@@ -0,0 +1,192 @@
+/**
+ * @file    : LoadGen.c
+ * @brief   : Load generator driving the simulated DA16200 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : LoadGen.h
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "LoadGen.h"
+#include "SimDa16200.h"
+#include "SimPeer.h"
+#include "../BLE/BleHandler.h"
+
+/*******************************************MACROS**********************************************************/
+#define LOAD_STACK_SIZE     1536
+#define LOAD_PRIORITY       6       //Below the simulated chips, above application threads
+#define LOAD_TICK_MS        5
+#define LOAD_URC_MAX        64
+
+/******************************************TYPEDEFS*********************************************************/
+typedef struct __sDepthAcc
+{
+    uint32_t ulMax;
+    uint32_t ulSum;
+    uint32_t ulFull;
+}_sDepthAcc;
+
+/******************************************PRIVATE GLOBALS**************************************************/
+static _sLoadGenStats sLoadStats = {0};
+static _sDepthAcc sUartAcc = {0};
+static _sDepthAcc sBleAcc = {0};
+static uint32_t ulSamples = 0;
+
+/*Queues filled by the UART ISRs of WiFiHandler and BleHandler*/
+extern struct k_msgq UartMsgQueue;
+extern struct k_msgq BleMsgQueue;
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/**
+ * @brief       : Sample depth of a message queue
+ * @param [in]  : psQueue - queue
+ * @param [out] : psAcc - accumulated depth
+ * @return      : None
+*/
+static void SampleQueue(struct k_msgq *psQueue, _sDepthAcc *psAcc)
+{
+    uint32_t ulUsed = k_msgq_num_used_get(psQueue);
+
+    psAcc->ulMax = MAX(psAcc->ulMax, ulUsed);
+    psAcc->ulSum += ulUsed;
+
+    if (k_msgq_num_free_get(psQueue) == 0)
+    {
+        psAcc->ulFull++;
+    }
+}
+
+/**
+ * @brief       : Close a report interval of a queue
+ * @param [in]  : psAcc - accumulated depth, cleared
+ * @param [out] : psDepth - depth over the interval
+ * @return      : None
+*/
+static void TakeDepth(_sDepthAcc *psAcc, _sQueueDepth *psDepth)
+{
+    psDepth->ulMax = psAcc->ulMax;
+    psDepth->ulAvgX100 = ulSamples ? (psAcc->ulSum * 100) / ulSamples : 0;
+    psDepth->ulFullSamples += psAcc->ulFull;
+    memset(psAcc, 0, sizeof(*psAcc));
+}
+
+/**
+ * @brief       : Print counters of both links
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : None
+*/
+static void PrintReport(void)
+{
+    const _sSimPeerStats *psPeer = GetSimPeerStats();
+    const _sLinkStats *psPeerLink = GetSimPeerLinkStats();
+    const _sFrameStats *psFrames = GetBleFrameStats();
+    const _sSimDaStats *psDa = GetSimDaStats();
+
+    TakeDepth(&sUartAcc, &sLoadStats.sUartQueue);
+    TakeDepth(&sBleAcc, &sLoadStats.sBleQueue);
+    ulSamples = 0;
+
+    printk("INFO: Load %u s, %u cmds, %u urcs requested\n\r", sLoadStats.ulSeconds,
+           sLoadStats.ulCmdsRequested, sLoadStats.ulUrcsSent);
+    printk("INFO: BLE cmds %u sent %u refused %u overrun, resp %u lost %u, latency %u/%u/%u ms\n\r",
+           psPeer->ulCmdsSent, psPeer->ulCmdsRefused, psPeer->ulCmdOverruns, psPeer->ulResps,
+           psPeer->ulUnanswered, psPeer->ulLatencyMinMs, psPeer->ulLatencyAvgMs,
+           psPeer->ulLatencyMaxMs);
+    printk("INFO: BLE retransmits %u, srtt %u ms, injected errors %u, crc %u framing %u\n\r",
+           psPeerLink->ulRetransmits, psPeerLink->ulSrttMs, psPeer->ulCorrupted,
+           psFrames->ulCrcErrors, psFrames->ulFramingErrors);
+    printk("INFO: WiFi cmds %u errors %u, lines %u, lines on full queue %u, turnaround %u/%u ms\n\r",
+           psDa->ulCmds, psDa->ulErrors, psDa->ulLines, psDa->ulQueueFullLines,
+           psDa->ulTurnaroundAvgMs, psDa->ulTurnaroundMaxMs);
+    printk("INFO: Queue depth UartMsgQueue max %u avg %u.%02u full %u, BleMsgQueue max %u avg %u.%02u full %u\n\r",
+           sLoadStats.sUartQueue.ulMax, sLoadStats.sUartQueue.ulAvgX100 / 100,
+           sLoadStats.sUartQueue.ulAvgX100 % 100, sLoadStats.sUartQueue.ulFullSamples,
+           sLoadStats.sBleQueue.ulMax, sLoadStats.sBleQueue.ulAvgX100 / 100,
+           sLoadStats.sBleQueue.ulAvgX100 % 100, sLoadStats.sBleQueue.ulFullSamples);
+}
+
+/**
+ * @brief       : Get load generator counters
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : statistics, queue depth of the last report interval
+*/
+const _sLoadGenStats *GetLoadGenStats(void)
+{
+    return &sLoadStats;
+}
+
+/**
+ * @brief       : Load generator task
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : None
+*/
+static void LoadGenTask(void)
+{
+    const uint32_t ulCmdPeriodUs = USEC_PER_SEC / CONFIG_PETTAP_SIM_LOAD_CMD_RATE;
+    const uint32_t ulUrcPeriodUs = CONFIG_PETTAP_SIM_LOAD_URC_RATE ?
+                                   USEC_PER_SEC / CONFIG_PETTAP_SIM_LOAD_URC_RATE : 0;
+    char cUrc[LOAD_URC_MAX];
+    uint64_t ullStart = 0;
+    uint64_t ullNowUs = 0;
+    uint64_t ullNextCmdUs = 0;
+    uint64_t ullNextUrcUs = 0;
+    uint64_t ullNextReportUs = 0;
+
+    //Load starts once the link is up, bring-up is not measured
+    while (!SimPeerIsConnected())
+    {
+        k_msleep(100);
+    }
+
+    printk("INFO: Load started, %d cmd/s, %d urc/s\n\r", CONFIG_PETTAP_SIM_LOAD_CMD_RATE,
+           CONFIG_PETTAP_SIM_LOAD_URC_RATE);
+
+    ullStart = k_ticks_to_us_floor64(k_uptime_ticks());
+    ullNextCmdUs = ullStart;
+    ullNextUrcUs = ullStart;
+    ullNextReportUs = ullStart + (uint64_t)CONFIG_PETTAP_SIM_LOAD_REPORT_S * USEC_PER_SEC;
+
+    while (1)
+    {
+        ullNowUs = k_ticks_to_us_floor64(k_uptime_ticks());
+
+        while (ullNowUs >= ullNextCmdUs)
+        {
+            SimPeerRequestCmd(CMD_LOCATION);
+            sLoadStats.ulCmdsRequested++;
+            ullNextCmdUs += ulCmdPeriodUs;
+        }
+
+        //Lines the application ignores, they only occupy UartMsgQueue
+        while (ulUrcPeriodUs && ullNowUs >= ullNextUrcUs)
+        {
+            snprintf(cUrc, sizeof(cUrc), "+NWMQMSG:load,%u", sLoadStats.ulUrcsSent);
+            SimDa16200Urc(cUrc);
+            sLoadStats.ulUrcsSent++;
+            ullNextUrcUs += ulUrcPeriodUs;
+        }
+
+        SampleQueue(&UartMsgQueue, &sUartAcc);
+        SampleQueue(&BleMsgQueue, &sBleAcc);
+        ulSamples++;
+
+        if (ullNowUs >= ullNextReportUs)
+        {
+            sLoadStats.ulSeconds = (uint32_t)((ullNowUs - ullStart) / USEC_PER_SEC);
+            PrintReport();
+            ullNextReportUs += (uint64_t)CONFIG_PETTAP_SIM_LOAD_REPORT_S * USEC_PER_SEC;
+        }
+
+        k_msleep(LOAD_TICK_MS);
+    }
+}
+
+K_THREAD_DEFINE(LoadGenThread, LOAD_STACK_SIZE, LoadGenTask, NULL, NULL, NULL,
+                LOAD_PRIORITY, 0, 0);
+
+//EOF
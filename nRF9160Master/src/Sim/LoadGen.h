@@ -0,0 +1,42 @@
+/**
+ * @file    : LoadGen.h
+ * @brief   : Load generator driving the simulated DA16200 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : LoadGen.c
+ * @note    : Once the simulated 52840 is connected, LOCATION commands and
+ *            unsolicited DA16200 lines are injected at fixed rates while
+ *            the depth of UartMsgQueue and BleMsgQueue is sampled. A report
+ *            is printed every CONFIG_PETTAP_SIM_LOAD_REPORT_S seconds.
+*/
+
+#ifndef _LOAD_GEN_H
+#define _LOAD_GEN_H
+
+/*********************************************INCLUDES***************************************************/
+#include <zephyr/kernel.h>
+#include <stdint.h>
+
+/**********************************************TYPEDEFS***************************************************/
+typedef struct __sQueueDepth
+{
+    uint32_t ulMax;                 //Since last report
+    uint32_t ulAvgX100;             //Average since last report, times 100
+    uint32_t ulFullSamples;         //Samples with no free entry, since start
+}_sQueueDepth;
+
+typedef struct __sLoadGenStats
+{
+    uint32_t ulSeconds;             //Time under load
+    uint32_t ulCmdsRequested;
+    uint32_t ulUrcsSent;
+    _sQueueDepth sUartQueue;
+    _sQueueDepth sBleQueue;
+}_sLoadGenStats;
+
+/***********************************************FUNCTION DECLARATIONS**************************************/
+const _sLoadGenStats *GetLoadGenStats(void);
+
+#endif
+
+//EOF
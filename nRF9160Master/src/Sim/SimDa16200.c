@@ -0,0 +1,454 @@
+/**
+ * @file    : SimDa16200.c
+ * @brief   : Scripted DA16200 AT responder on an emulated UART
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : SimDa16200.h
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <zephyr/drivers/serial/uart_emul.h>
+#include <zephyr/random/rand32.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "SimDa16200.h"
+
+/*******************************************MACROS**********************************************************/
+#define SIM_STACK_SIZE      1024
+#define SIM_PRIORITY        5       //Above application threads, module runs on its own
+#define SIM_POLL_MS         2
+#define SIM_LINE_MAX        256
+#define SIM_SSID_MAX        32
+#define SIM_IP_ADDR         "192.168.1.100"
+
+/******************************************TYPEDEFS*********************************************************/
+typedef void (*simAtHandler)(const char *pcArgs);
+
+typedef struct __sSimAtCmd
+{
+    const char *pcPrefix;
+    simAtHandler Hdlr;
+}_sSimAtCmd;
+
+typedef struct __sSimAp
+{
+    const char *pcSSID;
+    const char *pcBssid;
+    uint16_t usFreq;
+    int8_t cRssi;
+}_sSimAp;
+
+/******************************************PRIVATE GLOBALS**************************************************/
+static const struct device *DaUart = DEVICE_DT_GET(DT_NODELABEL(uart1));
+/*Line assembly of commands written by 9160*/
+static char cCmdLine[SIM_LINE_MAX];
+static uint16_t usCmdIdx = 0;
+static bool bJoined = false;
+static char cJoinSSID[SIM_SSID_MAX + 1];
+static uint32_t ulLastReplyAt = 0;
+static uint64_t ullTurnaroundSumMs = 0;
+static uint32_t ulTurnarounds = 0;
+static _sSimDaStats sDaStats = {0};
+static struct k_work_delayable sJoinWork;
+/*In sleep mode 2 the module answers nothing until its RTC wakes it*/
+static bool bAsleep = false;
+static struct k_work_delayable sWakeWork;
+
+K_MUTEX_DEFINE(DaTxLock);
+
+/*Queue filled by WiFiHandler, watched to estimate drops*/
+extern struct k_msgq UartMsgQueue;
+
+/*APs in range, first one matches the built-in credentials*/
+static const _sSimAp sSimAps[] = {
+    {"Alcodex",         "a0:b1:c2:d3:e4:01",    2437,   -52},
+    {"PetTapGuest",     "a0:b1:c2:d3:e4:02",    2412,   -67},
+    {"Neighbour",       "3c:84:6a:10:22:7f",    2462,   -81},
+};
+
+static void HandleAt(const char *pcArgs);
+static void HandleJoin(const char *pcArgs);
+static void HandleScan(const char *pcArgs);
+static void HandleStat(const char *pcArgs);
+static void HandleSta(const char *pcArgs);
+static void HandleQuit(const char *pcArgs);
+static void HandleAws(const char *pcArgs);
+static void HandleSleep(const char *pcArgs);
+
+/*Longer prefixes first, matched in order*/
+static const _sSimAtCmd sSimAtCmds[] = {
+    {"AT+WFJAPA=",      HandleJoin  },
+    {"AT+WFSCAN",       HandleScan  },
+    {"AT+WFSTAT",       HandleStat  },
+    {"AT+WFSTA",        HandleSta   },
+    {"AT+WFQAP",        HandleQuit  },
+    {"AT+WFMODE=",      HandleAt    },
+    {"AT+AWS=",         HandleAws   },
+    {"AT+SETSLEEP2EXT=",HandleSleep },
+    {"AT",              HandleAt    },
+};
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/**
+ * @brief       : Send one line to 9160
+ * @param [in]  : pcLine - line without line end
+ * @param [out] : None
+ * @return      : None
+*/
+static void PutLine(const char *pcLine)
+{
+    char cLine[SIM_LINE_MAX + 2];
+    int nLen = 0;
+
+    nLen = snprintf(cLine, sizeof(cLine), "%s\r\n", pcLine);
+    nLen = MIN(nLen, (int)sizeof(cLine) - 1);
+
+    k_mutex_lock(&DaTxLock, K_FOREVER);
+
+    //Line is lost by the ISR if nothing is taken from the queue in the meantime
+    if (k_msgq_num_free_get(&UartMsgQueue) == 0)
+    {
+        sDaStats.ulQueueFullLines++;
+    }
+
+    uart_emul_put_rx_data(DaUart, (uint8_t *)cLine, nLen);
+    sDaStats.ulLines++;
+
+    k_mutex_unlock(&DaTxLock);
+}
+
+/**
+ * @brief       : Send the final line of a command reply
+ * @param [in]  : pcLine - line without line end
+ * @param [out] : None
+ * @return      : None
+*/
+static void PutReply(const char *pcLine)
+{
+    PutLine(pcLine);
+    ulLastReplyAt = k_uptime_get_32();
+}
+
+/**
+ * @brief       : Find an AP in range
+ * @param [in]  : pcSSID - SSID
+ * @param [out] : None
+ * @return      : AP, NULL if not in range
+*/
+static const _sSimAp *FindAp(const char *pcSSID)
+{
+    for (int nIdx = 0; nIdx < ARRAY_SIZE(sSimAps); nIdx++)
+    {
+        if (strcmp(sSimAps[nIdx].pcSSID, pcSSID) == 0)
+        {
+            return &sSimAps[nIdx];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief       : Report join result, AP join takes CONFIG_PETTAP_SIM_WIFI_JOIN_MS
+ * @param [in]  : psWork - join work
+ * @param [out] : None
+ * @return      : None
+*/
+static void JoinWorkFn(struct k_work *psWork)
+{
+    char cUrc[SIM_LINE_MAX];
+
+    if (FindAp(cJoinSSID))
+    {
+        bJoined = true;
+        sDaStats.ulJoins++;
+        snprintf(cUrc, sizeof(cUrc), "+WFJAP:1,'%s',%s", cJoinSSID, SIM_IP_ADDR);
+        PutLine(cUrc);
+    }
+    else
+    {
+        PutLine("+WFJAP:0");
+    }
+}
+
+/**
+ * @brief       : Plain commands, always accepted
+ * @param [in]  : pcArgs - command after the prefix
+ * @param [out] : None
+ * @return      : None
+*/
+static void HandleAt(const char *pcArgs)
+{
+    PutReply("OK");
+}
+
+/**
+ * @brief       : AT+WFJAPA=ssid,password, result follows as URC
+ * @param [in]  : pcArgs - command after the prefix
+ * @param [out] : None
+ * @return      : None
+*/
+static void HandleJoin(const char *pcArgs)
+{
+    size_t ulLen = MIN(strcspn(pcArgs, ","), SIM_SSID_MAX);
+
+    memcpy(cJoinSSID, pcArgs, ulLen);
+    cJoinSSID[ulLen] = '\0';
+    bJoined = false;
+
+    PutReply("OK");
+    k_work_reschedule(&sJoinWork, K_MSEC(CONFIG_PETTAP_SIM_WIFI_JOIN_MS));
+}
+
+/**
+ * @brief       : AT+WFSCAN, one line per AP closed by OK
+ * @param [in]  : pcArgs - command after the prefix
+ * @param [out] : None
+ * @return      : None
+*/
+static void HandleScan(const char *pcArgs)
+{
+    char cLine[SIM_LINE_MAX];
+    int8_t cRssi = 0;
+
+    for (int nIdx = 0; nIdx < ARRAY_SIZE(sSimAps); nIdx++)
+    {
+        //Few dB of fading between scans
+        cRssi = sSimAps[nIdx].cRssi + (int8_t)(sys_rand32_get() % 7) - 3;
+        snprintf(cLine, sizeof(cLine), "+WFSCAN:%s\t%u\t%d\t[WPA2-PSK-CCMP][ESS]\t%s",
+                 sSimAps[nIdx].pcBssid, sSimAps[nIdx].usFreq, cRssi, sSimAps[nIdx].pcSSID);
+        PutLine(cLine);
+    }
+
+    PutReply("OK");
+}
+
+/**
+ * @brief       : AT+WFSTAT, key=value report closed by OK
+ * @param [in]  : pcArgs - command after the prefix
+ * @param [out] : None
+ * @return      : None
+*/
+static void HandleStat(const char *pcArgs)
+{
+    const _sSimAp *psAp = FindAp(cJoinSSID);
+    char cLine[SIM_LINE_MAX];
+
+    if (bJoined && psAp)
+    {
+        snprintf(cLine, sizeof(cLine), "bssid=%s", psAp->pcBssid);
+        PutLine(cLine);
+        snprintf(cLine, sizeof(cLine), "freq=%u", psAp->usFreq);
+        PutLine(cLine);
+        snprintf(cLine, sizeof(cLine), "ssid=%s", psAp->pcSSID);
+        PutLine(cLine);
+        PutLine("ip_address=" SIM_IP_ADDR);
+        PutLine("wpa_state=COMPLETED");
+    }
+    else
+    {
+        PutLine("wpa_state=DISCONNECTED");
+    }
+
+    PutReply("OK");
+}
+
+/**
+ * @brief       : AT+WFSTA, connection status
+ * @param [in]  : pcArgs - command after the prefix
+ * @param [out] : None
+ * @return      : None
+*/
+static void HandleSta(const char *pcArgs)
+{
+    PutReply(bJoined ? "+WFSTA:1" : "+WFSTA:0");
+}
+
+/**
+ * @brief       : AT+WFQAP, leave the AP
+ * @param [in]  : pcArgs - command after the prefix
+ * @param [out] : None
+ * @return      : None
+*/
+static void HandleQuit(const char *pcArgs)
+{
+    bool bWasJoined = bJoined;
+
+    bJoined = false;
+    k_work_cancel_delayable(&sJoinWork);
+    PutReply("OK");
+
+    if (bWasJoined)
+    {
+        PutLine("+WFDAP:0");
+    }
+}
+
+/**
+ * @brief       : AT+AWS=..., configuration and publish
+ * @param [in]  : pcArgs - command after the prefix
+ * @param [out] : None
+ * @return      : None
+*/
+static void HandleAws(const char *pcArgs)
+{
+    //Publishing needs the AP, configuration is stored in NVRAM right away
+    if (strncmp(pcArgs, "CMD MCU_DATA", strlen("CMD MCU_DATA")) == 0 && !bJoined)
+    {
+        PutReply("ERROR");
+    }
+    else
+    {
+        PutReply("OK");
+    }
+}
+
+/**
+ * @brief       : Module boots again after sleep
+ * @param [in]  : psWork - wake work
+ * @param [out] : None
+ * @return      : None
+*/
+static void WakeWorkFn(struct k_work *psWork)
+{
+    bAsleep = false;
+    PutLine("+INIT:WAKEUP,0");
+}
+
+/**
+ * @brief       : AT+SETSLEEP2EXT=<seconds>,<rtm>, sleep until the RTC wakes
+ *                the module
+ * @param [in]  : pcArgs - command after the prefix
+ * @param [out] : None
+ * @return      : None
+*/
+static void HandleSleep(const char *pcArgs)
+{
+    uint32_t ulSeconds = strtoul(pcArgs, NULL, 10);
+
+    PutReply("OK");
+    bJoined = false;
+    bAsleep = true;
+    sDaStats.ulSleeps++;
+    k_work_cancel_delayable(&sJoinWork);
+    k_work_reschedule(&sWakeWork, K_SECONDS(ulSeconds));
+}
+
+/**
+ * @brief       : Answer one AT command
+ * @param [in]  : pcCmd - command without line end
+ * @param [out] : None
+ * @return      : None
+*/
+static void ProcessCmd(const char *pcCmd)
+{
+    uint32_t ulNow = k_uptime_get_32();
+    uint32_t ulTurnaround = 0;
+
+    sDaStats.ulCmds++;
+
+    if (bAsleep)
+    {
+        return;
+    }
+
+    if (ulLastReplyAt)
+    {
+        ulTurnaround = ulNow - ulLastReplyAt;
+        ulLastReplyAt = 0;
+        ulTurnarounds++;
+        ullTurnaroundSumMs += ulTurnaround;
+        sDaStats.ulTurnaroundAvgMs = (uint32_t)(ullTurnaroundSumMs / ulTurnarounds);
+        sDaStats.ulTurnaroundMaxMs = MAX(sDaStats.ulTurnaroundMaxMs, ulTurnaround);
+    }
+
+    k_msleep(CONFIG_PETTAP_SIM_WIFI_LATENCY_MS);
+
+    if ((sys_rand32_get() % 1000) < CONFIG_PETTAP_SIM_WIFI_ERROR_PERMILLE)
+    {
+        sDaStats.ulErrors++;
+        PutReply("ERROR");
+        return;
+    }
+
+    for (int nIdx = 0; nIdx < ARRAY_SIZE(sSimAtCmds); nIdx++)
+    {
+        if (strncmp(pcCmd, sSimAtCmds[nIdx].pcPrefix, strlen(sSimAtCmds[nIdx].pcPrefix)) == 0)
+        {
+            sSimAtCmds[nIdx].Hdlr(pcCmd + strlen(sSimAtCmds[nIdx].pcPrefix));
+            return;
+        }
+    }
+
+    PutReply("ERROR");
+}
+
+/**
+ * @brief       : Queue an unsolicited line, used by the load generator
+ * @param [in]  : pcLine - line without line end
+ * @param [out] : None
+ * @return      : None
+*/
+void SimDa16200Urc(const char *pcLine)
+{
+    PutLine(pcLine);
+}
+
+/**
+ * @brief       : Get counters of the simulated module
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : statistics
+*/
+const _sSimDaStats *GetSimDaStats(void)
+{
+    return &sDaStats;
+}
+
+/**
+ * @brief       : Simulated module, collects commands written by 9160
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : None
+*/
+static void SimDaTask(void)
+{
+    uint8_t ucBuf[64];
+    uint32_t ulCount = 0;
+
+    k_work_init_delayable(&sJoinWork, JoinWorkFn);
+    k_work_init_delayable(&sWakeWork, WakeWorkFn);
+
+    while (1)
+    {
+        ulCount = uart_emul_get_tx_data(DaUart, ucBuf, sizeof(ucBuf));
+
+        for (uint32_t ulIdx = 0; ulIdx < ulCount; ulIdx++)
+        {
+            if (ucBuf[ulIdx] == '\r' || ucBuf[ulIdx] == '\n')
+            {
+                if (usCmdIdx)
+                {
+                    cCmdLine[usCmdIdx] = '\0';
+                    usCmdIdx = 0;
+                    ProcessCmd(cCmdLine);
+                }
+            }
+            else if (usCmdIdx < sizeof(cCmdLine) - 1)
+            {
+                cCmdLine[usCmdIdx++] = ucBuf[ulIdx];
+            }
+        }
+
+        if (!ulCount)
+        {
+            k_msleep(SIM_POLL_MS);
+        }
+    }
+}
+
+K_THREAD_DEFINE(SimDaThread, SIM_STACK_SIZE, SimDaTask, NULL, NULL, NULL,
+                SIM_PRIORITY, 0, 0);
+
+//EOF
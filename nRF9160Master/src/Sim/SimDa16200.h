@@ -0,0 +1,39 @@
+/**
+ * @file    : SimDa16200.h
+ * @brief   : Scripted DA16200 AT responder on an emulated UART
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : SimDa16200.c
+ * @note    : Stands in for the WiFi module on uart1 when the node is a
+ *            zephyr,uart-emul device (see sim.overlay). WiFiHandler runs
+ *            unchanged against it.
+*/
+
+#ifndef _SIM_DA16200_H
+#define _SIM_DA16200_H
+
+/*********************************************INCLUDES***************************************************/
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**********************************************TYPEDEFS***************************************************/
+typedef struct __sSimDaStats
+{
+    uint32_t ulCmds;                //AT commands received
+    uint32_t ulErrors;              //Commands answered with injected ERROR
+    uint32_t ulLines;               //Lines sent to 9160
+    uint32_t ulQueueFullLines;      //Lines sent while UartMsgQueue was full
+    uint32_t ulTurnaroundAvgMs;     //Last reply to next command
+    uint32_t ulTurnaroundMaxMs;
+    uint32_t ulJoins;
+    uint32_t ulSleeps;              //Sleep mode 2 entries
+}_sSimDaStats;
+
+/***********************************************FUNCTION DECLARATIONS**************************************/
+void SimDa16200Urc(const char *pcLine);
+const _sSimDaStats *GetSimDaStats(void);
+
+#endif
+
+//EOF
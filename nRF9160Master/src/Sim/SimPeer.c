@@ -0,0 +1,339 @@
+/**
+ * @file    : SimPeer.c
+ * @brief   : Virtual 52840 speaking the packet protocol on an emulated UART
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : SimPeer.h
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <zephyr/drivers/serial/uart_emul.h>
+#include <zephyr/random/rand32.h>
+#include <string.h>
+#include "SimPeer.h"
+
+/*******************************************MACROS**********************************************************/
+#define SIM_STACK_SIZE      1536
+#define SIM_PRIORITY        5       //Above application threads, peer runs on its own
+#define SIM_POLL_MS         2
+#define SIM_RESP_TIMEOUT_MS 1000    //Timed command given up after
+
+/*Rate negotiation operations, values of _eCtrlOp in LinkBaud.c*/
+#define SIM_CTRL_BAUD_REQ       1
+#define SIM_CTRL_BAUD_ACK       2
+#define SIM_CTRL_PROBE          3
+#define SIM_CTRL_ECHO           4
+#define SIM_CTRL_COMMIT         5
+#define SIM_CTRL_COMMIT_ACK     6
+#define SIM_CTRL_KEEPALIVE      7
+
+/******************************************PRIVATE GLOBALS**************************************************/
+static const struct device *PeerUart = DEVICE_DT_GET(DT_NODELABEL(uart2));
+/*Frames written by 9160*/
+static _sPacketDecoder sPeerDecoder = {.eState = FRAME_START};
+/*Sequencing and retransmission towards 9160*/
+static _sLinkReliable sPeerLink;
+static bool bConnected = false;
+/*One command at a time is timed*/
+static bool bTimedCmd = false;
+static uint32_t ulTimedCmdAt = 0;
+static uint64_t ullLatencySumMs = 0;
+static _sSimPeerStats sPeerStats = {0};
+
+/*Commands requested by the load generator, sent from the peer thread*/
+K_MSGQ_DEFINE(SimPeerCmdQueue, sizeof(uint8_t), 16, 1);
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/**
+ * @brief       : Serialize packet and hand it to the 9160 UART receiver
+ * @param [in]  : psPacket - packet to transmit
+ * @param [out] : None
+ * @return      : true for success
+*/
+static bool PeerTransmit(const _sPacket *psPacket)
+{
+    uint8_t ucFrame[FRAME_MAX_SIZE] = {0};
+    uint16_t usLen = 0;
+
+    usLen = SerializePacket(psPacket, ucFrame, sizeof(ucFrame));
+
+    if (!usLen)
+    {
+        return false;
+    }
+
+    //Bit error somewhere past the start byte, caught by CRC or framing on 9160
+    if ((sys_rand32_get() % 1000) < CONFIG_PETTAP_SIM_PEER_CORRUPT_PERMILLE)
+    {
+        ucFrame[1 + (sys_rand32_get() % (usLen - 1))] ^= BIT(sys_rand32_get() % 8);
+        sPeerStats.ulCorrupted++;
+    }
+
+    uart_emul_put_rx_data(PeerUart, ucFrame, usLen);
+
+    return true;
+}
+
+/**
+ * @brief       : Encode a command and send it over the reliable link
+ * @param [in]  : eId - command
+ * @param [out] : None
+ * @return      : true if accepted by the link window
+*/
+static bool PeerSendCmd(_eCmdId eId)
+{
+    uint8_t ucPayload[DATA_SIZE] = {0};
+    _sPacket sPacket = {0};
+    _sCmd sCmd = {.eId = eId};
+    uint16_t usLen = 0;
+
+    usLen = CmdEncode(&sCmd, ucPayload, sizeof(ucPayload));
+
+    if (!usLen || !BuildPacket(&sPacket, CMD, ucPayload, usLen) || !LinkSend(&sPeerLink, &sPacket))
+    {
+        sPeerStats.ulCmdsRefused++;
+        return false;
+    }
+
+    sPeerStats.ulCmdsSent++;
+
+    //Only LOCATION is answered by 9160
+    if (eId == CMD_LOCATION && !bTimedCmd)
+    {
+        bTimedCmd = true;
+        ulTimedCmdAt = k_uptime_get_32();
+    }
+
+    return true;
+}
+
+/**
+ * @brief       : Send a text response over the reliable link
+ * @param [in]  : pcResp - response text
+ * @param [out] : None
+ * @return      : None
+*/
+static void PeerSendResp(const char *pcResp)
+{
+    _sPacket sPacket = {0};
+
+    if (BuildPacket(&sPacket, RESP, (uint8_t *)pcResp, strlen(pcResp)))
+    {
+        LinkSend(&sPeerLink, &sPacket);
+    }
+}
+
+/**
+ * @brief       : Answer rate negotiation like a 52840 slave. The emulated
+ *                UART has no bit timing, so any rate is accepted.
+ * @param [in]  : psPacket - control packet from 9160
+ * @param [out] : None
+ * @return      : None
+*/
+static void PeerHandleCtrl(_sPacket *psPacket)
+{
+    _sPacket sReply = {0};
+    uint8_t ucReply[3] = {0};
+    uint16_t usLen = 0;
+
+    if (!psPacket->usLen)
+    {
+        return;
+    }
+
+    switch (psPacket->pucPayload[0])
+    {
+        case SIM_CTRL_BAUD_REQ:
+                    ucReply[0] = SIM_CTRL_BAUD_ACK;
+                    ucReply[1] = psPacket->pucPayload[1];
+                    ucReply[2] = 0;
+                    usLen = 3;
+                    break;
+
+        case SIM_CTRL_COMMIT:
+                    ucReply[0] = SIM_CTRL_COMMIT_ACK;
+                    ucReply[1] = psPacket->pucPayload[1];
+                    usLen = 2;
+                    break;
+
+        case SIM_CTRL_PROBE:
+                    psPacket->pucPayload[0] = SIM_CTRL_ECHO;
+                    /* fall through */
+        case SIM_CTRL_KEEPALIVE:
+                    if (BuildPacket(&sReply, CTRL, psPacket->pucPayload, psPacket->usLen))
+                    {
+                        PeerTransmit(&sReply);
+                        sPeerStats.ulCtrlFrames++;
+                    }
+                    return;
+
+        default:
+                    return;
+    }
+
+    if (BuildPacket(&sReply, CTRL, ucReply, usLen))
+    {
+        PeerTransmit(&sReply);
+        sPeerStats.ulCtrlFrames++;
+    }
+}
+
+/**
+ * @brief       : Handle a complete frame from 9160
+ * @param [in]  : psPacket - decoded packet
+ * @param [out] : None
+ * @return      : None
+*/
+static void PeerHandlePacket(_sPacket *psPacket)
+{
+    _sCmd sCmd = {0};
+    uint32_t ulLatency = 0;
+
+    if (psPacket->PacketType == CTRL)
+    {
+        PeerHandleCtrl(psPacket);
+        return;
+    }
+
+    //ACKs and duplicates are consumed by the link layer
+    if (!LinkReceive(&sPeerLink, psPacket))
+    {
+        return;
+    }
+
+    switch (psPacket->PacketType)
+    {
+        case CMD:
+                    k_msleep(CONFIG_PETTAP_SIM_PEER_LATENCY_MS);
+
+                    if (CmdDecode(psPacket->pucPayload, psPacket->usLen, &sCmd) &&
+                        sCmd.eId == CMD_CONNECT)
+                    {
+                        bConnected = true;
+                        PeerSendResp("ACK");
+                    }
+                    break;
+
+        case RESP:
+                    if (bTimedCmd)
+                    {
+                        bTimedCmd = false;
+                        ulLatency = k_uptime_get_32() - ulTimedCmdAt;
+                        sPeerStats.ulResps++;
+                        ullLatencySumMs += ulLatency;
+                        sPeerStats.ulLatencyAvgMs = (uint32_t)(ullLatencySumMs / sPeerStats.ulResps);
+                        sPeerStats.ulLatencyMaxMs = MAX(sPeerStats.ulLatencyMaxMs, ulLatency);
+                        sPeerStats.ulLatencyMinMs = (sPeerStats.ulResps == 1) ? ulLatency :
+                                                    MIN(sPeerStats.ulLatencyMinMs, ulLatency);
+                    }
+                    break;
+
+        default:
+                    break;
+    }
+}
+
+/**
+ * @brief       : Ask the peer to send a command to 9160
+ * @param [in]  : eId - command
+ * @param [out] : None
+ * @return      : true if queued
+*/
+bool SimPeerRequestCmd(_eCmdId eId)
+{
+    uint8_t ucId = (uint8_t)eId;
+
+    if (k_msgq_put(&SimPeerCmdQueue, &ucId, K_NO_WAIT) != 0)
+    {
+        sPeerStats.ulCmdOverruns++;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief       : Check if 9160 has connected to the peer
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true after CONNECT was answered
+*/
+bool SimPeerIsConnected(void)
+{
+    return bConnected;
+}
+
+/**
+ * @brief       : Get counters of the simulated peer
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : statistics
+*/
+const _sSimPeerStats *GetSimPeerStats(void)
+{
+    return &sPeerStats;
+}
+
+/**
+ * @brief       : Get statistics of the reliable link towards 9160,
+ *                retransmissions are frames 9160 did not take in
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : link statistics
+*/
+const _sLinkStats *GetSimPeerLinkStats(void)
+{
+    return LinkGetStats(&sPeerLink);
+}
+
+/**
+ * @brief       : Simulated 52840, decodes frames written by 9160 and
+ *                sends queued commands
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : None
+*/
+static void SimPeerTask(void)
+{
+    uint8_t ucBuf[64];
+    uint32_t ulCount = 0;
+    uint8_t ucId = 0;
+
+    LinkInit(&sPeerLink, PeerTransmit);
+
+    while (1)
+    {
+        ulCount = uart_emul_get_tx_data(PeerUart, ucBuf, sizeof(ucBuf));
+
+        for (uint32_t ulIdx = 0; ulIdx < ulCount; ulIdx++)
+        {
+            if (PacketDecodeByte(&sPeerDecoder, ucBuf[ulIdx]) == FRAME_COMPLETE)
+            {
+                PeerHandlePacket(&sPeerDecoder.sPacket);
+            }
+        }
+
+        while (0 == k_msgq_get(&SimPeerCmdQueue, &ucId, K_NO_WAIT))
+        {
+            PeerSendCmd((_eCmdId)ucId);
+        }
+
+        if (bTimedCmd && (k_uptime_get_32() - ulTimedCmdAt) >= SIM_RESP_TIMEOUT_MS)
+        {
+            bTimedCmd = false;
+            sPeerStats.ulUnanswered++;
+        }
+
+        LinkPoll(&sPeerLink);
+
+        if (!ulCount)
+        {
+            k_msleep(SIM_POLL_MS);
+        }
+    }
+}
+
+K_THREAD_DEFINE(SimPeerThread, SIM_STACK_SIZE, SimPeerTask, NULL, NULL, NULL,
+                SIM_PRIORITY, 0, 0);
+
+//EOF
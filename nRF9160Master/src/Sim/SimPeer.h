@@ -0,0 +1,45 @@
+/**
+ * @file    : SimPeer.h
+ * @brief   : Virtual 52840 speaking the packet protocol on an emulated UART
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : SimPeer.c
+ * @note    : Stands in for the 52840 on uart2 when the node is a
+ *            zephyr,uart-emul device (see sim.overlay). BleHandler runs
+ *            unchanged against it.
+*/
+
+#ifndef _SIM_PEER_H
+#define _SIM_PEER_H
+
+/*********************************************INCLUDES***************************************************/
+#include <zephyr/kernel.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "PacketFrame.h"
+#include "LinkReliable.h"
+
+/**********************************************TYPEDEFS***************************************************/
+typedef struct __sSimPeerStats
+{
+    uint32_t ulCmdsSent;            //Commands accepted by the link window
+    uint32_t ulCmdsRefused;         //Window full, 9160 not acknowledging fast enough
+    uint32_t ulCmdOverruns;         //Requests lost, peer could not keep up with the load
+    uint32_t ulResps;               //Responses to a timed command
+    uint32_t ulUnanswered;          //Timed commands without response
+    uint32_t ulLatencyMinMs;        //Command to response
+    uint32_t ulLatencyAvgMs;
+    uint32_t ulLatencyMaxMs;
+    uint32_t ulCorrupted;           //Frames to 9160 with an injected bit error
+    uint32_t ulCtrlFrames;          //Rate negotiation frames answered
+}_sSimPeerStats;
+
+/***********************************************FUNCTION DECLARATIONS**************************************/
+bool SimPeerRequestCmd(_eCmdId eId);
+bool SimPeerIsConnected(void);
+const _sSimPeerStats *GetSimPeerStats(void);
+const _sLinkStats *GetSimPeerLinkStats(void);
+
+#endif
+
+//EOF
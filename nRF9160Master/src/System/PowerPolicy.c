@@ -0,0 +1,264 @@
+/**
+ * @file    : PowerPolicy.c
+ * @brief   : Joint power state of the 9160, DA16200 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : PowerPolicy.h
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <math.h>
+#include <zephyr/kernel.h>
+#include "PowerPolicy.h"
+#include "PerfStats.h"
+
+/*******************************************MACROS**********************************************************/
+#define STATIONARY_MS       ((uint32_t)CONFIG_PETTAP_POWER_STATIONARY_S * MSEC_PER_SEC)
+#define EARTH_RADIUS_M      6371000.0
+#define DEG_TO_RAD          (3.14159265358979323846 / 180.0)
+
+/******************************************GLOBALS VARIABLES**********************************************/
+static _ePowerState eCurState = POWER_STATE_ROAMING;
+static uint32_t ulStateSince = 0;
+static bool bCentral = false;
+static uint32_t ulLastMove = 0;
+static bool bAnchorSet = false;
+static double dAnchorLat = 0.0;
+static double dAnchorLon = 0.0;
+static powerStateHandler StateHandler = NULL;
+K_MUTEX_DEFINE(PowerLock);
+
+static const char *const pcStateNames[POWER_STATE_MAX] = {
+    [POWER_STATE_ACTIVE]    = "ACTIVE",
+    [POWER_STATE_ROAMING]   = "ROAMING",
+    [POWER_STATE_SLEEP]     = "SLEEP",
+};
+
+PERF_COUNTER_DEFINE(power_active_ms);
+PERF_COUNTER_DEFINE(power_roaming_ms);
+PERF_COUNTER_DEFINE(power_sleep_ms);
+PERF_COUNTER_DEFINE(power_transitions);
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/**
+ * @brief      : Distance between two positions, equirectangular
+ *               approximation good enough for tens of metres
+ * @param [in] : dLat1, dLon1, dLat2, dLon2 - positions in degrees
+ * @param [out]: None
+ * @return     : distance in metres
+*/
+static double DistanceM(double dLat1, double dLon1, double dLat2, double dLon2)
+{
+    double dX = (dLon2 - dLon1) * DEG_TO_RAD * cos((dLat1 + dLat2) * 0.5 * DEG_TO_RAD);
+    double dY = (dLat2 - dLat1) * DEG_TO_RAD;
+
+    return sqrt(dX * dX + dY * dY) * EARTH_RADIUS_M;
+}
+
+/**
+ * @brief      : Print a timestamped power transition of one domain
+ * @param [in] : pcDomain - SYSTEM, GNSS, LTE, WIFI or BLE
+ *               pcState - state entered
+ * @param [out]: None
+ * @return     : None
+*/
+void PowerLog(const char *pcDomain, const char *pcState)
+{
+    printk("PWR: t=%u %s %s\n\r", k_uptime_get_32(), pcDomain, pcState);
+}
+
+/**
+ * @brief      : Account time spent in the state being left
+ * @param [in] : eFrom - state left
+ *               ulMs - time spent in it
+ * @param [out]: None
+ * @return     : None
+*/
+static void AccountResidency(_ePowerState eFrom, uint32_t ulMs)
+{
+    PERF_COUNT(power_transitions);
+
+    switch (eFrom)
+    {
+        case POWER_STATE_ACTIVE:
+                PERF_ADD(power_active_ms, ulMs);
+                break;
+
+        case POWER_STATE_ROAMING:
+                PERF_ADD(power_roaming_ms, ulMs);
+                break;
+
+        case POWER_STATE_SLEEP:
+                PERF_ADD(power_sleep_ms, ulMs);
+                break;
+
+        default:
+                break;
+    }
+}
+
+/**
+ * @brief      : Register the handler applying GNSS and LTE settings
+ * @param [in] : Handler - called on each power state change, may be NULL
+ * @param [out]: None
+ * @return     : true for success
+*/
+bool PowerPolicyInit(powerStateHandler Handler)
+{
+    k_mutex_lock(&PowerLock, K_FOREVER);
+    StateHandler = Handler;
+    ulStateSince = k_uptime_get_32();
+    //Boot counts as movement, sleep is entered only after a full quiet period
+    ulLastMove = ulStateSince;
+    k_mutex_unlock(&PowerLock);
+
+    PowerLog("SYSTEM", pcStateNames[eCurState]);
+
+    return true;
+}
+
+/**
+ * @brief      : Update BLE central state as reported by the 52840
+ * @param [in] : bConnected - true if a central is connected
+ * @param [out]: None
+ * @return     : None
+*/
+void PowerPolicySetCentral(bool bConnected)
+{
+    k_mutex_lock(&PowerLock, K_FOREVER);
+    bCentral = bConnected;
+    k_mutex_unlock(&PowerLock);
+}
+
+/**
+ * @brief      : Check a GNSS fix against the last anchor position
+ * @param [in] : psLocation - fix
+ * @param [out]: None
+ * @return     : None
+*/
+void PowerPolicyFix(const _sGnssConfig *psLocation)
+{
+    if (!psLocation)
+    {
+        return;
+    }
+
+    k_mutex_lock(&PowerLock, K_FOREVER);
+
+    if (!bAnchorSet || DistanceM(dAnchorLat, dAnchorLon, psLocation->dLatitude,
+                                 psLocation->dLongitude) > CONFIG_PETTAP_POWER_MOVE_M)
+    {
+        //First fix after boot is not taken as movement
+        if (bAnchorSet)
+        {
+            ulLastMove = k_uptime_get_32();
+        }
+
+        dAnchorLat = psLocation->dLatitude;
+        dAnchorLon = psLocation->dLongitude;
+        bAnchorSet = true;
+    }
+
+    k_mutex_unlock(&PowerLock);
+}
+
+/**
+ * @brief      : Report movement seen by other means, such as arriving at or
+ *               leaving a known WiFi place
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : None
+*/
+void PowerPolicyMoved(void)
+{
+    k_mutex_lock(&PowerLock, K_FOREVER);
+    ulLastMove = k_uptime_get_32();
+    //Next fix becomes the new anchor
+    bAnchorSet = false;
+    k_mutex_unlock(&PowerLock);
+}
+
+/**
+ * @brief      : Evaluate the power state, call periodically from the
+ *               system task
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : None
+*/
+void PowerPolicyProcess(void)
+{
+    _ePowerState eNext = POWER_STATE_ROAMING;
+    _ePowerState ePrev = POWER_STATE_ROAMING;
+    uint32_t ulNow = k_uptime_get_32();
+    uint32_t ulSpent = 0;
+
+    k_mutex_lock(&PowerLock, K_FOREVER);
+
+    if (bCentral)
+    {
+        eNext = POWER_STATE_ACTIVE;
+    }
+    else if (STATIONARY_MS && (ulNow - ulLastMove) >= STATIONARY_MS)
+    {
+        eNext = POWER_STATE_SLEEP;
+    }
+
+    ePrev = eCurState;
+    ulSpent = ulNow - ulStateSince;
+
+    if (eNext != ePrev)
+    {
+        eCurState = eNext;
+        ulStateSince = ulNow;
+    }
+
+    k_mutex_unlock(&PowerLock);
+
+    if (eNext == ePrev)
+    {
+        return;
+    }
+
+    AccountResidency(ePrev, ulSpent);
+    printk("PWR: t=%u SYSTEM %s after %u ms in %s\n\r", ulNow, pcStateNames[eNext],
+           ulSpent, pcStateNames[ePrev]);
+
+    //Device state machine powers the DA16200 and the 52840 down and up
+    if (eNext == POWER_STATE_SLEEP)
+    {
+        SetDeviceState(DEV_SLEEP);
+    }
+    else if (ePrev == POWER_STATE_SLEEP)
+    {
+        SetDeviceState(DEV_WAKEUP);
+    }
+
+    if (StateHandler)
+    {
+        StateHandler(eNext);
+    }
+}
+
+/**
+ * @brief      : Get current power state
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : power state
+*/
+_ePowerState PowerPolicyGetState(void)
+{
+    return eCurState;
+}
+
+/**
+ * @brief      : Get name of a power state
+ * @param [in] : eState - power state
+ * @param [out]: None
+ * @return     : name, "UNKNOWN" if invalid
+*/
+const char *PowerPolicyStateName(_ePowerState eState)
+{
+    return (eState < POWER_STATE_MAX) ? pcStateNames[eState] : "UNKNOWN";
+}
+
+//EOF
@@ -0,0 +1,49 @@
+/**
+ * @file    : PowerPolicy.h
+ * @brief   : Joint power state of the 9160, DA16200 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : PowerPolicy.c
+ * @note    : The power state follows from whether a BLE central is
+ *            connected to the 52840 and whether the pet has moved in the
+ *            last CONFIG_PETTAP_POWER_STATIONARY_S seconds. Movement is
+ *            taken from GNSS fixes and from WiFi place changes. With no
+ *            central and no movement the device state machine is put in
+ *            DEV_SLEEP, see SystemHandler.c. Each transition is printed as
+ *            "PWR: t=<uptime ms> <domain> <state>" so the time spent in a
+ *            state can be matched with a current capture.
+*/
+
+#ifndef _POWER_POLICY_H
+#define _POWER_POLICY_H
+
+/*********************************************INCLUDES***************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "SystemHandler.h"
+
+/**********************************************TYPEDEFS***************************************************/
+typedef enum __ePowerState
+{
+    POWER_STATE_ACTIVE,             //BLE central connected
+    POWER_STATE_ROAMING,            //No central, pet moving
+    POWER_STATE_SLEEP,              //No central, pet stationary
+    POWER_STATE_MAX
+}_ePowerState;
+
+/*Called from the system task after each power state change*/
+typedef void (*powerStateHandler)(_ePowerState eState);
+
+/***********************************************FUNCTION DECLARATIONS**************************************/
+bool PowerPolicyInit(powerStateHandler Handler);
+void PowerPolicySetCentral(bool bConnected);
+void PowerPolicyFix(const _sGnssConfig *psLocation);
+void PowerPolicyMoved(void);
+void PowerPolicyProcess(void);
+_ePowerState PowerPolicyGetState(void);
+const char *PowerPolicyStateName(_ePowerState eState);
+void PowerLog(const char *pcDomain, const char *pcState);
+
+#endif
+
+//EOF
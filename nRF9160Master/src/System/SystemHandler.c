@@ -10,64 +10,140 @@
 #include "SystemHandler.h"
 #include "../WiFi/WiFiHandler.h"
 #include "../PacketHandler/PacketHandler.h"
+#include "../BLE/BleHandler.h"
+#include "../Transport/TransportArbiter.h"
+#include "PowerPolicy.h"
+#include "TimerService.h"
+#include <zephyr/logging/log.h>
 
 /*******************************************MACROS**********************************************************/
-#define BUFFER_SIZE     255
+/*Delivery is handled by the link layer, this only paces new requests after a NACK*/
+#define CONN_REQ_INTERVAL_MS    2000
+/*Rescan for a known AP while none is in range*/
+#define WIFI_RETRY_MS           30000
+/*Rescan for a known place while joined*/
+#define WIFI_POS_SCAN_MS        60000
+/*Put DA16200 back to sleep after it woke on its own timer*/
+#define WIFI_SLEEP_RETRY_MS     5000
+/*Location handed to the arbiter while on WiFi*/
+#define PUBLISH_PERIOD_MS       30000
+/*Timers may expire this much late to share a wake-up, see TimerService*/
+#define CONN_REQ_SLACK_MS       250
+#define WIFI_RETRY_SLACK_MS     2000
+#define POS_SCAN_SLACK_MS       5000
+#define PUBLISH_SLACK_MS        2000
+/*Longest sleep of the system task, for the checks still made against
+  uptime (power policy, transport retry, WiFi DPM and wake-up)*/
+#define SYSTEM_IDLE_MS          1000
+
+LOG_MODULE_REGISTER(system_handler, CONFIG_PETTAP_LOG_LEVEL);
 
 /******************************************TYPEDEFS*********************************************************/
 static _eDevState DevState = DEV_IDLE;
 _sGnssConfig sGnssConfig = {0.0,0.0,false};
 static bool bConfigStatus = false;
-struct k_timer Timer;
-static bool TimerExpired = false;
+static bool bConnReqSent = false;
+/*Expiries wake the system task, which then checks TimerSvcExpired*/
+static TIMER_SVC_DEFINE(ConnReqTimer, SystemWake, NULL, CONN_REQ_SLACK_MS);
+static TIMER_SVC_DEFINE(WiFiRetryTimer, SystemWake, NULL, WIFI_RETRY_SLACK_MS);
+static TIMER_SVC_DEFINE(PosScanTimer, SystemWake, NULL, POS_SCAN_SLACK_MS);
+static TIMER_SVC_DEFINE(PublishTimer, SystemWake, NULL, PUBLISH_SLACK_MS);
+
+/*Given by UART reception, timer expiries, state changes and uploads*/
+K_SEM_DEFINE(SystemWakeSem, 0, 1);
 
 /*****************************************FUNCTION DEFINITION***********************************************/
 /**
- * @brief       : Connect to a 52840 device 
- * @param [in]  : None
+ * @brief       : Encode and send a command to 52840
+ * @param [in]  : psCmd - command to send
  * @param [out] : none
  * @return      : true for success
 */
-static bool ConnectToBLE()
+static bool SendCmd(const _sCmd *psCmd)
 {
-    uint8_t ucPayload[BUFFER_SIZE] = {0};
+    uint8_t ucPayload[DATA_SIZE] = {0};
     _sPacket sPacket = {0};
+    uint16_t usLen = 0;
     bool bRetVal = false;
 
-    strcpy((char *)ucPayload, "CONNECT");
+    usLen = CmdEncode(psCmd, ucPayload, sizeof(ucPayload));
 
-    if (BuildPacket(&sPacket, CMD, ucPayload, strlen((char *)ucPayload)))
+    if (usLen && BuildPacket(&sPacket, CMD, ucPayload, usLen))
     {
-        SendBleMsg((uint8_t *)&sPacket, sizeof(_sPacket));
-        bRetVal = true;
+        bRetVal = SendPacket(&sPacket);
     }
 
     return bRetVal;
 }
 
 /**
- * @brief       : Process Device state of MASTER device
+ * @brief       : Connect to a 52840 device 
+ * @param [in]  : None
+ * @param [out] : none
+ * @return      : true for success
+*/
+static bool ConnectToBLE()
+{
+    _sCmd sCmd = {.eId = CMD_CONNECT};
+
+    return SendCmd(&sCmd);
+}
+
+/**
+ * @brief       : Request a power mode from the 52840
+ * @param [in]  : ePowerMode - POWER_SLEEP for slow advertising
+ * @param [out] : none
+ * @return      : true for success
+*/
+static bool SetBlePowerMode(_ePowerMode ePowerMode)
+{
+    _sCmd sCmd = {.eId = CMD_POWER_MODE, .uArgs.ePowerMode = ePowerMode};
+
+    return SendCmd(&sCmd);
+}
+
+/**
+ * @brief       : Process packets received from 52840
  * @param [in]  : None
  * @param [out] : none
  * @return      : None
 */
 void ProcessBleMsg()
 {
-    uint32_t TimeNow = 0;
-    uint8_t ucBuff[BUFFER_SIZE];
     _sPacket sPacket = {0};
 
-    if (ReadPacket(ucBuff))
+    while (ReadPacket(&sPacket))
     {
-        printk("Received packet\n\r");
-
-        if (ParsePacket(ucBuff, &sPacket))
-        {
-            ProcessRcvdPacket(&sPacket);
-        }
+        LOG_DBG("Received packet");
+        ProcessRcvdPacket(&sPacket);
     }
 }
 
+/**
+ * @brief       : Wake the system task, may be called from ISR
+ * @param [in]  : None
+ * @param [out] : none
+ * @return      : None
+*/
+void SystemWake(void)
+{
+    k_sem_give(&SystemWakeSem);
+}
+
+/**
+ * @brief       : Block the system task until there is work or the BLE
+ *                link layer is due
+ * @param [in]  : None
+ * @param [out] : none
+ * @return      : None
+*/
+void SystemWait(void)
+{
+    uint32_t ulWait = MIN(BleLinkWaitMs(), SYSTEM_IDLE_MS);
+
+    (void)k_sem_take(&SystemWakeSem, K_MSEC(ulWait));
+}
+
 /**
  * @brief       : Process Device state of MASTER device
  * @param [in]  : None
@@ -85,7 +161,20 @@ void ProcessDeviceState()
                     //Perform Configuration
                     printk("INFO: IDLE STATE\n\r");
 
-                    do
+                    //Last AP known, skip the full configuration
+                    if (RejoinWiFi())
+                    {
+                        bConfigStatus = true;
+                        nRetry = -1;
+                    }
+                    else if (!SelectWiFiAP())
+                    {
+                        //Do not spend association attempts on absent networks
+                        printk("INFO: No known AP in range\n\r");
+                        nRetry = -1;
+                    }
+
+                    while (nRetry-- >= 0)
                     {
                         if (ConfigureWiFi())
                         {
@@ -96,64 +185,72 @@ void ProcessDeviceState()
                         {
                             printk("ERR: WiFi Conn failed\n\r");
                         }
-                    } while (nRetry-- > 0);
+                    }
 
-                    SetDeviceState(WAIT_CONNECTION);
+                    TimerSvcStart(&WiFiRetryTimer, WIFI_RETRY_MS, 0);
+
+                    //Join URC may already have been consumed while configuring
+                    SetDeviceState(IsAPJoined() ? WIFI_CONNECTED : WAIT_CONNECTION);
                     break;
 
         case WAIT_CONNECTION:
-                    printk("Info: Sending connection request to BLE\n\r");
-                    if (ConnectToBLE())
-                    {
-                        SetDeviceState(WAIT_CONNECTION);
-                    }
-                    else
+                    if (!bConnReqSent || TimerSvcExpired(&ConnReqTimer))
                     {
-                        printk("ERR: BLE Conn failed\n\r");                        
+                        printk("Info: Sending connection request to BLE\n\r");
+                        TimerSvcStart(&ConnReqTimer, CONN_REQ_INTERVAL_MS, 0);
+                        bConnReqSent = true;
+
+                        if (!ConnectToBLE())
+                        {
+                            printk("ERR: BLE Conn failed\n\r");
+                        }
                     }
 
-                    if (!bConfigStatus)
+                    if ((!bConfigStatus || IsAPJoinFailed()) && !IsWiFiAsleep() &&
+                        TimerSvcExpired(&WiFiRetryTimer))
                     {
+                        bConfigStatus = false;
+                        bConnReqSent = false;
                         SetDeviceState(DEV_IDLE);
                     }
-
-                    printk("INFO: waiting connection\n\r");
-                    k_msleep(500);
                     break;
 
         case WIFI_CONNECTED:
                     printk("INFO: Connected to WiFi\n\r");
-                    InitTimerTask(30);
+                    UpdateAPProfile();
+                    TimerSvcStart(&PosScanTimer, 0, WIFI_POS_SCAN_MS);
+                    TimerSvcStart(&PublishTimer, 0, PUBLISH_PERIOD_MS);
                     SetDeviceState(WIFI_DEVICE);
                     break;
 
         case WIFI_DEVICE:
-                    if (TimerExpired)
-                    {   if (IsWiFiConnected)
-                        {
-                            if (IsLocationDataOK())
-                            {
-                                if (SendLocation())
-                                {
-                                    printk("INFO: Location sent success\n\r");
-                                    TimerExpired=false;
-                                }
-                            }
-                        }                   
+                    //GNSS is switched off while the scan matches a known place
+                    if (TimerSvcExpired(&PosScanTimer))
+                    {
+                        ScanWiFiPosition();
                     }
 
-                    k_msleep(500);
+                    //Upload goes over the cheapest link up, see TransportArbiter
+                    if (IsLocationDataOK() && TimerSvcExpired(&PublishTimer))
+                    {
+                        if (TransportPublish(GetLocationData()))
+                        {
+                            printk("INFO: Location queued for upload\n\r");
+                        }
+                    }
                     break;
 
         case WIFI_DISCONNECTED:
                     printk("INFO: AP is not visble\n\r");
                     DisconnectFromWiFi();
-                    StopTimer();
+                    TimerSvcStop(&PublishTimer);
+                    TimerSvcStop(&PosScanTimer);
                     SetDeviceState(WAIT_CONNECTION);
                     break;
 
         case BLE_CONNECTED:
                     printk("INFO: Connected to BLE\n\r");
+                    bConnReqSent = false;
                     SetDeviceState(BLE_DEVICE);
                     break;
 
@@ -161,6 +258,56 @@ void ProcessDeviceState()
                     //No Operation
                     break;
 
+        case DEV_SLEEP:
+                    printk("INFO: Entering sleep\n\r");
+
+                    if (!SetBlePowerMode(POWER_SLEEP))
+                    {
+                        printk("ERR: BLE sleep request failed\n\r");
+                    }
+
+                    TimerSvcStop(&PublishTimer);
+                    TimerSvcStop(&PosScanTimer);
+
+                    if (IsAPJoined())
+                    {
+                        DisconnectFromWiFi();
+                    }
+
+                    bConfigStatus = false;
+                    bConnReqSent = false;
+                    //LTE is idled by the arbiter and may stay in PSM
+                    TransportHold(true);
+                    TimerSvcStart(&WiFiRetryTimer, 0, 0);
+                    SetDeviceState(DEV_SLEEPING);
+                    break;
+
+        case DEV_SLEEPING:
+                    //DA16200 boots again on its RTC timer
+                    if (!IsWiFiAsleep() && TimerSvcExpired(&WiFiRetryTimer))
+                    {
+                        TimerSvcStart(&WiFiRetryTimer, WIFI_SLEEP_RETRY_MS, 0);
+                        SleepWiFi(CONFIG_PETTAP_POWER_WIFI_WAKE_S);
+                    }
+                    break;
+
+        case DEV_WAKEUP:
+                    printk("INFO: Waking up\n\r");
+
+                    if (!SetBlePowerMode(POWER_ACTIVE))
+                    {
+                        printk("ERR: BLE wake request failed\n\r");
+                    }
+
+                    TransportHold(false);
+                    WakeWiFi();
+
+                    //WiFi is configured as soon as the module has booted
+                    bConfigStatus = false;
+                    TimerSvcStart(&WiFiRetryTimer, 0, 0);
+                    SetDeviceState(WAIT_CONNECTION);
+                    break;
+
         default        :
                     break;
     }
@@ -186,6 +333,8 @@ _eDevState *GetDeviceState()
 void SetDeviceState(_eDevState DeviceState)
 {
     DevState = DeviceState;
+    //Next state is run without waiting for other work
+    SystemWake();
 }
 
 /**
@@ -242,61 +391,4 @@ void SetLocationDataStatus(bool bStatus)
     sGnssConfig.bLocationUpdated = bStatus;
 }
 
-/**
- * @brief       : Timer task expired callback
- * @param [in]  : None
- * @param [out] : timer - timer handle
- * @return      : None
-*/
-static void TimerExpiredCb(struct k_timer *timer)
-{
-    //Callback for sending data over Wifi/BLE/LTE
-    switch(DevState)
-    {
-        case WIFI_DEVICE :  printk("INFO: TimerExpired Callback\n\r");
-                            TimerExpired = true;
-                            break;
-
-        case BLE_DEVICE  :  
-                            break;
-
-        default          :
-                            break;
-    }
-}
-
-/**
- * @brief       : Timer task stopped callback
- * @param [in]  : None
- * @param [out] : timer - timer handle
- * @return      : None
-*/
-static void TimerStoppedCb(struct k_timer *timer)
-{
-    printk("INFO timer stopped\n\r");
-}
-
-/**
- * @brief       : Initialise and start Timer task 
- * @param [in]  : nPeriod - period of timer 
- * @param [out] : None
- * @return      : None
-*/
-void InitTimerTask(int nPeriod)
-{
-    k_timer_init(&Timer, TimerExpiredCb, TimerStoppedCb);
-    k_timer_start(&Timer, K_SECONDS(0), K_SECONDS(nPeriod));
-}
-
-/**
- * @brief       : Stop Timer task 
- * @param [in]  : None 
- * @param [out] : None
- * @return      : None
-*/
-void StopTimer()
-{
-    k_timer_stop(&Timer);
-}
-
 //EOF
\ No newline at end of file
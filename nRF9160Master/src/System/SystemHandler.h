@@ -25,6 +25,9 @@ typedef enum __eDevState
     WIFI_DEVICE,
     BLE_DEVICE,
     DEV_IDLE,
+    DEV_SLEEP,                      //Power down peers, see PowerPolicy
+    DEV_SLEEPING,
+    DEV_WAKEUP,
 }_eDevState;
 
 typedef struct __sGnssConfig
@@ -37,12 +40,13 @@ typedef struct __sGnssConfig
 /**********************************************FUNCTION DECLARATIONS*************************************/
 void ProcessDeviceState();
 void ProcessBleMsg();
+void SystemWake(void);
+void SystemWait(void);
 _eDevState *GetDeviceState();
 void SetDeviceState(_eDevState DeviceState);
 bool IsLocationDataOK(void);
 void SetLocationDataStatus(bool bStatus);
 bool UpdateLocation(_sGnssConfig *psLocationData);
-void InitTimerTask(int nPeriod);
 _sGnssConfig * GetLocationData();
 
 #endif
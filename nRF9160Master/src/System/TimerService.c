@@ -0,0 +1,262 @@
+/**
+ * @file    : TimerService.c
+ * @brief   : Shared deadline queue for the periodic work of the system
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : TimerService.h
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include "TimerService.h"
+#include "PerfStats.h"
+
+/******************************************GLOBALS VARIABLES**********************************************/
+/*Active timers, earliest deadline first*/
+static _sTimerSvc *psTimerHead = NULL;
+
+K_MUTEX_DEFINE(TimerSvcLock);
+
+PERF_COUNTER_DEFINE(timer_wakeups);
+PERF_COUNTER_DEFINE(timer_expiries);
+PERF_COUNTER_DEFINE(timer_coalesced);
+PERF_HIST_DEFINE(timer_late, "ms");
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+static void TimerSvcWorkFn(struct k_work *psWork);
+
+K_WORK_DELAYABLE_DEFINE(TimerSvcWork, TimerSvcWorkFn);
+
+/**
+ * @brief      : Remove a timer from the list, call with lock held
+ * @param [in] : psTimer - timer
+ * @param [out]: None
+ * @return     : None
+*/
+static void Unlink(_sTimerSvc *psTimer)
+{
+    _sTimerSvc **ppsLink = &psTimerHead;
+
+    while (*ppsLink && *ppsLink != psTimer)
+    {
+        ppsLink = &(*ppsLink)->psNext;
+    }
+
+    if (*ppsLink)
+    {
+        *ppsLink = psTimer->psNext;
+    }
+
+    psTimer->psNext = NULL;
+    psTimer->bActive = false;
+}
+
+/**
+ * @brief      : Insert a timer by deadline, call with lock held
+ * @param [in] : psTimer - timer with deadline set
+ * @param [out]: None
+ * @return     : None
+*/
+static void Insert(_sTimerSvc *psTimer)
+{
+    _sTimerSvc **ppsLink = &psTimerHead;
+
+    //Timers with equal deadlines expire in the order they were started
+    while (*ppsLink && (int32_t)((*ppsLink)->ulDeadline - psTimer->ulDeadline) <= 0)
+    {
+        ppsLink = &(*ppsLink)->psNext;
+    }
+
+    psTimer->psNext = *ppsLink;
+    *ppsLink = psTimer;
+    psTimer->bActive = true;
+}
+
+/**
+ * @brief      : Schedule the work item for the latest time every timer
+ *               still accepts, call with lock held
+ * @param [in] : ulNow - uptime in ms
+ * @param [out]: None
+ * @return     : None
+*/
+static void Schedule(uint32_t ulNow)
+{
+    const _sTimerSvc *psTimer = psTimerHead;
+    uint32_t ulWake = 0;
+    int32_t lDelay = 0;
+
+    if (!psTimer)
+    {
+        (void)k_work_cancel_delayable(&TimerSvcWork);
+        return;
+    }
+
+    ulWake = psTimer->ulDeadline + psTimer->ulSlackMs;
+
+    //A later deadline with less slack may close its window first
+    for (psTimer = psTimer->psNext; psTimer; psTimer = psTimer->psNext)
+    {
+        if ((int32_t)(psTimer->ulDeadline - ulWake) >= 0)
+        {
+            break;
+        }
+
+        if ((int32_t)(psTimer->ulDeadline + psTimer->ulSlackMs - ulWake) < 0)
+        {
+            ulWake = psTimer->ulDeadline + psTimer->ulSlackMs;
+        }
+    }
+
+    lDelay = (int32_t)(ulWake - ulNow);
+    (void)k_work_reschedule(&TimerSvcWork, (lDelay > 0) ? K_MSEC(lDelay) : K_NO_WAIT);
+}
+
+/**
+ * @brief      : Expire every timer due, then schedule the next wake-up
+ * @param [in] : psWork - work item
+ * @param [out]: None
+ * @return     : None
+*/
+static void TimerSvcWorkFn(struct k_work *psWork)
+{
+    _sTimerSvc *psTimer = NULL;
+    timerSvcHandler Handler = NULL;
+    struct k_work_delayable *psFeed = NULL;
+    uint32_t ulNow = k_uptime_get_32();
+    uint8_t ucDue = 0;
+
+    ARG_UNUSED(psWork);
+
+    PERF_COUNT(timer_wakeups);
+    k_mutex_lock(&TimerSvcLock, K_FOREVER);
+
+    while (psTimerHead && (int32_t)(psTimerHead->ulDeadline - ulNow) <= 0)
+    {
+        psTimer = psTimerHead;
+        Unlink(psTimer);
+        PERF_HIST(timer_late, ulNow - psTimer->ulDeadline);
+
+        psTimer->bExpired = true;
+        psTimer->ulExpiries++;
+        ucDue++;
+
+        if (psTimer->ulPeriodMs)
+        {
+            psTimer->ulDeadline += psTimer->ulPeriodMs;
+
+            //Periods missed altogether are skipped, not made up
+            if ((int32_t)(psTimer->ulDeadline - ulNow) <= 0)
+            {
+                psTimer->ulDeadline = ulNow + psTimer->ulPeriodMs;
+            }
+
+            Insert(psTimer);
+        }
+
+        Handler = psTimer->Handler;
+        psFeed = psTimer->psWork;
+
+        //Handlers may start and stop timers
+        k_mutex_unlock(&TimerSvcLock);
+
+        if (Handler)
+        {
+            Handler();
+        }
+
+        if (psFeed)
+        {
+            (void)k_work_reschedule(psFeed, K_NO_WAIT);
+        }
+
+        k_mutex_lock(&TimerSvcLock, K_FOREVER);
+    }
+
+    Schedule(k_uptime_get_32());
+    k_mutex_unlock(&TimerSvcLock);
+
+    PERF_ADD(timer_expiries, ucDue);
+
+    if (ucDue > 1)
+    {
+        PERF_ADD(timer_coalesced, ucDue - 1);
+    }
+}
+
+/**
+ * @brief      : Start or restart a timer, a pending expiry is dropped
+ * @param [in] : psTimer - timer
+ *               ulDelayMs - time to first expiry
+ *               ulPeriodMs - time between expiries, 0 for one-shot
+ * @param [out]: None
+ * @return     : None
+*/
+void TimerSvcStart(_sTimerSvc *psTimer, uint32_t ulDelayMs, uint32_t ulPeriodMs)
+{
+    uint32_t ulNow = k_uptime_get_32();
+
+    if (!psTimer)
+    {
+        return;
+    }
+
+    k_mutex_lock(&TimerSvcLock, K_FOREVER);
+
+    if (psTimer->bActive)
+    {
+        Unlink(psTimer);
+    }
+
+    psTimer->ulDeadline = ulNow + ulDelayMs;
+    psTimer->ulPeriodMs = ulPeriodMs;
+    psTimer->bExpired = false;
+    Insert(psTimer);
+    Schedule(ulNow);
+
+    k_mutex_unlock(&TimerSvcLock);
+}
+
+/**
+ * @brief      : Stop a timer, a pending expiry is dropped
+ * @param [in] : psTimer - timer
+ * @param [out]: None
+ * @return     : None
+*/
+void TimerSvcStop(_sTimerSvc *psTimer)
+{
+    if (!psTimer)
+    {
+        return;
+    }
+
+    k_mutex_lock(&TimerSvcLock, K_FOREVER);
+
+    if (psTimer->bActive)
+    {
+        Unlink(psTimer);
+        Schedule(k_uptime_get_32());
+    }
+
+    psTimer->bExpired = false;
+
+    k_mutex_unlock(&TimerSvcLock);
+}
+
+/**
+ * @brief      : Check and clear the expiry flag of a timer
+ * @param [in] : psTimer - timer
+ * @param [out]: None
+ * @return     : true if the timer expired since the last call
+*/
+bool TimerSvcExpired(_sTimerSvc *psTimer)
+{
+    bool bRetVal = false;
+
+    k_mutex_lock(&TimerSvcLock, K_FOREVER);
+    bRetVal = psTimer->bExpired;
+    psTimer->bExpired = false;
+    k_mutex_unlock(&TimerSvcLock);
+
+    return bRetVal;
+}
+
+//EOF
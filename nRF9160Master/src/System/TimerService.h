@@ -0,0 +1,61 @@
+/**
+ * @file    : TimerService.h
+ * @brief   : Shared deadline queue for the periodic work of the system
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : TimerService.c
+ * @note    : Timers are kept in one list sorted by deadline and served by
+ *            a single delayable work item on the system work queue. Each
+ *            timer may expire up to its slack after its deadline, the work
+ *            item is scheduled for the earliest deadline plus slack and
+ *            expires every timer already due at that point, so deadlines
+ *            that fall close together cost one wake-up. On expiry a timer
+ *            sets a flag read with TimerSvcExpired, calls its handler and
+ *            reschedules its delayable work, whichever are given. A task
+ *            waiting for a timer is woken by its handler, the flag alone
+ *            is not polled.
+*/
+
+#ifndef _TIMER_SERVICE_H
+#define _TIMER_SERVICE_H
+
+/*********************************************INCLUDES***************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+/*********************************************MACROS******************************************************/
+#define TIMER_SVC_DEFINE(Name, Hdlr, Work, SlackMs)     \
+    _sTimerSvc Name = {                                 \
+        .pcName = #Name,                                \
+        .Handler = (Hdlr),                              \
+        .psWork = (Work),                               \
+        .ulSlackMs = (SlackMs),                         \
+    }
+
+/**********************************************TYPEDEFS***************************************************/
+/*Called from the system work queue, must not block*/
+typedef void (*timerSvcHandler)(void);
+
+typedef struct __sTimerSvc
+{
+    const char *pcName;
+    timerSvcHandler Handler;            //Optional
+    struct k_work_delayable *psWork;    //Optional, system work queue
+    uint32_t ulSlackMs;                 //Expiry may be late by this much
+    uint32_t ulPeriodMs;                //0 for one-shot
+    uint32_t ulDeadline;
+    uint32_t ulExpiries;
+    bool bActive;
+    bool bExpired;                      //Cleared by TimerSvcExpired
+    struct __sTimerSvc *psNext;
+}_sTimerSvc;
+
+/***********************************************FUNCTION DECLARATIONS**************************************/
+void TimerSvcStart(_sTimerSvc *psTimer, uint32_t ulDelayMs, uint32_t ulPeriodMs);
+void TimerSvcStop(_sTimerSvc *psTimer);
+bool TimerSvcExpired(_sTimerSvc *psTimer);
+
+#endif
+
+//EOF
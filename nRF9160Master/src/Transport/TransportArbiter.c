@@ -0,0 +1,669 @@
+/**
+ * @file    : TransportArbiter.c
+ * @brief   : Routes location uploads to the cheapest cloud link available
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : TransportArbiter.h
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include "TransportArbiter.h"
+#include "PerfStats.h"
+
+/******************************************TYPEDEFS*********************************************************/
+typedef struct __sPendingMsg
+{
+    bool bPending;
+    bool bRetryWait;
+    uint32_t ulSince;               //Publish requested
+    uint32_t ulRetryAt;
+    uint8_t ucLen;                  //Packed scan length
+    uint32_t ulSeq;                 //Location sequence number
+    union
+    {
+        _sGnssConfig sLocation;
+        uint8_t ucScan[TRANSPORT_SCAN_MAX];
+    };
+}_sPendingMsg;
+
+typedef struct __sQueuedLoc
+{
+    _sGnssConfig sLocation;
+    uint32_t ulSince;               //Publish requested
+    uint32_t ulSeq;
+}_sQueuedLoc;
+
+/******************************************GLOBALS VARIABLES**********************************************/
+static const _sTransportOps *psLinkOps[TRANSPORT_MAX] = {NULL};
+static _sTransportStats sLinkStats[TRANSPORT_MAX] = {0};
+static uint64_t ullLatencySumMs[TRANSPORT_MAX] = {0};
+static uint32_t ulIdleSince[TRANSPORT_MAX] = {0};
+/*Latest message of each kind waiting for a link*/
+static _sPendingMsg sPending[TRANSPORT_MSG_MAX] = {0};
+static _sTransportSummary sSummary[TRANSPORT_MSG_MAX] = {0};
+/*Consecutive publishes served by the cheapest link*/
+static uint8_t ucCheapStreak = 0;
+/*System asleep, nothing is sent*/
+static bool bHeld = false;
+/*Locations kept for a batching link, oldest first*/
+static _sQueuedLoc sLocQueue[TRANSPORT_BATCH_MAX] = {0};
+static uint8_t ucLocHead = 0;
+static uint8_t ucLocCount = 0;
+static uint32_t ulLocSeq = 0;
+static uint32_t ulFlushSeq = 0;     //Locations before this one are due
+/*Batch passed to a link until its publish completes*/
+static _sGnssConfig sBatch[TRANSPORT_BATCH_MAX];
+static uint8_t ucBatchLen = 0;
+static uint32_t ulBatchSeq = 0;     //Sequence number of sBatch[0]
+static bool bBatchOut = false;
+
+K_MUTEX_DEFINE(TransportLock);
+
+PERF_HIST_DEFINE(publish_latency, "ms");
+PERF_COUNTER_DEFINE(locations_published);
+PERF_HIST_DEFINE(location_latency, "ms");
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/**
+ * @brief      : Order registered links by estimated cost, cheapest first
+ * @param [in] : None
+ * @param [out]: peOrder - links in order, TRANSPORT_MAX entries
+ * @return     : number of links registered
+*/
+static uint8_t OrderLinks(_eTransport *peOrder)
+{
+    uint8_t ucCount = 0;
+    uint8_t ucPos = 0;
+
+    for (uint8_t ucLink = 0; ucLink < TRANSPORT_MAX; ucLink++)
+    {
+        if (!psLinkOps[ucLink])
+        {
+            continue;
+        }
+
+        //Insertion sort, there are only a couple of links
+        for (ucPos = ucCount; ucPos > 0 &&
+             psLinkOps[peOrder[ucPos - 1]]->ulMsgCostUj > psLinkOps[ucLink]->ulMsgCostUj; ucPos--)
+        {
+            peOrder[ucPos] = peOrder[ucPos - 1];
+        }
+
+        peOrder[ucPos] = (_eTransport)ucLink;
+        ucCount++;
+    }
+
+    return ucCount;
+}
+
+/**
+ * @brief      : Put a link idle or wake it up
+ * @param [in] : eLink - link
+ *               bIdle - true to idle
+ * @param [out]: None
+ * @return     : None
+*/
+static void SetLinkIdle(_eTransport eLink, bool bIdle)
+{
+    _sTransportStats *psStats = &sLinkStats[eLink];
+
+    if (!psLinkOps[eLink]->SetIdle || psStats->bIdle == bIdle)
+    {
+        return;
+    }
+
+    if (bIdle)
+    {
+        ulIdleSince[eLink] = k_uptime_get_32();
+    }
+    else
+    {
+        psStats->ulIdleMs += k_uptime_get_32() - ulIdleSince[eLink];
+    }
+
+    printk("INFO: %s link %s\n\r", psLinkOps[eLink]->pcName, bIdle ? "idle" : "needed");
+    psStats->bIdle = bIdle;
+    psLinkOps[eLink]->SetIdle(bIdle);
+}
+
+/**
+ * @brief      : Account a successful publish
+ * @param [in] : eLink - link used
+ *               nBytes - bytes sent
+ *               ulLatency - request to completion in ms
+ * @param [out]: None
+ * @return     : None
+*/
+static void AccountPublish(_eTransport eLink, int nBytes, uint32_t ulLatency)
+{
+    _sTransportStats *psStats = &sLinkStats[eLink];
+
+    psStats->ulMsgs++;
+    psStats->ulBytes += nBytes;
+    psStats->ullEnergyUj += psLinkOps[eLink]->ulMsgCostUj +
+                            (uint64_t)psLinkOps[eLink]->ulByteCostUj * nBytes;
+    psStats->ulLatencyLastMs = ulLatency;
+    psStats->ulLatencyMaxMs = MAX(psStats->ulLatencyMaxMs, ulLatency);
+    ullLatencySumMs[eLink] += ulLatency;
+    psStats->ulLatencyAvgMs = (uint32_t)(ullLatencySumMs[eLink] / psStats->ulMsgs);
+    PERF_HIST(publish_latency, ulLatency);
+}
+
+/**
+ * @brief      : Register a cloud link
+ * @param [in] : eLink - link
+ *               psOps - handlers and cost, must stay valid
+ * @param [out]: None
+ * @return     : true for success
+*/
+bool TransportRegister(_eTransport eLink, const _sTransportOps *psOps)
+{
+    if (eLink >= TRANSPORT_MAX || !psOps || !psOps->IsUp || !psOps->Send)
+    {
+        return false;
+    }
+
+    k_mutex_lock(&TransportLock, K_FOREVER);
+    psLinkOps[eLink] = psOps;
+    memset(&sLinkStats[eLink], 0, sizeof(sLinkStats[eLink]));
+    ullLatencySumMs[eLink] = 0;
+    k_mutex_unlock(&TransportLock);
+
+    return true;
+}
+
+/**
+ * @brief      : Record a message, call with lock held
+ * @param [in] : eMsg - message kind
+ *               bSend - send now, otherwise kept for the next send
+ * @param [out]: None
+ * @return     : pending slot to fill
+*/
+static _sPendingMsg *QueueMsg(_eTransportMsg eMsg, bool bSend)
+{
+    _sPendingMsg *psMsg = &sPending[eMsg];
+
+    //Locations are only superseded when dropped from the queue
+    if (psMsg->bPending && eMsg != TRANSPORT_MSG_LOCATION)
+    {
+        sSummary[eMsg].ulSuperseded++;
+    }
+
+    if (bSend)
+    {
+        psMsg->bPending = true;
+        psMsg->bRetryWait = false;
+    }
+
+    psMsg->ulSince = k_uptime_get_32();
+    sSummary[eMsg].ulRequests++;
+
+    return psMsg;
+}
+
+/**
+ * @brief      : Add a location to the queue
+ * @param [in] : psLocation - location to upload
+ *               bSend - send the queue now, otherwise kept for the next send
+ * @param [out]: None
+ * @return     : true for success
+*/
+static bool QueueLocation(const _sGnssConfig *psLocation, bool bSend)
+{
+    _sPendingMsg *psMsg = NULL;
+    _sQueuedLoc *psLoc = NULL;
+
+    if (!psLocation)
+    {
+        return false;
+    }
+
+    k_mutex_lock(&TransportLock, K_FOREVER);
+
+    psMsg = QueueMsg(TRANSPORT_MSG_LOCATION, bSend);
+    psMsg->sLocation = *psLocation;
+    psMsg->ulSeq = ulLocSeq++;
+
+    //Oldest location gives way when the queue is full
+    if (ucLocCount == TRANSPORT_BATCH_MAX)
+    {
+        ucLocHead = (ucLocHead + 1) % TRANSPORT_BATCH_MAX;
+        ucLocCount--;
+        sSummary[TRANSPORT_MSG_LOCATION].ulSuperseded++;
+    }
+
+    psLoc = &sLocQueue[(ucLocHead + ucLocCount) % TRANSPORT_BATCH_MAX];
+    psLoc->sLocation = *psLocation;
+    psLoc->ulSince = psMsg->ulSince;
+    psLoc->ulSeq = psMsg->ulSeq;
+    ucLocCount++;
+
+    if (bSend)
+    {
+        ulFlushSeq = ulLocSeq;
+    }
+
+    k_mutex_unlock(&TransportLock);
+
+    //Sent by TransportProcess on the system task
+    if (bSend)
+    {
+        SystemWake();
+    }
+
+    return true;
+}
+
+/**
+ * @brief      : Queue a location for upload and send the queue, replaces
+ *               one still waiting on links that do not batch
+ * @param [in] : psLocation - location to upload
+ * @param [out]: None
+ * @return     : true for success
+*/
+bool TransportPublish(const _sGnssConfig *psLocation)
+{
+    return QueueLocation(psLocation, true);
+}
+
+/**
+ * @brief      : Queue a location for the next publish without sending it
+ * @param [in] : psLocation - location to upload
+ * @param [out]: None
+ * @return     : true for success
+*/
+bool TransportQueue(const _sGnssConfig *psLocation)
+{
+    return QueueLocation(psLocation, false);
+}
+
+/**
+ * @brief      : Send the locations queued with TransportQueue
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : None
+*/
+void TransportFlush(void)
+{
+    k_mutex_lock(&TransportLock, K_FOREVER);
+
+    ulFlushSeq = ulLocSeq;
+
+    if (ucLocCount && !sPending[TRANSPORT_MSG_LOCATION].bPending)
+    {
+        sPending[TRANSPORT_MSG_LOCATION].bPending = true;
+        sPending[TRANSPORT_MSG_LOCATION].bRetryWait = false;
+    }
+
+    k_mutex_unlock(&TransportLock);
+    SystemWake();
+}
+
+/**
+ * @brief      : Drop queued locations that are too old, call with lock held
+ * @param [in] : ulNow - uptime in ms
+ * @param [out]: None
+ * @return     : None
+*/
+static void ExpireLocations(uint32_t ulNow)
+{
+    uint8_t ucExpired = 0;
+
+    while (ucLocCount && (ulNow - sLocQueue[ucLocHead].ulSince) >= TRANSPORT_MAX_AGE_MS)
+    {
+        ucLocHead = (ucLocHead + 1) % TRANSPORT_BATCH_MAX;
+        ucLocCount--;
+        ucExpired++;
+    }
+
+    if (ucExpired)
+    {
+        printk("ERR: %u locations not sent, expired\n\r", ucExpired);
+        sSummary[TRANSPORT_MSG_LOCATION].ulExpired += ucExpired;
+    }
+}
+
+/**
+ * @brief      : Remove delivered locations from the queue, older ones
+ *               not in the publish are superseded. Call with lock held.
+ * @param [in] : eLink - link used
+ *               ulFirstSeq - first location in the publish
+ *               ulEndSeq - first location after the publish
+ * @param [out]: None
+ * @return     : request to completion of the oldest location delivered, in ms
+*/
+static uint32_t DequeueLocations(_eTransport eLink, uint32_t ulFirstSeq, uint32_t ulEndSeq)
+{
+    const _sQueuedLoc *psLoc = NULL;
+    uint32_t ulNow = k_uptime_get_32();
+    uint32_t ulLatency = 0;
+    uint32_t ulOldest = 0;
+
+    while (ucLocCount)
+    {
+        psLoc = &sLocQueue[ucLocHead];
+
+        if ((int32_t)(psLoc->ulSeq - ulEndSeq) >= 0)
+        {
+            break;
+        }
+
+        if ((int32_t)(psLoc->ulSeq - ulFirstSeq) < 0)
+        {
+            sSummary[TRANSPORT_MSG_LOCATION].ulSuperseded++;
+        }
+        else
+        {
+            ulLatency = ulNow - psLoc->ulSince;
+            ulOldest = MAX(ulOldest, ulLatency);
+            sLinkStats[eLink].ulLocations++;
+            PERF_COUNT(locations_published);
+            PERF_HIST(location_latency, ulLatency);
+        }
+
+        ucLocHead = (ucLocHead + 1) % TRANSPORT_BATCH_MAX;
+        ucLocCount--;
+    }
+
+    return ulOldest;
+}
+
+/**
+ * @brief      : Queue a packed WiFi scan for upload, replaces one still
+ *               waiting
+ * @param [in] : pucScan - packed scan
+ *               ucLen - length of scan
+ * @param [out]: None
+ * @return     : true for success
+*/
+bool TransportPublishScan(const uint8_t *pucScan, uint8_t ucLen)
+{
+    _sPendingMsg *psMsg = NULL;
+
+    if (!pucScan || ucLen == 0 || ucLen > TRANSPORT_SCAN_MAX)
+    {
+        return false;
+    }
+
+    k_mutex_lock(&TransportLock, K_FOREVER);
+    psMsg = QueueMsg(TRANSPORT_MSG_WIFI_SCAN, true);
+    memcpy(psMsg->ucScan, pucScan, ucLen);
+    psMsg->ucLen = ucLen;
+    k_mutex_unlock(&TransportLock);
+    SystemWake();
+
+    return true;
+}
+
+/**
+ * @brief      : Send a message over a link
+ * @param [in] : eLink - link
+ *               eMsg - message kind
+ *               psMsg - message
+ * @param [out]: pucSent - locations of the batch sent, 0 if not batched
+ * @return     : bytes sent, -ENOTSUP if link cannot carry the message
+*/
+static int SendMsg(_eTransport eLink, _eTransportMsg eMsg, const _sPendingMsg *psMsg,
+                   uint8_t *pucSent)
+{
+    const _sTransportOps *psOps = psLinkOps[eLink];
+
+    *pucSent = 0;
+
+    if (eMsg == TRANSPORT_MSG_LOCATION)
+    {
+        //Batching link takes the queued locations, others only the latest
+        if (psOps->SendBatch && ucBatchLen)
+        {
+            return psOps->SendBatch(sBatch, ucBatchLen, pucSent);
+        }
+
+        return psOps->Send(&psMsg->sLocation);
+    }
+
+    return psOps->SendScan ? psOps->SendScan(psMsg->ucScan, psMsg->ucLen) : -ENOTSUP;
+}
+
+/**
+ * @brief      : Upload a pending message over the cheapest link up
+ * @param [in] : eMsg - message kind
+ * @param [out]: None
+ * @return     : None
+*/
+static void ProcessMsg(_eTransportMsg eMsg)
+{
+    _eTransport aeOrder[TRANSPORT_MAX];
+    _sPendingMsg *psPending = &sPending[eMsg];
+    _sPendingMsg sMsg = {0};
+    _eTransport eLink = TRANSPORT_MAX;
+    uint32_t ulNow = k_uptime_get_32();
+    uint8_t ucCount = 0;
+    uint8_t ucSent = 0;
+    uint32_t ulLatency = 0;
+    bool bFailedBefore = false;
+    int nBytes = -1;
+
+    k_mutex_lock(&TransportLock, K_FOREVER);
+
+    do
+    {
+        if (eMsg == TRANSPORT_MSG_LOCATION)
+        {
+            ExpireLocations(ulNow);
+            psPending->bPending = psPending->bPending && (ucLocCount > 0);
+            bBatchOut = bBatchOut && psPending->bPending;
+
+            //Batch stays the same until its publish completes
+            if (!bBatchOut)
+            {
+                ucBatchLen = ucLocCount;
+                ulBatchSeq = sLocQueue[ucLocHead].ulSeq;
+
+                for (uint8_t ucIdx = 0; ucIdx < ucBatchLen; ucIdx++)
+                {
+                    sBatch[ucIdx] = sLocQueue[(ucLocHead + ucIdx) % TRANSPORT_BATCH_MAX].sLocation;
+                }
+            }
+        }
+
+        if (bHeld || !psPending->bPending ||
+            (psPending->bRetryWait && (int32_t)(ulNow - psPending->ulRetryAt) < 0))
+        {
+            break;
+        }
+
+        if ((ulNow - psPending->ulSince) >= TRANSPORT_MAX_AGE_MS)
+        {
+            printk("ERR: Upload %d not sent, expired\n\r", eMsg);
+            sSummary[eMsg].ulExpired++;
+            psPending->bPending = false;
+            break;
+        }
+
+        sMsg = *psPending;
+        ucCount = OrderLinks(aeOrder);
+    } while (0);
+
+    k_mutex_unlock(&TransportLock);
+
+    if (ucCount == 0)
+    {
+        return;
+    }
+
+    //Sending may block, lock is not held so new messages can still be queued
+    for (uint8_t ucIdx = 0; ucIdx < ucCount; ucIdx++)
+    {
+        eLink = aeOrder[ucIdx];
+
+        if (!psLinkOps[eLink]->IsUp())
+        {
+            continue;
+        }
+
+        nBytes = SendMsg(eLink, eMsg, &sMsg, &ucSent);
+
+        //Link is waking up or publishing, message stays queued for it
+        if (nBytes >= 0 || nBytes == -EINPROGRESS)
+        {
+            break;
+        }
+
+        if (nBytes != -ENOTSUP)
+        {
+            printk("ERR: Upload over %s failed %d\n\r", psLinkOps[eLink]->pcName, nBytes);
+            sLinkStats[eLink].ulFailures++;
+            bFailedBefore = true;
+        }
+    }
+
+    k_mutex_lock(&TransportLock, K_FOREVER);
+
+    if (eMsg == TRANSPORT_MSG_LOCATION)
+    {
+        bBatchOut = (nBytes == -EINPROGRESS) && psLinkOps[eLink]->SendBatch;
+    }
+
+    if (nBytes == -EINPROGRESS)
+    {
+        //Completed on a later call
+    }
+    else if (nBytes < 0)
+    {
+        //Bring idle links back so the retry has somewhere to go
+        for (uint8_t ucIdx = 0; ucIdx < ucCount; ucIdx++)
+        {
+            SetLinkIdle(aeOrder[ucIdx], false);
+        }
+
+        ucCheapStreak = 0;
+        psPending->bRetryWait = true;
+        psPending->ulRetryAt = k_uptime_get_32() + TRANSPORT_RETRY_MS;
+    }
+    else
+    {
+        ulLatency = k_uptime_get_32() - sMsg.ulSince;
+
+        if (eMsg == TRANSPORT_MSG_LOCATION)
+        {
+            ulLatency = ucSent ? DequeueLocations(eLink, ulBatchSeq, ulBatchSeq + ucSent) :
+                                 DequeueLocations(eLink, sMsg.ulSeq, sMsg.ulSeq + 1);
+            //Locations queued while publishing wait for the next send
+            psPending->bPending = ucLocCount &&
+                                  (int32_t)(sLocQueue[ucLocHead].ulSeq - ulFlushSeq) < 0;
+        }
+        //A newer message may have been queued meanwhile
+        else if (psPending->ulSince == sMsg.ulSince)
+        {
+            psPending->bPending = false;
+        }
+
+        AccountPublish(eLink, nBytes, ulLatency);
+        sLinkStats[eLink].ulFailovers += bFailedBefore ? 1 : 0;
+
+        if (eLink == aeOrder[0])
+        {
+            ucCheapStreak = (ucCheapStreak < UINT8_MAX) ? ucCheapStreak + 1 : ucCheapStreak;
+        }
+        else
+        {
+            ucCheapStreak = 0;
+        }
+
+        if (ucCheapStreak >= TRANSPORT_IDLE_AFTER)
+        {
+            for (uint8_t ucIdx = 1; ucIdx < ucCount; ucIdx++)
+            {
+                SetLinkIdle(aeOrder[ucIdx], true);
+            }
+        }
+    }
+
+    k_mutex_unlock(&TransportLock);
+}
+
+/**
+ * @brief      : Upload pending messages, call periodically from the task
+ *               owning the WiFi module
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : None
+*/
+void TransportProcess(void)
+{
+    for (uint8_t ucMsg = 0; ucMsg < TRANSPORT_MSG_MAX; ucMsg++)
+    {
+        ProcessMsg((_eTransportMsg)ucMsg);
+    }
+}
+
+/**
+ * @brief      : Hold all uploads and idle every link, or release them
+ * @param [in] : bHold - true to hold
+ * @param [out]: None
+ * @return     : None
+*/
+void TransportHold(bool bHold)
+{
+    k_mutex_lock(&TransportLock, K_FOREVER);
+
+    if (bHeld != bHold)
+    {
+        bHeld = bHold;
+        ucCheapStreak = 0;
+
+        for (uint8_t ucLink = 0; ucLink < TRANSPORT_MAX; ucLink++)
+        {
+            if (psLinkOps[ucLink])
+            {
+                SetLinkIdle((_eTransport)ucLink, bHold);
+            }
+        }
+    }
+
+    k_mutex_unlock(&TransportLock);
+}
+
+/**
+ * @brief      : Get counters of a link
+ * @param [in] : eLink - link
+ * @param [out]: None
+ * @return     : link statistics, NULL if invalid
+*/
+const _sTransportStats *TransportGetStats(_eTransport eLink)
+{
+    uint32_t ulNow = k_uptime_get_32();
+
+    if (eLink >= TRANSPORT_MAX)
+    {
+        return NULL;
+    }
+
+    k_mutex_lock(&TransportLock, K_FOREVER);
+
+    if (sLinkStats[eLink].bIdle)
+    {
+        sLinkStats[eLink].ulIdleMs += ulNow - ulIdleSince[eLink];
+        ulIdleSince[eLink] = ulNow;
+    }
+
+    k_mutex_unlock(&TransportLock);
+
+    return &sLinkStats[eLink];
+}
+
+/**
+ * @brief      : Get counters of publish requests
+ * @param [in] : eMsg - message kind
+ * @param [out]: None
+ * @return     : request statistics, NULL if invalid
+*/
+const _sTransportSummary *TransportGetSummary(_eTransportMsg eMsg)
+{
+    return (eMsg < TRANSPORT_MSG_MAX) ? &sSummary[eMsg] : NULL;
+}
+
+//EOF
@@ -0,0 +1,123 @@
+/**
+ * @file    : TransportArbiter.h
+ * @brief   : Routes location uploads to the cheapest cloud link available
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : TransportArbiter.c
+ * @note    : Links register their send, link-state and idle handlers with
+ *            an estimated energy cost. Each publish is tried on the
+ *            cheapest link that is up and fails over to the next one.
+ *            Only the latest location and the latest WiFi scan wait for
+ *            a link, older ones are superseded. Up to
+ *            TRANSPORT_BATCH_MAX locations are kept for links that can
+ *            send several in one publish. Locations added with
+ *            TransportQueue wait for the next TransportPublish or
+ *            TransportFlush, so they share its uplink wake-up. While a cheaper link
+ *            keeps serving, the costlier links are put idle (LTE may then
+ *            stay in PSM). A link that is waking up keeps the message
+ *            queued without failing over. While held, all links are idle
+ *            and messages wait, the latest is sent on release if it has
+ *            not expired.
+*/
+
+#ifndef _TRANSPORT_ARBITER_H
+#define _TRANSPORT_ARBITER_H
+
+/*********************************************INCLUDES***************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "../System/SystemHandler.h"
+
+/*********************************************MACROS******************************************************/
+/*Estimated energy per publish and per payload byte, in uJ*/
+#define TRANSPORT_WIFI_MSG_UJ       5000
+#define TRANSPORT_WIFI_BYTE_UJ      2
+#define TRANSPORT_LTE_MSG_UJ        60000   //LTE-M RRC setup and inactivity tail
+#define TRANSPORT_LTE_BYTE_UJ       10
+
+#define TRANSPORT_RETRY_MS          5000    //No link up or all links failed
+#define TRANSPORT_MAX_AGE_MS        300000  //Pending location dropped after
+#define TRANSPORT_IDLE_AFTER        2       //Cheaper link successes before idling others
+#define TRANSPORT_SCAN_MAX          64      //Packed WiFi scan
+#define TRANSPORT_BATCH_MAX         8       //Locations kept for a batching link
+
+/**********************************************TYPEDEFS***************************************************/
+typedef enum __eTransport
+{
+    TRANSPORT_WIFI,
+    TRANSPORT_LTE,
+    TRANSPORT_MAX
+}_eTransport;
+
+typedef enum __eTransportMsg
+{
+    TRANSPORT_MSG_LOCATION,
+    TRANSPORT_MSG_WIFI_SCAN,        //Packed scan, positioned by cloud
+    TRANSPORT_MSG_MAX
+}_eTransportMsg;
+
+/*Link can carry a publish now*/
+typedef bool (*transportUpHandler)(void);
+/*Publish location, returns bytes sent, -EINPROGRESS while the link wakes up
+  or negative error*/
+typedef int (*transportSendHandler)(const _sGnssConfig *psLocation);
+/*Publish locations oldest first, returns bytes sent, -EINPROGRESS while the
+  publish is in flight or negative error. The same locations are passed until
+  the publish completes, pucSent is then set to the number taken from the
+  start of psLocations*/
+typedef int (*transportBatchHandler)(const _sGnssConfig *psLocations, uint8_t ucCount,
+                                     uint8_t *pucSent);
+/*Publish packed WiFi scan, returns bytes sent, -EINPROGRESS while the link is
+  busy or negative error*/
+typedef int (*transportScanHandler)(const uint8_t *pucScan, uint8_t ucLen);
+/*Link is not needed (true) or needed again (false)*/
+typedef void (*transportIdleHandler)(bool bIdle);
+
+typedef struct __sTransportOps
+{
+    const char *pcName;
+    transportUpHandler IsUp;
+    transportSendHandler Send;
+    transportBatchHandler SendBatch;    //Optional, used instead of Send
+    transportScanHandler SendScan;  //Optional
+    transportIdleHandler SetIdle;   //Optional
+    uint32_t ulMsgCostUj;
+    uint32_t ulByteCostUj;
+}_sTransportOps;
+
+typedef struct __sTransportStats
+{
+    uint32_t ulMsgs;
+    uint32_t ulLocations;           //Locations delivered, a batch carries several
+    uint32_t ulBytes;
+    uint32_t ulFailures;
+    uint32_t ulFailovers;           //Publishes taken over from a failed cheaper link
+    uint32_t ulLatencyLastMs;       //Publish request to send completed
+    uint32_t ulLatencyAvgMs;
+    uint32_t ulLatencyMaxMs;
+    uint64_t ullEnergyUj;           //Estimated from registered costs
+    uint32_t ulIdleMs;
+    bool bIdle;
+}_sTransportStats;
+
+typedef struct __sTransportSummary
+{
+    uint32_t ulRequests;
+    uint32_t ulSuperseded;
+    uint32_t ulExpired;
+}_sTransportSummary;
+
+/***********************************************FUNCTION DECLARATIONS**************************************/
+bool TransportRegister(_eTransport eLink, const _sTransportOps *psOps);
+bool TransportPublish(const _sGnssConfig *psLocation);
+bool TransportQueue(const _sGnssConfig *psLocation);
+void TransportFlush(void);
+bool TransportPublishScan(const uint8_t *pucScan, uint8_t ucLen);
+void TransportProcess(void);
+void TransportHold(bool bHold);
+const _sTransportStats *TransportGetStats(_eTransport eLink);
+const _sTransportSummary *TransportGetSummary(_eTransportMsg eMsg);
+
+#endif
+
+//EOF
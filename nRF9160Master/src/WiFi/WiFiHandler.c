@@ -8,8 +8,16 @@
 
 /*******************************************INCLUDES********************************************************/
 #include "WiFiHandler.h"
+#include "WiFiStore.h"
+#include "WiFiPosition.h"
 #include "../System/SystemHandler.h"
+#include "../System/PowerPolicy.h"
+#include "../Transport/TransportArbiter.h"
+#include "PerfStats.h"
+#include "LogRate.h"
 #include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/gpio.h>
 
 /*******************************************MACROS*********************************************************/
 #define MSG_SIZE 255
@@ -20,8 +28,29 @@
 #define CFG_NUM 	        1
 #define CFG_NAME 	        "latlong"
 #define RETRY_COUNT         2
-
-char cWifiCredentials[80] = "Alcodex,Adx@2013"; //SSID and password
+#define STAT_TIMEOUT_MS     500     //Wait for full AT+WFSTAT report
+#define WFSTA_TIMEOUT_MS    500     //Wait for AT+WFSTA reply
+#define SCAN_TIMEOUT_MS     5000    //Wait for full AT+WFSCAN report
+#define SCAN_MIN_RSSI       -85     //Weaker APs are not tried
+#define SCAN_TIE_DB         3       //Closer than this, faster join wins
+#define SCAN_FAIL_PENALTY   10      //dB taken off an AP that always fails
+#define SEND_TIMEOUT_MS     2000    //Wait for AT+AWS result
+#define AWS_LINE_MAX        255     //AT command line limit of the DA16200
+#define CFG_SCAN_NAME       "wifiscan"
+#define WIFI_BOOT_MS        2000    //Wake-up to +INIT report
+
+/*DPM sleep is only entered when the module can be woken through its pin*/
+#if defined(CONFIG_PETTAP_WIFI_DPM) && DT_NODE_HAS_PROP(DT_PATH(zephyr_user), wifi_wake_gpios)
+#define WIFI_DPM            1
+#define DPM_IDLE_MS         CONFIG_PETTAP_WIFI_DPM_IDLE_MS
+#define DPM_WAKE_TIMEOUT_MS CONFIG_PETTAP_WIFI_DPM_WAKE_TIMEOUT_MS
+#else
+#define WIFI_DPM            0
+#endif
+
+LOG_MODULE_REGISTER(wifi_handler, CONFIG_PETTAP_LOG_LEVEL);
+
+char cWifiCredentials[CREDENTIAL_SIZE] = "Alcodex,Adx@2013"; //SSID and password
 
 /******************************************GLOBALS VARIABLES**********************************************/
 static const struct device *uart_dev = DEVICE_DT_GET(DT_NODELABEL(uart1));
@@ -34,19 +63,91 @@ static _eWiFiUartRxState eWiFiUartRxState = UART_START;
 static uint16_t usRxBufferIdx = 0;
 /*Flag for packet receive completion*/
 static bool bRxCmplt = false;
+/*AP joined, set from +WFJAP:1 URC*/
+static bool bApJoined = false;
+/*Join refused, set from +WFJAP:0 URC*/
+static bool bApJoinFailed = false;
+/*SSID of AP in cWifiCredentials*/
+static char cCurSSID[CMD_SSID_MAX_LEN + 1] = {0};
+/*Time first command of a (re)connect went out, 0 when not timing*/
+static uint32_t ulJoinStart = 0;
+static bool bRejoin = false;
+static uint32_t ulRejoinSumMs = 0;
+static uint32_t ulFullSumMs = 0;
+static _sWiFiReconnStats sReconnStats = {0};
+/*Sleep command accepted and module not booted since*/
+static bool bWiFiAsleep = false;
+static uint32_t ulWiFiSleepAt = 0;
+static uint32_t ulWiFiSleepMs = 0;
+#if DT_NODE_HAS_PROP(DT_PATH(zephyr_user), wifi_wake_gpios)
+/*RTC wake-up input of the DA16200, optional*/
+static const struct gpio_dt_spec sWiFiWake = GPIO_DT_SPEC_GET(DT_PATH(zephyr_user), wifi_wake_gpios);
+#endif
+static _eWiFiDpmState eDpmState = WIFI_DPM_AWAKE;
+/*Last command sent, DPM sleep is entered after an idle period*/
+static uint32_t ulWiFiActiveAt = 0;
+static uint32_t ulDpmSleepAt = 0;
+static uint32_t ulDpmWakeAt = 0;
+static uint64_t ullDpmWakeSumMs = 0;
+static _sWiFiDpmStats sDpmStats = {0};
+/*Location publish in flight, see SendLocations*/
+static _eWiFiPubState ePubState = WIFI_PUB_IDLE;
+static uint32_t ulPubSentAt = 0;
+static uint32_t ulPubStamp = 0;
+static uint8_t ucPubFixes = 0;
+static int nPubLen = 0;
+static int nPubResult = 0;
 
 K_MSGQ_DEFINE(UartMsgQueue, MSG_SIZE, 10, 4);
+
+PERF_COUNTER_DEFINE(wifi_rx_bytes);
+PERF_COUNTER_DEFINE(wifi_rx_lines);
+PERF_COUNTER_DEFINE(wifi_rx_drops);
+PERF_COUNTER_DEFINE(wifi_tx_bytes);
+PERF_GAUGE_DEFINE(wifi_rx_queue);
+PERF_HIST_DEFINE(wifi_at_latency, "us");
+PERF_HIST_DEFINE(wifi_isr, "us");
+PERF_HIST_DEFINE(wifi_dpm_wake, "ms");
+PERF_COUNTER_DEFINE(wifi_publish_cmds);
 /*****************************************PRIVATE FUNCTIONS***********************************************/
 static void ProcessConnectionStatus(const char *pcResp, bool *pbStatus);
 static void CheckConnection(const char *pcResp, bool *pbStatus);
 static void SendCmdWithArgs(const char *cmd, char *pcArgs[], int nArgc);
 static void SendCommand(const char *cmd, char *pcArgs[], int nArgc);
+static void CheckAPConnected(const char *pcResp, bool *pbStatus);
+static void OnAPJoined(const char *pcUrc);
+static void OnAPJoinFailed(void);
+static void HandleUrc(const char *pcMsg);
+static int SendWiFiScan(const uint8_t *pucScan, uint8_t ucLen);
+static int WaitAwsResult(int nLen);
+static bool IsOkLine(const char *pcLine);
+static bool IsErrorLine(const char *pcLine);
+static bool DpmResume(void);
+static void DpmSleepIfIdle(void);
+static void OnDpmWoken(void);
+static void WaitPublish(void);
+
+/*WiFi as cloud link, up while the AP is joined*/
+static const _sTransportOps sWiFiLinkOps = {
+    .pcName = "WiFi",
+    .IsUp = IsAPJoined,
+    .Send = SendLocation,
+    .SendBatch = SendLocations,
+    .SendScan = SendWiFiScan,
+    .SetIdle = NULL,
+    .ulMsgCostUj = TRANSPORT_WIFI_MSG_UJ,
+    .ulByteCostUj = TRANSPORT_WIFI_BYTE_UJ,
+};
 
 //Table of AT Commands and their handlers
 _sAtCmdHandle sAtCmdHandle[] = {
     //CMD                                           //Handler       //RespHandler     //argument cnt    //Arguments
     {"AT\n\r",                                      SendCommand,     ProcessResponse,       0,            {NULL}                    },
     {"AT+WFMODE=0\n\r",                             SendCommand,     ProcessResponse,       0,            {NULL}                    },
+#if WIFI_DPM
+    //Stored in NVRAM, the module keeps the AP association while in DPM sleep
+    {"AT+DPM=1\n\r",                                SendCommand,     ProcessResponse,       0,            {NULL}                    },
+#endif
     {"AT+WFJAPA=%s\n\r",                            SendCmdWithArgs, ProcessResponse,       1,            {cWifiCredentials, NULL,NULL}},
     {"AT+AWS=SET APP_PUBTOPIC %s\r\n",              SendCmdWithArgs, ProcessResponse,       1,            {AWS_TOPIC, NULL, NULL}   },
     {"AT+AWS=CFG  0 latshad 1 1\r\n",               SendCommand,     ProcessResponse,       0,            {NULL}                    },
@@ -54,6 +155,12 @@ _sAtCmdHandle sAtCmdHandle[] = {
     {"AT+AWS=CFG %d %s 1 0\r\n",                    SendCmdWithArgs, ProcessResponse,       2,            {CFG_NUM, CFG_NAME, NULL} },
 };  
 
+//Reconnect to last AP. Mode and AWS settings are kept in DA16200 NVRAM
+_sAtCmdHandle sRejoinCmdHandle[] = {
+    //CMD                                           //Handler       //RespHandler     //argument cnt    //Arguments
+    {"AT+WFJAPA=%s\n\r",                            SendCmdWithArgs, ProcessResponse,       1,            {cWifiCredentials, NULL,NULL}},
+};
+
 
 /******************************************FUNCTION DEFINITIONS******************************************/  
 /**
@@ -68,6 +175,8 @@ bool ReadBuff(void)
  
     if (uart_fifo_read(uart_dev, &ucByte, 1) == 1)
     {
+        PERF_COUNT(wifi_rx_bytes);
+
         switch(eWiFiUartRxState)
         {
             case UART_START: if (ucByte != '\n' && ucByte != '\r')
@@ -85,7 +194,15 @@ bool ReadBuff(void)
                             cRxBuffer[usRxBufferIdx++] = '\0';
                             bRxCmplt = true;
                             eWiFiUartRxState = UART_START;
-                            k_msgq_put(&UartMsgQueue, &cRxBuffer, K_NO_WAIT);
+                            PERF_COUNT(wifi_rx_lines);
+
+                            if (k_msgq_put(&UartMsgQueue, &cRxBuffer, K_NO_WAIT) != 0)
+                            {
+                                PERF_COUNT(wifi_rx_drops);
+                            }
+
+                            PERF_GAUGE(wifi_rx_queue, k_msgq_num_used_get(&UartMsgQueue));
+                            SystemWake();
                         }
                         cRxBuffer[usRxBufferIdx++] = ucByte;
                         break;
@@ -110,24 +227,27 @@ bool ReadBuff(void)
 void serial_cb(const struct device *dev, void *user_data)
 {
     uint8_t c;
+    uint32_t ulStamp = PERF_STAMP();
 
     if (!uart_irq_update(uart_dev))
     {
-        printk("UART IRQ update failed\n\r");
+        PRINTK_RATELIMIT(LOG_RATE_ISR_MS, "UART IRQ update failed\n\r");
         return;
     }
 
     if (!uart_irq_rx_ready(uart_dev))
     {
-        printk("UART IRQ RX not ready\n\r");
+        PRINTK_RATELIMIT(LOG_RATE_ISR_MS, "UART IRQ RX not ready\n\r");
         return;
     }
 
     if (!ReadBuff())
     {
-        printk("UART reception failed\n\r");
+        PRINTK_RATELIMIT(LOG_RATE_ISR_MS, "UART reception failed\n\r");
         return;
     }
+
+    PERF_HIST_SINCE_US(wifi_isr, ulStamp);
 }
 
 /**
@@ -140,6 +260,9 @@ void print_uart(const char *buf)
 {
     int msg_len = strlen(buf);
 
+    PERF_ADD(wifi_tx_bytes, msg_len);
+    ulWiFiActiveAt = k_uptime_get_32();
+
     for (int i = 0; i < msg_len; i++)
     {
         uart_poll_out(uart_dev, buf[i]);
@@ -161,23 +284,66 @@ static void SendCommand(const char *cmd, char *pcArgs[], int nArgc)
 }
 
 /**
- * @brief       : Configure WiFi. Configuration
- *                includes AWS configurations also
- * @param [in]  : None
+ * @brief       : Use a known AP for the next connection
+ * @param [in]  : nIdx - index in AP table
+ * @param [out] : None
+ * @return      : true if AP is known
+*/
+static bool LoadAP(int nIdx)
+{
+    const _sWiFiAp *psAp = (nIdx >= 0) ? WiFiStoreGetAp(nIdx) : NULL;
+
+    if (psAp)
+    {
+        snprintf(cWifiCredentials, sizeof(cWifiCredentials), "%s,%s", psAp->cSSID, psAp->cPassword);
+        strcpy(cCurSSID, psAp->cSSID);
+    }
+
+    return psAp != NULL;
+}
+
+/**
+ * @brief       : Start timing a (re)connect to the AP
+ * @param [in]  : bRejoinPath - rejoin without the full configuration
+ * @param [out] : None
+ * @return      : None
+*/
+static void StartJoinTiming(bool bRejoinPath)
+{
+    ulJoinStart = k_uptime_get_32();
+    ulJoinStart = ulJoinStart ? ulJoinStart : 1;
+    bRejoin = bRejoinPath;
+    bApJoinFailed = false;
+
+    if (bRejoinPath)
+    {
+        sReconnStats.ulRejoinAttempts++;
+    }
+    else
+    {
+        sReconnStats.ulFullAttempts++;
+    }
+}
+
+/**
+ * @brief       : Send AT commands of a table in order
+ * @param [in]  : psTable - AT commands
+ *                ucCount - number of commands in table
  * @param [out] : None
  * @return      : true for success
 */
-bool ConfigureWiFi()
+static bool RunAtCmds(_sAtCmdHandle *psTable, uint8_t ucCount)
 {
     bool bRetVal = false;
     uint8_t ucIdx = 0;
-    uint32_t TimeNow=0;
     char cRespBuff[255] = {0};
     int8_t nRetry = 0;
+    bool bJoined = false;
+    uint32_t ulStamp = 0;
 
-    for (ucIdx = 0; ucIdx < sizeof(sAtCmdHandle)/sizeof(sAtCmdHandle[0]); ucIdx++)
+    for (ucIdx = 0; ucIdx < ucCount; ucIdx++)
     {
-        if (sAtCmdHandle[ucIdx].pcCmd)
+        if (psTable[ucIdx].pcCmd)
         {
             //no op
         }
@@ -191,18 +357,36 @@ bool ConfigureWiFi()
 
         do
         {
-            sAtCmdHandle[ucIdx].CmdHdlr(sAtCmdHandle[ucIdx].pcCmd, sAtCmdHandle[ucIdx].pcArgs, sAtCmdHandle[ucIdx].nArgsCount);
-            printk("Sending: %s\n\r", sAtCmdHandle[ucIdx].pcCmd);
+            ulStamp = PERF_STAMP();
+            psTable[ucIdx].CmdHdlr(psTable[ucIdx].pcCmd, psTable[ucIdx].pcArgs, psTable[ucIdx].nArgsCount);
+            LOG_DBG("Sending: %s", psTable[ucIdx].pcCmd);
             k_msleep(100);
 
-            if (0 == k_msgq_get(&UartMsgQueue, cRespBuff, K_MSEC(100)))
+            while (0 == k_msgq_get(&UartMsgQueue, cRespBuff, K_MSEC(100)))
             {
-                printk("Response: %s\n\r", cRespBuff);
+                LOG_DBG("Response: %s", cRespBuff);
+                CheckAPConnected(cRespBuff, &bJoined);
+
+                //Join URC can arrive between a later command and its reply
+                if (bJoined)
+                {
+                    OnAPJoined(cRespBuff);
+                    continue;
+                }
+
+                if (strstr(cRespBuff, "+WFJAP:0") != NULL)
+                {
+                    OnAPJoinFailed();
+                    continue;
+                }
+
                 k_msleep(100);
-                sAtCmdHandle[ucIdx].RespHdlr(cRespBuff, &bResponse);
+                psTable[ucIdx].RespHdlr(cRespBuff, &bResponse);
                 if (bResponse)
                 {
-                    printk("OK: cmd%s", sAtCmdHandle[ucIdx].pcCmd);
+                    //Includes the fixed delays of the command handlers
+                    PERF_HIST_SINCE_US(wifi_at_latency, ulStamp);
+                    printk("OK: cmd%s", psTable[ucIdx].pcCmd);
                     k_msleep(100);
                     bRetVal = true;
                     goto Cmplt;
@@ -221,260 +405,1144 @@ bool ConfigureWiFi()
     }
 
     return bRetVal;
-
 }
 
 /**
- * @brief       : Check whether configured AP is disconnected
- * @param [in]  : pcResp - Response from DA16200
- * @param [out] : pbStatus - Status 
- * @return      : None
+ * @brief       : Configure WiFi. Configuration
+ *                includes AWS configurations also
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true for success
 */
-static void CheckAPDisconnected(const char *pcResp, bool *pbStatus)
+bool ConfigureWiFi()
 {
-    if (strstr(pcResp, "+WFDAP:0") != NULL)
+    _sWiFiProfile sProfile = *WiFiStoreGetProfile();
+    bool bRetVal = false;
+
+    StartJoinTiming(false);
+    bRetVal = RunAtCmds(sAtCmdHandle, sizeof(sAtCmdHandle)/sizeof(sAtCmdHandle[0]));
+
+    if (!bRetVal)
     {
-        *pbStatus = true;
+        OnAPJoinFailed();
     }
-    else
+    else if (!sProfile.bAwsConfigured)
     {
-        *pbStatus = false;
-    } 
+        sProfile.bAwsConfigured = true;
+        WiFiStoreSetProfile(&sProfile);
+    }
+
+    return bRetVal;
 }
 
 /**
- * @brief       : Check whether configured AP is connected
- * @param [in]  : pcResp - Response from DA16200
- * @param [out] : pbStatus - Status 
- * @return      : None
+ * @brief       : Rejoin the last AP without the full configuration, mode
+ *                and AWS settings are kept in the DA16200. Succeeds only
+ *                when the AP was joined before with the current
+ *                credentials, otherwise ConfigureWiFi is needed.
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true if module joined or join request accepted
 */
-static void CheckAPConnected(const char *pcResp, bool *pbStatus)
+bool RejoinWiFi(void)
 {
-    if (strstr(pcResp, "+WFJAP:1") != NULL)
-    {
-        *pbStatus = true;
-    }
-    else
+    const _sWiFiProfile *psProfile = WiFiStoreGetProfile();
+    bool bRetVal = false;
+
+    do
     {
-        *pbStatus = false;
-    } 
+        if (!psProfile->bValid || !psProfile->bAwsConfigured ||
+            !LoadAP(WiFiStoreFindAp(psProfile->cSSID)))
+        {
+            break;
+        }
+
+        printk("INFO: Rejoin %s\n\r", cCurSSID);
+        StartJoinTiming(true);
+
+        //Module rejoins its saved profile by itself after a reset of the 9160 only
+        if (IsWiFiConnected())
+        {
+            //A +WFJAP:1 seen while asking was handled as such
+            if (!bApJoined)
+            {
+                OnAPJoined(NULL);
+            }
+
+            bRetVal = true;
+            break;
+        }
+
+        bRetVal = RunAtCmds(sRejoinCmdHandle, sizeof(sRejoinCmdHandle)/sizeof(sRejoinCmdHandle[0]));
+
+        if (!bRetVal)
+        {
+            OnAPJoinFailed();
+        }
+    } while (0);
+
+    return bRetVal;
 }
 
 /**
- * @brief      : GetAPCredentials
- * @param [in] : None
- * @param [out]: None
- * @return     : cWifiCredentials
+ * @brief       : Check for the OK result of a command, the whole line must
+ *                match so that data containing "OK" is not taken for it
+ * @param [in]  : pcLine - line received from WiFi module
+ * @param [out] : None
+ * @return      : true for an OK line
 */
-char *GetAPCredentials(void)
+static bool IsOkLine(const char *pcLine)
 {
-    return cWifiCredentials;
+    return strncmp(pcLine, "OK", 2) == 0 && pcLine[2 + strspn(pcLine + 2, "\r\n")] == '\0';
 }
 
 /**
- * @brief      : SetAPCredentials
- * @param [in] : pcCredential
- * @param [out]: None
- * @return     : None
+ * @brief       : Check for the ERROR result of a command, "ERROR" or "ERROR:<code>"
+ * @param [in]  : pcLine - line received from WiFi module
+ * @param [out] : None
+ * @return      : true for an ERROR line
 */
-void SetAPCredentials(char *pcCredential)
+static bool IsErrorLine(const char *pcLine)
 {
-    if (pcCredential != NULL)
-    {
-        memset(cWifiCredentials, 0, sizeof(cWifiCredentials));
-        strcpy(cWifiCredentials, pcCredential);
-    }
-    else
-    {
-        printk("Error: pcCredential is NULL");
-    }
+    return strncmp(pcLine, "ERROR", 5) == 0;
 }
 
 /**
- * @brief       : Processs Msgs from Wifi
- * @param [in]  : None
- * @param [out] : None 
- * @return      : None
+ * @brief       : Parse one AP of a scan report
+ *                "[+WFSCAN:]bssid\tfreq\trssi\tflags\tssid"
+ * @param [in]  : pcLine - line of the report
+ * @param [out] : pcSSID - SSID, CMD_SSID_MAX_LEN + 1 bytes, empty if hidden
+ *                pcRssi - signal in dBm
+ *                pucBssid - BSSID, WIFI_POS_BSSID_LEN bytes
+ * @return      : true for success
 */
-void ProcessWiFiMsgs()
+static bool ParseScanLine(const char *pcLine, char *pcSSID, int8_t *pcRssi, uint8_t *pucBssid)
 {
-    char cRxBuffer[255];
+    const char *pcField = pcLine;
+    unsigned int unOctet[WIFI_POS_BSSID_LEN];
+    size_t ulLen = 0;
 
-    _eDevState *DevState = NULL;
-    bool bStatus = false;
+    if (strncmp(pcField, "+WFSCAN:", strlen("+WFSCAN:")) == 0)
+    {
+        pcField += strlen("+WFSCAN:");
+    }
+
+    if (sscanf(pcField, "%x:%x:%x:%x:%x:%x", &unOctet[0], &unOctet[1], &unOctet[2],
+               &unOctet[3], &unOctet[4], &unOctet[5]) != WIFI_POS_BSSID_LEN)
+    {
+        return false;
+    }
 
-    DevState = GetDeviceState();
+    for (int nOctet = 0; nOctet < WIFI_POS_BSSID_LEN; nOctet++)
+    {
+        pucBssid[nOctet] = (uint8_t)unOctet[nOctet];
+    }
 
-    if (0 == k_msgq_get(&UartMsgQueue, cRxBuffer, K_MSEC(100)))
+    //Skip bssid and frequency
+    for (int nField = 0; nField < 2 && pcField; nField++)
     {
-        CheckAPConnected(cRxBuffer, &bStatus);
+        pcField = strchr(pcField, '\t');
+        pcField = pcField ? pcField + 1 : NULL;
+    }
 
-        if (bStatus)
-        {
-            SetDeviceState(WIFI_CONNECTED);
-        }
-        
-        CheckAPDisconnected(cRxBuffer, &bStatus);
+    if (!pcField)
+    {
+        return false;
+    }
 
-        if (bStatus)
-        {
-            SetDeviceState(WIFI_DISCONNECTED);
-        }
+    *pcRssi = (int8_t)atoi(pcField);
+
+    //Skip rssi and flags
+    for (int nField = 0; nField < 2 && pcField; nField++)
+    {
+        pcField = strchr(pcField, '\t');
+        pcField = pcField ? pcField + 1 : NULL;
     }
-}
 
-/**
- * @brief       : Process AT command response from WiFi module
- * @param [in]  : pcResp - AT command response
- * @param [out] : pbStatus - AT command stauts true for success else failed
- * @return      : None
-*/
-void ProcessResponse(const char *pcResp, bool *pbStatus)
-{
-    if (strstr(pcResp, "OK") != NULL)
+    if (!pcField)
     {
-        *pbStatus = true;
+        return false;
     }
-    else
+
+    ulLen = strcspn(pcField, "\r\n");
+
+    if (ulLen > CMD_SSID_MAX_LEN)
     {
-        *pbStatus = false;
-    }  
+        return false;
+    }
+
+    memcpy(pcSSID, pcField, ulLen);
+    pcSSID[ulLen] = '\0';
+
+    return true;
 }
 
 /**
- * @brief       : Checking connection status from WiFi
- * @param [in]  : pcResp - AT command response
- * @param [out] : pbStatus - AT command stauts true for success else failed
- * @return      : None
+ * @brief       : Rank score of a known AP, signal less a penalty for
+ *                failed joins
+ * @param [in]  : psAp - AP entry
+ *                cRssi - signal in dBm
+ * @param [out] : None
+ * @return      : score
 */
-static void ProcessConnectionStatus(const char *pcResp, bool *pbStatus)
+static int RankAP(const _sWiFiAp *psAp, int8_t cRssi)
 {
-    if (strstr(pcResp, "+WFSTA:1") != NULL)
+    int nPenalty = 0;
+
+    if (psAp->sStats.ulAttempts)
     {
-        *pbStatus = true;
+        nPenalty = (SCAN_FAIL_PENALTY * psAp->sStats.ulFailures) / psAp->sStats.ulAttempts;
     }
-    else
-    {
-        *pbStatus = false;
-    }  
+
+    return cRssi - nPenalty;
 }
 
 /**
- * @brief       : Initialise UART channel for WIFI interfacing
+ * @brief       : Scan APs in range, complete scans are also used for
+ *                positioning
  * @param [in]  : None
- * @param [out] : None
- * @return      : true for success
+ * @param [out] : pacKnownRssi - strongest signal of each known AP, 0 if not
+ *                seen, WIFI_AP_MAX entries, may be NULL
+ * @return      : true if scan completed
 */
-bool InitUart(void)
+static bool ScanAPs(int8_t *pacKnownRssi)
 {
-    int nRetVal = 0;
-    bool bRetVal = false;
-
-    do 
+    char cLine[MSG_SIZE];
+    char cSSID[CMD_SSID_MAX_LEN + 1];
+    uint8_t ucBssid[WIFI_POS_BSSID_LEN];
+    _sWiFiScan sScan = {0};
+    uint32_t ulStart = 0;
+    int8_t cRssi = 0;
+    int nIdx = 0;
+    bool bScanDone = false;
+
+    print_uart("AT+WFSCAN\r\n");
+    ulStart = k_uptime_get_32();
+
+    while ((k_uptime_get_32() - ulStart) < SCAN_TIMEOUT_MS &&
+           0 == k_msgq_get(&UartMsgQueue, cLine, K_MSEC(SCAN_TIMEOUT_MS)))
     {
-        if (!device_is_ready(uart_dev)) 
+        if (IsOkLine(cLine) || IsErrorLine(cLine))
         {
-            printk("UART device not found!");
+            bScanDone = IsOkLine(cLine);
             break;
         }
 
-        nRetVal = uart_irq_callback_user_data_set(uart_dev, serial_cb, NULL);
+        if (!ParseScanLine(cLine, cSSID, &cRssi, ucBssid))
+        {
+            continue;
+        }
 
-        if (nRetVal < 0) 
+        WiFiPosScanAdd(&sScan, ucBssid, cRssi);
+
+        if (pacKnownRssi && cSSID[0] && (nIdx = WiFiStoreFindAp(cSSID)) >= 0)
         {
-            if (nRetVal == -ENOTSUP) 
-            {
-                printk("Interrupt-driven UART API support not enabled\n");
-                break;
-            } 
-            else if (nRetVal == -ENOSYS) 
-            {
-                printk("UART device does not support interrupt-driven API\n");
-                break;
-            } 
-            else 
+            //Same SSID from several BSSIDs, keep the strongest
+            if (pacKnownRssi[nIdx] == 0 || cRssi > pacKnownRssi[nIdx])
             {
-                printk("Error setting UART callback: %d\n", nRetVal);
-                break;
+                pacKnownRssi[nIdx] = cRssi;
             }
         }
+    }
 
-        uart_irq_rx_enable(uart_dev);
-        printk("UART initialised\n\r");
-        bRetVal = true;
-    } while(0);
+    if (bScanDone)
+    {
+        WiFiPosUpdate(&sScan);
+    }
+    else
+    {
+        printk("ERR: WiFi scan incomplete\n\r");
+    }
 
-    return bRetVal;
+    return bScanDone;
 }
 
 /**
- * @brief       : Check if WiFi is connected 
+ * @brief       : Scan APs for positioning only
  * @param [in]  : None
  * @param [out] : None
- * @return      : true for success
+ * @return      : true if scan completed
 */
-bool IsWiFiConnected()
+bool ScanWiFiPosition(void)
 {
-    bool bRetVal = false;
-    bool bResponse = false;
-    char cCmdBuff[255];
-
-    bRxCmplt = false;
-    strcpy(cCmdBuff, "AT+WFSTA\n\r");
-    print_uart(cCmdBuff);
-
-    k_msgq_get(&UartMsgQueue, cCmdBuff, K_MSEC(100));
-    printk("ConnResponse: %s\n\r", cCmdBuff);
-    ProcessConnectionStatus(cCmdBuff, &bResponse);
-    if (bResponse)
-    {
-        bRetVal = true;
-    }
-
-    return bRetVal;
+    return DpmResume() && ScanAPs(NULL);
 }
 
 /**
- * @brief       : Disconnect DA module
+ * @brief       : Scan and pick the best known AP in range for the next
+ *                connection. If the scan does not complete, the AP joined
+ *                most often is picked.
  * @param [in]  : None
  * @param [out] : None
- * @return      : true for success
+ * @return      : false if no known AP is in range
 */
-bool DisconnectFromWiFi()
+bool SelectWiFiAP(void)
 {
-    
-    bool bRetVal = false;
-    bool bResponse = false;
-    char cCmdBuff[255];
-
-    bRxCmplt = false;
-    strcpy(cCmdBuff, "AT+WFQAP\n\r");
-    print_uart(cCmdBuff);
+    int8_t acRssi[WIFI_AP_MAX] = {0};
+    const _sWiFiAp *psAp = NULL;
+    const _sWiFiAp *psBest = NULL;
+    int nIdx = 0;
+    int nBest = -1;
+    int nScore = 0;
+    int nBestScore = 0;
+    bool bScanDone = false;
+
+    if (WiFiStoreGetApCount() == 0)
+    {
+        return false;
+    }
 
-    k_msgq_get(&UartMsgQueue, cCmdBuff, K_MSEC(100));
-    printk("Response: %s\n\r", cCmdBuff);
-    ProcessResponse(cCmdBuff, &bResponse);
+    bScanDone = ScanAPs(acRssi);
 
-    if (bResponse)
+    for (nIdx = 0; nIdx < WIFI_AP_MAX; nIdx++)
     {
-        bRetVal = true;
-    }
+        psAp = WiFiStoreGetAp(nIdx);
 
-    return bRetVal;
-}
+        if (!psAp)
+        {
+            continue;
+        }
 
-/**
- * @brief       : Callback for sending command with arguments
- * @param [in]  : cmd - AT command
- *                nArgc - argument count
- * @param [out] : pcArgs - arguments to the callback
- * @return      : None
-*/
-static void SendCmdWithArgs(const char *cmd, char *pcArgs[], int nArgc)
-{
-    char cmdBuf[255];
+        WiFiStoreSetApRssi(nIdx, acRssi[nIdx]);
 
-    switch(nArgc)
+        if (!bScanDone)
+        {
+            if (!psBest || psAp->sStats.ulJoins > psBest->sStats.ulJoins)
+            {
+                psBest = psAp;
+                nBest = nIdx;
+            }
+            continue;
+        }
+
+        if (acRssi[nIdx] == 0 || acRssi[nIdx] < SCAN_MIN_RSSI)
+        {
+            continue;
+        }
+
+        nScore = RankAP(psAp, acRssi[nIdx]);
+        printk("INFO: Known AP %s rssi %d score %d\n\r", psAp->cSSID, acRssi[nIdx], nScore);
+
+        if (!psBest || nScore > nBestScore + SCAN_TIE_DB ||
+            (nScore >= nBestScore - SCAN_TIE_DB && psAp->sStats.ulAvgJoinMs &&
+             psAp->sStats.ulAvgJoinMs < psBest->sStats.ulAvgJoinMs))
+        {
+            psBest = psAp;
+            nBest = nIdx;
+            nBestScore = nScore;
+        }
+    }
+
+    return LoadAP(nBest);
+}
+
+/**
+ * @brief       : Check whether configured AP is disconnected
+ * @param [in]  : pcResp - Response from DA16200
+ * @param [out] : pbStatus - Status 
+ * @return      : None
+*/
+static void CheckAPDisconnected(const char *pcResp, bool *pbStatus)
+{
+    if (strstr(pcResp, "+WFDAP:0") != NULL)
+    {
+        *pbStatus = true;
+    }
+    else
+    {
+        *pbStatus = false;
+    } 
+}
+
+/**
+ * @brief       : Check whether configured AP is connected
+ * @param [in]  : pcResp - Response from DA16200
+ * @param [out] : pbStatus - Status 
+ * @return      : None
+*/
+static void CheckAPConnected(const char *pcResp, bool *pbStatus)
+{
+    if (strstr(pcResp, "+WFJAP:1") != NULL)
+    {
+        *pbStatus = true;
+    }
+    else
+    {
+        *pbStatus = false;
+    } 
+}
+
+/**
+ * @brief       : AP joined, report time since first command of the connect
+ * @param [in]  : pcUrc - "+WFJAP:1,'ssid',ip", NULL if found already joined
+ * @param [out] : None
+ * @return      : None
+*/
+static void OnAPJoined(const char *pcUrc)
+{
+    _sWiFiProfile sProfile = *WiFiStoreGetProfile();
+    const char *pcIp = NULL;
+    uint32_t ulElapsed = 0;
+    uint16_t usLen = 0;
+
+    bApJoined = true;
+
+    if (ulJoinStart)
+    {
+        ulElapsed = k_uptime_get_32() - ulJoinStart;
+        ulJoinStart = 0;
+        sReconnStats.ulLastMs = ulElapsed;
+        sReconnStats.bLastRejoin = bRejoin;
+        sReconnStats.ulMaxMs = MAX(sReconnStats.ulMaxMs, ulElapsed);
+
+        if (bRejoin)
+        {
+            sReconnStats.ulRejoins++;
+            ulRejoinSumMs += ulElapsed;
+            sReconnStats.ulRejoinAvgMs = ulRejoinSumMs / sReconnStats.ulRejoins;
+        }
+        else
+        {
+            sReconnStats.ulFullJoins++;
+            ulFullSumMs += ulElapsed;
+            sReconnStats.ulFullAvgMs = ulFullSumMs / sReconnStats.ulFullJoins;
+        }
+
+        printk("INFO: AP %s joined in %u ms (%s)\n\r", cCurSSID, ulElapsed, bRejoin ? "rejoin" : "full");
+        WiFiStoreApResult(cCurSSID, true, ulElapsed);
+    }
+
+    strcpy(sProfile.cSSID, cCurSSID);
+
+    pcIp = pcUrc ? strrchr(pcUrc, ',') : NULL;
+
+    if (pcIp)
+    {
+        pcIp++;
+        usLen = MIN(strcspn(pcIp, "\r\n"), sizeof(sProfile.cIpAddr) - 1);
+        memset(sProfile.cIpAddr, 0, sizeof(sProfile.cIpAddr));
+        memcpy(sProfile.cIpAddr, pcIp, usLen);
+    }
+
+    WiFiStoreSetProfile(&sProfile);
+}
+
+/**
+ * @brief       : AP could not be joined
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : None
+*/
+static void OnAPJoinFailed(void)
+{
+    bApJoinFailed = true;
+
+    if (ulJoinStart)
+    {
+        ulJoinStart = 0;
+        printk("ERR: AP %s join failed\n\r", cCurSSID);
+        WiFiStoreApResult(cCurSSID, false, 0);
+
+        //Rejoin must not be retried against an AP that refused us
+        if (bRejoin)
+        {
+            WiFiStoreInvalidateProfile();
+        }
+    }
+}
+
+/**
+ * @brief       : Read IP of the joined AP and store it with the
+ *                profile used to rejoin
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true for success
+*/
+bool UpdateAPProfile(void)
+{
+    _sWiFiProfile sProfile = *WiFiStoreGetProfile();
+    char cLine[MSG_SIZE];
+    const char *pcVal = NULL;
+    uint32_t ulStart = 0;
+    bool bRetVal = false;
+
+    print_uart("AT+WFSTAT\r\n");
+    ulStart = k_uptime_get_32();
+
+    //Report comes as "key=value" lines closed by OK
+    while ((k_uptime_get_32() - ulStart) < STAT_TIMEOUT_MS &&
+           0 == k_msgq_get(&UartMsgQueue, cLine, K_MSEC(100)))
+    {
+        cLine[strcspn(cLine, "\r\n")] = '\0';
+
+        if ((pcVal = strstr(cLine, "ip_address=")) != NULL)
+        {
+            memset(sProfile.cIpAddr, 0, sizeof(sProfile.cIpAddr));
+            strncpy(sProfile.cIpAddr, pcVal + strlen("ip_address="), sizeof(sProfile.cIpAddr) - 1);
+        }
+        else if (strstr(cLine, "+WFDAP:0") != NULL)
+        {
+            bApJoined = false;
+            break;
+        }
+        else if (IsOkLine(cLine) || IsErrorLine(cLine))
+        {
+            bRetVal = IsOkLine(cLine);
+            break;
+        }
+    }
+
+    if (bRetVal && bApJoined)
+    {
+        strcpy(sProfile.cSSID, cCurSSID);
+        sProfile.bValid = true;
+        WiFiStoreSetProfile(&sProfile);
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief       : Check if AP was joined, set from the +WFJAP:1 URC
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true if joined
+*/
+bool IsAPJoined(void)
+{
+    return bApJoined;
+}
+
+/**
+ * @brief       : Get SSID of the AP used for the last connection
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : SSID, empty if none selected yet
+*/
+const char *GetWiFiSSID(void)
+{
+    return cCurSSID;
+}
+
+/**
+ * @brief       : Check if AP refused the last join
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true if join failed
+*/
+bool IsAPJoinFailed(void)
+{
+    return bApJoinFailed;
+}
+
+/**
+ * @brief       : Get time taken by rejoins and full reconnects
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : reconnect statistics
+*/
+const _sWiFiReconnStats *GetWiFiReconnStats(void)
+{
+    return &sReconnStats;
+}
+
+/**
+ * @brief      : GetAPCredentials
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : cWifiCredentials
+*/
+char *GetAPCredentials(void)
+{
+    return cWifiCredentials;
+}
+
+/**
+ * @brief      : Add an AP to the known APs or update its password
+ * @param [in] : pcSSID - SSID
+ *             : pcPassword - password
+ * @param [out]: None
+ * @return     : true for success
+*/
+bool AddWiFiAP(const char *pcSSID, const char *pcPassword)
+{
+    bool bRetVal = WiFiStoreAddAp(pcSSID, pcPassword);
+
+    if (!bRetVal)
+    {
+        printk("ERR: AP %s not stored\n\r", pcSSID ? pcSSID : "");
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Remove an AP from the known APs
+ * @param [in] : pcSSID - SSID
+ * @param [out]: None
+ * @return     : true if AP was known
+*/
+bool RemoveWiFiAP(const char *pcSSID)
+{
+    return WiFiStoreRemoveAp(pcSSID);
+}
+
+/**
+ * @brief       : Handle unsolicited AP join and disconnect reports
+ * @param [in]  : pcMsg - line received from WiFi module
+ * @param [out] : None
+ * @return      : None
+*/
+static void HandleUrc(const char *pcMsg)
+{
+    bool bStatus = false;
+    _eDevState eState = *GetDeviceState();
+
+    //Result of the location publish in flight
+    if (ePubState == WIFI_PUB_SENT && (IsOkLine(pcMsg) || IsErrorLine(pcMsg)))
+    {
+        PERF_HIST_SINCE_US(wifi_at_latency, ulPubStamp);
+        nPubResult = IsErrorLine(pcMsg) ? -EIO : nPubLen;
+        ePubState = WIFI_PUB_DONE;
+        return;
+    }
+
+    if (strstr(pcMsg, "+INIT") != NULL)
+    {
+        if (eDpmState == WIFI_DPM_SLEEP || eDpmState == WIFI_DPM_WAKING)
+        {
+            //Woken from DPM sleep, association is kept
+            OnDpmWoken();
+        }
+        else
+        {
+            //Module boots again when it leaves sleep, association is lost
+            if (bWiFiAsleep)
+            {
+                PowerLog("WIFI", "AWAKE");
+            }
+
+            bWiFiAsleep = false;
+            bApJoined = false;
+        }
+    }
+
+    //Join and leave reports are stale while the system sleeps
+    if (eState == DEV_SLEEP || eState == DEV_SLEEPING)
+    {
+        return;
+    }
+
+    CheckAPConnected(pcMsg, &bStatus);
+
+    if (bStatus)
+    {
+        OnAPJoined(pcMsg);
+        SetDeviceState(WIFI_CONNECTED);
+    }
+
+    if (strstr(pcMsg, "+WFJAP:0") != NULL)
+    {
+        OnAPJoinFailed();
+    }
+
+    CheckAPDisconnected(pcMsg, &bStatus);
+
+    if (bStatus)
+    {
+        //Module wakes from DPM sleep to report the AP loss
+        if (eDpmState == WIFI_DPM_SLEEP)
+        {
+            OnDpmWoken();
+        }
+
+        //Arbiter does not ask for the result of a link that is down
+        ePubState = WIFI_PUB_IDLE;
+        bApJoined = false;
+        SetDeviceState(WIFI_DISCONNECTED);
+    }
+}
+
+/**
+ * @brief       : Processs Msgs from Wifi
+ * @param [in]  : None
+ * @param [out] : None 
+ * @return      : None
+*/
+void ProcessWiFiMsgs()
+{
+    char cRxBuffer[255];
+
+    //Lines wake the system task, see SystemWait
+    while (0 == k_msgq_get(&UartMsgQueue, cRxBuffer, K_NO_WAIT))
+    {
+        HandleUrc(cRxBuffer);
+    }
+
+    DpmSleepIfIdle();
+}
+
+/**
+ * @brief       : Process AT command response from WiFi module
+ * @param [in]  : pcResp - AT command response
+ * @param [out] : pbStatus - AT command stauts true for success else failed
+ * @return      : None
+*/
+void ProcessResponse(const char *pcResp, bool *pbStatus)
+{
+    *pbStatus = IsOkLine(pcResp);
+}
+
+/**
+ * @brief       : Checking connection status from WiFi
+ * @param [in]  : pcResp - AT command response
+ * @param [out] : pbStatus - AT command stauts true for success else failed
+ * @return      : None
+*/
+static void ProcessConnectionStatus(const char *pcResp, bool *pbStatus)
+{
+    if (strstr(pcResp, "+WFSTA:1") != NULL)
+    {
+        *pbStatus = true;
+    }
+    else
+    {
+        *pbStatus = false;
+    }  
+}
+
+/**
+ * @brief       : Initialise UART channel for WIFI interfacing
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true for success
+*/
+bool InitUart(void)
+{
+    int nRetVal = 0;
+    bool bRetVal = false;
+    char *pcPwd = NULL;
+
+    do 
+    {
+        if (!device_is_ready(uart_dev)) 
+        {
+            printk("UART device not found!");
+            break;
+        }
+
+        nRetVal = uart_irq_callback_user_data_set(uart_dev, serial_cb, NULL);
+
+        if (nRetVal < 0) 
+        {
+            if (nRetVal == -ENOTSUP) 
+            {
+                printk("Interrupt-driven UART API support not enabled\n");
+                break;
+            } 
+            else if (nRetVal == -ENOSYS) 
+            {
+                printk("UART device does not support interrupt-driven API\n");
+                break;
+            } 
+            else 
+            {
+                printk("Error setting UART callback: %d\n", nRetVal);
+                break;
+            }
+        }
+
+        WiFiStoreInit();
+
+        //Built-in credentials seed an empty AP table
+        if (WiFiStoreGetApCount() == 0 && (pcPwd = strchr(cWifiCredentials, ',')) != NULL)
+        {
+            *pcPwd = '\0';
+            WiFiStoreAddAp(cWifiCredentials, pcPwd + 1);
+            *pcPwd = ',';
+        }
+
+        printk("INFO: %d known APs\n\r", WiFiStoreGetApCount());
+        TransportRegister(TRANSPORT_WIFI, &sWiFiLinkOps);
+
+        uart_irq_rx_enable(uart_dev);
+        printk("UART initialised\n\r");
+        bRetVal = true;
+    } while(0);
+
+    return bRetVal;
+}
+
+/**
+ * @brief       : Check if WiFi is connected. Join state is tracked from
+ *                URCs, the module is asked only when none was seen, as
+ *                after a reset of the 9160 while it stayed associated.
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true for success
+*/
+bool IsWiFiConnected()
+{
+    bool bRetVal = bApJoined;
+    uint32_t ulStart = 0;
+    char cResp[MSG_SIZE];
+
+    if (bRetVal)
+    {
+        return true;
+    }
+
+    DpmResume();
+    bRxCmplt = false;
+    print_uart("AT+WFSTA\n\r");
+    ulStart = k_uptime_get_32();
+
+    //Reports queued before the reply are not taken for it
+    while ((k_uptime_get_32() - ulStart) < WFSTA_TIMEOUT_MS)
+    {
+        if (0 != k_msgq_get(&UartMsgQueue, cResp, K_MSEC(100)))
+        {
+            continue;
+        }
+
+        if (strncmp(cResp, "+WFSTA:", strlen("+WFSTA:")) == 0)
+        {
+            LOG_DBG("ConnResponse: %s", cResp);
+            ProcessConnectionStatus(cResp, &bRetVal);
+            break;
+        }
+
+        HandleUrc(cResp);
+
+        if (bApJoined)
+        {
+            bRetVal = true;
+            break;
+        }
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief       : Disconnect DA module
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true for success
+*/
+bool DisconnectFromWiFi()
+{
+    
+    bool bRetVal = false;
+    bool bResponse = false;
+
+    //Sent anyway if the module cannot be woken, association is dropped below
+    DpmResume();
+    bRxCmplt = false;
+    print_uart("AT+WFQAP\n\r");
+
+    bResponse = (WaitAwsResult(0) == 0);
+    LOG_DBG("Response: %d", bResponse);
+    bApJoined = false;
+    ePubState = WIFI_PUB_IDLE;
+
+    if (bResponse)
+    {
+        bRetVal = true;
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief       : Pulse the wake-up pin of DA module, if wired
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true if pulsed
+*/
+static bool PulseWakeLine(void)
+{
+    bool bRetVal = false;
+
+#if DT_NODE_HAS_PROP(DT_PATH(zephyr_user), wifi_wake_gpios)
+    if (gpio_is_ready_dt(&sWiFiWake) && gpio_pin_configure_dt(&sWiFiWake, GPIO_OUTPUT_ACTIVE) == 0)
+    {
+        k_msleep(WIFI_WAKE_PULSE_MS);
+        gpio_pin_set_dt(&sWiFiWake, 0);
+        bRetVal = true;
+    }
+#endif
+
+    return bRetVal;
+}
+
+/**
+ * @brief       : Put DA module in sleep mode 2, it boots again after
+ *                ulWakeS seconds or on its wake-up pin
+ * @param [in]  : ulWakeS - RTC wake-up time in seconds
+ * @param [out] : None
+ * @return      : true for success
+*/
+bool SleepWiFi(uint32_t ulWakeS)
+{
+    bool bResponse = false;
+    char cCmdBuff[255];
+
+    snprintf(cCmdBuff, sizeof(cCmdBuff), "AT+SETSLEEP2EXT=%u,0\n\r", ulWakeS);
+    print_uart(cCmdBuff);
+
+    bResponse = (WaitAwsResult(0) == 0);
+    LOG_DBG("Response: %d", bResponse);
+
+    if (bResponse)
+    {
+        bWiFiAsleep = true;
+        bApJoined = false;
+        ulWiFiSleepAt = k_uptime_get_32();
+        ulWiFiSleepMs = ulWakeS * MSEC_PER_SEC;
+        PowerLog("WIFI", "SLEEP");
+    }
+    else
+    {
+        printk("ERR: WiFi sleep failed\n\r");
+    }
+
+    return bResponse;
+}
+
+/**
+ * @brief       : Wake DA module through its wake-up pin, without the pin it
+ *                wakes on its RTC timer
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true if the module is awake or was woken
+*/
+bool WakeWiFi(void)
+{
+    bool bRetVal = !bWiFiAsleep;
+
+    if (bWiFiAsleep && PulseWakeLine())
+    {
+        PowerLog("WIFI", "WAKE");
+        bRetVal = true;
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief       : Check if DA module is in sleep mode
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true until the module reports it booted again, or its
+ *                RTC timer has run out if the report was missed
+*/
+bool IsWiFiAsleep(void)
+{
+    if (bWiFiAsleep && (k_uptime_get_32() - ulWiFiSleepAt) >= (ulWiFiSleepMs + WIFI_BOOT_MS))
+    {
+        bWiFiAsleep = false;
+    }
+
+    return bWiFiAsleep;
+}
+
+/**
+ * @brief       : Put DA module in DPM sleep once the AP is joined and no
+ *                command was sent for CONFIG_PETTAP_WIFI_DPM_IDLE_MS
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : None
+*/
+static void DpmSleepIfIdle(void)
+{
+#if WIFI_DPM
+    if (eDpmState != WIFI_DPM_AWAKE || ePubState != WIFI_PUB_IDLE || !bApJoined || bWiFiAsleep ||
+        *GetDeviceState() != WIFI_DEVICE || (k_uptime_get_32() - ulWiFiActiveAt) < DPM_IDLE_MS)
+    {
+        return;
+    }
+
+    print_uart("AT+SETDPMSLPEXT\n\r");
+
+    //Tried again after another idle period
+    if (WaitAwsResult(0) < 0)
+    {
+        printk("ERR: WiFi DPM sleep failed\n\r");
+        return;
+    }
+
+    eDpmState = WIFI_DPM_SLEEP;
+    ulDpmSleepAt = k_uptime_get_32();
+    sDpmStats.ulSleeps++;
+    PowerLog("WIFI", "DPM");
+#endif
+}
+
+/**
+ * @brief       : Module left DPM sleep, account sleep time and wake latency
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : None
+*/
+static void OnDpmWoken(void)
+{
+    uint32_t ulNow = k_uptime_get_32();
+    uint32_t ulLatency = 0;
+
+    if (eDpmState == WIFI_DPM_WAKING)
+    {
+        ulLatency = ulNow - ulDpmWakeAt;
+        sDpmStats.ulWakes++;
+        sDpmStats.ulLastWakeMs = ulLatency;
+        sDpmStats.ulWakeMaxMs = MAX(sDpmStats.ulWakeMaxMs, ulLatency);
+        ullDpmWakeSumMs += ulLatency;
+        sDpmStats.ulWakeAvgMs = (uint32_t)(ullDpmWakeSumMs / sDpmStats.ulWakes);
+        PERF_HIST(wifi_dpm_wake, ulLatency);
+        LOG_DBG("DPM wake-up in %u ms", ulLatency);
+    }
+    else
+    {
+        //Woke by itself, sleep time was not accounted on the wake pulse
+        sDpmStats.ulSleepMs += ulNow - ulDpmSleepAt;
+    }
+
+    eDpmState = WIFI_DPM_WOKEN;
+    PowerLog("WIFI", "AWAKE");
+}
+
+/**
+ * @brief       : Take one step of waking DA module from DPM sleep, does not
+ *                block while the module boots
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : 0 if the module is held awake, -EINPROGRESS while it wakes,
+ *                negative error on failure
+*/
+static int DpmWake(void)
+{
+    int nRetVal = 0;
+
+    switch (eDpmState)
+    {
+        case WIFI_DPM_SLEEP:
+                sDpmStats.ulSleepMs += k_uptime_get_32() - ulDpmSleepAt;
+                PulseWakeLine();
+                ulDpmWakeAt = k_uptime_get_32();
+                eDpmState = WIFI_DPM_WAKING;
+                nRetVal = -EINPROGRESS;
+                break;
+
+        case WIFI_DPM_WAKING:
+                nRetVal = -EINPROGRESS;
+
+#if WIFI_DPM
+                if ((k_uptime_get_32() - ulDpmWakeAt) >= DPM_WAKE_TIMEOUT_MS)
+                {
+                    //Pulsed again on the next attempt
+                    printk("ERR: WiFi DPM wake-up timed out\n\r");
+                    sDpmStats.ulWakeFails++;
+                    ulDpmSleepAt = k_uptime_get_32();
+                    eDpmState = WIFI_DPM_SLEEP;
+                    nRetVal = -ETIMEDOUT;
+                }
+#endif
+                break;
+
+        case WIFI_DPM_WOKEN:
+                //Module goes back to DPM sleep by itself unless held awake
+                print_uart("AT+CLRDPMSLPEXT\n\r");
+                nRetVal = WaitAwsResult(0);
+
+                if (nRetVal < 0)
+                {
+                    printk("ERR: WiFi DPM hold failed %d\n\r", nRetVal);
+                    ulDpmSleepAt = k_uptime_get_32();
+                    eDpmState = WIFI_DPM_SLEEP;
+                    break;
+                }
+
+                eDpmState = WIFI_DPM_AWAKE;
+                break;
+
+        default:
+                break;
+    }
+
+    return nRetVal;
+}
+
+/**
+ * @brief       : Wait for the result of a location publish in flight, so
+ *                that the next command does not take it for its own
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : None
+*/
+static void WaitPublish(void)
+{
+    char cResp[MSG_SIZE];
+
+    while (ePubState == WIFI_PUB_SENT && (k_uptime_get_32() - ulPubSentAt) < SEND_TIMEOUT_MS)
+    {
+        if (0 == k_msgq_get(&UartMsgQueue, cResp, K_MSEC(10)))
+        {
+            HandleUrc(cResp);
+        }
+    }
+}
+
+/**
+ * @brief       : Wake DA module from DPM sleep before a command, blocks
+ *                until it is held awake and no publish is in flight
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true if the module takes commands
+*/
+static bool DpmResume(void)
+{
+    char cResp[MSG_SIZE];
+    int nRetVal = 0;
+
+    WaitPublish();
+    nRetVal = DpmWake();
+
+    while (nRetVal == -EINPROGRESS)
+    {
+        if (0 == k_msgq_get(&UartMsgQueue, cResp, K_MSEC(10)))
+        {
+            HandleUrc(cResp);
+        }
+
+        nRetVal = DpmWake();
+    }
+
+    return nRetVal == 0;
+}
+
+/**
+ * @brief       : Get DPM sleep and wake-up statistics
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : statistics
+*/
+const _sWiFiDpmStats *GetWiFiDpmStats(void)
+{
+    return &sDpmStats;
+}
+
+/**
+ * @brief       : Callback for sending command with arguments
+ * @param [in]  : cmd - AT command
+ *                nArgc - argument count
+ * @param [out] : pcArgs - arguments to the callback
+ * @return      : None
+*/
+static void SendCmdWithArgs(const char *cmd, char *pcArgs[], int nArgc)
+{
+    char cmdBuf[255];
+
+    switch(nArgc)
     {
         case 0: printk("ERR: Invalid args\n\r");
                 k_msleep(500);
@@ -502,31 +1570,192 @@ static void SendCmdWithArgs(const char *cmd, char *pcArgs[], int nArgc)
 }
 
 /**
- * @brief       : function for sending location data over WiFi
- * @param [in]  : None
+ * @brief       : Wait for the OK/ERROR result of a command, other lines
+ *                are handled as URCs
+ * @param [in]  : nLen - payload bytes to report on success
  * @param [out] : None
- * @return      : true for success
+ * @return      : nLen for success, negative error on failure
 */
-bool SendLocation()
+static int WaitAwsResult(int nLen)
 {
-    _sGnssConfig *psLocationData = NULL;
-    bool bRetVal = false;
-    char cPayload[50]; //Location data buffer
-    char cATcmd[100]; //AT command buffer 
+    int nRetVal = -ETIMEDOUT;
+    uint32_t ulStart = k_uptime_get_32();
+    uint32_t ulStamp = PERF_STAMP();
+    char cResp[MSG_SIZE];
+
+    //Join reports may arrive before the command result
+    while ((k_uptime_get_32() - ulStart) < SEND_TIMEOUT_MS)
+    {
+        if (0 != k_msgq_get(&UartMsgQueue, cResp, K_MSEC(100)))
+        {
+            continue;
+        }
+
+        if (IsOkLine(cResp))
+        {
+            PERF_HIST_SINCE_US(wifi_at_latency, ulStamp);
+            nRetVal = nLen;
+            break;
+        }
+
+        if (IsErrorLine(cResp))
+        {
+            nRetVal = -EIO;
+            break;
+        }
 
-    psLocationData = GetLocationData();
+        HandleUrc(cResp);
+    }
+
+    return nRetVal;
+}
+
+/**
+ * @brief       : Publish locations over WiFi, packed as "lat/lon;lat/lon"
+ *                into one AT+AWS command up to the line limit of the
+ *                module. Does not wait for the result, call again with the
+ *                same locations until it is returned.
+ * @param [in]  : psLocations - locations, oldest first
+ *                ucCount - number of locations
+ * @param [out] : pucSent - locations published, set with the result
+ * @return      : payload bytes sent, -EINPROGRESS while the module wakes
+ *                from DPM sleep or the publish is in flight, negative
+ *                error on failure
+*/
+int SendLocations(const _sGnssConfig *psLocations, uint8_t ucCount, uint8_t *pucSent)
+{
+    char cATcmd[AWS_LINE_MAX + 1];
+    int nHdrLen = 0;
+    int nOff = 0;
+    int nLen = 0;
+    int nRet = 0;
 
-    if (psLocationData)
+    if (!psLocations || ucCount == 0 || !pucSent)
     {
-        sprintf(cPayload,"%.6f/%.6f", psLocationData->dLatitude, psLocationData->dLongitude);
-        printk("sending data: %s\n\r", cPayload);
-        sprintf(cATcmd, "AT+AWS=CMD MCU_DATA %d %s %s\r\n", CFG_NUM, CFG_NAME, cPayload);
-        print_uart(cATcmd);
-        k_msleep(500);
-        bRetVal = true;
+        return -EINVAL;
     }
 
-    return bRetVal;
+    *pucSent = 0;
+
+    switch (ePubState)
+    {
+        case WIFI_PUB_SENT:
+                if ((k_uptime_get_32() - ulPubSentAt) < SEND_TIMEOUT_MS)
+                {
+                    return -EINPROGRESS;
+                }
+
+                printk("ERR: AWS publish timed out\n\r");
+                ePubState = WIFI_PUB_IDLE;
+                return -ETIMEDOUT;
+
+        case WIFI_PUB_DONE:
+                ePubState = WIFI_PUB_IDLE;
+                *pucSent = (nPubResult >= 0) ? ucPubFixes : 0;
+                return nPubResult;
+
+        default:
+                break;
+    }
+
+    //Arbiter keeps the locations queued while the module wakes
+    nRet = DpmWake();
+
+    if (nRet < 0)
+    {
+        return nRet;
+    }
+
+    nHdrLen = snprintf(cATcmd, sizeof(cATcmd), "AT+AWS=CMD MCU_DATA %d %s ", CFG_NUM, CFG_NAME);
+    nOff = nHdrLen;
+
+    //Room is kept for the line end
+    for (ucPubFixes = 0; ucPubFixes < ucCount; ucPubFixes++)
+    {
+        nLen = snprintf(cATcmd + nOff, sizeof(cATcmd) - nOff - 2, "%s%.6f/%.6f", ucPubFixes ? ";" : "",
+                        psLocations[ucPubFixes].dLatitude, psLocations[ucPubFixes].dLongitude);
+
+        if (nLen < 0 || nLen >= (int)(sizeof(cATcmd) - nOff - 2))
+        {
+            break;
+        }
+
+        nOff += nLen;
+    }
+
+    if (ucPubFixes == 0)
+    {
+        return -EMSGSIZE;
+    }
+
+    strcpy(cATcmd + nOff, "\r\n");
+    LOG_DBG("sending %u locations: %s", ucPubFixes, cATcmd + nHdrLen);
+    print_uart(cATcmd);
+
+    nPubLen = nOff - nHdrLen;
+    ulPubSentAt = k_uptime_get_32();
+    ulPubStamp = PERF_STAMP();
+    ePubState = WIFI_PUB_SENT;
+    PERF_COUNT(wifi_publish_cmds);
+
+    return -EINPROGRESS;
+}
+
+/**
+ * @brief       : Publish one location over WiFi, see SendLocations
+ * @param [in]  : psLocation - location to send
+ * @param [out] : None
+ * @return      : payload bytes sent, -EINPROGRESS while the module wakes
+ *                from DPM sleep or the publish is in flight, negative
+ *                error on failure
+*/
+int SendLocation(const _sGnssConfig *psLocation)
+{
+    uint8_t ucSent = 0;
+
+    return SendLocations(psLocation, 1, &ucSent);
+}
+
+/**
+ * @brief       : Send packed WiFi scan over WiFi, hex encoded
+ * @param [in]  : pucScan - packed scan
+ *                ucLen - length of scan
+ * @param [out] : None
+ * @return      : payload bytes sent, -EINPROGRESS while the module wakes
+ *                from DPM sleep or a location publish is in flight,
+ *                negative error on failure
+*/
+static int SendWiFiScan(const uint8_t *pucScan, uint8_t ucLen)
+{
+    char cHex[2 * WIFI_POS_PACKED_MAX + 1];
+    char cATcmd[sizeof(cHex) + 40];
+    size_t ulHexLen = 0;
+    int nRet = 0;
+
+    //Waits until the location publish result is taken
+    if (ePubState != WIFI_PUB_IDLE)
+    {
+        return -EINPROGRESS;
+    }
+
+    nRet = DpmWake();
+
+    if (nRet < 0)
+    {
+        return nRet;
+    }
+
+    ulHexLen = bin2hex(pucScan, ucLen, cHex, sizeof(cHex));
+
+    if (ulHexLen == 0)
+    {
+        return -EINVAL;
+    }
+
+    snprintf(cATcmd, sizeof(cATcmd), "AT+AWS=CMD MCU_DATA %d %s %s\r\n", CFG_NUM, CFG_SCAN_NAME, cHex);
+    print_uart(cATcmd);
+
+    return WaitAwsResult((int)ulHexLen);
 }
 
 //EOF
\ No newline at end of file
@@ -17,11 +17,13 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "../System/SystemHandler.h"
 
 /*********************************************MACROS******************************************************/
 #define TICK_RATE      32768
 #define TIMESLOT       TICK_RATE * 15
 #define ARGS_CNT       5
+#define WIFI_WAKE_PULSE_MS  5       //Wake line pulse out of sleep
 
 /**********************************************TYPEDEFS***************************************************/
 typedef void (*cmdHandler)(const char *pcCmd, char *pcArgs[], int nArgc);
@@ -33,6 +35,22 @@ typedef enum __eWiFiUartRxState
     UART_RCV,
     UART_END
 }_eWiFiUartRxState;
+
+typedef enum __eWiFiDpmState
+{
+    WIFI_DPM_AWAKE,                 //Held awake, takes AT commands
+    WIFI_DPM_SLEEP,                 //DPM sleep, AP association kept
+    WIFI_DPM_WAKING,                //Wake line pulsed, waiting for +INIT:WAKEUP
+    WIFI_DPM_WOKEN                  //Awake, not yet held awake
+}_eWiFiDpmState;
+
+typedef enum __eWiFiPubState
+{
+    WIFI_PUB_IDLE,
+    WIFI_PUB_SENT,                  //AT+AWS sent, waiting for OK or ERROR
+    WIFI_PUB_DONE                   //Result not yet taken by the arbiter
+}_eWiFiPubState;
+
 typedef struct __sAtCmdHandle
 {
     const char *pcCmd;
@@ -42,17 +60,55 @@ typedef struct __sAtCmdHandle
     char *pcArgs[ARGS_CNT];
 }_sAtCmdHandle;
 
+typedef struct __sWiFiReconnStats
+{
+    uint32_t ulRejoinAttempts;
+    uint32_t ulRejoins;
+    uint32_t ulFullAttempts;
+    uint32_t ulFullJoins;
+    uint32_t ulLastMs;              //First command to +WFJAP:1
+    uint32_t ulRejoinAvgMs;
+    uint32_t ulFullAvgMs;
+    uint32_t ulMaxMs;
+    bool bLastRejoin;
+}_sWiFiReconnStats;
+
+typedef struct __sWiFiDpmStats
+{
+    uint32_t ulSleeps;
+    uint32_t ulWakes;
+    uint32_t ulWakeFails;           //No +INIT:WAKEUP within timeout
+    uint32_t ulLastWakeMs;          //Wake line to +INIT:WAKEUP
+    uint32_t ulWakeAvgMs;
+    uint32_t ulWakeMaxMs;
+    uint32_t ulSleepMs;             //Total time in DPM sleep
+}_sWiFiDpmStats;
+
 /***********************************************FUNCTION DECLARATIONS**************************************/
 bool InitUart(void);
 void ProcessResponse(const char *pcResp, bool *pbStatus);
 bool ConfigureWiFi();
 bool IsWiFiConnected();
 void ProcessWiFiMsgs();
-bool SendLocation();
+int SendLocation(const _sGnssConfig *psLocation);
+int SendLocations(const _sGnssConfig *psLocations, uint8_t ucCount, uint8_t *pucSent);
 bool ReadBuff(void);
 bool DisconnectFromWiFi();
 char *GetAPCredentials(void);
-void SetAPCredentials(char *pcCredential);
+bool AddWiFiAP(const char *pcSSID, const char *pcPassword);
+bool RemoveWiFiAP(const char *pcSSID);
+bool SelectWiFiAP(void);
+bool ScanWiFiPosition(void);
+bool IsAPJoinFailed(void);
+const char *GetWiFiSSID(void);
+bool RejoinWiFi(void);
+bool UpdateAPProfile(void);
+bool IsAPJoined(void);
+const _sWiFiReconnStats *GetWiFiReconnStats(void);
+bool SleepWiFi(uint32_t ulWakeS);
+bool WakeWiFi(void);
+bool IsWiFiAsleep(void);
+const _sWiFiDpmStats *GetWiFiDpmStats(void);
 #endif
 
 //EOF
\ No newline at end of file
@@ -0,0 +1,423 @@
+/**
+ * @file    : WiFiPosition.c
+ * @brief   : Positioning from WiFi AP scans
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : WiFiPosition.h
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include "WiFiPosition.h"
+#include "WiFiHandler.h"
+#include "../Transport/TransportArbiter.h"
+
+/*******************************************MACROS**********************************************************/
+#define POS_ROOT            "wifipos"
+#define POS_KEY_FP          "fp"
+#define POS_KEY_SIZE        20
+
+/******************************************GLOBALS VARIABLES**********************************************/
+static _sWiFiFingerprint sFpTable[WIFI_POS_FP_MAX] = {0};
+static _sWiFiScan sLastScan = {0};
+static uint32_t ulLastScanTime = 0;
+static uint32_t ulFpSeq = 0;
+static int nPlace = -1;             //Fingerprint matched by last scan
+static bool bPosReady = false;
+static wifiPosHandler PlaceHandler = NULL;
+K_MUTEX_DEFINE(PosLock);
+
+BUILD_ASSERT(WIFI_POS_PACKED_MAX <= TRANSPORT_SCAN_MAX, "Packed scan does not fit upload");
+
+/*****************************************PRIVATE FUNCTIONS***********************************************/
+static int PosSet(const char *pcKey, size_t len, settings_read_cb read_cb, void *cb_arg);
+
+SETTINGS_STATIC_HANDLER_DEFINE(wifi_pos, POS_ROOT, NULL, PosSet, NULL, NULL);
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/**
+ * @brief      : Settings callback loading "wifipos/" entries
+ * @param [in] : pcKey - key below "wifipos/"
+ *             : len - stored length
+ *             : read_cb - settings read callback
+ *             : cb_arg - argument to read callback
+ * @param [out]: None
+ * @return     : 0 for success
+*/
+static int PosSet(const char *pcKey, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    const char *pcNext = NULL;
+    _sWiFiFingerprint sLoaded = {0};
+    int nIdx = 0;
+    int nRetVal = -ENOENT;
+
+    if (settings_name_steq(pcKey, POS_KEY_FP, &pcNext) && pcNext)
+    {
+        nIdx = atoi(pcNext);
+
+        if (nIdx < 0 || nIdx >= WIFI_POS_FP_MAX || len != sizeof(sLoaded))
+        {
+            return 0;
+        }
+
+        nRetVal = read_cb(cb_arg, &sLoaded, len);
+
+        if (nRetVal >= 0)
+        {
+            if (sLoaded.ucVersion == WIFI_POS_FP_VER && sLoaded.sScan.ucCount <= WIFI_POS_SCAN_MAX)
+            {
+                sFpTable[nIdx] = sLoaded;
+                ulFpSeq = MAX(ulFpSeq, sLoaded.ulSeq);
+            }
+
+            nRetVal = 0;
+        }
+    }
+
+    return nRetVal;
+}
+
+/**
+ * @brief      : Write one fingerprint, call with lock held
+ * @param [in] : ucIdx - table index
+ * @param [out]: None
+ * @return     : true for success
+*/
+static bool SaveFingerprint(uint8_t ucIdx)
+{
+    char cKey[POS_KEY_SIZE];
+    int nRetVal = 0;
+
+    if (!bPosReady)
+    {
+        return false;
+    }
+
+    snprintf(cKey, sizeof(cKey), POS_ROOT "/" POS_KEY_FP "/%u", ucIdx);
+    nRetVal = settings_save_one(cKey, &sFpTable[ucIdx], sizeof(sFpTable[ucIdx]));
+
+    if (nRetVal)
+    {
+        printk("ERR: Saving fingerprint %u failed %d\n\r", ucIdx, nRetVal);
+    }
+
+    return nRetVal == 0;
+}
+
+/**
+ * @brief      : Score a scan against a fingerprint
+ * @param [in] : psFp - fingerprint scan
+ *               psScan - current scan
+ * @param [out]: None
+ * @return     : percent of fingerprint APs seen, -1 if no match
+*/
+static int MatchScore(const _sWiFiScan *psFp, const _sWiFiScan *psScan)
+{
+    uint8_t ucCommon = 0;
+    uint32_t ulRssiDiff = 0;
+
+    if (psFp->ucCount == 0)
+    {
+        return -1;
+    }
+
+    for (uint8_t ucFp = 0; ucFp < psFp->ucCount; ucFp++)
+    {
+        for (uint8_t ucAp = 0; ucAp < psScan->ucCount; ucAp++)
+        {
+            if (memcmp(psFp->sAp[ucFp].ucBssid, psScan->sAp[ucAp].ucBssid, WIFI_POS_BSSID_LEN) == 0)
+            {
+                ucCommon++;
+                ulRssiDiff += abs(psFp->sAp[ucFp].cRssi - psScan->sAp[ucAp].cRssi);
+                break;
+            }
+        }
+    }
+
+    if (ucCommon < MIN(WIFI_POS_MIN_COMMON, psFp->ucCount) ||
+        (ucCommon * 100) < (WIFI_POS_MATCH_PCT * psFp->ucCount) ||
+        (ulRssiDiff / ucCommon) > WIFI_POS_RSSI_TOL_DB)
+    {
+        return -1;
+    }
+
+    return (ucCommon * 100) / psFp->ucCount;
+}
+
+/**
+ * @brief      : Find the fingerprint matching a scan best, call with lock held
+ * @param [in] : psScan - scan
+ * @param [out]: None
+ * @return     : table index, -1 if none
+*/
+static int FindFingerprint(const _sWiFiScan *psScan)
+{
+    int nBest = -1;
+    int nBestScore = -1;
+    int nScore = 0;
+
+    for (int nIdx = 0; nIdx < WIFI_POS_FP_MAX; nIdx++)
+    {
+        if (!sFpTable[nIdx].bUsed)
+        {
+            continue;
+        }
+
+        nScore = MatchScore(&sFpTable[nIdx].sScan, psScan);
+
+        if (nScore > nBestScore)
+        {
+            nBest = nIdx;
+            nBestScore = nScore;
+        }
+    }
+
+    return nBest;
+}
+
+/**
+ * @brief      : Load stored fingerprints
+ * @param [in] : Handler - called when arriving at or leaving a known place
+ * @param [out]: None
+ * @return     : true for success
+*/
+bool WiFiPosInit(wifiPosHandler Handler)
+{
+    int nRetVal = 0;
+    uint8_t ucCount = 0;
+
+    PlaceHandler = Handler;
+
+    //Settings backend is brought up by WiFiStoreInit
+    nRetVal = settings_load_subtree(POS_ROOT);
+
+    if (nRetVal)
+    {
+        printk("ERR: Fingerprint load failed %d\n\r", nRetVal);
+        return false;
+    }
+
+    for (uint8_t ucIdx = 0; ucIdx < WIFI_POS_FP_MAX; ucIdx++)
+    {
+        ucCount += sFpTable[ucIdx].bUsed ? 1 : 0;
+    }
+
+    printk("INFO: %d known places\n\r", ucCount);
+    bPosReady = true;
+
+    return true;
+}
+
+/**
+ * @brief      : Add an AP to a scan, only the strongest are kept
+ * @param [in] : pucBssid - BSSID
+ *               cRssi - signal in dBm
+ * @param [out]: psScan - scan, strongest first
+ * @return     : None
+*/
+void WiFiPosScanAdd(_sWiFiScan *psScan, const uint8_t *pucBssid, int8_t cRssi)
+{
+    uint8_t ucPos = psScan->ucCount;
+
+    for (uint8_t ucIdx = 0; ucIdx < psScan->ucCount; ucIdx++)
+    {
+        //Reported twice, keep the first
+        if (memcmp(psScan->sAp[ucIdx].ucBssid, pucBssid, WIFI_POS_BSSID_LEN) == 0)
+        {
+            return;
+        }
+    }
+
+    if (ucPos == WIFI_POS_SCAN_MAX)
+    {
+        if (cRssi <= psScan->sAp[WIFI_POS_SCAN_MAX - 1].cRssi)
+        {
+            return;
+        }
+
+        ucPos--;
+    }
+    else
+    {
+        psScan->ucCount++;
+    }
+
+    for (; ucPos > 0 && psScan->sAp[ucPos - 1].cRssi < cRssi; ucPos--)
+    {
+        psScan->sAp[ucPos] = psScan->sAp[ucPos - 1];
+    }
+
+    memcpy(psScan->sAp[ucPos].ucBssid, pucBssid, WIFI_POS_BSSID_LEN);
+    psScan->sAp[ucPos].cRssi = cRssi;
+}
+
+/**
+ * @brief      : Position from a complete scan. A known place gives its
+ *               stored location, else the scan is uploaded while GNSS has
+ *               no fix.
+ * @param [in] : psScan - scan
+ * @param [out]: None
+ * @return     : None
+*/
+void WiFiPosUpdate(const _sWiFiScan *psScan)
+{
+    _sGnssConfig sLocation = {0};
+    uint8_t ucPacked[WIFI_POS_PACKED_MAX];
+    uint8_t ucLen = 0;
+    int nPrevPlace = 0;
+    int nIdx = 0;
+
+    k_mutex_lock(&PosLock, K_FOREVER);
+
+    sLastScan = *psScan;
+    ulLastScanTime = k_uptime_get_32();
+    nIdx = FindFingerprint(psScan);
+    nPrevPlace = nPlace;
+    nPlace = nIdx;
+
+    if (nIdx >= 0)
+    {
+        sLocation.dLatitude = sFpTable[nIdx].dLatitude;
+        sLocation.dLongitude = sFpTable[nIdx].dLongitude;
+    }
+
+    k_mutex_unlock(&PosLock);
+
+    if (nIdx >= 0)
+    {
+        UpdateLocation(&sLocation);
+        SetLocationDataStatus(true);
+
+        if (nPrevPlace != nIdx)
+        {
+            printk("INFO: At known place %d\n\r", nIdx);
+            TransportPublish(&sLocation);
+        }
+    }
+    else
+    {
+        if (nPrevPlace >= 0)
+        {
+            //Stored location no longer holds, wait for GNSS
+            printk("INFO: Left known place %d\n\r", nPrevPlace);
+            SetLocationDataStatus(false);
+        }
+
+        if (!IsLocationDataOK() && (ucLen = WiFiPosPack(psScan, ucPacked, sizeof(ucPacked))) > 0)
+        {
+            TransportPublishScan(ucPacked, ucLen);
+        }
+    }
+
+    if (PlaceHandler && ((nPrevPlace >= 0) != (nIdx >= 0)))
+    {
+        PlaceHandler(nIdx >= 0);
+    }
+}
+
+/**
+ * @brief      : Learn the place of the last scan from a GNSS fix. Only
+ *               learned while joined to a known AP, oldest place is
+ *               replaced when the table is full.
+ * @param [in] : psLocation - GNSS fix
+ * @param [out]: None
+ * @return     : true if a new place was stored
+*/
+bool WiFiPosLearn(const _sGnssConfig *psLocation)
+{
+    bool bRetVal = false;
+    int nSlot = 0;
+
+    if (!psLocation || !IsAPJoined())
+    {
+        return false;
+    }
+
+    k_mutex_lock(&PosLock, K_FOREVER);
+
+    do
+    {
+        if (sLastScan.ucCount < WIFI_POS_MIN_COMMON ||
+            (k_uptime_get_32() - ulLastScanTime) > WIFI_POS_LEARN_AGE_MS ||
+            FindFingerprint(&sLastScan) >= 0)
+        {
+            break;
+        }
+
+        for (int nIdx = 0; nIdx < WIFI_POS_FP_MAX; nIdx++)
+        {
+            if (!sFpTable[nIdx].bUsed)
+            {
+                nSlot = nIdx;
+                break;
+            }
+
+            if (sFpTable[nIdx].ulSeq < sFpTable[nSlot].ulSeq)
+            {
+                nSlot = nIdx;
+            }
+        }
+
+        sFpTable[nSlot].ucVersion = WIFI_POS_FP_VER;
+        sFpTable[nSlot].bUsed = true;
+        sFpTable[nSlot].ulSeq = ++ulFpSeq;
+        sFpTable[nSlot].dLatitude = psLocation->dLatitude;
+        sFpTable[nSlot].dLongitude = psLocation->dLongitude;
+        sFpTable[nSlot].sScan = sLastScan;
+        SaveFingerprint(nSlot);
+
+        printk("INFO: Learned place %d, %d APs\n\r", nSlot, sLastScan.ucCount);
+        bRetVal = true;
+    } while (0);
+
+    k_mutex_unlock(&PosLock);
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Check whether last scan matched a known place
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : true if at a known place
+*/
+bool WiFiPosIsKnownPlace(void)
+{
+    return nPlace >= 0;
+}
+
+/**
+ * @brief      : Pack a scan for upload, count followed by BSSID and RSSI
+ *               of each AP
+ * @param [in] : psScan - scan
+ *               ucSize - size of buffer
+ * @param [out]: pucBuf - packed scan
+ * @return     : packed length, 0 if empty or buffer too small
+*/
+uint8_t WiFiPosPack(const _sWiFiScan *psScan, uint8_t *pucBuf, uint8_t ucSize)
+{
+    uint8_t ucLen = 1;
+
+    if (psScan->ucCount == 0 || ucSize < 1 + psScan->ucCount * WIFI_POS_AP_PACKED)
+    {
+        return 0;
+    }
+
+    pucBuf[0] = psScan->ucCount;
+
+    for (uint8_t ucIdx = 0; ucIdx < psScan->ucCount; ucIdx++)
+    {
+        memcpy(&pucBuf[ucLen], psScan->sAp[ucIdx].ucBssid, WIFI_POS_BSSID_LEN);
+        ucLen += WIFI_POS_BSSID_LEN;
+        pucBuf[ucLen++] = (uint8_t)psScan->sAp[ucIdx].cRssi;
+    }
+
+    return ucLen;
+}
+
+//EOF
@@ -0,0 +1,72 @@
+/**
+ * @file    : WiFiPosition.h
+ * @brief   : Positioning from WiFi AP scans
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : WiFiPosition.c
+ * @note    : Each complete scan is matched against fingerprints of known
+ *            places (home, kennel, ...) learned from GNSS fixes taken
+ *            while joined to a known AP. On a match the stored location
+ *            is used and GNSS can be switched off. Otherwise the scan is
+ *            packed and uploaded for cloud positioning while GNSS has no
+ *            fix.
+*/
+
+#ifndef _WIFI_POSITION_H
+#define _WIFI_POSITION_H
+
+/*********************************************INCLUDES***************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "../System/SystemHandler.h"
+
+/*********************************************MACROS******************************************************/
+#define WIFI_POS_SCAN_MAX       8       //Strongest APs kept from a scan
+#define WIFI_POS_FP_MAX         4       //Known places
+#define WIFI_POS_MIN_COMMON     2       //APs to share with a fingerprint
+#define WIFI_POS_MATCH_PCT      60      //Of fingerprint APs seen again
+#define WIFI_POS_RSSI_TOL_DB    12      //Mean signal difference allowed
+#define WIFI_POS_LEARN_AGE_MS   120000  //Scan older than this is not learned
+#define WIFI_POS_BSSID_LEN      6
+#define WIFI_POS_AP_PACKED      (WIFI_POS_BSSID_LEN + 1)
+#define WIFI_POS_PACKED_MAX     (1 + WIFI_POS_SCAN_MAX * WIFI_POS_AP_PACKED)
+#define WIFI_POS_FP_VER         1
+
+/**********************************************TYPEDEFS***************************************************/
+typedef struct __sWiFiPosAp
+{
+    uint8_t ucBssid[WIFI_POS_BSSID_LEN];
+    int8_t cRssi;
+}_sWiFiPosAp;
+
+/*APs of a scan, strongest first*/
+typedef struct __sWiFiScan
+{
+    uint8_t ucCount;
+    _sWiFiPosAp sAp[WIFI_POS_SCAN_MAX];
+}_sWiFiScan;
+
+typedef struct __sWiFiFingerprint
+{
+    uint8_t ucVersion;
+    bool bUsed;
+    uint32_t ulSeq;                 //Learn order, oldest is replaced
+    double dLatitude;
+    double dLongitude;
+    _sWiFiScan sScan;
+}_sWiFiFingerprint;
+
+/*Device arrived at (true) or left (false) a known place*/
+typedef void (*wifiPosHandler)(bool bKnownPlace);
+
+/***********************************************FUNCTION DECLARATIONS**************************************/
+bool WiFiPosInit(wifiPosHandler Handler);
+void WiFiPosScanAdd(_sWiFiScan *psScan, const uint8_t *pucBssid, int8_t cRssi);
+void WiFiPosUpdate(const _sWiFiScan *psScan);
+bool WiFiPosLearn(const _sGnssConfig *psLocation);
+bool WiFiPosIsKnownPlace(void);
+uint8_t WiFiPosPack(const _sWiFiScan *psScan, uint8_t *pucBuf, uint8_t ucSize);
+
+#endif
+
+//EOF
@@ -0,0 +1,532 @@
+/**
+ * @file    : WiFiStore.c
+ * @brief   : Persistent storage of known APs and last AP profile
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : WiFiStore.h
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include "WiFiStore.h"
+
+/*******************************************MACROS**********************************************************/
+#define STORE_ROOT          "wifi"
+#define STORE_KEY_CRED      "cred"      //Single "ssid,password" of older firmware
+#define STORE_KEY_AP        "ap"
+#define STORE_KEY_PROFILE   "prof"
+#define STORE_KEY_SIZE      16
+
+/******************************************GLOBALS VARIABLES**********************************************/
+static _sWiFiAp sApTable[WIFI_AP_MAX] = {0};
+static _sWiFiProfile sProfile = {0};
+static char cLegacyCred[CREDENTIAL_SIZE] = {0};
+static bool bStoreReady = false;
+K_MUTEX_DEFINE(StoreLock);
+
+/*****************************************PRIVATE FUNCTIONS***********************************************/
+static int StoreSet(const char *pcKey, size_t len, settings_read_cb read_cb, void *cb_arg);
+
+SETTINGS_STATIC_HANDLER_DEFINE(wifi_store, STORE_ROOT, NULL, StoreSet, NULL, NULL);
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/**
+ * @brief      : Settings callback loading "wifi/" entries
+ * @param [in] : pcKey - key below "wifi/"
+ *             : len - stored length
+ *             : read_cb - settings read callback
+ *             : cb_arg - argument to read callback
+ * @param [out]: None
+ * @return     : 0 for success
+*/
+static int StoreSet(const char *pcKey, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    const char *pcNext = NULL;
+    _sWiFiProfile sLoadedProfile = {0};
+    _sWiFiAp sLoadedAp = {0};
+    int nIdx = 0;
+    int nRetVal = -ENOENT;
+
+    if (settings_name_steq(pcKey, STORE_KEY_AP, &pcNext) && pcNext)
+    {
+        nIdx = atoi(pcNext);
+
+        //Layout changed between firmware versions, start over
+        if (nIdx < 0 || nIdx >= WIFI_AP_MAX || len != sizeof(sLoadedAp))
+        {
+            return 0;
+        }
+
+        nRetVal = read_cb(cb_arg, &sLoadedAp, len);
+
+        if (nRetVal >= 0)
+        {
+            if (sLoadedAp.ucVersion == WIFI_AP_VER)
+            {
+                sLoadedAp.cSSID[sizeof(sLoadedAp.cSSID) - 1] = '\0';
+                sLoadedAp.cPassword[sizeof(sLoadedAp.cPassword) - 1] = '\0';
+                sLoadedAp.sStats.cLastRssi = 0;
+                sApTable[nIdx] = sLoadedAp;
+            }
+
+            nRetVal = 0;
+        }
+    }
+    else if (settings_name_steq(pcKey, STORE_KEY_PROFILE, &pcNext) && !pcNext)
+    {
+        if (len != sizeof(sLoadedProfile))
+        {
+            return 0;
+        }
+
+        nRetVal = read_cb(cb_arg, &sLoadedProfile, len);
+
+        if (nRetVal >= 0)
+        {
+            if (sLoadedProfile.ucVersion == WIFI_PROFILE_VER)
+            {
+                sProfile = sLoadedProfile;
+            }
+
+            nRetVal = 0;
+        }
+    }
+    else if (settings_name_steq(pcKey, STORE_KEY_CRED, &pcNext) && !pcNext)
+    {
+        if (len == 0 || len > sizeof(cLegacyCred))
+        {
+            return 0;
+        }
+
+        nRetVal = read_cb(cb_arg, cLegacyCred, len);
+
+        if (nRetVal >= 0)
+        {
+            cLegacyCred[sizeof(cLegacyCred) - 1] = '\0';
+            nRetVal = 0;
+        }
+    }
+
+    return nRetVal;
+}
+
+/**
+ * @brief      : Write one AP entry, call with lock held
+ * @param [in] : ucIdx - table index
+ * @param [out]: None
+ * @return     : true for success
+*/
+static bool SaveAp(uint8_t ucIdx)
+{
+    char cKey[STORE_KEY_SIZE];
+    int nRetVal = 0;
+
+    if (!bStoreReady)
+    {
+        return false;
+    }
+
+    snprintf(cKey, sizeof(cKey), STORE_ROOT "/" STORE_KEY_AP "/%u", ucIdx);
+
+    if (sApTable[ucIdx].bUsed)
+    {
+        nRetVal = settings_save_one(cKey, &sApTable[ucIdx], sizeof(sApTable[ucIdx]));
+    }
+    else
+    {
+        nRetVal = settings_delete(cKey);
+    }
+
+    if (nRetVal)
+    {
+        printk("ERR: Saving AP %u failed %d\n\r", ucIdx, nRetVal);
+    }
+
+    return nRetVal == 0;
+}
+
+/**
+ * @brief      : Find AP by SSID, call with lock held
+ * @param [in] : pcSSID - SSID
+ * @param [out]: None
+ * @return     : table index, -1 if unknown
+*/
+static int FindAp(const char *pcSSID)
+{
+    for (int nIdx = 0; nIdx < WIFI_AP_MAX; nIdx++)
+    {
+        if (sApTable[nIdx].bUsed && strcmp(sApTable[nIdx].cSSID, pcSSID) == 0)
+        {
+            return nIdx;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief      : Initialise settings backend and load stored entries
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : true for success
+*/
+bool WiFiStoreInit(void)
+{
+    bool bRetVal = false;
+    int nRetVal = 0;
+    char *pcPwd = NULL;
+
+    do
+    {
+        nRetVal = settings_subsys_init();
+
+        if (nRetVal)
+        {
+            printk("ERR: Settings init failed %d\n\r", nRetVal);
+            break;
+        }
+
+        nRetVal = settings_load_subtree(STORE_ROOT);
+
+        if (nRetVal)
+        {
+            printk("ERR: Settings load failed %d\n\r", nRetVal);
+            break;
+        }
+
+        bStoreReady = true;
+        bRetVal = true;
+
+        //Move credentials of older firmware into the table
+        if (cLegacyCred[0])
+        {
+            pcPwd = strchr(cLegacyCred, ',');
+
+            if (pcPwd)
+            {
+                *pcPwd++ = '\0';
+                WiFiStoreAddAp(cLegacyCred, pcPwd);
+            }
+
+            settings_delete(STORE_ROOT "/" STORE_KEY_CRED);
+            memset(cLegacyCred, 0, sizeof(cLegacyCred));
+        }
+    } while (0);
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Add an AP or update its password. When the table is full
+ *               the AP with the fewest successful joins is replaced.
+ * @param [in] : pcSSID - SSID
+ *             : pcPassword - password, empty for open networks
+ * @param [out]: None
+ * @return     : true for success
+*/
+bool WiFiStoreAddAp(const char *pcSSID, const char *pcPassword)
+{
+    bool bRetVal = false;
+    bool bDropProfile = false;
+    int nIdx = 0;
+    int nSlot = -1;
+
+    if (!pcSSID || !pcPassword || !pcSSID[0] ||
+        strlen(pcSSID) > CMD_SSID_MAX_LEN || strlen(pcPassword) > CMD_PWD_MAX_LEN)
+    {
+        return false;
+    }
+
+    k_mutex_lock(&StoreLock, K_FOREVER);
+
+    do
+    {
+        nSlot = FindAp(pcSSID);
+
+        if (nSlot >= 0)
+        {
+            if (strcmp(sApTable[nSlot].cPassword, pcPassword) == 0)
+            {
+                bRetVal = true;
+                break;
+            }
+
+            bDropProfile = (strcmp(sProfile.cSSID, pcSSID) == 0);
+        }
+        else
+        {
+            for (nIdx = 0; nIdx < WIFI_AP_MAX; nIdx++)
+            {
+                if (!sApTable[nIdx].bUsed)
+                {
+                    nSlot = nIdx;
+                    break;
+                }
+
+                if (nSlot < 0 || sApTable[nIdx].sStats.ulJoins < sApTable[nSlot].sStats.ulJoins)
+                {
+                    nSlot = nIdx;
+                }
+            }
+
+            if (sApTable[nSlot].bUsed)
+            {
+                printk("INFO: AP table full, replacing %s\n\r", sApTable[nSlot].cSSID);
+                bDropProfile = (strcmp(sProfile.cSSID, sApTable[nSlot].cSSID) == 0);
+            }
+
+            memset(&sApTable[nSlot], 0, sizeof(sApTable[nSlot]));
+            sApTable[nSlot].ucVersion = WIFI_AP_VER;
+            sApTable[nSlot].bUsed = true;
+            strcpy(sApTable[nSlot].cSSID, pcSSID);
+        }
+
+        memset(sApTable[nSlot].cPassword, 0, sizeof(sApTable[nSlot].cPassword));
+        strcpy(sApTable[nSlot].cPassword, pcPassword);
+        bRetVal = SaveAp(nSlot) || !bStoreReady;
+    } while (0);
+
+    k_mutex_unlock(&StoreLock);
+
+    if (bDropProfile)
+    {
+        WiFiStoreInvalidateProfile();
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Remove an AP
+ * @param [in] : pcSSID - SSID
+ * @param [out]: None
+ * @return     : true if AP was known
+*/
+bool WiFiStoreRemoveAp(const char *pcSSID)
+{
+    bool bRetVal = false;
+    bool bDropProfile = false;
+    int nIdx = 0;
+
+    if (!pcSSID)
+    {
+        return false;
+    }
+
+    k_mutex_lock(&StoreLock, K_FOREVER);
+
+    nIdx = FindAp(pcSSID);
+
+    if (nIdx >= 0)
+    {
+        memset(&sApTable[nIdx], 0, sizeof(sApTable[nIdx]));
+        SaveAp(nIdx);
+        bDropProfile = (strcmp(sProfile.cSSID, pcSSID) == 0);
+        bRetVal = true;
+    }
+
+    k_mutex_unlock(&StoreLock);
+
+    if (bDropProfile)
+    {
+        WiFiStoreInvalidateProfile();
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Find AP by SSID
+ * @param [in] : pcSSID - SSID
+ * @param [out]: None
+ * @return     : table index, -1 if unknown
+*/
+int WiFiStoreFindAp(const char *pcSSID)
+{
+    int nIdx = -1;
+
+    if (pcSSID)
+    {
+        k_mutex_lock(&StoreLock, K_FOREVER);
+        nIdx = FindAp(pcSSID);
+        k_mutex_unlock(&StoreLock);
+    }
+
+    return nIdx;
+}
+
+/**
+ * @brief      : Get AP entry
+ * @param [in] : ucIdx - table index
+ * @param [out]: None
+ * @return     : AP entry, NULL if slot is empty
+*/
+const _sWiFiAp *WiFiStoreGetAp(uint8_t ucIdx)
+{
+    if (ucIdx < WIFI_AP_MAX && sApTable[ucIdx].bUsed)
+    {
+        return &sApTable[ucIdx];
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief      : Get number of known APs
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : number of APs in table
+*/
+uint8_t WiFiStoreGetApCount(void)
+{
+    uint8_t ucCount = 0;
+
+    for (uint8_t ucIdx = 0; ucIdx < WIFI_AP_MAX; ucIdx++)
+    {
+        ucCount += sApTable[ucIdx].bUsed ? 1 : 0;
+    }
+
+    return ucCount;
+}
+
+/**
+ * @brief      : Note signal of an AP seen in a scan, not written to flash
+ * @param [in] : ucIdx - table index
+ *             : cRssi - signal in dBm, 0 if not seen
+ * @param [out]: None
+ * @return     : None
+*/
+void WiFiStoreSetApRssi(uint8_t ucIdx, int8_t cRssi)
+{
+    if (ucIdx < WIFI_AP_MAX)
+    {
+        sApTable[ucIdx].sStats.cLastRssi = cRssi;
+    }
+}
+
+/**
+ * @brief      : Record result of a connection attempt
+ * @param [in] : pcSSID - SSID of AP tried
+ *             : bJoined - AP joined
+ *             : ulJoinMs - time from first command to join
+ * @param [out]: None
+ * @return     : None
+*/
+void WiFiStoreApResult(const char *pcSSID, bool bJoined, uint32_t ulJoinMs)
+{
+    _sWiFiApStats *psStats = NULL;
+    int nIdx = 0;
+
+    if (!pcSSID)
+    {
+        return;
+    }
+
+    k_mutex_lock(&StoreLock, K_FOREVER);
+
+    nIdx = FindAp(pcSSID);
+
+    if (nIdx >= 0)
+    {
+        psStats = &sApTable[nIdx].sStats;
+        psStats->ulAttempts++;
+
+        if (bJoined)
+        {
+            psStats->ulJoins++;
+            psStats->ulLastJoinMs = ulJoinMs;
+            //Running average weighted towards recent joins
+            psStats->ulAvgJoinMs = psStats->ulAvgJoinMs ?
+                                   (psStats->ulAvgJoinMs * 3 + ulJoinMs) / 4 : ulJoinMs;
+        }
+        else
+        {
+            psStats->ulFailures++;
+        }
+
+        SaveAp(nIdx);
+    }
+
+    k_mutex_unlock(&StoreLock);
+}
+
+/**
+ * @brief      : Get last AP profile
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : stored profile, bValid false if none
+*/
+const _sWiFiProfile *WiFiStoreGetProfile(void)
+{
+    return &sProfile;
+}
+
+/**
+ * @brief      : Store AP profile, flash is only written when it changed
+ * @param [in] : psProfile - profile of the AP joined
+ * @param [out]: None
+ * @return     : true for success
+*/
+bool WiFiStoreSetProfile(const _sWiFiProfile *psProfile)
+{
+    _sWiFiProfile sNew = {0};
+    bool bRetVal = false;
+
+    if (!psProfile)
+    {
+        return false;
+    }
+
+    sNew = *psProfile;
+    sNew.ucVersion = WIFI_PROFILE_VER;
+
+    k_mutex_lock(&StoreLock, K_FOREVER);
+
+    do
+    {
+        if (memcmp(&sProfile, &sNew, sizeof(sProfile)) == 0)
+        {
+            bRetVal = true;
+            break;
+        }
+
+        sProfile = sNew;
+
+        if (bStoreReady && settings_save_one(STORE_ROOT "/" STORE_KEY_PROFILE, &sProfile, sizeof(sProfile)))
+        {
+            printk("ERR: Saving AP profile failed\n\r");
+            break;
+        }
+
+        bRetVal = true;
+    } while (0);
+
+    k_mutex_unlock(&StoreLock);
+
+    return bRetVal;
+}
+
+/**
+ * @brief      : Forget last AP, next connection has to look for it again.
+ *               AWS configuration of the module is kept.
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : None
+*/
+void WiFiStoreInvalidateProfile(void)
+{
+    _sWiFiProfile sCleared = {0};
+
+    k_mutex_lock(&StoreLock, K_FOREVER);
+    sCleared.bAwsConfigured = sProfile.bAwsConfigured;
+    k_mutex_unlock(&StoreLock);
+
+    WiFiStoreSetProfile(&sCleared);
+}
+
+//EOF
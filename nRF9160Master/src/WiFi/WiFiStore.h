@@ -0,0 +1,73 @@
+/**
+ * @file    : WiFiStore.h
+ * @brief   : Persistent storage of known APs and last AP profile
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : WiFiStore.c
+ * @note    : Stored with the settings subsystem on NVS under "wifi/".
+ *            Each known AP keeps its credentials and connection
+ *            statistics. The profile of the last AP joined is used to
+ *            rejoin without the full configuration and is dropped when
+ *            that AP is removed or its password changes.
+*/
+
+#ifndef _WIFI_STORE_H
+#define _WIFI_STORE_H
+
+/*********************************************INCLUDES***************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "CmdDispatch.h"
+
+/*********************************************MACROS******************************************************/
+#define CREDENTIAL_SIZE     100
+#define WIFI_AP_MAX         4       //Known APs (home, office, kennel, ...)
+#define IP_ADDR_SIZE        16
+#define WIFI_PROFILE_VER    3
+#define WIFI_AP_VER         1
+
+/**********************************************TYPEDEFS***************************************************/
+typedef struct __sWiFiApStats
+{
+    uint32_t ulAttempts;
+    uint32_t ulJoins;
+    uint32_t ulFailures;
+    uint32_t ulLastJoinMs;          //First command to +WFJAP:1
+    uint32_t ulAvgJoinMs;
+    int8_t cLastRssi;               //From last scan, 0 if not seen
+}_sWiFiApStats;
+
+typedef struct __sWiFiAp
+{
+    uint8_t ucVersion;
+    bool bUsed;
+    char cSSID[CMD_SSID_MAX_LEN + 1];
+    char cPassword[CMD_PWD_MAX_LEN + 1];
+    _sWiFiApStats sStats;
+}_sWiFiAp;
+
+typedef struct __sWiFiProfile
+{
+    uint8_t ucVersion;
+    bool bValid;                    //AP joined with current credentials
+    bool bAwsConfigured;            //AWS settings already written to DA16200
+    char cSSID[CMD_SSID_MAX_LEN + 1];
+    char cIpAddr[IP_ADDR_SIZE];     //Last DHCP lease
+}_sWiFiProfile;
+
+/***********************************************FUNCTION DECLARATIONS**************************************/
+bool WiFiStoreInit(void);
+bool WiFiStoreAddAp(const char *pcSSID, const char *pcPassword);
+bool WiFiStoreRemoveAp(const char *pcSSID);
+int WiFiStoreFindAp(const char *pcSSID);
+const _sWiFiAp *WiFiStoreGetAp(uint8_t ucIdx);
+uint8_t WiFiStoreGetApCount(void);
+void WiFiStoreSetApRssi(uint8_t ucIdx, int8_t cRssi);
+void WiFiStoreApResult(const char *pcSSID, bool bJoined, uint32_t ulJoinMs);
+const _sWiFiProfile *WiFiStoreGetProfile(void);
+bool WiFiStoreSetProfile(const _sWiFiProfile *psProfile);
+void WiFiStoreInvalidateProfile(void);
+
+#endif
+
+//EOF
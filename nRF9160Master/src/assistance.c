@@ -18,6 +18,7 @@
 #endif /* CONFIG_NRF_CLOUD_PGPS */
 
 #include "assistance.h"
+#include "coarse_position.h"
 
 LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
 
@@ -39,53 +40,6 @@ static struct k_work inject_pgps_data_work;
 static struct k_work_q *work_q;
 static volatile bool assistance_active;
 
-#if defined(CONFIG_NRF_CLOUD_AGPS)
-static int serving_cell_info_get(struct lte_lc_cell *serving_cell)
-{
-	int err;
-
-	err = modem_info_init();
-	if (err) {
-		return err;
-	}
-
-	char resp_buf[MODEM_INFO_MAX_RESPONSE_SIZE];
-
-	err = modem_info_string_get(MODEM_INFO_CELLID,
-				    resp_buf,
-				    MODEM_INFO_MAX_RESPONSE_SIZE);
-	if (err < 0) {
-		return err;
-	}
-
-	serving_cell->id = strtol(resp_buf, NULL, 16);
-
-	err = modem_info_string_get(MODEM_INFO_AREA_CODE,
-				    resp_buf,
-				    MODEM_INFO_MAX_RESPONSE_SIZE);
-	if (err < 0) {
-		return err;
-	}
-
-	serving_cell->tac = strtol(resp_buf, NULL, 16);
-
-	/* Request for MODEM_INFO_MNC returns both MNC and MCC in the same string. */
-	err = modem_info_string_get(MODEM_INFO_OPERATOR,
-				    resp_buf,
-				    MODEM_INFO_MAX_RESPONSE_SIZE);
-	if (err < 0) {
-		return err;
-	}
-
-	serving_cell->mnc = strtol(&resp_buf[3], NULL, 10);
-	/* Null-terminate MCC, read and store it. */
-	resp_buf[3] = '\0';
-	serving_cell->mcc = strtol(resp_buf, NULL, 10);
-
-	return 0;
-}
-#endif /* CONFIG_NRF_CLOUD_AGPS */
-
 #if defined(CONFIG_NRF_CLOUD_PGPS)
 static void get_pgps_data_work_fn(struct k_work *work)
 {
@@ -299,7 +253,7 @@ int assistance_request(struct nrf_modem_gnss_agps_data_frame *agps_request)
 
 	struct lte_lc_cells_info net_info = { 0 };
 
-	err = serving_cell_info_get(&net_info.current_cell);
+	err = coarse_position_serving_cell_get(&net_info.current_cell);
 	if (err) {
 		LOG_ERR("Could not get cell info, error: %d", err);
 	} else {
@@ -339,6 +293,11 @@ agps_exit:
 	return err;
 }
 
+void assistance_cancel(void)
+{
+	/* REST requests can't be interrupted, downloads are short. */
+}
+
 bool assistance_is_active(void)
 {
 	return assistance_active;
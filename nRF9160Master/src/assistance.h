@@ -33,6 +33,14 @@ int assistance_init(struct k_work_q *assistance_work_q);
  */
 int assistance_request(struct nrf_modem_gnss_agps_data_frame *agps_request);
 
+/**
+ * @brief Cancels an ongoing assistance data download.
+ *
+ * @details Called when GNSS got a fix and the download is not needed anymore. Data
+ *          already received stays injected.
+ */
+void assistance_cancel(void);
+
 /**
  * @brief Returns assistance module state.
  *
@@ -0,0 +1,433 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/logging/log.h>
+#include <nrf_modem_gnss.h>
+#if defined(CONFIG_DATE_TIME)
+#include <date_time.h>
+#endif
+
+#include "assistance_cache.h"
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER)
+#include "gnss_scheduler.h"
+#endif
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* (6.1.1980 UTC - 1.1.1970 UTC) */
+#define GPS_TO_UNIX_UTC_OFFSET_SECONDS	(315964800UL)
+/* UTC/GPS time offset as of 1st of January 2017. */
+#define GPS_TO_UTC_LEAP_SECONDS		(18UL)
+#define SEC_PER_HOUR			(60UL * 60UL)
+#define SEC_PER_DAY			(24UL * SEC_PER_HOUR)
+#define SEC_PER_WEEK			(7UL * SEC_PER_DAY)
+
+#define GPS_SV_COUNT			32
+/* Ephemeris fit interval is 4 hours centered at toe. */
+#define EPHE_VALID_AFTER_TOE_SEC	(2UL * SEC_PER_HOUR)
+#define EPHE_TOE_SCALE			16
+#define ALM_VALID_SEC			(14UL * SEC_PER_DAY)
+#define KLOB_VALID_SEC			(1UL * SEC_PER_DAY)
+#define UTC_VALID_SEC			(7UL * SEC_PER_DAY)
+/* A download writes many frames in a burst, save once after it. */
+#define SAVE_DELAY			K_SECONDS(10)
+
+/* Expiry is in GPS seconds, 0 means the entry is empty. */
+struct ephe_entry {
+	uint32_t expiry;
+	struct nrf_modem_gnss_agps_data_ephemeris data;
+};
+
+struct alm_entry {
+	uint32_t expiry;
+	struct nrf_modem_gnss_agps_data_almanac data;
+};
+
+struct klob_entry {
+	uint32_t expiry;
+	struct nrf_modem_gnss_agps_data_klobuchar data;
+};
+
+struct utc_entry {
+	uint32_t expiry;
+	struct nrf_modem_gnss_agps_data_utc data;
+};
+
+static struct ephe_entry ephe_cache[GPS_SV_COUNT];
+static struct alm_entry alm_cache[GPS_SV_COUNT];
+static struct klob_entry klob_cache;
+static struct utc_entry utc_cache;
+
+/* GPS time reference taken from injected system time. */
+static uint32_t time_ref_gps_sec;
+static int64_t time_ref_uptime;
+
+static bool cache_ready;
+static bool ephe_dirty;
+static bool alm_dirty;
+static bool klob_dirty;
+static bool utc_dirty;
+static struct assistance_cache_stats stats;
+static struct k_work_delayable save_work;
+static K_MUTEX_DEFINE(cache_lock);
+
+/* Declared by the linker for --wrap=nrf_modem_gnss_agps_write. */
+int32_t __real_nrf_modem_gnss_agps_write(void *buf, int32_t buf_len, uint16_t type);
+
+#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_CACHE)
+static int set(const char *key, size_t len_rd, settings_read_cb read_cb, void *cb_arg)
+{
+	const char *next;
+	void *dst;
+	size_t size;
+
+	if (settings_name_steq(key, "ephe", &next) && !next) {
+		dst = ephe_cache;
+		size = sizeof(ephe_cache);
+	} else if (settings_name_steq(key, "alm", &next) && !next) {
+		dst = alm_cache;
+		size = sizeof(alm_cache);
+	} else if (settings_name_steq(key, "klob", &next) && !next) {
+		dst = &klob_cache;
+		size = sizeof(klob_cache);
+	} else if (settings_name_steq(key, "utc", &next) && !next) {
+		dst = &utc_cache;
+		size = sizeof(utc_cache);
+	} else {
+		return -ENOENT;
+	}
+
+	/* Layout changed between firmware versions, start over. */
+	if (len_rd != size) {
+		return 0;
+	}
+
+	if (read_cb(cb_arg, dst, size) < 0) {
+		LOG_ERR("Failed to read assistance cache from settings");
+		memset(dst, 0, size);
+	}
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(assistance_cache, "agps_cache", NULL, set, NULL, NULL);
+#endif /* CONFIG_GNSS_SAMPLE_ASSISTANCE_CACHE */
+
+static bool gps_time_get(uint32_t *gps_sec)
+{
+	if (time_ref_gps_sec != 0) {
+		*gps_sec = time_ref_gps_sec + (k_uptime_get() - time_ref_uptime) / MSEC_PER_SEC;
+		return true;
+	}
+
+#if defined(CONFIG_DATE_TIME)
+	int64_t unix_ms;
+
+	if (date_time_now(&unix_ms) == 0) {
+		*gps_sec = (unix_ms / MSEC_PER_SEC) - GPS_TO_UNIX_UTC_OFFSET_SECONDS +
+			   GPS_TO_UTC_LEAP_SECONDS;
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+static uint32_t ephe_expiry(const struct nrf_modem_gnss_agps_data_ephemeris *ephe,
+			    uint32_t now)
+{
+	uint32_t toe = now - (now % SEC_PER_WEEK) + ephe->toe * EPHE_TOE_SCALE;
+
+	/* toe is time of week, pick the week closest to the current time. */
+	if (toe > now + SEC_PER_WEEK / 2) {
+		toe -= SEC_PER_WEEK;
+	} else if (toe + SEC_PER_WEEK / 2 < now) {
+		toe += SEC_PER_WEEK;
+	}
+
+	return toe + EPHE_VALID_AFTER_TOE_SEC;
+}
+
+/* Ephemerides are fresh for the scheduler only once GNSS has accepted them, however they
+ * were obtained. A failed or cancelled download leaves the SVs stale.
+ */
+static void ephe_injected(const void *buf, int32_t buf_len, uint16_t type)
+{
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER)
+	const struct nrf_modem_gnss_agps_data_ephemeris *ephe = buf;
+
+	if (type == NRF_MODEM_GNSS_AGPS_EPHEMERIDES && buf_len == sizeof(*ephe) &&
+	    ephe->sv_id >= 1 && ephe->sv_id <= GPS_SV_COUNT) {
+		gnss_scheduler_assistance_done(BIT(ephe->sv_id - 1));
+	}
+#endif
+}
+
+static void capture(const void *buf, int32_t buf_len, uint16_t type)
+{
+	uint32_t now;
+
+	if (type == NRF_MODEM_GNSS_AGPS_GPS_SYSTEM_CLOCK_AND_TOWS &&
+	    buf_len >= sizeof(struct nrf_modem_gnss_agps_data_system_time_and_sv_tow)) {
+		const struct nrf_modem_gnss_agps_data_system_time_and_sv_tow *time = buf;
+
+		time_ref_gps_sec = time->date_day * SEC_PER_DAY + time->time_full_s;
+		time_ref_uptime = k_uptime_get();
+		return;
+	}
+
+	/* Validity windows can't be known without the current time. */
+	if (!IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_CACHE) || !gps_time_get(&now)) {
+		return;
+	}
+
+	if (type == NRF_MODEM_GNSS_AGPS_EPHEMERIDES && buf_len == sizeof(ephe_cache[0].data)) {
+		const struct nrf_modem_gnss_agps_data_ephemeris *ephe = buf;
+
+		if (ephe->sv_id >= 1 && ephe->sv_id <= GPS_SV_COUNT) {
+			ephe_cache[ephe->sv_id - 1].expiry = ephe_expiry(ephe, now);
+			ephe_cache[ephe->sv_id - 1].data = *ephe;
+			ephe_dirty = true;
+		}
+	} else if (type == NRF_MODEM_GNSS_AGPS_ALMANAC && buf_len == sizeof(alm_cache[0].data)) {
+		const struct nrf_modem_gnss_agps_data_almanac *alm = buf;
+
+		if (alm->sv_id >= 1 && alm->sv_id <= GPS_SV_COUNT) {
+			alm_cache[alm->sv_id - 1].expiry = now + ALM_VALID_SEC;
+			alm_cache[alm->sv_id - 1].data = *alm;
+			alm_dirty = true;
+		}
+	} else if (type == NRF_MODEM_GNSS_AGPS_KLOBUCHAR_IONOSPHERIC_CORRECTION &&
+		   buf_len == sizeof(klob_cache.data)) {
+		klob_cache.expiry = now + KLOB_VALID_SEC;
+		memcpy(&klob_cache.data, buf, sizeof(klob_cache.data));
+		klob_dirty = true;
+	} else if (type == NRF_MODEM_GNSS_AGPS_UTC_PARAMETERS && buf_len == sizeof(utc_cache.data)) {
+		utc_cache.expiry = now + UTC_VALID_SEC;
+		memcpy(&utc_cache.data, buf, sizeof(utc_cache.data));
+		utc_dirty = true;
+	} else {
+		return;
+	}
+
+	if (cache_ready) {
+		k_work_reschedule(&save_work, SAVE_DELAY);
+	}
+}
+
+int32_t __wrap_nrf_modem_gnss_agps_write(void *buf, int32_t buf_len, uint16_t type)
+{
+	int32_t err;
+
+	err = __real_nrf_modem_gnss_agps_write(buf, buf_len, type);
+	if (err) {
+		return err;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	stats.network_bytes += buf_len;
+	capture(buf, buf_len, type);
+	k_mutex_unlock(&cache_lock);
+
+	ephe_injected(buf, buf_len, type);
+
+	return 0;
+}
+
+static void save_one(const char *key, bool *dirty, const void *value, size_t len)
+{
+	int err;
+
+	if (!*dirty) {
+		return;
+	}
+
+	err = settings_save_one(key, value, len);
+	if (err) {
+		LOG_ERR("Failed to save %s, error %d", key, err);
+		return;
+	}
+
+	*dirty = false;
+	stats.saves++;
+}
+
+static void save_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	if (!IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_CACHE)) {
+		return;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	save_one("agps_cache/ephe", &ephe_dirty, ephe_cache, sizeof(ephe_cache));
+	save_one("agps_cache/alm", &alm_dirty, alm_cache, sizeof(alm_cache));
+	save_one("agps_cache/klob", &klob_dirty, &klob_cache, sizeof(klob_cache));
+	save_one("agps_cache/utc", &utc_dirty, &utc_cache, sizeof(utc_cache));
+	k_mutex_unlock(&cache_lock);
+
+	LOG_DBG("Assistance cache saved");
+}
+
+static bool entry_valid(uint32_t expiry, bool time_known, uint32_t now)
+{
+	if (expiry == 0) {
+		return false;
+	}
+
+	return !time_known || now < expiry;
+}
+
+static bool entry_inject(void *data, int32_t len, uint16_t type)
+{
+	int err;
+
+	/* Bypasses the wrapper, cached data is not captured again. */
+	err = __real_nrf_modem_gnss_agps_write(data, len, type);
+	if (err) {
+		LOG_WRN("Failed to inject cached assistance, type %d, error %d", type, err);
+		return false;
+	}
+
+	stats.cache_bytes += len;
+	stats.cache_hits++;
+	ephe_injected(data, len, type);
+
+	return true;
+}
+
+/* Injects the requested, still valid entries and clears them from the request.
+ * Without the current time, ephemerides are skipped and the rest is trusted.
+ */
+static int cache_serve(struct nrf_modem_gnss_agps_data_frame *request)
+{
+	uint32_t now = 0;
+	bool time_known = gps_time_get(&now);
+	int count = 0;
+
+	if (!IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_CACHE)) {
+		return 0;
+	}
+
+	for (int i = 0; i < GPS_SV_COUNT; i++) {
+		uint32_t sv_bit = BIT(i);
+
+		if ((request->sv_mask_ephe & sv_bit) && time_known &&
+		    entry_valid(ephe_cache[i].expiry, time_known, now) &&
+		    entry_inject(&ephe_cache[i].data, sizeof(ephe_cache[i].data),
+				 NRF_MODEM_GNSS_AGPS_EPHEMERIDES)) {
+			request->sv_mask_ephe &= ~sv_bit;
+			count++;
+		}
+
+		if ((request->sv_mask_alm & sv_bit) &&
+		    entry_valid(alm_cache[i].expiry, time_known, now) &&
+		    entry_inject(&alm_cache[i].data, sizeof(alm_cache[i].data),
+				 NRF_MODEM_GNSS_AGPS_ALMANAC)) {
+			request->sv_mask_alm &= ~sv_bit;
+			count++;
+		}
+	}
+
+	if ((request->data_flags & NRF_MODEM_GNSS_AGPS_KLOBUCHAR_REQUEST) &&
+	    entry_valid(klob_cache.expiry, time_known, now) &&
+	    entry_inject(&klob_cache.data, sizeof(klob_cache.data),
+			 NRF_MODEM_GNSS_AGPS_KLOBUCHAR_IONOSPHERIC_CORRECTION)) {
+		request->data_flags &= ~NRF_MODEM_GNSS_AGPS_KLOBUCHAR_REQUEST;
+		count++;
+	}
+
+	if ((request->data_flags & NRF_MODEM_GNSS_AGPS_GPS_UTC_REQUEST) &&
+	    entry_valid(utc_cache.expiry, time_known, now) &&
+	    entry_inject(&utc_cache.data, sizeof(utc_cache.data),
+			 NRF_MODEM_GNSS_AGPS_UTC_PARAMETERS)) {
+		request->data_flags &= ~NRF_MODEM_GNSS_AGPS_GPS_UTC_REQUEST;
+		count++;
+	}
+
+	return count;
+}
+
+int assistance_cache_init(void)
+{
+	int err;
+
+	k_work_init_delayable(&save_work, save_work_fn);
+
+	if (!IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_CACHE)) {
+		/* Only download statistics are collected. */
+		return 0;
+	}
+
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("Settings subsystem initialization failed, error %d", err);
+		return err;
+	}
+
+	err = settings_load_subtree("agps_cache");
+	if (err) {
+		LOG_ERR("Loading assistance cache failed, error %d", err);
+		return err;
+	}
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	cache_ready = true;
+	k_mutex_unlock(&cache_lock);
+
+	return 0;
+}
+
+int assistance_cache_inject(void)
+{
+	struct nrf_modem_gnss_agps_data_frame all = {
+		.sv_mask_ephe = UINT32_MAX,
+		.sv_mask_alm = UINT32_MAX,
+		.data_flags = NRF_MODEM_GNSS_AGPS_KLOBUCHAR_REQUEST |
+			      NRF_MODEM_GNSS_AGPS_GPS_UTC_REQUEST
+	};
+	int count;
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	count = cache_serve(&all);
+	k_mutex_unlock(&cache_lock);
+
+	if (count > 0) {
+		LOG_INF("Injected %d cached assistance items, ephe 0x%08x, alm 0x%08x",
+			count, ~all.sv_mask_ephe, ~all.sv_mask_alm);
+	}
+
+	return count;
+}
+
+void assistance_cache_trim(struct nrf_modem_gnss_agps_data_frame *agps_request)
+{
+	int count;
+
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	count = cache_serve(agps_request);
+	k_mutex_unlock(&cache_lock);
+
+	if (count > 0) {
+		LOG_INF("Served %d assistance items from cache, still needed: "
+			"ephe 0x%08x, alm 0x%08x, flags 0x%02x",
+			count,
+			agps_request->sv_mask_ephe,
+			agps_request->sv_mask_alm,
+			agps_request->data_flags);
+	}
+}
+
+void assistance_cache_stats_get(struct assistance_cache_stats *out)
+{
+	k_mutex_lock(&cache_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef ASSISTANCE_CACHE_H_
+#define ASSISTANCE_CACHE_H_
+
+#include <stdint.h>
+#include <nrf_modem_gnss.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct assistance_cache_stats {
+	uint32_t cache_bytes;   /* Injected to GNSS from the cache */
+	uint32_t network_bytes; /* Injected to GNSS from downloaded assistance */
+	uint32_t cache_hits;    /* Requested items served from the cache */
+	uint32_t saves;         /* Cache writes to flash */
+};
+
+/**
+ * @brief Loads the assistance cache from flash.
+ *
+ * @details Assistance data written to GNSS by any assistance backend is captured and,
+ *          with CONFIG_GNSS_SAMPLE_ASSISTANCE_CACHE, stored with its validity window.
+ *          Statistics are collected also without the cache.
+ *
+ * @retval 0 on success.
+ * @retval <0 in case of an error.
+ */
+int assistance_cache_init(void);
+
+/**
+ * @brief Injects all still valid cached assistance data to GNSS.
+ *
+ * @details Ephemerides are injected only when the current GPS time is known, almanacs,
+ *          ionospheric corrections and UTC parameters are injected also without it.
+ *
+ * @retval Number of injected items.
+ */
+int assistance_cache_inject(void);
+
+/**
+ * @brief Serves an assistance request from the cache.
+ *
+ * @details Injects valid cached data matching the request and clears the served items
+ *          from the request, so that only stale data needs to be downloaded.
+ *
+ * @param[in,out] agps_request A-GPS data requested by GNSS.
+ */
+void assistance_cache_trim(struct nrf_modem_gnss_agps_data_frame *agps_request);
+
+/**
+ * @brief Reads the assistance cache statistics.
+ *
+ * @param[out] stats Statistics since boot.
+ */
+void assistance_cache_stats_get(struct assistance_cache_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ASSISTANCE_CACHE_H_ */
@@ -15,7 +15,7 @@
 
 #include "assistance.h"
 #include "factory_almanac.h"
-#include "mcc_location_table.h"
+#include "coarse_position.h"
 
 LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
 
@@ -29,7 +29,6 @@ LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
 #define HOURS_PER_DAY			(24UL)
 #define SEC_PER_DAY			(HOURS_PER_DAY * SEC_PER_HOUR)
 #define DAYS_PER_WEEK			(7UL)
-#define PLMN_STR_MAX_LEN		8 /* MCC + MNC + quotes */
 
 static char almanac_checksum[64];
 
@@ -149,73 +148,6 @@ static void time_inject(void)
 		gps_time.date_day, gps_time.time_full_s);
 }
 
-static void location_inject(void)
-{
-	int err;
-	char plmn_str[PLMN_STR_MAX_LEN + 1];
-	uint16_t mcc;
-	const struct mcc_table *mcc_info;
-	struct nrf_modem_gnss_agps_data_location location = { 0 };
-
-	/* Read PLMN string from modem to get the MCC. */
-	err = nrf_modem_at_scanf(
-		"AT%XMONITOR",
-		"%%XMONITOR: "
-		"%*d"                                  /* <reg_status>: ignored */
-		",%*[^,]"                              /* <full_name>: ignored */
-		",%*[^,]"                              /* <short_name>: ignored */
-		",%"STRINGIFY(PLMN_STR_MAX_LEN)"[^,]", /* <plmn> */
-		plmn_str);
-	if (err != 1) {
-		LOG_WRN("Couldn't read PLMN from modem, location assistance unavailable");
-		return;
-	}
-
-	/* NULL terminate MCC and read it. */
-	plmn_str[4] = '\0';
-	mcc = strtol(plmn_str + 1, NULL, 10);
-
-	mcc_info = mcc_lookup(mcc);
-	if (mcc_info == NULL) {
-		LOG_WRN("No location found for MCC %u", mcc);
-		return;
-	}
-
-	location.latitude = lat_convert(mcc_info->lat);
-	location.longitude = lon_convert(mcc_info->lon);
-	location.unc_semimajor = mcc_info->unc_semimajor;
-	location.unc_semiminor = mcc_info->unc_semiminor;
-	location.orientation_major = mcc_info->orientation;
-	location.confidence = mcc_info->confidence;
-
-#if defined(CONFIG_GNSS_SAMPLE_LOW_ACCURACY)
-	if (CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT != -32767) {
-		/* Use reference altitude to enable 3-sat first fix. */
-		LOG_INF("Using reference altitude %d meters",
-			CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT);
-		location.altitude = CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT;
-		/* The altitude uncertainty has to be less than 100 meters (coded number K has to
-		 * be less than 48) for the altitude to be used for a 3-sat fix. GNSS increases
-		 * the uncertainty depending on the age of the altitude and whether the device is
-		 * stationary or moving. The uncertainty is set to 0 (meaning 0 meters), so that
-		 * it remains usable for a 3-sat fix for as long as possible.
-		 */
-		location.unc_altitude = 0;
-	} else
-#endif
-	{
-		location.unc_altitude = 255; /* altitude not used */
-	}
-
-	err = nrf_modem_gnss_agps_write(&location, sizeof(location), NRF_MODEM_GNSS_AGPS_LOCATION);
-	if (err) {
-		LOG_ERR("Failed to inject location for MCC %u, error %d", mcc, err);
-		return;
-	}
-
-	LOG_INF("Injected location for MCC %u", mcc);
-}
-
 int assistance_init(struct k_work_q *assistance_work_q)
 {
 	ARG_UNUSED(assistance_work_q);
@@ -252,12 +184,17 @@ int assistance_request(struct nrf_modem_gnss_agps_data_frame *agps_request)
 	}
 
 	if (agps_request->data_flags & NRF_MODEM_GNSS_AGPS_POSITION_REQUEST) {
-		location_inject();
+		(void)coarse_position_inject();
 	}
 
 	return 0;
 }
 
+void assistance_cancel(void)
+{
+	/* Nothing to cancel, nothing is downloaded. */
+}
+
 bool assistance_is_active(void)
 {
 	/* Always return false because assistance_request() doesn't take much time. */
@@ -5,6 +5,8 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/net/socket.h>
@@ -20,17 +22,74 @@ LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
 
 BUILD_ASSERT(sizeof(CONFIG_GNSS_SAMPLE_SUPL_HOSTNAME) > 1, "Server hostname must be configured");
 
+/* The SUPL library expects a 1 second timeout for the read function. */
+#define SUPL_READ_TIMEOUT_MS	1000
+#define SUPL_SESSION_TIMEOUT_MS	(CONFIG_GNSS_SAMPLE_SUPL_SESSION_TIMEOUT * MSEC_PER_SEC)
+
+#define SUPL_WORKQ_THREAD_STACK_SIZE 2304
+#define SUPL_WORKQ_THREAD_PRIORITY   5
+
+K_THREAD_STACK_DEFINE(supl_workq_stack_area, SUPL_WORKQ_THREAD_STACK_SIZE);
+
+/* Sessions run on their own queue, a slow server does not stall the GNSS work queue. */
+static struct k_work_q supl_work_q;
+static struct k_work supl_session_work;
+static struct nrf_modem_gnss_agps_data_frame supl_request;
+
 static int supl_fd = -1;
 static volatile bool assistance_active;
+static volatile bool cancel_requested;
+static int64_t session_deadline;
+static uint8_t injected_types;
+
+/* Returns the time left for the session in milliseconds, 0 if it should end. */
+static int session_time_left(void)
+{
+	int64_t left = session_deadline - k_uptime_get();
+
+	if (cancel_requested || left <= 0) {
+		return 0;
+	}
+
+	return (int)left;
+}
+
+static int supl_poll(short events, int timeout_ms)
+{
+	struct pollfd fds = {
+		.fd = supl_fd,
+		.events = events
+	};
+	int rc = poll(&fds, 1, timeout_ms);
+
+	if (rc > 0 && !(fds.revents & events)) {
+		/* POLLERR, POLLHUP or POLLNVAL only. */
+		return -1;
+	}
+
+	return rc;
+}
 
 static ssize_t supl_read(void *p_buff, size_t nbytes, void *user_data)
 {
 	ARG_UNUSED(user_data);
 
-	ssize_t rc = recv(supl_fd, p_buff, nbytes, 0);
+	int left = session_time_left();
+	ssize_t rc;
 
-	if (rc < 0 && (errno == EAGAIN)) {
+	if (left == 0) {
+		/* Deadline passed or cancelled, end the session. */
+		return -1;
+	}
+
+	rc = supl_poll(POLLIN, MIN(left, SUPL_READ_TIMEOUT_MS));
+	if (rc <= 0) {
 		/* Return 0 to indicate a timeout. */
+		return rc;
+	}
+
+	rc = recv(supl_fd, p_buff, nbytes, MSG_DONTWAIT);
+	if (rc < 0 && (errno == EAGAIN)) {
 		rc = 0;
 	} else if (rc == 0) {
 		/* Peer closed the socket, return an error. */
@@ -44,13 +103,22 @@ static ssize_t supl_write(const void *p_buff, size_t nbytes, void *user_data)
 {
 	ARG_UNUSED(user_data);
 
-	return send(supl_fd, p_buff, nbytes, 0);
+	int left = session_time_left();
+
+	if (left == 0 || supl_poll(POLLOUT, left) <= 0) {
+		return -1;
+	}
+
+	return send(supl_fd, p_buff, nbytes, MSG_DONTWAIT);
 }
 
 static int inject_agps_type(void *agps, size_t agps_size, uint16_t type, void *user_data)
 {
 	ARG_UNUSED(user_data);
 
+	/* Each type is injected as soon as it is decoded, GNSS can use it before the
+	 * session ends.
+	 */
 	int retval = nrf_modem_gnss_agps_write(agps, agps_size, type);
 
 	if (retval != 0) {
@@ -58,6 +126,8 @@ static int inject_agps_type(void *agps, size_t agps_size, uint16_t type, void *u
 		return -1;
 	}
 
+	injected_types++;
+
 	LOG_INF("Injected A-GPS data, type: %d, size: %d", type, agps_size);
 
 	return 0;
@@ -100,6 +170,9 @@ static int open_supl_socket(void)
 
 	snprintf(port, sizeof(port), "%d", SUPL_SERVER_PORT);
 
+	/* The lookup is made by the modem and can't be bounded from here, the session
+	 * time limit starts once the server address is known.
+	 */
 	err = getaddrinfo(SUPL_SERVER, port, &hints, &info);
 	if (err) {
 		LOG_ERR("Failed to resolve hostname %s, error: %d", SUPL_SERVER, err);
@@ -107,6 +180,14 @@ static int open_supl_socket(void)
 		return -1;
 	}
 
+	session_deadline = k_uptime_get() + SUPL_SESSION_TIMEOUT_MS;
+
+	if (cancel_requested) {
+		freeaddrinfo(info);
+
+		return -1;
+	}
+
 	/* Not connected. */
 	err = -1;
 
@@ -120,15 +201,10 @@ static int open_supl_socket(void)
 			goto cleanup;
 		}
 
-		/* The SUPL library expects a 1 second timeout for the read function. */
-		struct timeval timeout = {
-			.tv_sec = 1,
-			.tv_usec = 0,
-		};
-
-		err = setsockopt(supl_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		/* All I/O is bounded by the session deadline through poll(). */
+		err = fcntl(supl_fd, F_SETFL, O_NONBLOCK);
 		if (err) {
-			LOG_ERR("Failed to set socket timeout, errno %d", errno);
+			LOG_ERR("Failed to set socket non-blocking, errno %d", errno);
 			goto cleanup;
 		}
 
@@ -139,6 +215,19 @@ static int open_supl_socket(void)
 		LOG_INF("Connecting to %s port %d", ip, SUPL_SERVER_PORT);
 
 		err = connect(supl_fd, sa, addr->ai_addrlen);
+		if (err && errno == EINPROGRESS) {
+			int sock_err = 0;
+			socklen_t len = sizeof(sock_err);
+
+			if (supl_poll(POLLOUT, session_time_left()) > 0 &&
+			    getsockopt(supl_fd, SOL_SOCKET, SO_ERROR, &sock_err, &len) == 0 &&
+			    sock_err == 0) {
+				err = 0;
+			} else {
+				errno = sock_err ? sock_err : ETIMEDOUT;
+			}
+		}
+
 		if (err) {
 			close(supl_fd);
 			supl_fd = -1;
@@ -172,12 +261,61 @@ static void close_supl_socket(void)
 	if (close(supl_fd) < 0) {
 		LOG_ERR("Failed to close SUPL socket");
 	}
+
+	supl_fd = -1;
+}
+
+static void supl_session_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	int err;
+	int64_t start = k_uptime_get();
+
+	/* Set again when the server address is resolved. */
+	session_deadline = start + SUPL_SESSION_TIMEOUT_MS;
+	injected_types = 0;
+
+	err = open_supl_socket();
+	if (err) {
+		goto exit;
+	}
+
+	LOG_INF("Starting SUPL session");
+	err = supl_session(&supl_request);
+	close_supl_socket();
+
+exit:
+	if (cancel_requested) {
+		LOG_INF("SUPL session cancelled");
+	} else if (k_uptime_get() >= session_deadline) {
+		LOG_WRN("SUPL session timed out");
+	}
+
+	LOG_INF("SUPL session ended in %lld ms, error %d, %u types injected",
+		k_uptime_get() - start, err, injected_types);
+
+	assistance_active = false;
 }
 
 int assistance_init(struct k_work_q *assistance_work_q)
 {
 	ARG_UNUSED(assistance_work_q);
 
+	struct k_work_queue_config cfg = {
+		.name = "supl_work_q",
+		.no_yield = false
+	};
+
+	k_work_queue_start(
+		&supl_work_q,
+		supl_workq_stack_area,
+		K_THREAD_STACK_SIZEOF(supl_workq_stack_area),
+		SUPL_WORKQ_THREAD_PRIORITY,
+		&cfg);
+
+	k_work_init(&supl_session_work, supl_session_work_fn);
+
 	static struct supl_api supl_api = {
 		.read       = supl_read,
 		.write      = supl_write,
@@ -196,24 +334,24 @@ int assistance_init(struct k_work_q *assistance_work_q)
 
 int assistance_request(struct nrf_modem_gnss_agps_data_frame *agps_request)
 {
-	int err;
+	if (assistance_active) {
+		return -EBUSY;
+	}
 
+	memcpy(&supl_request, agps_request, sizeof(supl_request));
+	cancel_requested = false;
 	assistance_active = true;
 
-	err = open_supl_socket();
-	if (err) {
-		goto exit;
-	}
+	k_work_submit_to_queue(&supl_work_q, &supl_session_work);
 
-	LOG_INF("Starting SUPL session");
-	err = supl_session(agps_request);
-	LOG_INF("Done");
-	close_supl_socket();
-
-exit:
-	assistance_active = false;
+	return 0;
+}
 
-	return err;
+void assistance_cancel(void)
+{
+	if (assistance_active) {
+		cancel_requested = true;
+	}
 }
 
 bool assistance_is_active(void)
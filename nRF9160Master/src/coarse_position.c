@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/logging/log.h>
+#include <modem/modem_info.h>
+
+#include "coarse_position.h"
+#include "mcc_location_table.h"
+#if defined(CONFIG_GNSS_SAMPLE_RADIO_COORDINATOR)
+#include "radio_coordinator.h"
+#endif
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define CELL_CACHE_SIZE		16
+#define CELL_INVALID_ID		UINT32_MAX
+/* Typical LTE-M cell radius, used as uncertainty of a cached cell position. */
+#define CELL_RADIUS_M		2000
+#define NEIGHBOR_RADIUS_M	5000
+#define CELL_CONFIDENCE		68
+/* Neighbour measurement older than this is not used. */
+#define NCELL_MAX_AGE_MS	(10 * 60 * MSEC_PER_SEC)
+/* Measurement result not received, may be requested again. */
+#define NCELL_MEAS_TIMEOUT_MS	(60 * MSEC_PER_SEC)
+/* Scaled uncertainty is r = 10 * (1.1^K - 1) meters, K at most 127. */
+#define UNC_MAX			127
+
+struct cell_entry {
+	uint32_t id;
+	uint16_t tac;
+	uint16_t mcc;
+	uint16_t mnc;
+	uint16_t pci;
+	uint32_t earfcn;
+	uint32_t seq;      /* Insert order, oldest is replaced */
+	float lat;
+	float lon;
+};
+
+static struct cell_entry cell_cache[CELL_CACHE_SIZE];
+static uint32_t cell_seq;
+static struct lte_lc_cell serving_cell = { .id = CELL_INVALID_ID };
+static struct lte_lc_ncell ncells[CONFIG_LTE_NEIGHBOR_CELLS_MAX];
+static uint8_t ncells_count;
+static int64_t ncells_timestamp;
+static bool ncellmeas_pending;
+static int64_t ncellmeas_timestamp;
+static enum coarse_position_source injected_source;
+static bool cache_ready;
+static K_MUTEX_DEFINE(coarse_lock);
+
+static int set(const char *key, size_t len_rd, settings_read_cb read_cb, void *cb_arg)
+{
+	const char *next;
+
+	if (settings_name_steq(key, "cells", &next) && !next) {
+		/* Layout changed between firmware versions, start over. */
+		if (len_rd != sizeof(cell_cache)) {
+			return 0;
+		}
+
+		if (read_cb(cb_arg, cell_cache, sizeof(cell_cache)) < 0) {
+			LOG_ERR("Failed to read cell cache from settings");
+			memset(cell_cache, 0, sizeof(cell_cache));
+		}
+
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(coarse_position, "coarse", NULL, set, NULL, NULL);
+
+static uint8_t unc_from_meters(uint32_t meters)
+{
+	uint8_t k = 0;
+	float r = 0.0f;
+	float pow = 1.0f;
+
+	while (r < meters && k < UNC_MAX) {
+		k++;
+		pow *= 1.1f;
+		r = 10.0f * (pow - 1.0f);
+	}
+
+	return k;
+}
+
+static struct cell_entry *cell_find(uint32_t id, uint16_t tac)
+{
+	for (int i = 0; i < ARRAY_SIZE(cell_cache); i++) {
+		if (cell_cache[i].seq != 0 && cell_cache[i].id == id && cell_cache[i].tac == tac) {
+			return &cell_cache[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void cache_save(void)
+{
+	int err;
+
+	if (!cache_ready) {
+		return;
+	}
+
+	err = settings_save_one("coarse/cells", cell_cache, sizeof(cell_cache));
+	if (err) {
+		LOG_ERR("Failed to save cell cache, error %d", err);
+	}
+}
+
+int coarse_position_init(void)
+{
+	int err;
+
+	err = settings_subsys_init();
+	if (err) {
+		LOG_ERR("Settings subsystem initialization failed, error %d", err);
+		return err;
+	}
+
+	err = settings_load_subtree("coarse");
+	if (err) {
+		LOG_ERR("Loading cell cache failed, error %d", err);
+		return err;
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(cell_cache); i++) {
+		cell_seq = MAX(cell_seq, cell_cache[i].seq);
+	}
+
+	cache_ready = true;
+
+	return 0;
+}
+
+int coarse_position_serving_cell_get(struct lte_lc_cell *cell)
+{
+	int err;
+
+	err = modem_info_init();
+	if (err) {
+		return err;
+	}
+
+	char resp_buf[MODEM_INFO_MAX_RESPONSE_SIZE];
+
+	err = modem_info_string_get(MODEM_INFO_CELLID,
+				    resp_buf,
+				    MODEM_INFO_MAX_RESPONSE_SIZE);
+	if (err < 0) {
+		return err;
+	}
+
+	cell->id = strtol(resp_buf, NULL, 16);
+
+	err = modem_info_string_get(MODEM_INFO_AREA_CODE,
+				    resp_buf,
+				    MODEM_INFO_MAX_RESPONSE_SIZE);
+	if (err < 0) {
+		return err;
+	}
+
+	cell->tac = strtol(resp_buf, NULL, 16);
+
+	/* Request for MODEM_INFO_MNC returns both MNC and MCC in the same string. */
+	err = modem_info_string_get(MODEM_INFO_OPERATOR,
+				    resp_buf,
+				    MODEM_INFO_MAX_RESPONSE_SIZE);
+	if (err < 0) {
+		return err;
+	}
+
+	cell->mnc = strtol(&resp_buf[3], NULL, 10);
+	/* Null-terminate MCC, read and store it. */
+	resp_buf[3] = '\0';
+	cell->mcc = strtol(resp_buf, NULL, 10);
+
+	return 0;
+}
+
+void coarse_position_cell_update(const struct lte_lc_cell *cell)
+{
+	k_mutex_lock(&coarse_lock, K_FOREVER);
+
+	if (cell->id != serving_cell.id || cell->tac != serving_cell.tac) {
+		/* Only ID and tracking area are known, the rest is read when needed. */
+		memset(&serving_cell, 0, sizeof(serving_cell));
+		serving_cell.id = cell->id;
+		serving_cell.tac = cell->tac;
+	}
+
+	k_mutex_unlock(&coarse_lock);
+}
+
+void coarse_position_cells_update(const struct lte_lc_cells_info *cells)
+{
+	struct cell_entry *entry;
+
+	k_mutex_lock(&coarse_lock, K_FOREVER);
+
+	ncellmeas_pending = false;
+
+	if (cells->current_cell.id != LTE_LC_CELL_EUTRAN_ID_INVALID) {
+		serving_cell = cells->current_cell;
+
+		/* Learn the physical identity of a cached cell, neighbour lists only
+		 * report EARFCN and PCI.
+		 */
+		entry = cell_find(serving_cell.id, serving_cell.tac);
+		if (entry) {
+			entry->earfcn = serving_cell.earfcn;
+			entry->pci = serving_cell.phys_cell_id;
+		}
+	}
+
+	ncells_count = MIN(cells->ncells_count, ARRAY_SIZE(ncells));
+	if (ncells_count > 0) {
+		memcpy(ncells, cells->neighbor_cells, ncells_count * sizeof(ncells[0]));
+	}
+	ncells_timestamp = k_uptime_get();
+
+	k_mutex_unlock(&coarse_lock);
+}
+
+void coarse_position_fix_update(double latitude, double longitude)
+{
+	struct cell_entry *entry;
+	bool added = false;
+
+	k_mutex_lock(&coarse_lock, K_FOREVER);
+
+	if (serving_cell.id == CELL_INVALID_ID) {
+		goto exit;
+	}
+
+	entry = cell_find(serving_cell.id, serving_cell.tac);
+	if (entry) {
+		/* Cached position drifts towards the centre of the fixes seen in the cell.
+		 * Kept in RAM only, flash is written when a cell is added.
+		 */
+		entry->lat = (entry->lat * 3.0f + (float)latitude) / 4.0f;
+		entry->lon = (entry->lon * 3.0f + (float)longitude) / 4.0f;
+		goto exit;
+	}
+
+	entry = &cell_cache[0];
+	for (int i = 1; i < ARRAY_SIZE(cell_cache); i++) {
+		if (cell_cache[i].seq < entry->seq) {
+			entry = &cell_cache[i];
+		}
+	}
+
+	memset(entry, 0, sizeof(*entry));
+	entry->id = serving_cell.id;
+	entry->tac = serving_cell.tac;
+	entry->mcc = serving_cell.mcc;
+	entry->mnc = serving_cell.mnc;
+	entry->earfcn = serving_cell.earfcn;
+	entry->pci = serving_cell.phys_cell_id;
+	entry->lat = (float)latitude;
+	entry->lon = (float)longitude;
+	entry->seq = ++cell_seq;
+	added = true;
+
+	LOG_INF("Cached position of cell %u, tracking area %u", entry->id, entry->tac);
+
+exit:
+	if (added) {
+		cache_save();
+	}
+
+	k_mutex_unlock(&coarse_lock);
+}
+
+static void ncellmeas_request(void)
+{
+	int err;
+
+	if ((ncellmeas_pending && (k_uptime_get() - ncellmeas_timestamp) < NCELL_MEAS_TIMEOUT_MS) ||
+	    (ncells_timestamp != 0 && (k_uptime_get() - ncells_timestamp) < NCELL_MAX_AGE_MS)) {
+		return;
+	}
+
+#if defined(CONFIG_GNSS_SAMPLE_RADIO_COORDINATOR)
+	/* Measuring takes radio time from GNSS, the cached cells are used meanwhile. */
+	if (!radio_coord_lte_allowed()) {
+		return;
+	}
+#endif
+
+	err = lte_lc_neighbor_cell_measurement(NULL);
+	if (err) {
+		LOG_WRN("Neighbour cell measurement failed, error %d", err);
+		return;
+	}
+
+	ncellmeas_pending = true;
+	ncellmeas_timestamp = k_uptime_get();
+}
+
+static bool cell_position_get(struct coarse_position *pos)
+{
+	const struct cell_entry *entry;
+	double lat = 0.0;
+	double lon = 0.0;
+	int matches = 0;
+
+	entry = cell_find(serving_cell.id, serving_cell.tac);
+	if (entry) {
+		pos->source = COARSE_POSITION_CELL;
+		pos->latitude = entry->lat;
+		pos->longitude = entry->lon;
+		pos->accuracy = CELL_RADIUS_M;
+		return true;
+	}
+
+	if (ncells_timestamp == 0 || (k_uptime_get() - ncells_timestamp) >= NCELL_MAX_AGE_MS) {
+		return false;
+	}
+
+	for (int n = 0; n < ncells_count; n++) {
+		for (int i = 0; i < ARRAY_SIZE(cell_cache); i++) {
+			entry = &cell_cache[i];
+
+			if (entry->seq != 0 && entry->earfcn == ncells[n].earfcn &&
+			    entry->pci == ncells[n].phys_cell_id) {
+				lat += entry->lat;
+				lon += entry->lon;
+				matches++;
+				break;
+			}
+		}
+	}
+
+	if (matches == 0) {
+		return false;
+	}
+
+	pos->source = COARSE_POSITION_NEIGHBOR;
+	pos->latitude = lat / matches;
+	pos->longitude = lon / matches;
+	pos->accuracy = NEIGHBOR_RADIUS_M;
+
+	return true;
+}
+
+int coarse_position_get(struct coarse_position *pos)
+{
+	struct mcc_location mcc_info;
+	struct lte_lc_cell cell = { 0 };
+	float radius = 10.0f;
+	bool found;
+
+	memset(pos, 0, sizeof(*pos));
+
+	/* MCC is needed for the fallback and is not part of cell update events. */
+	if (serving_cell.mcc == 0 && coarse_position_serving_cell_get(&cell) == 0) {
+		k_mutex_lock(&coarse_lock, K_FOREVER);
+		serving_cell.id = cell.id;
+		serving_cell.tac = cell.tac;
+		serving_cell.mcc = cell.mcc;
+		serving_cell.mnc = cell.mnc;
+		k_mutex_unlock(&coarse_lock);
+	}
+
+	k_mutex_lock(&coarse_lock, K_FOREVER);
+
+	ncellmeas_request();
+	found = cell_position_get(pos);
+	cell.mcc = serving_cell.mcc;
+
+	k_mutex_unlock(&coarse_lock);
+
+	if (found) {
+		pos->confidence = CELL_CONFIDENCE;
+		pos->unc_semimajor = unc_from_meters(pos->accuracy);
+		pos->unc_semiminor = pos->unc_semimajor;
+		return 0;
+	}
+
+	if (cell.mcc == 0 || mcc_lookup(cell.mcc, &mcc_info) != 0) {
+		return -ENODATA;
+	}
+
+	pos->source = COARSE_POSITION_MCC;
+	pos->latitude = lat_degrees(mcc_info.lat);
+	pos->longitude = lon_degrees(mcc_info.lon);
+	pos->unc_semimajor = mcc_info.unc_semimajor;
+	pos->unc_semiminor = mcc_info.unc_semiminor;
+	pos->orientation = mcc_info.orientation;
+	pos->confidence = mcc_info.confidence;
+	/* Inverse of the scaled uncertainty. */
+	for (int k = 0; k < mcc_info.unc_semimajor; k++) {
+		radius *= 1.1f;
+	}
+	pos->accuracy = (uint32_t)(radius - 10.0f);
+
+	return 0;
+}
+
+int coarse_position_inject(void)
+{
+	int err;
+	struct coarse_position pos;
+	struct nrf_modem_gnss_agps_data_location location = { 0 };
+
+	err = coarse_position_get(&pos);
+	if (err) {
+		LOG_WRN("No coarse position, location assistance unavailable");
+		return err;
+	}
+
+	location.latitude = lat_convert(pos.latitude);
+	location.longitude = lon_convert(pos.longitude);
+	location.unc_semimajor = pos.unc_semimajor;
+	location.unc_semiminor = pos.unc_semiminor;
+	location.orientation_major = pos.orientation;
+	location.confidence = pos.confidence;
+
+#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT)
+	if (CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT != -32767) {
+		/* Use reference altitude to enable 3-sat first fix. */
+		LOG_INF("Using reference altitude %d meters",
+			CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT);
+		location.altitude = CONFIG_GNSS_SAMPLE_ASSISTANCE_REFERENCE_ALT;
+		/* The altitude uncertainty has to be less than 100 meters (coded number K has to
+		 * be less than 48) for the altitude to be used for a 3-sat fix. GNSS increases
+		 * the uncertainty depending on the age of the altitude and whether the device is
+		 * stationary or moving. The uncertainty is set to 0 (meaning 0 meters), so that
+		 * it remains usable for a 3-sat fix for as long as possible.
+		 */
+		location.unc_altitude = 0;
+	} else
+#endif
+	{
+		location.unc_altitude = 255; /* altitude not used */
+	}
+
+	err = nrf_modem_gnss_agps_write(&location, sizeof(location), NRF_MODEM_GNSS_AGPS_LOCATION);
+	if (err) {
+		LOG_ERR("Failed to inject %s location, error %d",
+			coarse_position_source_str(pos.source), err);
+		return err;
+	}
+
+	injected_source = pos.source;
+	LOG_INF("Injected %s location, accuracy %u m",
+		coarse_position_source_str(pos.source), pos.accuracy);
+
+	return 0;
+}
+
+enum coarse_position_source coarse_position_injected_source(void)
+{
+	return injected_source;
+}
+
+const char *coarse_position_source_str(enum coarse_position_source source)
+{
+	switch (source) {
+	case COARSE_POSITION_MCC:
+		return "MCC";
+	case COARSE_POSITION_NEIGHBOR:
+		return "neighbour cell";
+	case COARSE_POSITION_CELL:
+		return "serving cell";
+	default:
+		return "no";
+	}
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef COARSE_POSITION_H_
+#define COARSE_POSITION_H_
+
+#include <stdint.h>
+#include <modem/lte_lc.h>
+#include <nrf_modem_gnss.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Source of a coarse position, best last. */
+enum coarse_position_source {
+	COARSE_POSITION_NONE,
+	COARSE_POSITION_MCC,      /* Country of the network */
+	COARSE_POSITION_NEIGHBOR, /* Neighbour cell seen with an earlier fix */
+	COARSE_POSITION_CELL,     /* Serving cell seen with an earlier fix */
+};
+
+struct coarse_position {
+	enum coarse_position_source source;
+	double latitude;
+	double longitude;
+	uint32_t accuracy;        /* meters */
+	uint8_t confidence;       /* percentage, 0-100 */
+	uint8_t unc_semimajor;    /* scaled, see GNSS interface for details */
+	uint8_t unc_semiminor;
+	uint8_t orientation;
+};
+
+/**
+ * @brief Initializes the coarse position engine and loads the cell cache.
+ *
+ * @retval 0 on success.
+ * @retval <0 in case of an error.
+ */
+int coarse_position_init(void);
+
+/**
+ * @brief Reads serving cell information from the modem.
+ *
+ * @param[out] serving_cell Cell ID, tracking area, MCC and MNC of the serving cell.
+ *
+ * @retval 0 on success.
+ * @retval <0 in case of an error.
+ */
+int coarse_position_serving_cell_get(struct lte_lc_cell *serving_cell);
+
+/**
+ * @brief Updates the serving cell, call on LTE_LC_EVT_CELL_UPDATE.
+ *
+ * @param[in] cell Serving cell.
+ */
+void coarse_position_cell_update(const struct lte_lc_cell *cell);
+
+/**
+ * @brief Updates serving and neighbour cells, call on LTE_LC_EVT_NEIGHBOR_CELL_MEAS.
+ *
+ * @param[in] cells Result of the neighbour cell measurement.
+ */
+void coarse_position_cells_update(const struct lte_lc_cells_info *cells);
+
+/**
+ * @brief Associates a GNSS fix with the serving cell.
+ *
+ * @param[in] latitude Latitude in degrees.
+ * @param[in] longitude Longitude in degrees.
+ */
+void coarse_position_fix_update(double latitude, double longitude);
+
+/**
+ * @brief Gets the best coarse position available, serving cell first, then neighbour
+ *        cells, then the MCC of the network.
+ *
+ * @param[out] pos Coarse position.
+ *
+ * @retval 0 on success.
+ * @retval -ENODATA if no position is available.
+ */
+int coarse_position_get(struct coarse_position *pos);
+
+/**
+ * @brief Injects the best coarse position into GNSS as a location prior.
+ *
+ * @retval 0 on success.
+ * @retval <0 in case of an error.
+ */
+int coarse_position_inject(void);
+
+/**
+ * @brief Returns the source of the last position injected into GNSS.
+ */
+enum coarse_position_source coarse_position_injected_source(void);
+
+/**
+ * @brief Returns a printable name of a coarse position source.
+ */
+const char *coarse_position_source_str(enum coarse_position_source source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COARSE_POSITION_H_ */
@@ -0,0 +1,491 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <nrf_modem_gnss.h>
+
+#include "gnss_replay.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* With the modem library linked in, the calls are wrapped by the linker and the GNSS
+ * receiver stays unused. Without it, for example on native_sim, the calls are provided
+ * here directly.
+ */
+#if defined(CONFIG_NRF_MODEM_LIB)
+#define REPLAY_API(fn) __wrap_##fn
+#else
+#define REPLAY_API(fn) fn
+#endif
+
+#define TRACE_MAGIC		0x43525447 /* "GTRC" */
+#define TRACE_VERSION		1
+#define REPLAY_SPEED		CONFIG_GNSS_SAMPLE_REPLAY_SPEED
+#define REPLAY_STACK_SIZE	2048
+#define REPLAY_PRIORITY		3
+
+BUILD_ASSERT(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+	     "Trace floating point fields are read as little-endian");
+
+struct trace_header {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t reserved[3];
+} __packed;
+
+struct trace_record {
+	uint32_t time_ms;       /* From the start of the trace */
+	uint8_t type;           /* enum gnss_replay_record */
+	uint8_t reserved;
+	uint16_t len;           /* Payload length */
+} __packed;
+
+struct trace_pvt {
+	double latitude;
+	double longitude;
+	float altitude;
+	float accuracy;
+	float speed;
+	float heading;
+	float pdop;
+	float hdop;
+	float vdop;
+	uint16_t year;
+	uint8_t month;
+	uint8_t day;
+	uint8_t hour;
+	uint8_t minute;
+	uint8_t seconds;
+	uint16_t ms;
+	uint8_t flags;          /* NRF_MODEM_GNSS_PVT_FLAG_* */
+	uint8_t sv_count;       /* Followed by struct trace_sv entries */
+} __packed;
+
+struct trace_sv {
+	uint16_t sv;
+	uint16_t cn0;           /* 0.1 dB-Hz */
+	int16_t elevation;
+	int16_t azimuth;
+	uint8_t flags;          /* NRF_MODEM_GNSS_SV_FLAG_* */
+	uint8_t signal;
+} __packed;
+
+struct trace_agps_req {
+	uint32_t sv_mask_ephe;
+	uint32_t sv_mask_alm;
+	uint32_t data_flags;
+} __packed;
+
+static const uint8_t trace[] = {
+#include "gnss_replay_trace.inc"
+};
+
+static nrf_modem_gnss_event_handler_type_t event_handler;
+static uint16_t fix_interval = 1;
+static uint16_t fix_retry = 60;
+static uint16_t nmea_mask;
+static bool started;
+static bool sleeping;
+static bool single_fix_done;
+static uint32_t wake_time;      /* Trace time when a periodic search starts */
+static uint32_t search_start;   /* Trace time when the current search started */
+static uint32_t search_end_time; /* Trace time of the epoch that ended the search */
+static uint32_t trace_now;      /* Trace time of the latest record */
+
+static struct nrf_modem_gnss_pvt_data_frame pvt_frame;
+static struct nrf_modem_gnss_nmea_data_frame nmea_frame;
+static struct nrf_modem_gnss_agps_data_frame agps_frame;
+
+static struct gnss_replay_stats stats;
+static K_MUTEX_DEFINE(replay_lock);
+static K_SEM_DEFINE(replay_start_sem, 0, 1);
+
+static void pvt_convert(const uint8_t *payload, uint16_t len)
+{
+	struct trace_pvt pvt;
+	struct trace_sv sv;
+	uint8_t count;
+
+	memset(&pvt_frame, 0, sizeof(pvt_frame));
+
+	if (len < sizeof(pvt)) {
+		return;
+	}
+
+	memcpy(&pvt, payload, sizeof(pvt));
+
+	pvt_frame.latitude = pvt.latitude;
+	pvt_frame.longitude = pvt.longitude;
+	pvt_frame.altitude = pvt.altitude;
+	pvt_frame.accuracy = pvt.accuracy;
+	pvt_frame.speed = pvt.speed;
+	pvt_frame.heading = pvt.heading;
+	pvt_frame.pdop = pvt.pdop;
+	pvt_frame.hdop = pvt.hdop;
+	pvt_frame.vdop = pvt.vdop;
+	pvt_frame.datetime.year = pvt.year;
+	pvt_frame.datetime.month = pvt.month;
+	pvt_frame.datetime.day = pvt.day;
+	pvt_frame.datetime.hour = pvt.hour;
+	pvt_frame.datetime.minute = pvt.minute;
+	pvt_frame.datetime.seconds = pvt.seconds;
+	pvt_frame.datetime.ms = pvt.ms;
+	pvt_frame.flags = pvt.flags;
+
+	count = MIN(pvt.sv_count, NRF_MODEM_GNSS_MAX_SATELLITES);
+	count = MIN(count, (len - sizeof(pvt)) / sizeof(sv));
+
+	for (int i = 0; i < count; i++) {
+		memcpy(&sv, payload + sizeof(pvt) + i * sizeof(sv), sizeof(sv));
+
+		pvt_frame.sv[i].sv = sv.sv;
+		pvt_frame.sv[i].signal = sv.signal;
+		pvt_frame.sv[i].cn0 = sv.cn0;
+		pvt_frame.sv[i].elevation = sv.elevation;
+		pvt_frame.sv[i].azimuth = sv.azimuth;
+		pvt_frame.sv[i].flags = sv.flags;
+	}
+}
+
+/* Ends the current search, GNSS sleeps until the next periodic fix or a restart. */
+static void search_end(void)
+{
+	search_end_time = trace_now;
+
+	if (fix_interval == 0) {
+		single_fix_done = true;
+	} else {
+		sleeping = true;
+		wake_time = search_start + fix_interval * MSEC_PER_SEC;
+	}
+}
+
+/* Copies the record to the frame buffers and returns the number of events to send. */
+static int record_prepare(const struct trace_record *record, const uint8_t *payload,
+			  int *events)
+{
+	struct trace_agps_req agps;
+	bool fix;
+	bool epoch_tail;
+	int count = 0;
+
+	trace_now = record->time_ms;
+
+	/* NMEA of the epoch that ended the search is still output. */
+	epoch_tail = (single_fix_done || sleeping) && record->type == GNSS_REPLAY_NMEA &&
+		     record->time_ms == search_end_time;
+
+	if (!started || (single_fix_done && !epoch_tail)) {
+		stats.skipped++;
+		return 0;
+	}
+
+	if (sleeping && !epoch_tail) {
+		if (record->time_ms < wake_time) {
+			stats.skipped++;
+			return 0;
+		}
+
+		sleeping = false;
+		search_start = record->time_ms;
+	}
+
+	switch (record->type) {
+	case GNSS_REPLAY_PVT:
+		pvt_convert(payload, record->len);
+		events[count++] = NRF_MODEM_GNSS_EVT_PVT;
+		stats.pvt++;
+
+		fix = pvt_frame.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID;
+		if (fix) {
+			events[count++] = NRF_MODEM_GNSS_EVT_FIX;
+			stats.fixes++;
+		}
+
+		/* Continuous tracking neither sleeps nor times out. */
+		if (fix_interval == 1) {
+			break;
+		}
+
+		if (fix) {
+			search_end();
+		} else if (fix_retry > 0 &&
+			   record->time_ms - search_start >= fix_retry * MSEC_PER_SEC) {
+			events[count++] = NRF_MODEM_GNSS_EVT_SLEEP_AFTER_TIMEOUT;
+			search_end();
+		}
+		break;
+
+	case GNSS_REPLAY_NMEA:
+		if (nmea_mask == 0) {
+			break;
+		}
+
+		memset(&nmea_frame, 0, sizeof(nmea_frame));
+		memcpy(nmea_frame.nmea_str, payload,
+		       MIN(record->len, sizeof(nmea_frame.nmea_str) - 3));
+		strcat(nmea_frame.nmea_str, "\r\n");
+		events[count++] = NRF_MODEM_GNSS_EVT_NMEA;
+		stats.nmea++;
+		break;
+
+	case GNSS_REPLAY_AGPS_REQ:
+		if (record->len < sizeof(agps)) {
+			break;
+		}
+
+		memcpy(&agps, payload, sizeof(agps));
+		agps_frame.sv_mask_ephe = agps.sv_mask_ephe;
+		agps_frame.sv_mask_alm = agps.sv_mask_alm;
+		agps_frame.data_flags = agps.data_flags;
+		events[count++] = NRF_MODEM_GNSS_EVT_AGPS_REQ;
+		stats.agps_req++;
+		break;
+
+	default:
+		break;
+	}
+
+	return count;
+}
+
+static void events_send(const int *events, int count)
+{
+	uint32_t start;
+	uint32_t handler_us;
+
+	for (int i = 0; i < count; i++) {
+		if (event_handler == NULL) {
+			return;
+		}
+
+		start = k_cycle_get_32();
+		event_handler(events[i]);
+		handler_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+		k_mutex_lock(&replay_lock, K_FOREVER);
+		stats.max_handler_us = MAX(stats.max_handler_us, handler_us);
+		k_mutex_unlock(&replay_lock);
+	}
+}
+
+static void replay_thread_fn(void)
+{
+	const struct trace_header *header = (const struct trace_header *)trace;
+	struct trace_record record;
+	size_t pos = sizeof(*header);
+	uint32_t offset = 0;
+	int64_t base;
+	int64_t due;
+	int64_t now;
+	int events[3];
+	int count;
+
+	if (sizeof(trace) < sizeof(*header) || sys_le32_to_cpu(header->magic) != TRACE_MAGIC ||
+	    header->version != TRACE_VERSION) {
+		LOG_ERR("Invalid GNSS replay trace");
+		return;
+	}
+
+	/* Trace time starts when the application first starts GNSS. */
+	k_sem_take(&replay_start_sem, K_FOREVER);
+	base = k_uptime_get();
+
+	LOG_INF("Replaying GNSS trace, %u bytes, speed x%d", (uint32_t)sizeof(trace),
+		REPLAY_SPEED);
+
+	for (;;) {
+		if (pos + sizeof(record) > sizeof(trace)) {
+			LOG_INF("GNSS trace done: %u PVT, %u fixes, %u NMEA, %u A-GPS requests",
+				stats.pvt, stats.fixes, stats.nmea, stats.agps_req);
+			LOG_INF("GNSS trace done: max lag %u ms, max handler time %u us",
+				stats.max_lag_ms, stats.max_handler_us);
+
+			stats.loops++;
+			if (!IS_ENABLED(CONFIG_GNSS_SAMPLE_REPLAY_LOOP)) {
+				return;
+			}
+
+			/* Trace time keeps running across the loops. */
+			offset = trace_now + MSEC_PER_SEC;
+			pos = sizeof(*header);
+			continue;
+		}
+
+		memcpy(&record, &trace[pos], sizeof(record));
+		record.time_ms = sys_le32_to_cpu(record.time_ms) + offset;
+		record.len = sys_le16_to_cpu(record.len);
+
+		if (pos + sizeof(record) + record.len > sizeof(trace)) {
+			LOG_ERR("Truncated GNSS replay trace");
+			return;
+		}
+
+		due = base + record.time_ms / REPLAY_SPEED;
+		now = k_uptime_get();
+		if (due > now) {
+			k_msleep(due - now);
+			now = k_uptime_get();
+		}
+
+		k_mutex_lock(&replay_lock, K_FOREVER);
+		stats.max_lag_ms = MAX(stats.max_lag_ms, (uint32_t)(now - due));
+		count = record_prepare(&record, &trace[pos + sizeof(record)], events);
+		k_mutex_unlock(&replay_lock);
+
+		events_send(events, count);
+
+		pos += sizeof(record) + record.len;
+	}
+}
+
+K_THREAD_DEFINE(gnss_replay_thread, REPLAY_STACK_SIZE, replay_thread_fn, NULL, NULL, NULL,
+		REPLAY_PRIORITY, 0, 0);
+
+void gnss_replay_stats_get(struct gnss_replay_stats *out)
+{
+	k_mutex_lock(&replay_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&replay_lock);
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_event_handler_set)(nrf_modem_gnss_event_handler_type_t handler)
+{
+	event_handler = handler;
+
+	return 0;
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_read)(void *buf, int32_t buf_len, int type)
+{
+	const void *src;
+	size_t size;
+
+	switch (type) {
+	case NRF_MODEM_GNSS_DATA_PVT:
+		src = &pvt_frame;
+		size = sizeof(pvt_frame);
+		break;
+	case NRF_MODEM_GNSS_DATA_NMEA:
+		src = &nmea_frame;
+		size = sizeof(nmea_frame);
+		break;
+	case NRF_MODEM_GNSS_DATA_AGPS_REQ:
+		src = &agps_frame;
+		size = sizeof(agps_frame);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (buf == NULL || buf_len < (int32_t)size) {
+		return -EINVAL;
+	}
+
+	/* Frames are only written by the replay thread, which calls the handler. */
+	memcpy(buf, src, size);
+
+	return 0;
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_start)(void)
+{
+	k_mutex_lock(&replay_lock, K_FOREVER);
+	started = true;
+	sleeping = false;
+	single_fix_done = false;
+	search_start = trace_now;
+	k_mutex_unlock(&replay_lock);
+
+	k_sem_give(&replay_start_sem);
+
+	return 0;
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_stop)(void)
+{
+	k_mutex_lock(&replay_lock, K_FOREVER);
+	started = false;
+	k_mutex_unlock(&replay_lock);
+
+	return 0;
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_fix_interval_set)(uint16_t fix_interval_s)
+{
+	if (fix_interval_s > 1 && fix_interval_s < 10) {
+		return -EINVAL;
+	}
+
+	fix_interval = fix_interval_s;
+
+	return 0;
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_fix_retry_set)(uint16_t fix_retry_s)
+{
+	fix_retry = fix_retry_s;
+
+	return 0;
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_nmea_mask_set)(uint16_t nmea_mask_bits)
+{
+	nmea_mask = nmea_mask_bits;
+
+	return 0;
+}
+
+/* Settings without an effect on the trace are accepted as such. */
+
+int32_t REPLAY_API(nrf_modem_gnss_use_case_set)(uint8_t use_case)
+{
+	ARG_UNUSED(use_case);
+
+	return 0;
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_power_mode_set)(uint8_t power_mode)
+{
+	ARG_UNUSED(power_mode);
+
+	return 0;
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_elevation_threshold_set)(uint8_t angle)
+{
+	ARG_UNUSED(angle);
+
+	return 0;
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_nv_data_delete)(uint32_t delete_mask)
+{
+	ARG_UNUSED(delete_mask);
+
+	return 0;
+}
+
+int32_t REPLAY_API(nrf_modem_gnss_prio_mode_enable)(void)
+{
+	return 0;
+}
+
+#if !defined(CONFIG_NRF_MODEM_LIB)
+/* Assistance data is accepted and dropped, the trace already contains its effect. */
+int32_t nrf_modem_gnss_agps_write(void *buf, int32_t buf_len, uint16_t type)
+{
+	ARG_UNUSED(buf);
+	ARG_UNUSED(buf_len);
+	ARG_UNUSED(type);
+
+	return 0;
+}
+#endif
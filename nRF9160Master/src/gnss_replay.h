@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef GNSS_REPLAY_H_
+#define GNSS_REPLAY_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Trace record types, see scripts/gnss_trace_gen.py for the layout. */
+enum gnss_replay_record {
+	GNSS_REPLAY_PVT = 1,
+	GNSS_REPLAY_NMEA = 2,
+	GNSS_REPLAY_AGPS_REQ = 3,
+};
+
+struct gnss_replay_stats {
+	uint32_t pvt;            /* PVT notifications delivered */
+	uint32_t fixes;          /* PVT notifications with a valid fix */
+	uint32_t nmea;           /* NMEA notifications delivered */
+	uint32_t agps_req;       /* A-GPS requests delivered */
+	uint32_t skipped;        /* Records passed while GNSS was stopped or sleeping */
+	uint32_t max_lag_ms;     /* Latest delivery compared to the trace time */
+	uint32_t max_handler_us; /* Longest time spent in the application event handler */
+	uint32_t loops;          /* Completed passes through the trace */
+};
+
+/**
+ * @brief Reads the replay statistics.
+ *
+ * @details With CONFIG_GNSS_SAMPLE_REPLAY, the nrf_modem_gnss_* calls of the application
+ *          are served from a trace built into the firmware instead of the GNSS receiver.
+ *          The trace clock starts when GNSS is first started and runs
+ *          CONFIG_GNSS_SAMPLE_REPLAY_SPEED times faster than real time. Records are
+ *          delivered only while GNSS is started and not sleeping between periodic fixes.
+ *
+ * @param[out] stats Statistics since boot.
+ */
+void gnss_replay_stats_get(struct gnss_replay_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GNSS_REPLAY_H_ */
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <modem/lte_lc.h>
+#include <nrf_modem_gnss.h>
+
+#include "gnss_scheduler.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define GPS_SV_COUNT		32
+/* Ephemerides are valid 4 hours around toe, assume 2 hours from when last seen fresh. */
+#define EPHE_VALID_MS		(2 * 60 * 60 * MSEC_PER_SEC)
+/* Hot start needs valid ephemerides for at least this many SVs. */
+#define FRESH_SV_MIN		5
+/* Ephemerides expiring within this time are fetched when LTE is awake anyway. */
+#define PREFETCH_MARGIN_MS	(15 * 60 * MSEC_PER_SEC)
+#define PREFETCH_INTERVAL_MS	(15 * 60 * MSEC_PER_SEC)
+/* Let RRC release settle before starting GNSS. */
+#define LTE_IDLE_GUARD_MS	500
+/* Single fix timeout is handled by GNSS, this only catches a missing notification. */
+#define SEARCH_SLACK_MS		(5 * MSEC_PER_SEC)
+#define INTERVAL_MS		(CONFIG_GNSS_SAMPLE_PERIODIC_INTERVAL * MSEC_PER_SEC)
+#define MAX_DEFER_MS		(CONFIG_GNSS_SAMPLE_SCHEDULER_MAX_DEFER * MSEC_PER_SEC)
+
+enum scheduler_state {
+	STATE_STOPPED,
+	STATE_WAITING,   /* Waiting for the next fix to be due */
+	STATE_LTE_WAIT,  /* Fix is due, waiting for LTE to go idle */
+	STATE_SEARCHING, /* GNSS is running */
+};
+
+static const struct gnss_scheduler_cb *callbacks;
+static enum scheduler_state state;
+static int64_t ephe_expiry[GPS_SV_COUNT]; /* Uptime, 0 if unknown */
+static uint32_t sv_seen;
+static bool rrc_connected;
+static bool lte_sleep_capable; /* PSM or eDRX in use */
+static int64_t due_time;
+static int64_t search_start;
+static int64_t interval_ms = INTERVAL_MS;
+static int64_t last_prefetch;
+static uint32_t blocked_count;
+static struct k_work_delayable scheduler_work;
+static K_MUTEX_DEFINE(scheduler_lock);
+
+static uint8_t fresh_count(int64_t now)
+{
+	uint8_t count = 0;
+
+	for (int i = 0; i < GPS_SV_COUNT; i++) {
+		if (ephe_expiry[i] > now) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/* Returns the time when fewer than FRESH_SV_MIN SVs have valid ephemerides. */
+static int64_t fresh_horizon(void)
+{
+	int64_t best[FRESH_SV_MIN] = { 0 };
+
+	/* Keeps the FRESH_SV_MIN latest expiries, latest first. */
+	for (int i = 0; i < GPS_SV_COUNT; i++) {
+		int64_t expiry = ephe_expiry[i];
+
+		for (int j = 0; j < FRESH_SV_MIN; j++) {
+			if (expiry > best[j]) {
+				int64_t tmp = best[j];
+
+				best[j] = expiry;
+				expiry = tmp;
+			}
+		}
+	}
+
+	return best[FRESH_SV_MIN - 1];
+}
+
+/* Returns the SVs to prefetch ephemerides for, 0 if nothing should be fetched now. */
+static uint32_t prefetch_mask_get(int64_t now)
+{
+	uint32_t mask = 0;
+
+	if (callbacks->prefetch == NULL || !rrc_connected) {
+		return 0;
+	}
+
+	if (last_prefetch != 0 && now - last_prefetch < PREFETCH_INTERVAL_MS) {
+		return 0;
+	}
+
+	if (fresh_horizon() > now + PREFETCH_MARGIN_MS) {
+		return 0;
+	}
+
+	for (int i = 0; i < GPS_SV_COUNT; i++) {
+		if ((sv_seen & BIT(i)) && ephe_expiry[i] < now + PREFETCH_MARGIN_MS) {
+			mask |= BIT(i);
+		}
+	}
+
+	if (mask != 0) {
+		last_prefetch = now;
+	}
+
+	return mask;
+}
+
+static void prefetch(uint32_t mask)
+{
+	if (mask == 0) {
+		return;
+	}
+
+	LOG_INF("Prefetching ephemerides while LTE is awake, SVs 0x%08x", mask);
+	callbacks->prefetch(mask);
+}
+
+static void schedule_next(int64_t now)
+{
+	state = STATE_WAITING;
+	due_time = search_start + interval_ms;
+	if (due_time < now) {
+		due_time = now;
+	}
+
+	k_work_reschedule(&scheduler_work, K_MSEC(due_time - now));
+}
+
+static void search_start_now(int64_t now)
+{
+	bool hot = fresh_count(now) >= FRESH_SV_MIN;
+	uint16_t timeout = hot ? CONFIG_GNSS_SAMPLE_SCHEDULER_HOT_TIMEOUT :
+				 CONFIG_GNSS_SAMPLE_PERIODIC_TIMEOUT;
+
+	if (now > due_time) {
+		LOG_DBG("GNSS start deferred %lld ms for LTE", now - due_time);
+	}
+
+	/* Ensure GNSS is stopped after the previous single fix. */
+	(void)nrf_modem_gnss_stop();
+
+	if (nrf_modem_gnss_fix_retry_set(timeout) != 0) {
+		LOG_ERR("Failed to set GNSS fix retry");
+	}
+
+	if (callbacks->pre_start != NULL) {
+		callbacks->pre_start();
+	}
+
+	if (nrf_modem_gnss_start() != 0) {
+		LOG_ERR("Failed to start GNSS");
+		search_start = now;
+		schedule_next(now);
+		return;
+	}
+
+	LOG_INF("GNSS started, %s start expected, %u SVs with valid ephemerides",
+		hot ? "hot" : "cold/warm", fresh_count(now));
+
+	state = STATE_SEARCHING;
+	search_start = now;
+	blocked_count = 0;
+
+	/* A fix timeout of 0 lets GNSS search until it gets a fix. */
+	if (timeout > 0) {
+		k_work_reschedule(&scheduler_work,
+				  K_MSEC(timeout * MSEC_PER_SEC + SEARCH_SLACK_MS));
+	}
+}
+
+static void scheduler_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	int64_t now = k_uptime_get();
+	uint32_t mask = 0;
+
+	k_mutex_lock(&scheduler_lock, K_FOREVER);
+
+	switch (state) {
+	case STATE_WAITING:
+		mask = prefetch_mask_get(now);
+
+		if (rrc_connected) {
+			/* GNSS would be blocked by LTE, wait for idle. */
+			state = STATE_LTE_WAIT;
+			k_work_reschedule(&scheduler_work, K_MSEC(MAX_DEFER_MS));
+			break;
+		}
+
+		search_start_now(now);
+		break;
+
+	case STATE_LTE_WAIT:
+		/* LTE went idle or waited long enough. */
+		search_start_now(now);
+		break;
+
+	case STATE_SEARCHING:
+		LOG_WRN("No fix within %lld ms", now - search_start);
+		schedule_next(now);
+		break;
+
+	default:
+		break;
+	}
+
+	k_mutex_unlock(&scheduler_lock);
+
+	prefetch(mask);
+}
+
+int gnss_scheduler_init(const struct gnss_scheduler_cb *cb)
+{
+	if (cb == NULL) {
+		return -EINVAL;
+	}
+
+	callbacks = cb;
+	state = STATE_STOPPED;
+	k_work_init_delayable(&scheduler_work, scheduler_work_fn);
+
+	return 0;
+}
+
+void gnss_scheduler_start(void)
+{
+	k_mutex_lock(&scheduler_lock, K_FOREVER);
+	state = STATE_WAITING;
+	due_time = k_uptime_get();
+	k_work_reschedule(&scheduler_work, K_NO_WAIT);
+	k_mutex_unlock(&scheduler_lock);
+}
+
+void gnss_scheduler_interval_set(uint32_t interval)
+{
+	k_mutex_lock(&scheduler_lock, K_FOREVER);
+
+	interval_ms = interval > 0 ? (int64_t)interval * MSEC_PER_SEC : INTERVAL_MS;
+
+	if (state == STATE_WAITING) {
+		schedule_next(k_uptime_get());
+	}
+
+	k_mutex_unlock(&scheduler_lock);
+}
+
+void gnss_scheduler_pvt_update(const struct nrf_modem_gnss_pvt_data_frame *pvt)
+{
+	int64_t now = k_uptime_get();
+
+	k_mutex_lock(&scheduler_lock, K_FOREVER);
+
+	/* SVs used in a fix have valid ephemerides, GNSS decodes new ones while tracking. */
+	for (int i = 0; i < NRF_MODEM_GNSS_MAX_SATELLITES; i++) {
+		uint16_t sv = pvt->sv[i].sv;
+
+		if (sv >= 1 && sv <= GPS_SV_COUNT &&
+		    (pvt->sv[i].flags & NRF_MODEM_GNSS_SV_FLAG_USED_IN_FIX)) {
+			ephe_expiry[sv - 1] = MAX(ephe_expiry[sv - 1], now + EPHE_VALID_MS);
+			sv_seen |= BIT(sv - 1);
+		}
+	}
+
+	if (state == STATE_SEARCHING) {
+		if (pvt->flags & NRF_MODEM_GNSS_PVT_FLAG_DEADLINE_MISSED) {
+			blocked_count++;
+		}
+
+		if (pvt->flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID) {
+			LOG_INF("GNSS fix in %lld ms, blocked by LTE %u times",
+				now - search_start, blocked_count);
+			schedule_next(now);
+		}
+	}
+
+	k_mutex_unlock(&scheduler_lock);
+}
+
+void gnss_scheduler_agps_request(uint32_t sv_mask_ephe)
+{
+	k_mutex_lock(&scheduler_lock, K_FOREVER);
+
+	for (int i = 0; i < GPS_SV_COUNT; i++) {
+		if (sv_mask_ephe & BIT(i)) {
+			ephe_expiry[i] = 0;
+		}
+	}
+
+	k_mutex_unlock(&scheduler_lock);
+}
+
+void gnss_scheduler_assistance_done(uint32_t sv_mask_ephe)
+{
+	int64_t now = k_uptime_get();
+
+	k_mutex_lock(&scheduler_lock, K_FOREVER);
+
+	for (int i = 0; i < GPS_SV_COUNT; i++) {
+		if (sv_mask_ephe & BIT(i)) {
+			ephe_expiry[i] = now + EPHE_VALID_MS;
+			sv_seen |= BIT(i);
+		}
+	}
+
+	k_mutex_unlock(&scheduler_lock);
+}
+
+void gnss_scheduler_lte_evt(const struct lte_lc_evt *const evt)
+{
+	uint32_t mask = 0;
+
+	k_mutex_lock(&scheduler_lock, K_FOREVER);
+
+	switch (evt->type) {
+	case LTE_LC_EVT_RRC_UPDATE:
+		rrc_connected = (evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED);
+
+		if (rrc_connected) {
+			/* LTE is awake anyway, fetching now costs no extra wake-up. */
+			mask = prefetch_mask_get(k_uptime_get());
+		} else if (state == STATE_LTE_WAIT &&
+			   !(IS_ENABLED(CONFIG_LTE_LC_MODEM_SLEEP_NOTIFICATIONS) &&
+			     lte_sleep_capable)) {
+			k_work_reschedule(&scheduler_work, K_MSEC(LTE_IDLE_GUARD_MS));
+		}
+		break;
+
+	case LTE_LC_EVT_PSM_UPDATE:
+		lte_sleep_capable = evt->psm_cfg.active_time >= 0;
+		break;
+
+	case LTE_LC_EVT_EDRX_UPDATE:
+		if (evt->edrx_cfg.edrx > 0.0f) {
+			lte_sleep_capable = true;
+		}
+		break;
+
+#if defined(CONFIG_LTE_LC_MODEM_SLEEP_NOTIFICATIONS)
+	case LTE_LC_EVT_MODEM_SLEEP_ENTER:
+		/* Modem sleeps in PSM or between eDRX paging windows, GNSS gets all the
+		 * radio time.
+		 */
+		if (state == STATE_LTE_WAIT) {
+			k_work_reschedule(&scheduler_work, K_NO_WAIT);
+		}
+		break;
+#endif
+
+	default:
+		break;
+	}
+
+	k_mutex_unlock(&scheduler_lock);
+
+	prefetch(mask);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef GNSS_SCHEDULER_H_
+#define GNSS_SCHEDULER_H_
+
+#include <stdint.h>
+#include <modem/lte_lc.h>
+#include <nrf_modem_gnss.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gnss_scheduler_cb {
+	/* Called before each GNSS start, for example to inject a location prior. */
+	void (*pre_start)(void);
+	/* Called while LTE is awake when ephemerides of the SVs in the mask expire soon.
+	 * May be NULL if assistance can't be fetched.
+	 */
+	void (*prefetch)(uint32_t sv_mask_ephe);
+};
+
+/**
+ * @brief Initializes the GNSS scheduler.
+ *
+ * @details GNSS is used in single fix mode and started by the scheduler every
+ *          CONFIG_GNSS_SAMPLE_PERIODIC_INTERVAL seconds. Starts are delayed while LTE is
+ *          in RRC connected mode and the fix timeout depends on how many SVs still have
+ *          valid ephemerides.
+ *
+ * @param[in] cb Callbacks, must stay valid.
+ *
+ * @retval 0 on success.
+ * @retval <0 in case of an error.
+ */
+int gnss_scheduler_init(const struct gnss_scheduler_cb *cb);
+
+/**
+ * @brief Schedules the first GNSS start immediately.
+ */
+void gnss_scheduler_start(void);
+
+/**
+ * @brief Changes the interval between fixes.
+ *
+ * @details A fix already due is rescheduled from the start of the last search.
+ *
+ * @param[in] interval Interval in seconds, 0 restores CONFIG_GNSS_SAMPLE_PERIODIC_INTERVAL.
+ */
+void gnss_scheduler_interval_set(uint32_t interval);
+
+/**
+ * @brief Updates the scheduler with a PVT notification.
+ *
+ * @param[in] pvt PVT data frame.
+ */
+void gnss_scheduler_pvt_update(const struct nrf_modem_gnss_pvt_data_frame *pvt);
+
+/**
+ * @brief Marks ephemerides requested by GNSS as stale.
+ *
+ * @param[in] sv_mask_ephe SVs GNSS needs ephemerides for.
+ */
+void gnss_scheduler_agps_request(uint32_t sv_mask_ephe);
+
+/**
+ * @brief Marks ephemerides injected to GNSS as fresh.
+ *
+ * @param[in] sv_mask_ephe SVs ephemerides were injected for.
+ */
+void gnss_scheduler_assistance_done(uint32_t sv_mask_ephe);
+
+/**
+ * @brief Updates the scheduler with an LTE link controller event.
+ *
+ * @param[in] evt LTE event.
+ */
+void gnss_scheduler_lte_evt(const struct lte_lc_evt *const evt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GNSS_SCHEDULER_H_ */
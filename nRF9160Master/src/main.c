@@ -16,7 +16,28 @@
 #include <modem/nrf_modem_lib.h>
 #include <date_time.h>
 #include "WiFi/WiFiHandler.h"
+#include "WiFi/WiFiStore.h"
+#include "WiFi/WiFiPosition.h"
 #include "System/SystemHandler.h"
+#include "System/PowerPolicy.h"
+#include "System/TimerService.h"
+#include "Transport/TransportArbiter.h"
+#if defined(CONFIG_GNSS_SAMPLE_COARSE_POSITION)
+#include "coarse_position.h"
+#endif
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER)
+#include "gnss_scheduler.h"
+#endif
+#if defined(CONFIG_GNSS_SAMPLE_RADIO_COORDINATOR)
+#include "radio_coordinator.h"
+#endif
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+#include "ttff_bench.h"
+#endif
+#include "PerfStats.h"
+#if defined(CONFIG_PETTAP_PERF_THREADS)
+#include "ThreadProfile.h"
+#endif
 
 
 // aws
@@ -33,11 +54,40 @@
 #define STACKSIZE 			2048
 #define THREAD0_PRIORITY 	7
 #define THREAD1_PRIORITY 	7
+/* Timers may expire this much late to share a wake-up, see TimerService.h */
+#define CONNECT_RETRY_SLACK_MS	5000
+#define DIAG_SLACK_MS		30000
+#define POST_SLACK_MS		5000
 //aws connect work function
 static struct k_work_delayable connect_work;
+static TIMER_SVC_DEFINE(connect_retry_timer, NULL, &connect_work, CONNECT_RETRY_SLACK_MS);
+/* Locations are posted every post_counter seconds, fixes in between are batched.
+ * Coarse or dummy location is posted instead when there was no fix.
+ */
+static K_SEM_DEFINE(post_sem, 0, 1);
+
+static void post_timer_handler(void)
+{
+	/* Wakes GpsTask, see events */
+	k_sem_give(&post_sem);
+}
+
+static TIMER_SVC_DEFINE(post_timer, post_timer_handler, NULL, POST_SLACK_MS);
 
 static bool cloud_connected = false;
+/* LTE not needed while WiFi carries uploads, stay in PSM */
+static bool lte_parked = false;
 static bool gnss_connected = false;
+/* Fix settings of the operation mode, GNSS is slowed down while asleep */
+static uint16_t gnss_fix_retry;
+static uint16_t gnss_fix_interval;
+static bool gnss_slowed;
+
+PERF_HIST_DEFINE(gnss_ttff, "ms");
+#if defined(CONFIG_PETTAP_PERF) && (CONFIG_GNSS_SAMPLE_DIAG_INTERVAL > 0)
+static struct k_work_delayable diag_work;
+static TIMER_SVC_DEFINE(diag_timer, NULL, &diag_work, DIAG_SLACK_MS);
+#endif
 
 static void GpsTask(void);
 static void SystemTask(void);
@@ -65,17 +115,24 @@ K_THREAD_STACK_DEFINE(gnss_workq_stack_area, GNSS_WORKQ_THREAD_STACK_SIZE);
 
 #if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
 #include "assistance.h"
+#include "assistance_cache.h"
 
 static struct nrf_modem_gnss_agps_data_frame last_agps;
 static struct k_work agps_data_get_work;
 static volatile bool requesting_assistance;
+/* Request made by the GNSS scheduler before ephemerides expire. */
+static volatile bool agps_prefetch;
 #endif /* !CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE */
 
 #if defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
 static struct k_work_delayable ttff_test_got_fix_work;
 static struct k_work_delayable ttff_test_prepare_work;
 static struct k_work ttff_test_start_work;
-static uint32_t time_to_fix;
+static uint32_t time_to_fix_ms;
+static bool ttff_timed_out;
+#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
+static struct assistance_cache_stats ttff_assistance_stats;
+#endif
 #endif
 
 static const char update_indicator[] = {'\\', '|', '/', '-'};
@@ -93,13 +150,16 @@ K_MSGQ_DEFINE(nmea_queue, sizeof(struct nrf_modem_gnss_nmea_data_frame *), 10, 4
 static K_SEM_DEFINE(pvt_data_sem, 0, 1);
 static K_SEM_DEFINE(time_sem, 0, 1);
 
-static struct k_poll_event events[2] = {
+static struct k_poll_event events[3] = {
 	K_POLL_EVENT_STATIC_INITIALIZER(K_POLL_TYPE_SEM_AVAILABLE,
 					K_POLL_MODE_NOTIFY_ONLY,
 					&pvt_data_sem, 0),
 	K_POLL_EVENT_STATIC_INITIALIZER(K_POLL_TYPE_MSGQ_DATA_AVAILABLE,
 					K_POLL_MODE_NOTIFY_ONLY,
 					&nmea_queue, 0),
+	K_POLL_EVENT_STATIC_INITIALIZER(K_POLL_TYPE_SEM_AVAILABLE,
+					K_POLL_MODE_NOTIFY_ONLY,
+					&post_sem, 0),
 };
 
 BUILD_ASSERT(IS_ENABLED(CONFIG_LTE_NETWORK_MODE_LTE_M_GPS) ||
@@ -153,6 +213,14 @@ static void print_distance_from_reference(struct nrf_modem_gnss_pvt_data_frame *
 	}
 }
 
+static void gnss_prior_inject(void)
+{
+#if defined(CONFIG_GNSS_SAMPLE_COARSE_POSITION)
+	/* Coarse position shortens TTFF when GNSS has no recent fix. */
+	(void)coarse_position_inject();
+#endif
+}
+
 static void gnss_event_handler(int event)
 {
 	int retval;
@@ -171,11 +239,28 @@ static void gnss_event_handler(int event)
 		/* Time to fix is calculated here, but it's printed from a delayed work to avoid
 		 * messing up the NMEA output.
 		 */
-		time_to_fix = (k_uptime_get() - fix_timestamp) / 1000;
+		time_to_fix_ms = k_uptime_get() - fix_timestamp;
+		PERF_HIST(gnss_ttff, time_to_fix_ms);
+#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
+		/* Download still ongoing is not needed for this fix. */
+		assistance_cancel();
+#endif
+		ttff_timed_out = false;
 		k_work_schedule_for_queue(&gnss_work_q, &ttff_test_got_fix_work, K_MSEC(100));
 		k_work_schedule_for_queue(&gnss_work_q, &ttff_test_prepare_work,
 					  K_SECONDS(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_INTERVAL));
 		break;
+
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+	case NRF_MODEM_GNSS_EVT_SLEEP_AFTER_TIMEOUT:
+		/* No fix within the benchmark fix timeout, recorded as a failed iteration. */
+		time_to_fix_ms = k_uptime_get() - fix_timestamp;
+		ttff_timed_out = true;
+		k_work_schedule_for_queue(&gnss_work_q, &ttff_test_got_fix_work, K_MSEC(100));
+		k_work_schedule_for_queue(&gnss_work_q, &ttff_test_prepare_work,
+					  K_SECONDS(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_INTERVAL));
+		break;
+#endif /* CONFIG_GNSS_SAMPLE_TTFF_BENCH */
 #endif /* CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST */
 
 	case NRF_MODEM_GNSS_EVT_NMEA:
@@ -263,6 +348,23 @@ void lte_disconnect(void)
 
 	LOG_INF("LTE disconnected");
 }
+
+static struct k_work_delayable lte_disconnect_work;
+static bool lte_on_demand_connected;
+
+static void lte_disconnect_work_fn(struct k_work *item)
+{
+	ARG_UNUSED(item);
+
+	/* Asynchronous assistance download still needs LTE. */
+	if (assistance_is_active()) {
+		k_work_reschedule_for_queue(&gnss_work_q, &lte_disconnect_work, K_SECONDS(1));
+		return;
+	}
+
+	lte_disconnect();
+	lte_on_demand_connected = false;
+}
 #endif /* CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND */
 
 static void agps_data_get_work_fn(struct k_work *item)
@@ -271,6 +373,30 @@ static void agps_data_get_work_fn(struct k_work *item)
 
 	int err;
 
+	if (assistance_is_active()) {
+		LOG_INF("Assistance download already in progress");
+		return;
+	}
+
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER)
+	/* Marked fresh again by assistance_cache.c as the ephemerides are injected. */
+	gnss_scheduler_agps_request(last_agps.sv_mask_ephe);
+#endif
+
+	if (agps_prefetch) {
+		/* Cached ephemerides are about to expire, fetch new ones. */
+		agps_prefetch = false;
+	} else {
+		/* Only stale data is downloaded. */
+		assistance_cache_trim(&last_agps);
+		if (last_agps.sv_mask_ephe == 0 &&
+		    last_agps.sv_mask_alm == 0 &&
+		    last_agps.data_flags == 0) {
+			LOG_INF("Assistance request served from cache");
+			return;
+		}
+	}
+
 #if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_SUPL)
 	/* SUPL doesn't usually provide NeQuick ionospheric corrections and satellite real time
 	 * integrity information. If GNSS asks only for those, the request should be ignored.
@@ -303,7 +429,12 @@ static void agps_data_get_work_fn(struct k_work *item)
 		last_agps.data_flags);
 
 #if defined(CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND)
-	lte_connect();
+	/* LTE may still be up with the disconnect pending from the previous request. */
+	(void)k_work_cancel_delayable(&lte_disconnect_work);
+	if (!lte_on_demand_connected) {
+		lte_connect();
+		lte_on_demand_connected = true;
+	}
 #endif /* CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND */
 
 	err = assistance_request(&last_agps);
@@ -312,21 +443,87 @@ static void agps_data_get_work_fn(struct k_work *item)
 	}
 
 #if defined(CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND)
-	lte_disconnect();
+	/* Disconnects when the download has ended, SUPL runs asynchronously. */
+	k_work_reschedule_for_queue(&gnss_work_q, &lte_disconnect_work, K_NO_WAIT);
 #endif /* CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND */
 
 	requesting_assistance = false;
 }
+
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER) && \
+	(defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NRF_CLOUD) || \
+	 defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_SUPL))
+static void gnss_scheduler_prefetch(uint32_t sv_mask_ephe)
+{
+	if (requesting_assistance || assistance_is_active()) {
+		return;
+	}
+
+	last_agps.sv_mask_ephe = sv_mask_ephe;
+	last_agps.sv_mask_alm = 0;
+	last_agps.data_flags = 0;
+	agps_prefetch = true;
+
+	k_work_submit_to_queue(&gnss_work_q, &agps_data_get_work);
+}
+#endif
 #endif /* !CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE */
 
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER)
+static const struct gnss_scheduler_cb scheduler_cb = {
+	.pre_start = gnss_prior_inject,
+#if defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NRF_CLOUD) || defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_SUPL)
+	.prefetch = gnss_scheduler_prefetch,
+#endif
+};
+#endif /* CONFIG_GNSS_SAMPLE_SCHEDULER */
+
 #if defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
 static void ttff_test_got_fix_work_fn(struct k_work *item)
 {
-	LOG_INF("Time to fix: %u", time_to_fix);
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+	struct ttff_bench_result result = {
+		.ttff_ms = time_to_fix_ms,
+		.blocked_s = time_blocked,
+		.accuracy = last_pvt.accuracy,
+		.error = -1.0f,
+		.timeout = ttff_timed_out,
+	};
+#endif
+
+	if (ttff_timed_out) {
+		LOG_INF("No fix in %u seconds", time_to_fix_ms / MSEC_PER_SEC);
+	} else {
+		LOG_INF("Time to fix: %u", time_to_fix_ms / MSEC_PER_SEC);
+	}
+#if defined(CONFIG_GNSS_SAMPLE_COARSE_POSITION)
+	LOG_INF("Location prior: %s",
+		coarse_position_source_str(coarse_position_injected_source()));
+#endif
+#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
+	struct assistance_cache_stats stats;
+
+	assistance_cache_stats_get(&stats);
+	LOG_INF("Assistance bytes: %u from cache, %u downloaded",
+		stats.cache_bytes - ttff_assistance_stats.cache_bytes,
+		stats.network_bytes - ttff_assistance_stats.network_bytes);
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+	result.cache_bytes = stats.cache_bytes - ttff_assistance_stats.cache_bytes;
+	result.network_bytes = stats.network_bytes - ttff_assistance_stats.network_bytes;
+#endif
+#endif
 	if (time_blocked > 0) {
 		LOG_INF("Time GNSS was blocked by LTE: %u", time_blocked);
 	}
 	print_distance_from_reference(&last_pvt);
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+	if (ref_used) {
+		result.error = distance_calculate(last_pvt.latitude, last_pvt.longitude,
+						  ref_latitude, ref_longitude);
+	}
+
+	ttff_bench_record(&result);
+#endif
 	LOG_INF("Sleeping for %u seconds", CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_INTERVAL);
 }
 
@@ -361,19 +558,78 @@ static int ttff_test_force_cold_start(void)
 	return 0;
 }
 
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+static int ttff_test_force_warm_start(void)
+{
+	LOG_INF("Deleting GNSS ephemerides");
+
+	if (nrf_modem_gnss_nv_data_delete(NRF_MODEM_GNSS_DELETE_EPHEMERIDES) != 0) {
+		LOG_ERR("Failed to delete GNSS data");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void ttff_bench_done(const char *json)
+{
+	char topic[] = "sample/pet/ttff";
+	struct aws_iot_data tx_data = {
+		.qos = MQTT_QOS_0_AT_MOST_ONCE,
+		.topic.type = 0,
+		.topic.str = topic,
+		.topic.len = strlen(topic),
+		.ptr = (char *)json,
+		.len = strlen(json)
+	};
+	int err;
+
+	LOG_INF("TTFF benchmark summary: %s", json);
+
+	if (!cloud_connected) {
+		return;
+	}
+
+	err = aws_iot_send(&tx_data);
+	if (err) {
+		LOG_ERR("aws_iot_send, error: %d", err);
+	}
+}
+#endif /* CONFIG_GNSS_SAMPLE_TTFF_BENCH */
+
 static void ttff_test_prepare_work_fn(struct k_work *item)
 {
+	bool cold_start = IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_COLD_START);
+
 	/* Make sure GNSS is stopped before next start. */
 	nrf_modem_gnss_stop();
 
-	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_COLD_START)) {
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+	enum ttff_bench_start start = ttff_bench_next_start();
+
+	if (start == TTFF_BENCH_DONE) {
+		LOG_INF("TTFF benchmark done, GNSS stopped");
+		return;
+	}
+
+	cold_start = (start == TTFF_BENCH_COLD);
+
+	if (start == TTFF_BENCH_WARM && ttff_test_force_warm_start() != 0) {
+		return;
+	}
+#endif
+
+	if (cold_start) {
 		if (ttff_test_force_cold_start() != 0) {
 			return;
 		}
 	}
 
 #if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
-	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST_COLD_START)) {
+	/* Assistance used for this fix is counted from here. */
+	assistance_cache_stats_get(&ttff_assistance_stats);
+
+	if (cold_start) {
 		/* All A-GPS data is always requested before GNSS is started. */
 		last_agps.sv_mask_ephe = 0xffffffff;
 		last_agps.sv_mask_alm = 0xffffffff;
@@ -400,6 +656,8 @@ static void ttff_test_prepare_work_fn(struct k_work *item)
 
 static void ttff_test_start_work_fn(struct k_work *item)
 {
+	gnss_prior_inject();
+
 	LOG_INF("Starting GNSS");
 	if (nrf_modem_gnss_start() != 0) {
 		LOG_ERR("Failed to start GNSS");
@@ -477,6 +735,14 @@ static int sample_init(void)
 
 #if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
 	k_work_init(&agps_data_get_work, agps_data_get_work_fn);
+#if defined(CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND)
+	k_work_init_delayable(&lte_disconnect_work, lte_disconnect_work_fn);
+#endif /* CONFIG_GNSS_SAMPLE_LTE_ON_DEMAND */
+
+	err = assistance_cache_init();
+	if (err) {
+		LOG_ERR("Failed to initialize assistance cache");
+	}
 
 	err = assistance_init(&gnss_work_q);
 #endif /* !CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE */
@@ -485,6 +751,9 @@ static int sample_init(void)
 	k_work_init_delayable(&ttff_test_got_fix_work, ttff_test_got_fix_work_fn);
 	k_work_init_delayable(&ttff_test_prepare_work, ttff_test_prepare_work_fn);
 	k_work_init(&ttff_test_start_work, ttff_test_start_work_fn);
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+	(void)ttff_bench_init(ttff_bench_done);
+#endif
 #endif /* CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST */
 
 	return err;
@@ -566,12 +835,23 @@ static int gnss_init_and_start(void)
 #if defined(CONFIG_GNSS_SAMPLE_MODE_PERIODIC)
 	fix_retry = CONFIG_GNSS_SAMPLE_PERIODIC_TIMEOUT;
 	fix_interval = CONFIG_GNSS_SAMPLE_PERIODIC_INTERVAL;
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER)
+	/* Single fixes, the scheduler decides when GNSS is started. */
+	fix_interval = 0;
+#endif
 #elif defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
 	/* Single fix for TTFF test mode. */
 	fix_retry = 0;
 	fix_interval = 0;
+#if defined(CONFIG_GNSS_SAMPLE_TTFF_BENCH)
+	/* Benchmark iterations without a fix are recorded as timeouts. */
+	fix_retry = CONFIG_GNSS_SAMPLE_TTFF_BENCH_TIMEOUT;
+#endif
 #endif
 
+	gnss_fix_retry = fix_retry;
+	gnss_fix_interval = fix_interval;
+
 	if (nrf_modem_gnss_fix_retry_set(fix_retry) != 0) {
 		LOG_ERR("Failed to set GNSS fix retry");
 		return -1;
@@ -585,10 +865,25 @@ static int gnss_init_and_start(void)
 #if defined(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)
 	k_work_schedule_for_queue(&gnss_work_q, &ttff_test_prepare_work, K_NO_WAIT);
 #else /* !CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST */
+#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
+	/* Assistance from the previous boot, before anything is downloaded. */
+	(void)assistance_cache_inject();
+#endif
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER)
+	if (gnss_scheduler_init(&scheduler_cb) != 0) {
+		LOG_ERR("Failed to initialize GNSS scheduler");
+		return -1;
+	}
+
+	gnss_scheduler_start();
+#else
+	gnss_prior_inject();
+
 	if (nrf_modem_gnss_start() != 0) {
 		LOG_ERR("Failed to start GNSS");
 		return -1;
 	}
+#endif /* CONFIG_GNSS_SAMPLE_SCHEDULER */
 #endif
 
 	return 0;
@@ -626,6 +921,23 @@ static void print_satellite_stats(struct nrf_modem_gnss_pvt_data_frame *pvt_data
 	//printf("Tracking: %2d Using: %2d Unhealthy: %d\n", tracked, in_fix, unhealthy);
 }
 
+/* Fallback location while GNSS has no fix. */
+static bool coarse_location_get(_sGnssConfig *location)
+{
+#if defined(CONFIG_GNSS_SAMPLE_COARSE_POSITION)
+	struct coarse_position pos;
+
+	if (coarse_position_get(&pos) == 0) {
+		LOG_INF("Using %s location, accuracy %u m",
+			coarse_position_source_str(pos.source), pos.accuracy);
+		location->dLatitude = pos.latitude;
+		location->dLongitude = pos.longitude;
+		return true;
+	}
+#endif
+	return false;
+}
+
 static void create_dummy_gnss(struct nrf_modem_gnss_pvt_data_frame *pvt_data)
 {
 	pvt_data->latitude= 47.6061;
@@ -773,6 +1085,8 @@ static int shadow_update(struct nrf_modem_gnss_pvt_data_frame *pvt_data)
 	err = aws_iot_send(&tx_data);
 	if (err) {
 		LOG_ERR("aws_iot_send, error: %d", err);
+	} else {
+		err = tx_data.len;
 	}
 
 	cJSON_FreeString(message);
@@ -784,6 +1098,76 @@ cleanup:
 	return err;
 }
 
+static int scan_publish(const uint8_t *scan, uint8_t len)
+{
+	int err;
+	char *message;
+	int64_t message_ts = 0;
+	char scan_hex[2 * WIFI_POS_PACKED_MAX + 1];
+
+	if (bin2hex(scan, len, scan_hex, sizeof(scan_hex)) == 0) {
+		return -EINVAL;
+	}
+
+	err = date_time_now(&message_ts);
+	if (err) {
+		LOG_ERR("date_time_now, error: %d", err);
+		return err;
+	}
+
+	cJSON *root_obj = cJSON_CreateObject();
+	cJSON *state_obj = cJSON_CreateObject();
+	cJSON *reported_obj = cJSON_CreateObject();
+
+	if (root_obj == NULL || state_obj == NULL || reported_obj == NULL) {
+		cJSON_Delete(root_obj);
+		cJSON_Delete(state_obj);
+		cJSON_Delete(reported_obj);
+		return -ENOMEM;
+	}
+
+	err = json_add_number(reported_obj, "ts", message_ts);
+	err += json_add_str(reported_obj, "wifi_scan", scan_hex);
+	err += json_add_obj(state_obj, "reported", reported_obj);
+	err += json_add_obj(root_obj, "state", state_obj);
+
+	if (err) {
+		LOG_ERR("json_add, error: %d", err);
+		goto cleanup;
+	}
+
+	message = cJSON_PrintUnformatted(root_obj);
+	if (message == NULL) {
+		LOG_ERR("cJSON_Print, error: returned NULL");
+		err = -ENOMEM;
+		goto cleanup;
+	}
+
+	char end_topic[] = "sample/pet";
+	struct aws_iot_data tx_data = {
+		.qos = MQTT_QOS_0_AT_MOST_ONCE,
+		.topic.type = 0,
+		.topic.str = end_topic,
+		.topic.len = strlen(end_topic),
+		.ptr = message,
+		.len = strlen(message)
+	};
+
+	err = aws_iot_send(&tx_data);
+	if (err) {
+		LOG_ERR("aws_iot_send, error: %d", err);
+	} else {
+		err = tx_data.len;
+	}
+
+	cJSON_FreeString(message);
+
+cleanup:
+	cJSON_Delete(root_obj);
+
+	return err;
+}
+
 static int app_topics_subscribe(void)
 {
 	int err;
@@ -832,15 +1216,281 @@ clean_exit:
 	cJSON_Delete(root_obj);
 }
 
+/* Reports the known SSIDs and clears the desired AP list so the delta
+ * is not sent again. Passwords are never reported.
+ */
+static int shadow_wifi_aps_ack(void)
+{
+	int err = 0;
+	char *message;
+	const _sWiFiAp *ap;
+	cJSON *root_obj = cJSON_CreateObject();
+	cJSON *state_obj = cJSON_CreateObject();
+	cJSON *reported_obj = cJSON_CreateObject();
+	cJSON *desired_obj = cJSON_CreateObject();
+	cJSON *ssids_obj = cJSON_CreateArray();
+
+	if (root_obj == NULL || state_obj == NULL || reported_obj == NULL ||
+	    desired_obj == NULL || ssids_obj == NULL) {
+		cJSON_Delete(root_obj);
+		cJSON_Delete(state_obj);
+		cJSON_Delete(reported_obj);
+		cJSON_Delete(desired_obj);
+		cJSON_Delete(ssids_obj);
+		return -ENOMEM;
+	}
+
+	for (uint8_t i = 0; i < WIFI_AP_MAX; i++) {
+		ap = WiFiStoreGetAp(i);
+		if (ap) {
+			cJSON_AddItemToArray(ssids_obj, cJSON_CreateString(ap->cSSID));
+		}
+	}
+
+	err += json_add_obj(reported_obj, "wifi_aps", ssids_obj);
+	err += json_add_obj(desired_obj, "wifi_aps", cJSON_CreateNull());
+	err += json_add_obj(state_obj, "reported", reported_obj);
+	err += json_add_obj(state_obj, "desired", desired_obj);
+	err += json_add_obj(root_obj, "state", state_obj);
+
+	message = cJSON_PrintUnformatted(root_obj);
+	if (message == NULL) {
+		err = -ENOMEM;
+		goto cleanup;
+	}
+
+	struct aws_iot_data tx_data = {
+		.qos = MQTT_QOS_0_AT_MOST_ONCE,
+		.topic.type = AWS_IOT_SHADOW_TOPIC_UPDATE,
+		.ptr = message,
+		.len = strlen(message)
+	};
+
+	err = aws_iot_send(&tx_data);
+	if (err) {
+		LOG_ERR("aws_iot_send, error: %d", err);
+	}
+
+	cJSON_FreeString(message);
+
+cleanup:
+	cJSON_Delete(root_obj);
+
+	return err;
+}
+
+/* Desired state "wifi_aps": [{"ssid": "...", "pwd": "..."}, ...] replaces
+ * the known APs. Statistics of APs kept in the list are preserved.
+ */
+static void shadow_delta_handle(const char *buf)
+{
+	cJSON *root_obj;
+	cJSON *aps_obj;
+	cJSON *ap_obj;
+	cJSON *ssid_obj;
+	cJSON *pwd_obj;
+	const _sWiFiAp *ap;
+	char ssid[CMD_SSID_MAX_LEN + 1];
+	bool listed;
+
+	root_obj = cJSON_Parse(buf);
+	if (root_obj == NULL) {
+		LOG_ERR("cJSON Parse failure");
+		return;
+	}
+
+	aps_obj = cJSON_GetObjectItem(cJSON_GetObjectItem(root_obj, "state"), "wifi_aps");
+	if (!cJSON_IsArray(aps_obj)) {
+		goto clean_exit;
+	}
+
+	for (uint8_t i = 0; i < WIFI_AP_MAX; i++) {
+		ap = WiFiStoreGetAp(i);
+		if (ap == NULL) {
+			continue;
+		}
+
+		listed = false;
+		cJSON_ArrayForEach(ap_obj, aps_obj) {
+			ssid_obj = cJSON_GetObjectItem(ap_obj, "ssid");
+			if (cJSON_IsString(ssid_obj) &&
+			    strcmp(ssid_obj->valuestring, ap->cSSID) == 0) {
+				listed = true;
+				break;
+			}
+		}
+
+		if (!listed) {
+			strcpy(ssid, ap->cSSID);
+			LOG_INF("Shadow removes AP %s", ssid);
+			RemoveWiFiAP(ssid);
+		}
+	}
+
+	cJSON_ArrayForEach(ap_obj, aps_obj) {
+		ssid_obj = cJSON_GetObjectItem(ap_obj, "ssid");
+		pwd_obj = cJSON_GetObjectItem(ap_obj, "pwd");
+		if (!cJSON_IsString(ssid_obj)) {
+			continue;
+		}
+
+		AddWiFiAP(ssid_obj->valuestring,
+			  cJSON_IsString(pwd_obj) ? pwd_obj->valuestring : "");
+	}
+
+	(void)shadow_wifi_aps_ack();
+
+clean_exit:
+	cJSON_Delete(root_obj);
+}
+
+static bool lte_link_up(void)
+{
+	if (!cloud_connected || lte_parked) {
+		return false;
+	}
+
+#if defined(CONFIG_GNSS_SAMPLE_RADIO_COORDINATOR)
+	/* Held until GNSS has a fix or an LTE window opens, the arbiter retries. */
+	return radio_coord_lte_allowed();
+#else
+	return true;
+#endif
+}
+
+static int lte_publish(const _sGnssConfig *location)
+{
+	struct nrf_modem_gnss_pvt_data_frame pvt = last_pvt;
+
+	pvt.latitude = location->dLatitude;
+	pvt.longitude = location->dLongitude;
+
+	return shadow_update(&pvt);
+}
+
+static void lte_set_idle(bool idle)
+{
+	lte_parked = idle;
+	PowerLog("LTE", idle ? "IDLE" : "ACTIVE");
+
+	if (!idle) {
+		k_work_schedule(&connect_work, K_NO_WAIT);
+		return;
+	}
+
+	/* Drop the broker connection so the modem is free to stay in PSM,
+	 * the connection is brought back when the arbiter needs LTE again.
+	 */
+	TimerSvcStop(&connect_retry_timer);
+	(void)k_work_cancel_delayable(&connect_work);
+	if (cloud_connected) {
+		(void)aws_iot_disconnect();
+	}
+
+#if defined(CONFIG_NRF_MODEM_LIB)
+	int err = lte_lc_psm_req(true);
+	if (err) {
+		LOG_ERR("Requesting PSM failed, error: %d", err);
+	}
+#endif
+}
+
+static const _sTransportOps lte_link_ops = {
+	.pcName = "LTE",
+	.IsUp = lte_link_up,
+	.Send = lte_publish,
+	.SendScan = scan_publish,
+	.SetIdle = lte_set_idle,
+	.ulMsgCostUj = TRANSPORT_LTE_MSG_UJ,
+	.ulByteCostUj = TRANSPORT_LTE_BYTE_UJ,
+};
+
+static void wifi_pos_handler(bool known_place)
+{
+	int err;
+
+	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)) {
+		return;
+	}
+
+	/* GNSS is the biggest consumer, the stored location of the place
+	 * is used until the scans stop matching.
+	 */
+	/* Arriving at or leaving a place both mean the pet is moving. */
+	PowerPolicyMoved();
+
+	if (known_place) {
+		LOG_INF("At a known place, stopping GNSS");
+		err = nrf_modem_gnss_stop();
+		gnss_connected = false;
+	} else {
+		LOG_INF("Left known place, starting GNSS");
+		gnss_prior_inject();
+		err = nrf_modem_gnss_start();
+	}
+
+	if (err) {
+		LOG_ERR("GNSS %s failed, error: %d", known_place ? "stop" : "start", err);
+	}
+}
+
+static void power_state_handler(_ePowerState state)
+{
+	bool slow = (state == POWER_STATE_SLEEP);
+	int err = 0;
+
+	LOG_INF("Power state %s", PowerPolicyStateName(state));
+
+	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST) || slow == gnss_slowed) {
+		return;
+	}
+
+	gnss_slowed = slow;
+
+	/* While asleep GNSS only checks now and then whether the pet moves,
+	 * LTE is idled by the transport hold and stays in PSM.
+	 */
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER)
+	gnss_scheduler_interval_set(slow ? CONFIG_PETTAP_POWER_GNSS_INTERVAL : 0);
+#else
+	(void)nrf_modem_gnss_stop();
+	gnss_connected = false;
+
+	if (nrf_modem_gnss_fix_retry_set(slow ? CONFIG_PETTAP_POWER_GNSS_TIMEOUT :
+					 gnss_fix_retry) != 0 ||
+	    nrf_modem_gnss_fix_interval_set(slow ? CONFIG_PETTAP_POWER_GNSS_INTERVAL :
+					    gnss_fix_interval) != 0) {
+		LOG_ERR("Failed to set GNSS fix interval");
+	}
+
+	/* At a known place GNSS stays off until the scans stop matching. */
+	if (slow || !WiFiPosIsKnownPlace()) {
+		gnss_prior_inject();
+		err = nrf_modem_gnss_start();
+		if (err) {
+			LOG_ERR("Failed to start GNSS, error: %d", err);
+		}
+	}
+#endif
+
+	PowerLog("GNSS", slow ? "PERIODIC" : "NORMAL");
+}
 
 static void connect_work_fn(struct k_work *work)
 {
 	int err;
 printk("Connct to work fn");	
-	if (cloud_connected) {
+	if (cloud_connected || lte_parked) {
 		return;
 	}
 
+#if defined(CONFIG_GNSS_SAMPLE_RADIO_COORDINATOR)
+	/* Connecting blocks GNSS, retried when LTE is allowed again. */
+	if (!radio_coord_lte_allowed()) {
+		return;
+	}
+#endif
+
 	printk("Trying to connect to aws");
 	
 	err = aws_iot_connect(NULL);
@@ -851,9 +1501,52 @@ printk("Connct to work fn");
 	LOG_INF("Next connection retry in %d seconds",
 		CONFIG_AWS_IOT_SAMPLE_CONNECTION_RETRY_TIMEOUT_SECONDS);
 
-	k_work_schedule(&connect_work,
-			K_SECONDS(CONFIG_AWS_IOT_SAMPLE_CONNECTION_RETRY_TIMEOUT_SECONDS));
+	TimerSvcStart(&connect_retry_timer,
+		      CONFIG_AWS_IOT_SAMPLE_CONNECTION_RETRY_TIMEOUT_SECONDS * MSEC_PER_SEC, 0);
+}
+
+#if defined(CONFIG_PETTAP_PERF) && (CONFIG_GNSS_SAMPLE_DIAG_INTERVAL > 0)
+static void diag_work_fn(struct k_work *work)
+{
+	static char json[CONFIG_PETTAP_PERF_JSON_SIZE];
+	char topic[] = "sample/pet/diag";
+	struct aws_iot_data tx_data = {
+		.qos = MQTT_QOS_0_AT_MOST_ONCE,
+		.topic.type = 0,
+		.topic.str = topic,
+		.topic.len = strlen(topic),
+		.ptr = json,
+	};
+	int len;
+	int err;
+
+	if (!cloud_connected) {
+		return;
+	}
+
+#if defined(CONFIG_GNSS_SAMPLE_RADIO_COORDINATOR)
+	/* Diagnostics are not worth blocking a GNSS search, try again shortly. */
+	if (!radio_coord_lte_allowed()) {
+		k_work_reschedule(&diag_work, K_SECONDS(10));
+		return;
+	}
+#endif
+
+	len = PerfToJson(json, sizeof(json));
+	if (len < 0) {
+		LOG_ERR("Statistics do not fit in %d bytes", CONFIG_PETTAP_PERF_JSON_SIZE);
+		return;
+	}
+
+	tx_data.len = len;
+
+	err = aws_iot_send(&tx_data);
+	if (err) {
+		LOG_ERR("aws_iot_send, error: %d", err);
+	}
 }
+#endif
+
 void aws_iot_event_handler(const struct aws_iot_evt *const evt)
 {
 	switch (evt->type) {
@@ -870,7 +1563,8 @@ void aws_iot_event_handler(const struct aws_iot_evt *const evt)
 		 * it will exit after checking the above flag and the work will
 		 * not be scheduled again.
 		 */
-		 (void)k_work_cancel_delayable(&connect_work);
+		TimerSvcStop(&connect_retry_timer);
+		(void)k_work_cancel_delayable(&connect_work);
 
 		if (evt->data.persistent_session) {
 			LOG_INF("Persistent session enabled");
@@ -915,12 +1609,17 @@ void aws_iot_event_handler(const struct aws_iot_evt *const evt)
 		 * not be scheduled again.
 		 */
 		// (void)k_work_cancel_delayable(&shadow_update_work);
-		k_work_schedule(&connect_work, K_NO_WAIT);
+		if (!lte_parked) {
+			k_work_schedule(&connect_work, K_NO_WAIT);
+		}
 		break;
 	case AWS_IOT_EVT_DATA_RECEIVED:
 		LOG_INF("AWS_IOT_EVT_DATA_RECEIVED");
 		print_received_data(evt->data.msg.ptr, evt->data.msg.topic.str,
 				    evt->data.msg.topic.len);
+		if (evt->data.msg.topic.type == AWS_IOT_SHADOW_TOPIC_UPDATE_DELTA) {
+			shadow_delta_handle(evt->data.msg.ptr);
+		}
 		break;
 	case AWS_IOT_EVT_PUBACK:
 		LOG_INF("AWS_IOT_EVT_PUBACK, message ID: %d", evt->data.message_id);
@@ -968,8 +1667,34 @@ void aws_iot_event_handler(const struct aws_iot_evt *const evt)
 	}
 }
 
+#if defined(CONFIG_GNSS_SAMPLE_RADIO_COORDINATOR)
+static void radio_window_handler(uint32_t next_ms)
+{
+	int err;
+
+	if (!cloud_connected) {
+		if (!lte_parked) {
+			k_work_reschedule(&connect_work, K_NO_WAIT);
+		}
+		return;
+	}
+
+	/* Send the MQTT keepalive now rather than in the middle of a GNSS search. */
+	if (next_ms > 0 && aws_iot_keepalive_time_left() < (int)next_ms) {
+		err = aws_iot_ping();
+		if (err) {
+			LOG_WRN("aws_iot_ping, error: %d", err);
+		}
+	}
+}
+#endif
+
 static void lte_handler(const struct lte_lc_evt *const evt)
 {
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER)
+	gnss_scheduler_lte_evt(evt);
+#endif
+
 	switch (evt->type) {
 	case LTE_LC_EVT_NW_REG_STATUS:
 		if ((evt->nw_reg_status != LTE_LC_NW_REG_REGISTERED_HOME) &&
@@ -1003,17 +1728,36 @@ static void lte_handler(const struct lte_lc_evt *const evt)
 		LOG_INF("RRC mode: %s",
 			evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED ?
 			"Connected" : "Idle");
+		PowerLog("LTE", evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED ?
+			 "RRC_CONNECTED" : "RRC_IDLE");
+		break;
+#if defined(CONFIG_LTE_LC_MODEM_SLEEP_NOTIFICATIONS)
+	case LTE_LC_EVT_MODEM_SLEEP_ENTER:
+		PowerLog("LTE", evt->modem_sleep.type == LTE_LC_MODEM_SLEEP_PSM ?
+			 "PSM" : "SLEEP");
 		break;
+	case LTE_LC_EVT_MODEM_SLEEP_EXIT:
+		PowerLog("LTE", "WAKE");
+		break;
+#endif
 	case LTE_LC_EVT_CELL_UPDATE:
 		LOG_INF("LTE cell changed: Cell ID: %d, Tracking area: %d",
 			evt->cell.id, evt->cell.tac);
+#if defined(CONFIG_GNSS_SAMPLE_COARSE_POSITION)
+		coarse_position_cell_update(&evt->cell);
+#endif
 		break;
+#if defined(CONFIG_GNSS_SAMPLE_COARSE_POSITION)
+	case LTE_LC_EVT_NEIGHBOR_CELL_MEAS:
+		coarse_position_cells_update(&evt->cells_info);
+		break;
+#endif
 	default:
 		break;
 	}
 }
 
-int post_counter = 60; // delay between posts to aws
+int post_counter = 60; // delay in seconds between posts to aws
 int main(void)
 {
 	int err;
@@ -1062,9 +1806,30 @@ int main(void)
 		LOG_ERR("Failed initializing modem info module, error: %d", err);
 	}
 	k_work_init_delayable(&connect_work, connect_work_fn);
+	TransportRegister(TRANSPORT_LTE, &lte_link_ops);
+#if defined(CONFIG_PETTAP_PERF) && (CONFIG_GNSS_SAMPLE_DIAG_INTERVAL > 0)
+	k_work_init_delayable(&diag_work, diag_work_fn);
+	TimerSvcStart(&diag_timer, CONFIG_GNSS_SAMPLE_DIAG_INTERVAL * MSEC_PER_SEC,
+		      CONFIG_GNSS_SAMPLE_DIAG_INTERVAL * MSEC_PER_SEC);
+#endif
+#if defined(CONFIG_PETTAP_PERF_THREADS)
+	ThreadProfInit();
+#endif
+
+#if defined(CONFIG_GNSS_SAMPLE_RADIO_COORDINATOR)
+	if (radio_coord_init(radio_window_handler) != 0) {
+		LOG_ERR("Failed to initialize radio coordinator");
+	}
+#endif
 	
 
 
+#if defined(CONFIG_GNSS_SAMPLE_COARSE_POSITION)
+	if (coarse_position_init() != 0) {
+		LOG_ERR("Failed to initialize coarse position");
+	}
+#endif
+
 	if (sample_init() != 0) {
 		LOG_ERR("Failed to initialize sample");
 		return -1;
@@ -1075,7 +1840,11 @@ int main(void)
 		return -1;
 	}
 
+	WiFiPosInit(wifi_pos_handler);
+	PowerPolicyInit(power_state_handler);
+
 	k_work_schedule(&connect_work, K_NO_WAIT); /*Aws connect work shedule*/
+	TimerSvcStart(&post_timer, post_counter * MSEC_PER_SEC, post_counter * MSEC_PER_SEC);
 	fix_timestamp = k_uptime_get();
 
 	// err = lte_lc_func_mode_set(LTE_LC_FUNC_MODE_DEACTIVATE_LTE);
@@ -1084,11 +1853,7 @@ int main(void)
 	// 	return;
 	// }
 
-	while(1)
-	{
-		k_msleep(10);
-	}
-
+	/* GpsTask and SystemTask carry on, woken by their events */
 	return 0;
 }
 
@@ -1101,17 +1866,26 @@ int main(void)
 static void GpsTask()
 {
 	uint8_t cnt = 0;
-	uint8_t count = 0;
 	struct nrf_modem_gnss_nmea_data_frame *nmea_data;
 	_sGnssConfig sGnssConfig = {0};
+	bool fix_queued = false;
+
+	/* Shown by the thread profiler instead of the thread object name */
+	k_thread_name_set(NULL, "GpsTask");
 
 	for (;;) {
 		//NRFX_DELAY_US(2000000);
-		(void)k_poll(events, 2, K_FOREVER);
+		(void)k_poll(events, ARRAY_SIZE(events), K_FOREVER);
 
 		if (events[0].state == K_POLL_STATE_SEM_AVAILABLE &&
 		    k_sem_take(events[0].sem, K_NO_WAIT) == 0) {
 			/* New PVT data available */
+#if defined(CONFIG_GNSS_SAMPLE_SCHEDULER)
+			gnss_scheduler_pvt_update(&last_pvt);
+#endif
+#if defined(CONFIG_GNSS_SAMPLE_RADIO_COORDINATOR)
+			radio_coord_pvt_update(&last_pvt);
+#endif
 
 			if (IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST)) {
 				/* TTFF test mode. */
@@ -1154,7 +1928,15 @@ static void GpsTask()
 				// printf("-----------------------------------\n");
 				// printk("satelite flag %d\n",last_pvt.flags);
 				if (last_pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID) {
+					if (!gnss_connected) {
+						/* Since boot or since the last fix before the loss */
+						PERF_HIST(gnss_ttff, k_uptime_get() - fix_timestamp);
+					}
 					gnss_connected = true;
+#if !defined(CONFIG_GNSS_SAMPLE_ASSISTANCE_NONE)
+					/* GNSS is tracking, rest of the download is not needed. */
+					assistance_cancel();
+#endif
 					
 					fix_timestamp = k_uptime_get();
 					printf("\n Valid GNSS\n\n\n");
@@ -1170,11 +1952,15 @@ static void GpsTask()
 					sGnssConfig.dLongitude = last_pvt.longitude;
 					UpdateLocation(&sGnssConfig);
 					SetLocationDataStatus(true);
+					WiFiPosLearn(&sGnssConfig);
+					PowerPolicyFix(&sGnssConfig);
+#if defined(CONFIG_GNSS_SAMPLE_COARSE_POSITION)
+					coarse_position_fix_update(last_pvt.latitude, last_pvt.longitude);
+#endif
 					
-					if(cloud_connected == true && gnss_connected == true)
-					{
-						shadow_update(&last_pvt);
-					}
+					/* Sent with the next post */
+					TransportQueue(&sGnssConfig);
+					fix_queued = true;
 					print_distance_from_reference(&last_pvt);
 				} else {
 					// printk("satelite flag %d\n",last_pvt.flags);
@@ -1184,16 +1970,6 @@ static void GpsTask()
 					//       (uint32_t)((k_uptime_get() - fix_timestamp) / 1000));
 						    
 						   //print_fix_data(&last_pvt);
-						  count++;
-					if(cloud_connected == true && (count > post_counter) )
-					{
-						create_dummy_gnss(&last_pvt);
-						shadow_update(&last_pvt);
-						count = 0;
-					}
-					else{
-						//printk("\ncloud not connected\n");
-					}
 					cnt++;
 					//printf("Searching [%c]\n", update_indicator[cnt%4]);
 				}
@@ -1215,9 +1991,27 @@ handle_nmea:
 			k_free(nmea_data);
 		}
 
+		/* Only uplink wake-up for locations, over the cheapest link up */
+		if (events[2].state == K_POLL_STATE_SEM_AVAILABLE &&
+		    k_sem_take(events[2].sem, K_NO_WAIT) == 0 &&
+		    !IS_ENABLED(CONFIG_GNSS_SAMPLE_MODE_TTFF_TEST) &&
+		    !IS_ENABLED(CONFIG_GNSS_SAMPLE_NMEA_ONLY)) {
+			if (fix_queued) {
+				TransportFlush();
+				fix_queued = false;
+			} else {
+				if (!coarse_location_get(&sGnssConfig)) {
+					create_dummy_gnss(&last_pvt);
+					sGnssConfig.dLatitude = last_pvt.latitude;
+					sGnssConfig.dLongitude = last_pvt.longitude;
+				}
+				TransportPublish(&sGnssConfig);
+			}
+		}
+
 		events[0].state = K_POLL_STATE_NOT_READY;
 		events[1].state = K_POLL_STATE_NOT_READY;
-		k_msleep(10);
+		events[2].state = K_POLL_STATE_NOT_READY;
 	}
 } 
 
@@ -1229,11 +2023,15 @@ handle_nmea:
 */
 static void SystemTask()
 {
+	k_thread_name_set(NULL, "SystemTask");
+
 	while (1)
 	{
 		ProcessWiFiMsgs();
 		ProcessBleMsg();
 		ProcessDeviceState();
-		k_msleep(10);
+		PowerPolicyProcess();
+		TransportProcess();
+		SystemWait();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef MCC_LOCATION_DATA_H_
+#define MCC_LOCATION_DATA_H_
+
+#include <stdint.h>
+
+/* Layout of the table generated by scripts/mcc_table_gen.py, used only by
+ * mcc_location_table.c.
+ */
+
+struct mcc_unc {
+	uint8_t confidence;
+	uint8_t unc_semiminor;
+	uint8_t unc_semimajor;
+	uint8_t orientation;
+};
+
+struct mcc_row {
+	uint8_t lat[3]; /* lat_convert() value, little-endian 24-bit */
+	uint8_t lon[3]; /* lon_convert() value, little-endian 24-bit */
+	uint8_t unc;    /* index to mcc_unc */
+};
+
+extern const struct mcc_unc mcc_unc[];
+extern const struct mcc_row mcc_rows[];
+extern const uint16_t mcc_rows_count;
+
+#if defined(CONFIG_GNSS_SAMPLE_MCC_TABLE_DENSE)
+extern const uint16_t mcc_index_base;
+extern const uint16_t mcc_index_count;
+extern const uint8_t mcc_index[];
+#else
+extern const uint16_t mcc_keys[];
+#endif
+
+#endif /* MCC_LOCATION_DATA_H_ */
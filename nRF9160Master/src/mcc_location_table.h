@@ -7,24 +7,27 @@
 #ifndef MCC_LOCATION_TABLE_H_
 #define MCC_LOCATION_TABLE_H_
 
-struct __attribute__ ((__packed__)) mcc_table {
+#include <stdint.h>
+
+struct mcc_location {
+	uint16_t mcc;
+	int32_t lat;           /* converted, see lat_convert() */
+	int32_t lon;           /* converted, see lon_convert() */
 	uint8_t confidence;    /* percentage, 0-100 */
 	uint8_t unc_semiminor; /* scaled, see GNSS interface for details */
 	uint8_t unc_semimajor; /* scaled, see GNSS interface for details */
 	uint8_t orientation;   /* orientation angle between the major axis and north */
-	float lat;
-	float lon;
-	uint16_t mcc;
 };
 
 /**
  * @brief Finds location information for a given Mobile Country Code (MCC).
  *
  * @param mcc[in] MCC to look for.
+ * @param location[out] Location information for the MCC.
  *
- * @return Location information for the matching MCC, NULL if no entry was found.
+ * @return 0 on success, -ENOENT if no entry was found.
  */
-const struct mcc_table *mcc_lookup(uint16_t mcc);
+int mcc_lookup(uint16_t mcc, struct mcc_location *location);
 
 /**
  * @brief Converts a latitude in degrees to the integer representation used by GNSS.
@@ -44,4 +47,22 @@ int32_t lat_convert(float lat);
  */
 int32_t lon_convert(float lon);
 
+/**
+ * @brief Converts a latitude in the integer representation used by GNSS to degrees.
+ *
+ * @param lat[in] Latitude in scaled integer representation.
+ *
+ * @return Latitude in degrees.
+ */
+double lat_degrees(int32_t lat);
+
+/**
+ * @brief Converts a longitude in the integer representation used by GNSS to degrees.
+ *
+ * @param lon[in] Longitude in scaled integer representation.
+ *
+ * @return Longitude in degrees.
+ */
+double lon_degrees(int32_t lon);
+
 #endif /* MCC_LOCATION_TABLE_H_ */
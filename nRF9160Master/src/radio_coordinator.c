@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <nrf_modem_gnss.h>
+
+#include "radio_coordinator.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* GNSS is considered stopped or sleeping when PVT notifications stop for this long. */
+#define GNSS_IDLE_TIMEOUT_MS	3000
+#define WINDOW_INTERVAL_MS	(CONFIG_GNSS_SAMPLE_RADIO_WINDOW_INTERVAL * MSEC_PER_SEC)
+#define WINDOW_LEN_MS		(CONFIG_GNSS_SAMPLE_RADIO_WINDOW_LEN * MSEC_PER_SEC)
+#define MAX_HOLD_MS		(CONFIG_GNSS_SAMPLE_RADIO_MAX_HOLD * MSEC_PER_SEC)
+#define HOUR_SECONDS		3600
+
+#define PVT_FLAGS_BLOCKED	(NRF_MODEM_GNSS_PVT_FLAG_DEADLINE_MISSED | \
+				 NRF_MODEM_GNSS_PVT_FLAG_NOT_ENOUGH_WINDOW_TIME)
+
+enum gnss_state {
+	GNSS_IDLE,      /* No PVT notifications, LTE is free */
+	GNSS_SEARCHING, /* No fix, LTE is held off */
+	GNSS_TRACKING,  /* Fix, LTE is allowed in windows */
+};
+
+static radio_coord_window_cb_t window_cb;
+static enum gnss_state state;
+static bool window_open;
+static bool prio_requested;
+static int64_t search_start;
+static int64_t last_window;
+static struct radio_coord_stats current;
+static struct radio_coord_stats history[RADIO_COORD_HISTORY_HOURS];
+static uint8_t history_head;
+static uint8_t history_count;
+static struct k_work_delayable window_work;
+static struct k_work_delayable idle_work;
+static struct k_work_delayable hour_work;
+static K_MUTEX_DEFINE(coord_lock);
+
+static void window_notify(uint32_t next_ms)
+{
+	if (window_cb != NULL) {
+		window_cb(next_ms);
+	}
+}
+
+/* Opens a window now, or schedules it if the previous one opened too recently. */
+static bool window_open_or_schedule(int64_t now)
+{
+	if (last_window != 0 && now - last_window < WINDOW_INTERVAL_MS) {
+		k_work_reschedule(&window_work, K_MSEC(last_window + WINDOW_INTERVAL_MS - now));
+		return false;
+	}
+
+	window_open = true;
+	last_window = now;
+	current.windows++;
+	k_work_reschedule(&window_work, K_MSEC(WINDOW_LEN_MS));
+
+	return true;
+}
+
+static void window_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	int64_t now = k_uptime_get();
+	bool notify = false;
+	uint32_t next_ms = 0;
+
+	k_mutex_lock(&coord_lock, K_FOREVER);
+
+	switch (state) {
+	case GNSS_SEARCHING:
+		/* Search has taken too long, LTE can't be held off any longer. */
+		LOG_INF("No fix in %d s, LTE released", CONFIG_GNSS_SAMPLE_RADIO_MAX_HOLD);
+		notify = true;
+		break;
+
+	case GNSS_TRACKING:
+		if (window_open) {
+			window_open = false;
+			k_work_reschedule(&window_work,
+					  K_MSEC(MAX(last_window + WINDOW_INTERVAL_MS - now, 0)));
+		} else {
+			notify = window_open_or_schedule(now);
+			next_ms = WINDOW_INTERVAL_MS;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	k_mutex_unlock(&coord_lock);
+
+	if (notify) {
+		window_notify(next_ms);
+	}
+}
+
+static void idle_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	k_mutex_lock(&coord_lock, K_FOREVER);
+	state = GNSS_IDLE;
+	window_open = false;
+	(void)k_work_cancel_delayable(&window_work);
+	k_mutex_unlock(&coord_lock);
+
+	LOG_DBG("GNSS idle, LTE free");
+
+	window_notify(0);
+}
+
+static void hour_work_fn(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	struct radio_coord_stats hour;
+
+	k_mutex_lock(&coord_lock, K_FOREVER);
+
+	hour = current;
+	memset(&current, 0, sizeof(current));
+
+	history_head = (history_head + 1) % RADIO_COORD_HISTORY_HOURS;
+	history[history_head] = hour;
+	if (history_count < RADIO_COORD_HISTORY_HOURS) {
+		history_count++;
+	}
+
+	k_mutex_unlock(&coord_lock);
+
+	k_work_reschedule(&hour_work, K_SECONDS(HOUR_SECONDS));
+
+	LOG_INF("Last hour: GNSS blocked %u s, searching %u s, tracking %u s",
+		hour.blocked_s, hour.searching_s, hour.tracking_s);
+	LOG_INF("Last hour: %u LTE windows, %u LTE deferrals, GNSS priority %u times",
+		hour.windows, hour.deferrals, hour.prio_count);
+}
+
+int radio_coord_init(radio_coord_window_cb_t cb)
+{
+	window_cb = cb;
+	state = GNSS_IDLE;
+
+	k_work_init_delayable(&window_work, window_work_fn);
+	k_work_init_delayable(&idle_work, idle_work_fn);
+	k_work_init_delayable(&hour_work, hour_work_fn);
+	k_work_schedule(&hour_work, K_SECONDS(HOUR_SECONDS));
+
+	return 0;
+}
+
+void radio_coord_pvt_update(const struct nrf_modem_gnss_pvt_data_frame *pvt)
+{
+	int64_t now = k_uptime_get();
+	bool prio = false;
+	bool notify = false;
+	int err;
+
+	k_mutex_lock(&coord_lock, K_FOREVER);
+
+	k_work_reschedule(&idle_work, K_MSEC(GNSS_IDLE_TIMEOUT_MS));
+
+	/* PVT notifications come once per second while GNSS is running. */
+	if (pvt->flags & PVT_FLAGS_BLOCKED) {
+		current.blocked_s++;
+	}
+
+	if (pvt->flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID) {
+		current.tracking_s++;
+
+		if (state != GNSS_TRACKING) {
+			/* Publishes held during the search go out right after the fix. */
+			state = GNSS_TRACKING;
+			window_open = false;
+			notify = window_open_or_schedule(now);
+		}
+	} else {
+		current.searching_s++;
+
+		if (state != GNSS_SEARCHING) {
+			state = GNSS_SEARCHING;
+			window_open = false;
+			prio_requested = false;
+			search_start = now;
+			k_work_reschedule(&window_work, K_MSEC(MAX_HOLD_MS));
+		}
+
+		/* Priority mode is requested once per search, GNSS disables it after a fix. */
+		if ((pvt->flags & PVT_FLAGS_BLOCKED) && !prio_requested) {
+			prio_requested = true;
+			prio = true;
+			current.prio_count++;
+		}
+	}
+
+	k_mutex_unlock(&coord_lock);
+
+	if (prio) {
+		err = nrf_modem_gnss_prio_mode_enable();
+		if (err) {
+			LOG_WRN("Failed to enable GNSS priority mode, error: %d", err);
+		} else {
+			LOG_INF("GNSS blocked by LTE, priority mode enabled");
+		}
+	}
+
+	if (notify) {
+		window_notify(WINDOW_INTERVAL_MS);
+	}
+}
+
+bool radio_coord_lte_allowed(void)
+{
+	bool allowed;
+
+	k_mutex_lock(&coord_lock, K_FOREVER);
+
+	switch (state) {
+	case GNSS_SEARCHING:
+		allowed = k_uptime_get() - search_start >= MAX_HOLD_MS;
+		break;
+
+	case GNSS_TRACKING:
+		allowed = window_open;
+		break;
+
+	default:
+		allowed = true;
+		break;
+	}
+
+	if (!allowed) {
+		current.deferrals++;
+	}
+
+	k_mutex_unlock(&coord_lock);
+
+	return allowed;
+}
+
+int radio_coord_stats_get(uint8_t hours_ago, struct radio_coord_stats *stats)
+{
+	if (hours_ago > history_count) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&coord_lock, K_FOREVER);
+
+	if (hours_ago == 0) {
+		*stats = current;
+	} else {
+		*stats = history[(history_head + RADIO_COORD_HISTORY_HOURS - hours_ago + 1) %
+				 RADIO_COORD_HISTORY_HOURS];
+	}
+
+	k_mutex_unlock(&coord_lock);
+
+	return 0;
+}
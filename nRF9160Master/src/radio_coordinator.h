@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef RADIO_COORDINATOR_H_
+#define RADIO_COORDINATOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <nrf_modem_gnss.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of full hours kept in the statistics history. */
+#define RADIO_COORD_HISTORY_HOURS 24
+
+struct radio_coord_stats {
+	uint32_t blocked_s;   /* PVT epochs blocked by LTE or without enough time windows */
+	uint32_t searching_s; /* PVT epochs without a fix */
+	uint32_t tracking_s;  /* PVT epochs with a fix */
+	uint32_t deferrals;   /* LTE accesses refused outside windows */
+	uint32_t windows;     /* LTE windows opened */
+	uint32_t prio_count;  /* GNSS priority mode requests */
+};
+
+/**
+ * @brief Called when LTE may be used, for example to send pending data or keepalives.
+ *
+ * @param[in] next_ms Time until the following window opens, 0 while GNSS is idle.
+ */
+typedef void (*radio_coord_window_cb_t)(uint32_t next_ms);
+
+/**
+ * @brief Initializes the radio coordinator.
+ *
+ * @details GNSS and LTE share the radio. While GNSS searches for a fix, LTE is held off
+ *          and GNSS priority mode is requested if LTE still blocks GNSS. While GNSS is
+ *          tracking, LTE is allowed only in windows of CONFIG_GNSS_SAMPLE_RADIO_WINDOW_LEN
+ *          seconds every CONFIG_GNSS_SAMPLE_RADIO_WINDOW_INTERVAL seconds, the first one
+ *          opening at the fix. LTE is always allowed while GNSS is not running.
+ *
+ * @param[in] cb Window callback, may be NULL.
+ *
+ * @retval 0 on success.
+ * @retval <0 in case of an error.
+ */
+int radio_coord_init(radio_coord_window_cb_t cb);
+
+/**
+ * @brief Updates the coordinator with a PVT notification.
+ *
+ * @param[in] pvt PVT data frame.
+ */
+void radio_coord_pvt_update(const struct nrf_modem_gnss_pvt_data_frame *pvt);
+
+/**
+ * @brief Checks whether LTE may be used now.
+ *
+ * @details A refused access is counted as a deferral, the caller is expected to retry
+ *          later or in the window callback.
+ *
+ * @retval true if LTE may be used.
+ * @retval false if LTE activity should be deferred.
+ */
+bool radio_coord_lte_allowed(void);
+
+/**
+ * @brief Reads the coordinator statistics.
+ *
+ * @param[in] hours_ago 0 for the current hour, 1 for the previous full hour and so on.
+ * @param[out] stats Statistics of the hour.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the hour is not in the history.
+ */
+int radio_coord_stats_get(uint8_t hours_ago, struct radio_coord_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RADIO_COORDINATOR_H_ */
@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#if defined(CONFIG_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+#include "ttff_bench.h"
+
+LOG_MODULE_DECLARE(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define BENCH_MAGIC		0x42465454 /* "TTFB" */
+#define BENCH_VERSION		1
+#define BENCH_ITERATIONS	CONFIG_GNSS_SAMPLE_TTFF_BENCH_ITERATIONS
+#define BENCH_RECORDS		(BENCH_ITERATIONS * TTFF_BENCH_START_COUNT)
+#define DUMP_LINE_BYTES		32
+#define SUMMARY_JSON_SIZE	640
+
+/* Assistance method of the build, stored in the log header. */
+enum bench_assistance {
+	BENCH_ASSISTANCE_NONE,
+	BENCH_ASSISTANCE_MINIMAL,
+	BENCH_ASSISTANCE_SUPL,
+	BENCH_ASSISTANCE_NRF_CLOUD,
+};
+
+#define BENCH_FLAG_AGPS		BIT(0)
+#define BENCH_FLAG_PGPS		BIT(1)
+#define BENCH_FLAG_CACHE	BIT(2)
+
+#define RECORD_FLAG_TIMEOUT	BIT(0)
+
+/* Log layout is decoded by scripts/ttff_bench_decode.py, all fields little-endian. */
+struct bench_header {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t assistance;     /* enum bench_assistance */
+	uint8_t flags;          /* BENCH_FLAG_* */
+	uint8_t count;          /* Records in the log */
+} __packed;
+
+struct bench_record {
+	uint8_t start;          /* enum ttff_bench_start */
+	uint8_t flags;          /* RECORD_FLAG_* */
+	uint16_t ttff_ds;       /* 0.1 s */
+	uint16_t blocked_s;
+	uint16_t accuracy_dm;   /* 0.1 m */
+	uint16_t error_dm;      /* 0.1 m, UINT16_MAX if no reference position */
+	uint16_t network_bytes;
+	uint16_t cache_bytes;
+	uint16_t reserved;
+} __packed;
+
+BUILD_ASSERT(sizeof(struct bench_record) == 16);
+
+static struct {
+	struct bench_header header;
+	struct bench_record records[BENCH_RECORDS];
+} __packed bench_log;
+
+static ttff_bench_done_cb_t done_cb;
+static uint8_t next_index;
+static enum ttff_bench_start current_start;
+static bool reported;
+
+static const char *const start_names[] = {
+	[TTFF_BENCH_COLD] = "cold",
+	[TTFF_BENCH_WARM] = "warm",
+	[TTFF_BENCH_HOT] = "hot",
+};
+
+static const char *assistance_str(void)
+{
+	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_MINIMAL)) {
+		return "minimal";
+	} else if (IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_SUPL)) {
+		return "supl";
+	} else if (IS_ENABLED(CONFIG_NRF_CLOUD_PGPS)) {
+		return IS_ENABLED(CONFIG_NRF_CLOUD_AGPS) ? "agps+pgps" : "pgps";
+	} else if (IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_NRF_CLOUD)) {
+		return "agps";
+	}
+
+	return "none";
+}
+
+static void header_init(void)
+{
+	struct bench_header *header = &bench_log.header;
+
+	header->magic = sys_cpu_to_le32(BENCH_MAGIC);
+	header->version = BENCH_VERSION;
+	header->flags = 0;
+
+	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_MINIMAL)) {
+		header->assistance = BENCH_ASSISTANCE_MINIMAL;
+	} else if (IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_SUPL)) {
+		header->assistance = BENCH_ASSISTANCE_SUPL;
+	} else if (IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_NRF_CLOUD)) {
+		header->assistance = BENCH_ASSISTANCE_NRF_CLOUD;
+	} else {
+		header->assistance = BENCH_ASSISTANCE_NONE;
+	}
+
+	if (IS_ENABLED(CONFIG_NRF_CLOUD_AGPS)) {
+		header->flags |= BENCH_FLAG_AGPS;
+	}
+	if (IS_ENABLED(CONFIG_NRF_CLOUD_PGPS)) {
+		header->flags |= BENCH_FLAG_PGPS;
+	}
+	if (IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_CACHE)) {
+		header->flags |= BENCH_FLAG_CACHE;
+	}
+}
+
+static uint16_t clamp_u16(uint32_t value)
+{
+	return MIN(value, UINT16_MAX - 1);
+}
+
+static uint16_t float_to_dm(float meters)
+{
+	if (meters < 0.0f) {
+		return UINT16_MAX;
+	}
+
+	return clamp_u16((uint32_t)(meters * 10.0f + 0.5f));
+}
+
+static void sort(uint32_t *values, uint8_t count)
+{
+	for (int i = 1; i < count; i++) {
+		uint32_t value = values[i];
+		int j = i - 1;
+
+		while (j >= 0 && values[j] > value) {
+			values[j + 1] = values[j];
+			j--;
+		}
+
+		values[j + 1] = value;
+	}
+}
+
+/* Nearest-rank percentiles of the values, which are sorted in place. */
+static void stat_calc(uint32_t *values, uint8_t count, struct ttff_bench_stat *stat)
+{
+	if (count == 0) {
+		memset(stat, 0, sizeof(*stat));
+		return;
+	}
+
+	sort(values, count);
+
+	stat->p50 = values[(count * 50 + 99) / 100 - 1];
+	stat->p90 = values[(count * 90 + 99) / 100 - 1];
+	stat->max = values[count - 1];
+}
+
+int ttff_bench_summary_get(enum ttff_bench_start start, struct ttff_bench_summary *summary)
+{
+	uint32_t ttff[BENCH_ITERATIONS];
+	uint32_t blocked[BENCH_ITERATIONS];
+	uint32_t network[BENCH_ITERATIONS];
+	uint32_t accuracy[BENCH_ITERATIONS];
+	uint8_t count = 0;
+
+	if (start >= TTFF_BENCH_START_COUNT) {
+		return -EINVAL;
+	}
+
+	memset(summary, 0, sizeof(*summary));
+
+	for (int i = 0; i < bench_log.header.count; i++) {
+		const struct bench_record *record = &bench_log.records[i];
+
+		if (record->start != start) {
+			continue;
+		}
+
+		summary->runs++;
+
+		if (record->flags & RECORD_FLAG_TIMEOUT) {
+			summary->timeouts++;
+			continue;
+		}
+
+		ttff[count] = sys_le16_to_cpu(record->ttff_ds) * 100;
+		blocked[count] = sys_le16_to_cpu(record->blocked_s);
+		network[count] = sys_le16_to_cpu(record->network_bytes);
+		accuracy[count] = sys_le16_to_cpu(record->accuracy_dm);
+		count++;
+	}
+
+	stat_calc(ttff, count, &summary->ttff_ms);
+	stat_calc(blocked, count, &summary->blocked_s);
+	stat_calc(network, count, &summary->network_bytes);
+	stat_calc(accuracy, count, &summary->accuracy_dm);
+
+	return 0;
+}
+
+/* Appends to the JSON buffer, the length keeps growing past the size on overflow. */
+static void json_append(char *buf, size_t size, size_t *len, const char *fmt, ...)
+{
+	va_list args;
+
+	if (*len >= size) {
+		return;
+	}
+
+	va_start(args, fmt);
+	*len += vsnprintf(buf + *len, size - *len, fmt, args);
+	va_end(args);
+}
+
+static void stat_json(char *buf, size_t size, size_t *len, const char *name,
+		      const struct ttff_bench_stat *stat)
+{
+	json_append(buf, size, len, ",\"%s\":[%u,%u,%u]", name, stat->p50, stat->p90, stat->max);
+}
+
+static int summary_json(char *buf, size_t size)
+{
+	struct ttff_bench_summary summary;
+	size_t len = 0;
+
+	json_append(buf, size, &len, "{\"assistance\":\"%s\",\"cache\":%s", assistance_str(),
+		    IS_ENABLED(CONFIG_GNSS_SAMPLE_ASSISTANCE_CACHE) ? "true" : "false");
+
+	for (int start = 0; start < TTFF_BENCH_START_COUNT; start++) {
+		(void)ttff_bench_summary_get(start, &summary);
+
+		json_append(buf, size, &len, ",\"%s\":{\"runs\":%u,\"timeouts\":%u",
+			    start_names[start], summary.runs, summary.timeouts);
+		stat_json(buf, size, &len, "ttff_ms", &summary.ttff_ms);
+		stat_json(buf, size, &len, "blocked_s", &summary.blocked_s);
+		stat_json(buf, size, &len, "download_bytes", &summary.network_bytes);
+		stat_json(buf, size, &len, "accuracy_dm", &summary.accuracy_dm);
+		json_append(buf, size, &len, "}");
+	}
+
+	json_append(buf, size, &len, "}");
+
+	return len < size ? 0 : -ENOMEM;
+}
+
+static void summary_log(void)
+{
+	struct ttff_bench_summary summary;
+
+	LOG_INF("TTFF benchmark, assistance: %s", assistance_str());
+
+	for (int start = 0; start < TTFF_BENCH_START_COUNT; start++) {
+		(void)ttff_bench_summary_get(start, &summary);
+
+		LOG_INF("%s: %u runs, %u timeouts, TTFF p50 %u ms, p90 %u ms, max %u ms",
+			start_names[start], summary.runs, summary.timeouts,
+			summary.ttff_ms.p50, summary.ttff_ms.p90, summary.ttff_ms.max);
+		LOG_INF("%s: blocked p50 %u s, p90 %u s, downloaded p50 %u B, p90 %u B, "
+			"accuracy p50 %u dm, p90 %u dm",
+			start_names[start], summary.blocked_s.p50, summary.blocked_s.p90,
+			summary.network_bytes.p50, summary.network_bytes.p90,
+			summary.accuracy_dm.p50, summary.accuracy_dm.p90);
+	}
+}
+
+static void report(void)
+{
+	static char json[SUMMARY_JSON_SIZE];
+
+	summary_log();
+	ttff_bench_dump();
+
+	if (done_cb == NULL) {
+		return;
+	}
+
+	if (summary_json(json, sizeof(json)) != 0) {
+		LOG_ERR("TTFF benchmark summary does not fit");
+		return;
+	}
+
+	done_cb(json);
+}
+
+void ttff_bench_dump(void)
+{
+	const uint8_t *data = (const uint8_t *)&bench_log;
+	size_t size = sizeof(bench_log.header) +
+		      bench_log.header.count * sizeof(struct bench_record);
+	char line[DUMP_LINE_BYTES * 2 + 1];
+
+	for (size_t offset = 0; offset < size; offset += DUMP_LINE_BYTES) {
+		size_t chunk = MIN(size - offset, DUMP_LINE_BYTES);
+
+		for (size_t i = 0; i < chunk; i++) {
+			snprintf(&line[i * 2], 3, "%02x", data[offset + i]);
+		}
+
+		printk("ttff_bench: %s\n", line);
+	}
+}
+
+int ttff_bench_init(ttff_bench_done_cb_t cb)
+{
+	done_cb = cb;
+	next_index = 0;
+	reported = false;
+
+	memset(&bench_log, 0, sizeof(bench_log));
+	header_init();
+
+	LOG_INF("TTFF benchmark: %u rounds of cold, warm and hot starts, assistance: %s",
+		BENCH_ITERATIONS, assistance_str());
+
+	return 0;
+}
+
+enum ttff_bench_start ttff_bench_next_start(void)
+{
+	if (next_index >= BENCH_RECORDS) {
+		if (!reported) {
+			reported = true;
+			report();
+		}
+
+		return TTFF_BENCH_DONE;
+	}
+
+	/* Start types are interleaved, so that changes in the sky view and network
+	 * conditions during the run affect all of them alike.
+	 */
+	current_start = next_index % TTFF_BENCH_START_COUNT;
+
+	LOG_INF("TTFF benchmark iteration %u/%u, %s start", next_index + 1, BENCH_RECORDS,
+		start_names[current_start]);
+
+	return current_start;
+}
+
+void ttff_bench_record(const struct ttff_bench_result *result)
+{
+	struct bench_record *record;
+
+	if (next_index >= BENCH_RECORDS) {
+		return;
+	}
+
+	record = &bench_log.records[next_index];
+	record->start = current_start;
+	record->flags = result->timeout ? RECORD_FLAG_TIMEOUT : 0;
+	record->ttff_ds = sys_cpu_to_le16(clamp_u16((result->ttff_ms + 50) / 100));
+	record->blocked_s = sys_cpu_to_le16(clamp_u16(result->blocked_s));
+	record->accuracy_dm = sys_cpu_to_le16(result->timeout ? UINT16_MAX :
+							     float_to_dm(result->accuracy));
+	record->error_dm = sys_cpu_to_le16(result->timeout ? UINT16_MAX :
+							  float_to_dm(result->error));
+	record->network_bytes = sys_cpu_to_le16(clamp_u16(result->network_bytes));
+	record->cache_bytes = sys_cpu_to_le16(clamp_u16(result->cache_bytes));
+
+	next_index++;
+	bench_log.header.count = next_index;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_summary(const struct shell *sh, size_t argc, char **argv)
+{
+	struct ttff_bench_summary summary;
+
+	shell_print(sh, "Assistance: %s, %u/%u iterations done", assistance_str(),
+		    bench_log.header.count, BENCH_RECORDS);
+
+	for (int start = 0; start < TTFF_BENCH_START_COUNT; start++) {
+		(void)ttff_bench_summary_get(start, &summary);
+
+		shell_print(sh, "%-4s runs %2u timeouts %2u | TTFF ms p50 %6u p90 %6u max %6u | "
+			    "blocked s p50 %3u p90 %3u | download B p50 %5u p90 %5u | "
+			    "accuracy dm p50 %4u p90 %4u",
+			    start_names[start], summary.runs, summary.timeouts,
+			    summary.ttff_ms.p50, summary.ttff_ms.p90, summary.ttff_ms.max,
+			    summary.blocked_s.p50, summary.blocked_s.p90,
+			    summary.network_bytes.p50, summary.network_bytes.p90,
+			    summary.accuracy_dm.p50, summary.accuracy_dm.p90);
+	}
+
+	return 0;
+}
+
+static int cmd_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	ttff_bench_dump();
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(ttff_bench_cmds,
+	SHELL_CMD(summary, NULL, "Print TTFF percentiles per start type", cmd_summary),
+	SHELL_CMD(dump, NULL, "Print the binary log as hex", cmd_dump),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(ttff_bench, &ttff_bench_cmds, "TTFF benchmark", NULL);
+#endif /* CONFIG_SHELL */
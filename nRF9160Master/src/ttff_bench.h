@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef TTFF_BENCH_H_
+#define TTFF_BENCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum ttff_bench_start {
+	TTFF_BENCH_COLD,  /* No GNSS data except the TCXO offset (and factory almanac) */
+	TTFF_BENCH_WARM,  /* Ephemerides deleted */
+	TTFF_BENCH_HOT,   /* Nothing deleted */
+	TTFF_BENCH_START_COUNT,
+	TTFF_BENCH_DONE = TTFF_BENCH_START_COUNT,
+};
+
+/** Result of one benchmark iteration. */
+struct ttff_bench_result {
+	uint32_t ttff_ms;
+	uint32_t blocked_s;      /* Seconds GNSS was blocked by LTE */
+	uint32_t network_bytes;  /* Downloaded assistance injected to GNSS */
+	uint32_t cache_bytes;    /* Cached assistance injected to GNSS */
+	float accuracy;          /* Estimated accuracy of the fix in meters */
+	float error;             /* Distance from the reference position, < 0 if not set */
+	bool timeout;            /* No fix within CONFIG_GNSS_SAMPLE_TTFF_BENCH_TIMEOUT */
+};
+
+struct ttff_bench_stat {
+	uint32_t p50;
+	uint32_t p90;
+	uint32_t max;
+};
+
+/** Percentiles over the iterations with a fix. */
+struct ttff_bench_summary {
+	uint8_t runs;
+	uint8_t timeouts;
+	struct ttff_bench_stat ttff_ms;
+	struct ttff_bench_stat blocked_s;
+	struct ttff_bench_stat network_bytes;
+	struct ttff_bench_stat accuracy_dm;
+};
+
+/**
+ * @brief Called when all iterations are done.
+ *
+ * @param[in] json Summary as a JSON string, valid during the call.
+ */
+typedef void (*ttff_bench_done_cb_t)(const char *json);
+
+/**
+ * @brief Initializes the TTFF benchmark.
+ *
+ * @details The benchmark runs CONFIG_GNSS_SAMPLE_TTFF_BENCH_ITERATIONS rounds of a cold,
+ *          a warm and a hot start. Results are kept in a compact binary log, which is
+ *          printed together with the summary when the benchmark is done. Each build
+ *          benchmarks the assistance method it was configured with.
+ *
+ * @param[in] cb Called with the summary when the benchmark is done, may be NULL.
+ *
+ * @retval 0 on success.
+ * @retval <0 in case of an error.
+ */
+int ttff_bench_init(ttff_bench_done_cb_t cb);
+
+/**
+ * @brief Returns the start type for the next iteration.
+ *
+ * @details Reports the results when all iterations are done.
+ *
+ * @retval Start type, or TTFF_BENCH_DONE when all iterations are done.
+ */
+enum ttff_bench_start ttff_bench_next_start(void);
+
+/**
+ * @brief Records the result of the current iteration.
+ *
+ * @param[in] result Iteration result.
+ */
+void ttff_bench_record(const struct ttff_bench_result *result);
+
+/**
+ * @brief Calculates the summary of one start type.
+ *
+ * @param[in] start Start type.
+ * @param[out] summary Summary.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the start type is invalid.
+ */
+int ttff_bench_summary_get(enum ttff_bench_start start, struct ttff_bench_summary *summary);
+
+/**
+ * @brief Prints the binary log as hex lines prefixed with "ttff_bench:".
+ *
+ * @details scripts/ttff_bench_decode.py decodes the lines from a console capture.
+ */
+void ttff_bench_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TTFF_BENCH_H_ */
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <zephyr/logging/log.h>
+#include <nrf_modem_gnss.h>
+
+#include "assistance_cache.h"
+
+LOG_MODULE_REGISTER(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+#define SEC_PER_HOUR		(60UL * 60UL)
+#define SEC_PER_DAY		(24UL * SEC_PER_HOUR)
+#define SEC_PER_WEEK		(7UL * SEC_PER_DAY)
+#define EPHE_TOE_SCALE		16
+
+/* Start of an arbitrary GPS week, in GPS seconds. */
+#define WEEK_START		(2200UL * SEC_PER_WEEK)
+/* Keeps checks clear of the time passing while the test runs. */
+#define MARGIN_SEC		10
+
+/* Satellites of each test, so that the tests do not see each other's entries. */
+#define SV_NO_TIME		10
+#define SV_EXPIRY		1
+#define SV_TOE_AHEAD		2
+#define SV_WRAP_BACK		5
+#define SV_WRAP_FORWARD		6
+#define SV_ALM			7
+#define SV_REJECTED		3
+#define SV_STATS		4
+
+int32_t __wrap_nrf_modem_gnss_agps_write(void *buf, int32_t buf_len, uint16_t type);
+
+/* GNSS as seen by the cache, records what reaches it. */
+static int32_t gnss_write_err;
+static uint32_t gnss_writes;
+static struct nrf_modem_gnss_agps_data_ephemeris gnss_last_ephe;
+
+int32_t __real_nrf_modem_gnss_agps_write(void *buf, int32_t buf_len, uint16_t type)
+{
+	if (gnss_write_err) {
+		return gnss_write_err;
+	}
+
+	gnss_writes++;
+
+	if (type == NRF_MODEM_GNSS_AGPS_EPHEMERIDES && buf_len == sizeof(gnss_last_ephe)) {
+		memcpy(&gnss_last_ephe, buf, sizeof(gnss_last_ephe));
+	}
+
+	return 0;
+}
+
+static void gps_time_set(uint32_t gps_sec)
+{
+	struct nrf_modem_gnss_agps_data_system_time_and_sv_tow time = {
+		.date_day = gps_sec / SEC_PER_DAY,
+		.time_full_s = gps_sec % SEC_PER_DAY
+	};
+
+	zassert_ok(__wrap_nrf_modem_gnss_agps_write(&time, sizeof(time),
+						    NRF_MODEM_GNSS_AGPS_GPS_SYSTEM_CLOCK_AND_TOWS));
+}
+
+static int32_t ephe_download(uint8_t sv_id, uint32_t toe_tow)
+{
+	struct nrf_modem_gnss_agps_data_ephemeris ephe = {
+		.sv_id = sv_id,
+		.toe = toe_tow / EPHE_TOE_SCALE
+	};
+
+	return __wrap_nrf_modem_gnss_agps_write(&ephe, sizeof(ephe),
+						NRF_MODEM_GNSS_AGPS_EPHEMERIDES);
+}
+
+static bool ephe_served(uint8_t sv_id)
+{
+	struct nrf_modem_gnss_agps_data_frame request = {
+		.sv_mask_ephe = BIT(sv_id - 1)
+	};
+
+	memset(&gnss_last_ephe, 0, sizeof(gnss_last_ephe));
+	assistance_cache_trim(&request);
+
+	/* Served means cleared from the request and written to GNSS. */
+	return request.sv_mask_ephe == 0 && gnss_last_ephe.sv_id == sv_id;
+}
+
+static int init_err;
+static int no_time_err;
+
+static void *assistance_cache_setup(void)
+{
+	init_err = assistance_cache_init();
+
+	/* Runs before any test sets the time, nothing can be cached yet. */
+	no_time_err = ephe_download(SV_NO_TIME, 0);
+
+	return NULL;
+}
+
+ZTEST(assistance_cache, test_no_time_not_cached)
+{
+	zassert_ok(init_err);
+	zassert_ok(no_time_err);
+
+	gps_time_set(WEEK_START);
+
+	zassert_false(ephe_served(SV_NO_TIME));
+}
+
+ZTEST(assistance_cache, test_ephe_expiry)
+{
+	uint32_t now = WEEK_START + 3 * SEC_PER_DAY;
+	uint32_t toe = now - WEEK_START;
+
+	gps_time_set(now);
+	zassert_ok(ephe_download(SV_EXPIRY, toe));
+	zassert_ok(ephe_download(SV_TOE_AHEAD, toe + SEC_PER_HOUR));
+
+	zassert_true(ephe_served(SV_EXPIRY));
+	zassert_true(ephe_served(SV_TOE_AHEAD));
+
+	/* Valid until two hours after toe. */
+	gps_time_set(now + 2 * SEC_PER_HOUR - MARGIN_SEC);
+	zassert_true(ephe_served(SV_EXPIRY));
+
+	gps_time_set(now + 2 * SEC_PER_HOUR + MARGIN_SEC);
+	zassert_false(ephe_served(SV_EXPIRY));
+	zassert_true(ephe_served(SV_TOE_AHEAD));
+
+	gps_time_set(now + 3 * SEC_PER_HOUR + MARGIN_SEC);
+	zassert_false(ephe_served(SV_TOE_AHEAD));
+}
+
+ZTEST(assistance_cache, test_ephe_week_wrap)
+{
+	/* Early in the week, toe late in the previous week. */
+	uint32_t now = WEEK_START + 600;
+	uint32_t toe_tow = SEC_PER_WEEK - 1200;
+	uint32_t expiry = WEEK_START - 1200 + 2 * SEC_PER_HOUR;
+
+	gps_time_set(now);
+	zassert_ok(ephe_download(SV_WRAP_BACK, toe_tow));
+	zassert_true(ephe_served(SV_WRAP_BACK));
+
+	gps_time_set(expiry - MARGIN_SEC);
+	zassert_true(ephe_served(SV_WRAP_BACK));
+
+	gps_time_set(expiry + MARGIN_SEC);
+	zassert_false(ephe_served(SV_WRAP_BACK));
+
+	/* Late in the week, toe early in the next week. */
+	now = WEEK_START + SEC_PER_WEEK - 600;
+	toe_tow = 1200;
+	expiry = WEEK_START + SEC_PER_WEEK + 1200 + 2 * SEC_PER_HOUR;
+
+	gps_time_set(now);
+	zassert_ok(ephe_download(SV_WRAP_FORWARD, toe_tow));
+	zassert_true(ephe_served(SV_WRAP_FORWARD));
+
+	gps_time_set(expiry - MARGIN_SEC);
+	zassert_true(ephe_served(SV_WRAP_FORWARD));
+
+	gps_time_set(expiry + MARGIN_SEC);
+	zassert_false(ephe_served(SV_WRAP_FORWARD));
+}
+
+ZTEST(assistance_cache, test_alm_klob_utc_expiry)
+{
+	struct nrf_modem_gnss_agps_data_almanac alm = { .sv_id = SV_ALM };
+	struct nrf_modem_gnss_agps_data_klobuchar klob = {0};
+	struct nrf_modem_gnss_agps_data_utc utc = {0};
+	struct nrf_modem_gnss_agps_data_frame request;
+	uint32_t now = WEEK_START + SEC_PER_DAY;
+	const uint32_t flags = NRF_MODEM_GNSS_AGPS_KLOBUCHAR_REQUEST |
+			       NRF_MODEM_GNSS_AGPS_GPS_UTC_REQUEST;
+	const struct {
+		uint32_t after;
+		bool alm;
+		bool klob;
+		bool utc;
+	} checks[] = {
+		{ 23 * SEC_PER_HOUR, true, true, true },
+		{ 25 * SEC_PER_HOUR, true, false, true },
+		{ 8 * SEC_PER_DAY, true, false, false },
+		{ 15 * SEC_PER_DAY, false, false, false },
+	};
+
+	gps_time_set(now);
+	zassert_ok(__wrap_nrf_modem_gnss_agps_write(&alm, sizeof(alm),
+						    NRF_MODEM_GNSS_AGPS_ALMANAC));
+	zassert_ok(__wrap_nrf_modem_gnss_agps_write(&klob, sizeof(klob),
+				NRF_MODEM_GNSS_AGPS_KLOBUCHAR_IONOSPHERIC_CORRECTION));
+	zassert_ok(__wrap_nrf_modem_gnss_agps_write(&utc, sizeof(utc),
+						    NRF_MODEM_GNSS_AGPS_UTC_PARAMETERS));
+
+	for (size_t i = 0; i < ARRAY_SIZE(checks); i++) {
+		gps_time_set(now + checks[i].after);
+
+		request.sv_mask_ephe = 0;
+		request.sv_mask_alm = BIT(SV_ALM - 1);
+		request.data_flags = flags;
+		assistance_cache_trim(&request);
+
+		zassert_equal(request.sv_mask_alm == 0, checks[i].alm, "almanac, check %zu", i);
+		zassert_equal(!(request.data_flags & NRF_MODEM_GNSS_AGPS_KLOBUCHAR_REQUEST),
+			      checks[i].klob, "Klobuchar, check %zu", i);
+		zassert_equal(!(request.data_flags & NRF_MODEM_GNSS_AGPS_GPS_UTC_REQUEST),
+			      checks[i].utc, "UTC, check %zu", i);
+	}
+}
+
+ZTEST(assistance_cache, test_rejected_not_cached)
+{
+	gps_time_set(WEEK_START + 2 * SEC_PER_DAY);
+
+	gnss_write_err = -EINVAL;
+	zassert_equal(ephe_download(SV_REJECTED, 2 * SEC_PER_DAY), -EINVAL);
+	gnss_write_err = 0;
+
+	zassert_false(ephe_served(SV_REJECTED));
+}
+
+ZTEST(assistance_cache, test_partial_request_and_stats)
+{
+	struct assistance_cache_stats before;
+	struct assistance_cache_stats after;
+	struct nrf_modem_gnss_agps_data_frame request = {
+		.sv_mask_ephe = BIT(SV_STATS - 1) | BIT(SV_REJECTED - 1)
+	};
+	uint32_t now = WEEK_START + 4 * SEC_PER_DAY;
+	uint32_t writes;
+
+	gps_time_set(now);
+	assistance_cache_stats_get(&before);
+	zassert_ok(ephe_download(SV_STATS, now - WEEK_START));
+
+	writes = gnss_writes;
+	assistance_cache_trim(&request);
+
+	/* Only the cached SV is served, the other one is still to be downloaded. */
+	zassert_equal(request.sv_mask_ephe, BIT(SV_REJECTED - 1));
+	zassert_equal(gnss_writes - writes, 1);
+	zassert_equal(gnss_last_ephe.sv_id, SV_STATS);
+
+	assistance_cache_stats_get(&after);
+	zassert_equal(after.network_bytes - before.network_bytes,
+		      sizeof(struct nrf_modem_gnss_agps_data_ephemeris));
+	zassert_equal(after.cache_bytes - before.cache_bytes,
+		      sizeof(struct nrf_modem_gnss_agps_data_ephemeris));
+	zassert_equal(after.cache_hits - before.cache_hits, 1);
+
+	/* Boot injection serves everything still valid, this SV included. */
+	zassert_true(assistance_cache_inject() >= 1);
+}
+
+ZTEST_SUITE(assistance_cache, NULL, assistance_cache_setup, NULL, NULL, NULL);
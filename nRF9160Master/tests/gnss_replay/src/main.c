@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <zephyr/logging/log.h>
+#include <nrf_modem_gnss.h>
+
+#include "gnss_replay.h"
+
+LOG_MODULE_REGISTER(gnss_sample, CONFIG_GNSS_SAMPLE_LOG_LEVEL);
+
+/* Contents of scripts/gnss_replay_walk.nmea, as reported by gnss_trace_gen.py. */
+#define TRACE_EPOCHS		90
+#define TRACE_FIXES		65
+#define TRACE_SENTENCES		510
+#define TRACE_LENGTH_MS		89000
+
+/* The walk stays within a few hundred meters. */
+#define WALK_LAT_MIN		61.48
+#define WALK_LAT_MAX		61.50
+#define WALK_LON_MIN		23.76
+#define WALK_LON_MAX		23.78
+
+struct replay_result {
+	uint32_t pvt;
+	uint32_t fixes;
+	uint32_t nmea;
+	uint32_t agps_req;
+	uint32_t bad_position;   /* Fix outside of the walk */
+	uint32_t bad_order;      /* Fix event without a valid PVT before it */
+	uint32_t bad_gga;        /* GGA fix quality not matching the PVT of its epoch */
+	uint32_t bad_agps;       /* A-GPS request not asking for everything */
+};
+
+static struct replay_result result;
+static bool last_pvt_fix;
+
+static void pvt_check(void)
+{
+	struct nrf_modem_gnss_pvt_data_frame pvt;
+
+	if (nrf_modem_gnss_read(&pvt, sizeof(pvt), NRF_MODEM_GNSS_DATA_PVT) != 0) {
+		return;
+	}
+
+	result.pvt++;
+	last_pvt_fix = pvt.flags & NRF_MODEM_GNSS_PVT_FLAG_FIX_VALID;
+
+	if (last_pvt_fix &&
+	    (pvt.latitude < WALK_LAT_MIN || pvt.latitude > WALK_LAT_MAX ||
+	     pvt.longitude < WALK_LON_MIN || pvt.longitude > WALK_LON_MAX)) {
+		result.bad_position++;
+	}
+}
+
+static void nmea_check(void)
+{
+	struct nrf_modem_gnss_nmea_data_frame nmea;
+	const char *quality;
+
+	if (nrf_modem_gnss_read(&nmea, sizeof(nmea), NRF_MODEM_GNSS_DATA_NMEA) != 0) {
+		return;
+	}
+
+	result.nmea++;
+
+	if (strncmp(nmea.nmea_str, "$GPGGA,", 7) != 0) {
+		return;
+	}
+
+	/* Fix quality is the sixth field. */
+	quality = nmea.nmea_str;
+	for (int i = 0; i < 6 && quality != NULL; i++) {
+		quality = strchr(quality + 1, ',');
+	}
+
+	if (quality == NULL || (quality[1] != '0') != last_pvt_fix) {
+		result.bad_gga++;
+	}
+}
+
+static void agps_check(void)
+{
+	struct nrf_modem_gnss_agps_data_frame agps;
+
+	if (nrf_modem_gnss_read(&agps, sizeof(agps), NRF_MODEM_GNSS_DATA_AGPS_REQ) != 0) {
+		return;
+	}
+
+	result.agps_req++;
+
+	if (agps.sv_mask_ephe != UINT32_MAX || agps.sv_mask_alm != UINT32_MAX) {
+		result.bad_agps++;
+	}
+}
+
+/* Runs in the replay thread, results are checked by the test when the trace is done. */
+static void gnss_event_handler(int event)
+{
+	switch (event) {
+	case NRF_MODEM_GNSS_EVT_PVT:
+		pvt_check();
+		break;
+
+	case NRF_MODEM_GNSS_EVT_FIX:
+		result.fixes++;
+		if (!last_pvt_fix) {
+			result.bad_order++;
+		}
+		break;
+
+	case NRF_MODEM_GNSS_EVT_NMEA:
+		nmea_check();
+		break;
+
+	case NRF_MODEM_GNSS_EVT_AGPS_REQ:
+		agps_check();
+		break;
+
+	default:
+		break;
+	}
+}
+
+ZTEST(gnss_replay, test_continuous_trace)
+{
+	struct gnss_replay_stats stats;
+	int64_t timeout;
+
+	zassert_ok(nrf_modem_gnss_event_handler_set(gnss_event_handler));
+	zassert_ok(nrf_modem_gnss_fix_interval_set(1));
+	zassert_ok(nrf_modem_gnss_nmea_mask_set(NRF_MODEM_GNSS_NMEA_GGA_MASK |
+						NRF_MODEM_GNSS_NMEA_GSA_MASK |
+						NRF_MODEM_GNSS_NMEA_GSV_MASK |
+						NRF_MODEM_GNSS_NMEA_RMC_MASK));
+	zassert_ok(nrf_modem_gnss_start());
+
+	/* Twice the replay time at CONFIG_GNSS_SAMPLE_REPLAY_SPEED. */
+	timeout = k_uptime_get() + 2 * TRACE_LENGTH_MS / CONFIG_GNSS_SAMPLE_REPLAY_SPEED;
+	do {
+		k_sleep(K_MSEC(100));
+		gnss_replay_stats_get(&stats);
+	} while (stats.loops == 0 && k_uptime_get() < timeout);
+
+	zassert_ok(nrf_modem_gnss_stop());
+
+	TC_PRINT("%u PVT, %u fixes, %u NMEA, %u A-GPS requests, max lag %u ms\n",
+		 stats.pvt, stats.fixes, stats.nmea, stats.agps_req, stats.max_lag_ms);
+
+	zassert_equal(stats.loops, 1, "Trace not replayed in time");
+	zassert_equal(stats.skipped, 0, "Records skipped in continuous tracking");
+
+	/* Everything in the trace reaches the application, once. */
+	zassert_equal(result.pvt, TRACE_EPOCHS);
+	zassert_equal(result.fixes, TRACE_FIXES);
+	zassert_equal(result.nmea, TRACE_SENTENCES);
+	zassert_equal(result.agps_req, 1);
+	zassert_equal(stats.pvt, result.pvt);
+	zassert_equal(stats.fixes, result.fixes);
+	zassert_equal(stats.nmea, result.nmea);
+	zassert_equal(stats.agps_req, result.agps_req);
+
+	zassert_equal(result.bad_position, 0, "%u fixes outside of the walk",
+		      result.bad_position);
+	zassert_equal(result.bad_order, 0, "%u fix events without a fix", result.bad_order);
+	zassert_equal(result.bad_gga, 0, "%u GGA sentences disagree with PVT", result.bad_gga);
+	zassert_equal(result.bad_agps, 0, "A-GPS request doesn't ask for all data");
+}
+
+ZTEST_SUITE(gnss_replay, NULL, NULL, NULL, NULL, NULL);
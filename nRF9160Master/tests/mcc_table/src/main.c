@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/ztest.h>
+
+#include "mcc_location_table.h"
+#include "mcc_location_data.h"
+#include "mcc_table_legacy.h"
+#include "BenchClock.h"
+
+#define MCC_COUNT 1000
+#define BENCH_ROUNDS 200
+
+ZTEST(mcc_table, test_equivalence)
+{
+	struct mcc_location location;
+	const struct legacy_mcc_table *legacy;
+	uint32_t found = 0;
+
+	for (uint16_t mcc = 0; mcc < MCC_COUNT; mcc++) {
+		legacy = legacy_mcc_lookup(mcc);
+
+		if (legacy == NULL) {
+			zassert_equal(mcc_lookup(mcc, &location), -ENOENT, "MCC %u added", mcc);
+			continue;
+		}
+
+		zassert_ok(mcc_lookup(mcc, &location), "MCC %u missing", mcc);
+		zassert_equal(location.mcc, mcc);
+		zassert_equal(location.lat, lat_convert(legacy->lat), "Latitude of MCC %u", mcc);
+		zassert_equal(location.lon, lon_convert(legacy->lon), "Longitude of MCC %u", mcc);
+		zassert_equal(location.confidence, legacy->confidence, "MCC %u", mcc);
+		zassert_equal(location.unc_semiminor, legacy->unc_semiminor, "MCC %u", mcc);
+		zassert_equal(location.unc_semimajor, legacy->unc_semimajor, "MCC %u", mcc);
+		zassert_equal(location.orientation, legacy->orientation, "MCC %u", mcc);
+		found++;
+	}
+
+	zassert_equal(found, mcc_rows_count);
+	TC_PRINT("%u MCCs match, %u bytes of rows before, %u now\n", found,
+		 (uint32_t)legacy_mcc_table_size(),
+		 (uint32_t)(mcc_rows_count * sizeof(struct mcc_row)));
+}
+
+ZTEST(mcc_table, test_lookup_time)
+{
+	struct mcc_location location;
+	const struct legacy_mcc_table *legacy;
+	volatile int32_t sink = 0;
+	uint64_t start;
+	uint64_t legacy_ns;
+	uint64_t table_ns;
+
+	start = BenchNowNs();
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		for (uint16_t mcc = 0; mcc < MCC_COUNT; mcc++) {
+			legacy = legacy_mcc_lookup(mcc);
+			if (legacy) {
+				sink += lat_convert(legacy->lat) + lon_convert(legacy->lon);
+			}
+		}
+	}
+	legacy_ns = BenchNowNs() - start;
+
+	start = BenchNowNs();
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		for (uint16_t mcc = 0; mcc < MCC_COUNT; mcc++) {
+			if (mcc_lookup(mcc, &location) == 0) {
+				sink += location.lat + location.lon;
+			}
+		}
+	}
+	table_ns = BenchNowNs() - start;
+
+	TC_PRINT("lookup and convert: %u ns before, %u ns now (%s)\n",
+		 (uint32_t)(legacy_ns / (BENCH_ROUNDS * MCC_COUNT)),
+		 (uint32_t)(table_ns / (BENCH_ROUNDS * MCC_COUNT)),
+		 IS_ENABLED(CONFIG_GNSS_SAMPLE_MCC_TABLE_DENSE) ? "dense index" : "binary search");
+}
+
+ZTEST_SUITE(mcc_table, NULL, NULL, NULL, NULL, NULL);
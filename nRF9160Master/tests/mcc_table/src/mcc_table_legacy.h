@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef MCC_TABLE_LEGACY_H_
+#define MCC_TABLE_LEGACY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct __attribute__ ((__packed__)) legacy_mcc_table {
+	uint8_t confidence;
+	uint8_t unc_semiminor;
+	uint8_t unc_semimajor;
+	uint8_t orientation;
+	float lat;
+	float lon;
+	uint16_t mcc;
+};
+
+const struct legacy_mcc_table *legacy_mcc_lookup(uint16_t mcc);
+size_t legacy_mcc_table_size(void);
+
+#endif /* MCC_TABLE_LEGACY_H_ */
@@ -0,0 +1,195 @@
+/**
+ * @file    : AppDouble.c
+ * @brief   : Stand-in for the parts of the 9160 application around the BLE link
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @ref     : AppDouble.h
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/uart.h>
+#include "AppDouble.h"
+#include "BLE/BleHandler.h"
+#include "System/SystemHandler.h"
+
+/*******************************************MACROS**********************************************************/
+/*Same depth and line size as WiFiHandler*/
+#define MSG_SIZE        255
+#define MSG_COUNT       10
+/*Same as SystemHandler*/
+#define SYSTEM_IDLE_MS  1000
+
+/******************************************PRIVATE GLOBALS**************************************************/
+static const struct device *WiFiUart = DEVICE_DT_GET(DT_NODELABEL(uart1));
+static char cRxLine[MSG_SIZE];
+static uint16_t usRxIdx = 0;
+static _sGnssConfig sGnssConfig = {61.488100, 23.771310, true};
+static _sAppDoubleStats sAppStats = {0};
+
+K_MSGQ_DEFINE(UartMsgQueue, MSG_SIZE, MSG_COUNT, 4);
+K_SEM_DEFINE(SystemWakeSem, 0, 1);
+
+static void HandleLocation(const _sCmd *psCmd);
+
+/*Commands answered by the 9160, as in PacketHandler*/
+static const cmdExecHandler pCmdHandlers[CMD_OPCODE_MAX] = {
+    [CMD_LOCATION]      = HandleLocation,
+};
+
+static const _sPacketHandlers sPacketHandlers = {
+    .pCmdHandlers       = pCmdHandlers,
+};
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/**
+ * @brief       : Assemble DA16200 lines into UartMsgQueue, like WiFiHandler
+ * @param [in]  : dev - UART handle
+ * @param [out] : user_data - unused
+ * @return      : None
+*/
+static void WiFiRxCb(const struct device *dev, void *user_data)
+{
+    uint8_t ucByte = 0;
+
+    if (!uart_irq_update(dev) || !uart_irq_rx_ready(dev))
+    {
+        return;
+    }
+
+    while (uart_fifo_read(dev, &ucByte, 1) == 1)
+    {
+        if (ucByte == '\r' || ucByte == '\n')
+        {
+            if (usRxIdx)
+            {
+                cRxLine[usRxIdx] = '\0';
+                usRxIdx = 0;
+
+                if (k_msgq_put(&UartMsgQueue, cRxLine, K_NO_WAIT) != 0)
+                {
+                    sAppStats.ulLineDrops++;
+                }
+
+                SystemWake();
+            }
+        }
+        else if (usRxIdx < sizeof(cRxLine) - 1)
+        {
+            cRxLine[usRxIdx++] = ucByte;
+        }
+    }
+}
+
+/**
+ * @brief       : Answer LOCATION with the fixed location
+ * @param [in]  : psCmd - decoded command
+ * @param [out] : None
+ * @return      : None
+*/
+static void HandleLocation(const _sCmd *psCmd)
+{
+    sAppStats.ulLocationCmds++;
+
+    if (SendLocationToBle())
+    {
+        sAppStats.ulLocationResps++;
+    }
+}
+
+/**
+ * @brief       : Location read by BleHandler, fixed in the test
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : location
+*/
+_sGnssConfig *GetLocationData()
+{
+    return &sGnssConfig;
+}
+
+/**
+ * @brief       : Wake the stand-in of the system task, as SystemHandler
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : None
+*/
+void SystemWake(void)
+{
+    k_sem_give(&SystemWakeSem);
+}
+
+/**
+ * @brief       : Initialise both UARTs
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true for success
+*/
+bool AppDoubleInit(void)
+{
+    if (!device_is_ready(WiFiUart) ||
+        uart_irq_callback_user_data_set(WiFiUart, WiFiRxCb, NULL) != 0)
+    {
+        return false;
+    }
+
+    uart_irq_rx_enable(WiFiUart);
+
+    return InitBleUart();
+}
+
+/**
+ * @brief       : Send CONNECT to 52840
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : true if accepted by the link window
+*/
+bool AppDoubleConnect(void)
+{
+    uint8_t ucPayload[DATA_SIZE] = {0};
+    _sPacket sPacket = {0};
+    _sCmd sCmd = {.eId = CMD_CONNECT};
+    uint16_t usLen = 0;
+
+    usLen = CmdEncode(&sCmd, ucPayload, sizeof(ucPayload));
+
+    return usLen && BuildPacket(&sPacket, CMD, ucPayload, usLen) && SendPacket(&sPacket);
+}
+
+/**
+ * @brief       : One pass of the system task: BLE packets, then DA16200
+ *                lines, then wait for more as SystemWait
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : None
+*/
+void AppDoubleProcess(void)
+{
+    _sPacket sPacket = {0};
+    char cLine[MSG_SIZE];
+
+    while (ReadPacket(&sPacket))
+    {
+        PacketDispatch(&sPacket, &sPacketHandlers);
+    }
+
+    while (0 == k_msgq_get(&UartMsgQueue, cLine, K_NO_WAIT))
+    {
+        sAppStats.ulLines++;
+    }
+
+    (void)k_sem_take(&SystemWakeSem, K_MSEC(MIN(BleLinkWaitMs(), SYSTEM_IDLE_MS)));
+}
+
+/**
+ * @brief       : Get counters of the application stand-in
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : statistics
+*/
+const _sAppDoubleStats *GetAppDoubleStats(void)
+{
+    return &sAppStats;
+}
+
+//EOF
@@ -0,0 +1,38 @@
+/**
+ * @file    : AppDouble.h
+ * @brief   : Stand-in for the parts of the 9160 application around the BLE link
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @see     : AppDouble.c
+ * @note    : SystemHandler, PacketHandler and WiFiHandler pull in LTE, AWS
+ *            and settings, none of which runs on native_sim. BleHandler is
+ *            built unchanged, this file gives it a location to answer with
+ *            and SystemWake, and gives SimDa16200 and LoadGen the
+ *            UartMsgQueue of WiFiHandler.
+*/
+
+#ifndef _APP_DOUBLE_H
+#define _APP_DOUBLE_H
+
+/*********************************************INCLUDES***************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/**********************************************TYPEDEFS***************************************************/
+typedef struct __sAppDoubleStats
+{
+    uint32_t ulLines;               //DA16200 lines taken from UartMsgQueue
+    uint32_t ulLineDrops;           //Lines lost on a full UartMsgQueue
+    uint32_t ulLocationCmds;        //LOCATION commands from 52840
+    uint32_t ulLocationResps;       //Responses accepted by the link window
+}_sAppDoubleStats;
+
+/***********************************************FUNCTION DECLARATIONS**************************************/
+bool AppDoubleInit(void);
+bool AppDoubleConnect(void);
+void AppDoubleProcess(void);
+const _sAppDoubleStats *GetAppDoubleStats(void);
+
+#endif
+
+//EOF
@@ -0,0 +1,108 @@
+/**
+ * @file    : main.c
+ * @brief   : Load generator against the simulated DA16200 and 52840
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @note    : LoadGen, SimPeer, SimDa16200 and BleHandler are the application
+ *            sources, built unchanged. The test thread plays SystemTask,
+ *            see AppDouble.c. Time is simulated, the load window takes
+ *            well under a second on the host.
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <zephyr/ztest.h>
+#include "AppDouble.h"
+#include "BLE/BleHandler.h"
+#include "Sim/LoadGen.h"
+#include "Sim/SimPeer.h"
+#include "Sim/SimDa16200.h"
+
+/*******************************************MACROS**********************************************************/
+#define CONNECT_TIMEOUT_MS  5000
+#define LOAD_MS             (30 * MSEC_PER_SEC)
+/*Commands still queued or in flight when the window closes*/
+#define LOAD_IN_FLIGHT      (LINK_WINDOW_SIZE + 2)
+/*Timed command given up after, see SimPeer.c*/
+#define RESP_TIMEOUT_MS     1000
+/*Window full refusals allowed with injected bit errors*/
+#define REFUSED_MAX_PCT     2
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+ZTEST(sim_load, test_load)
+{
+    const _sAppDoubleStats *psApp = GetAppDoubleStats();
+    const _sSimPeerStats *psPeer = GetSimPeerStats();
+    const _sSimDaStats *psDa = GetSimDaStats();
+    const _sLoadGenStats *psLoad = GetLoadGenStats();
+    const _sFrameStats *psFrames = GetBleFrameStats();
+    int64_t llStart = 0;
+    uint32_t ulRequested = 0;
+    uint32_t ulUrcs = 0;
+
+    zassert_true(AppDoubleInit(), "UARTs not ready");
+    zassert_true(AppDoubleConnect(), "CONNECT refused");
+
+    llStart = k_uptime_get();
+    while (!SimPeerIsConnected() && (k_uptime_get() - llStart) < CONNECT_TIMEOUT_MS)
+    {
+        AppDoubleProcess();
+    }
+
+    zassert_true(SimPeerIsConnected(), "52840 not connected");
+
+    llStart = k_uptime_get();
+    while ((k_uptime_get() - llStart) < LOAD_MS)
+    {
+        AppDoubleProcess();
+    }
+
+    ulRequested = psLoad->ulCmdsRequested;
+    ulUrcs = psLoad->ulUrcsSent;
+
+    TC_PRINT("%u cmds requested, %u handled, %u answered, %u refused, %u overrun, %u lost\n",
+             ulRequested, psApp->ulLocationCmds, psPeer->ulResps, psPeer->ulCmdsRefused,
+             psPeer->ulCmdOverruns, psPeer->ulUnanswered);
+    TC_PRINT("latency %u/%u/%u ms, %u retransmits, %u injected errors\n",
+             psPeer->ulLatencyMinMs, psPeer->ulLatencyAvgMs, psPeer->ulLatencyMaxMs,
+             GetSimPeerLinkStats()->ulRetransmits, psPeer->ulCorrupted);
+    TC_PRINT("%u urcs, %u lines taken, %u dropped, %u sent on a full queue\n",
+             ulUrcs, psApp->ulLines, psApp->ulLineDrops, psDa->ulQueueFullLines);
+
+    //Load was actually applied at the configured rates
+    zassert_true(ulRequested >= (LOAD_MS / MSEC_PER_SEC) * CONFIG_PETTAP_SIM_LOAD_CMD_RATE * 9 / 10,
+                 "Load generator behind");
+    zassert_true(ulUrcs >= (LOAD_MS / MSEC_PER_SEC) * CONFIG_PETTAP_SIM_LOAD_URC_RATE * 9 / 10,
+                 "Load generator behind");
+
+    //Throughput: every command accepted by the link reaches the 9160 and is answered in time
+    zassert_true(psApp->ulLocationCmds + psPeer->ulCmdsRefused + LOAD_IN_FLIGHT >= ulRequested,
+                 "%u of %u commands handled", psApp->ulLocationCmds, ulRequested);
+    zassert_equal(psApp->ulLocationResps, psApp->ulLocationCmds, "Responses refused");
+    zassert_true(psPeer->ulLatencyMaxMs < RESP_TIMEOUT_MS);
+
+    //Drops: none on either link, bit errors are recovered by retransmission
+    zassert_equal(psPeer->ulCmdOverruns, 0);
+    zassert_equal(psPeer->ulUnanswered, 0);
+    zassert_equal(psApp->ulLineDrops, 0);
+    zassert_equal(psDa->ulQueueFullLines, 0);
+    zassert_true(psApp->ulLines + 1 >= ulUrcs, "%u of %u lines taken", psApp->ulLines, ulUrcs);
+    zassert_equal(psLoad->sBleQueue.ulFullSamples, 0);
+
+    if (CONFIG_PETTAP_SIM_PEER_CORRUPT_PERMILLE == 0)
+    {
+        zassert_equal(psPeer->ulCmdsRefused, 0);
+        zassert_equal(psFrames->ulCrcErrors + psFrames->ulFramingErrors, 0);
+    }
+    else
+    {
+        //Two losses in a row stall the window long enough to fill it now and then
+        zassert_true(psPeer->ulCmdsRefused * 100 <= ulRequested * REFUSED_MAX_PCT,
+                     "%u of %u commands refused", psPeer->ulCmdsRefused, ulRequested);
+        zassert_true(psPeer->ulCorrupted > 0, "No errors injected");
+        zassert_true(GetSimPeerLinkStats()->ulRetransmits > 0);
+    }
+}
+
+ZTEST_SUITE(sim_load, NULL, NULL, NULL, NULL, NULL);
+
+//EOF
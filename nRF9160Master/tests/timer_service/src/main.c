@@ -0,0 +1,201 @@
+/**
+ * @file    : main.c
+ * @brief   : Timer service expiry order, coalescing and periodic timers
+ * @author  : Adhil
+ * @date    : 19-10-2026
+ * @note    : TimerService.c is built unchanged, expiries run on the system
+ *            work queue while the test thread sleeps. Time is simulated,
+ *            expiries land within LATE_MAX_MS of the time they are
+ *            scheduled for.
+*/
+
+/*******************************************INCLUDES********************************************************/
+#include <zephyr/ztest.h>
+#include "TimerService.h"
+
+/*******************************************MACROS**********************************************************/
+#define TIMER_A         0
+#define TIMER_B         1
+#define TIMER_C         2
+#define TIMER_COUNT     3
+#define LOG_SIZE        16
+/*Work item runs on the next tick after its deadline*/
+#define LATE_MAX_MS     2
+
+#define TEST_HANDLER(Idx)                       \
+    static void Handler##Idx(void)              \
+    {                                           \
+        RecordExpiry(TIMER_##Idx);              \
+    }
+
+/******************************************GLOBALS VARIABLES**********************************************/
+static uint8_t ucLog[LOG_SIZE];
+static uint8_t ucLogLen = 0;
+static uint32_t ulFiredAt[TIMER_COUNT];
+static uint32_t ulStart = 0;
+
+/*****************************************FUNCTION DEFINITION***********************************************/
+/**
+ * @brief      : Note which timer expired and when, relative to the test start
+ * @param [in] : ucIdx - timer
+ * @param [out]: None
+ * @return     : None
+*/
+static void RecordExpiry(uint8_t ucIdx)
+{
+    if (ucLogLen < LOG_SIZE)
+    {
+        ucLog[ucLogLen++] = ucIdx;
+    }
+
+    ulFiredAt[ucIdx] = k_uptime_get_32() - ulStart;
+}
+
+TEST_HANDLER(A)
+TEST_HANDLER(B)
+TEST_HANDLER(C)
+
+static TIMER_SVC_DEFINE(TimerA, HandlerA, NULL, 0);
+static TIMER_SVC_DEFINE(TimerB, HandlerB, NULL, 0);
+static TIMER_SVC_DEFINE(TimerC, HandlerC, NULL, 0);
+
+/**
+ * @brief      : Stop every timer and clear the log
+ * @param [in] : pvFixture - unused
+ * @param [out]: None
+ * @return     : None
+*/
+static void TimerServiceBefore(void *pvFixture)
+{
+    ARG_UNUSED(pvFixture);
+
+    TimerSvcStop(&TimerA);
+    TimerSvcStop(&TimerB);
+    TimerSvcStop(&TimerC);
+    TimerA.ulSlackMs = 0;
+    TimerB.ulSlackMs = 0;
+    TimerC.ulSlackMs = 0;
+    TimerA.ulExpiries = 0;
+
+    memset(ucLog, 0, sizeof(ucLog));
+    memset(ulFiredAt, 0, sizeof(ulFiredAt));
+    ucLogLen = 0;
+    ulStart = k_uptime_get_32();
+}
+
+ZTEST(timer_service, test_deadline_order)
+{
+    TimerSvcStart(&TimerA, 30, 0);
+    TimerSvcStart(&TimerB, 10, 0);
+    TimerSvcStart(&TimerC, 20, 0);
+
+    k_msleep(50);
+
+    zassert_equal(ucLogLen, 3, "%u expiries", ucLogLen);
+    zassert_equal(ucLog[0], TIMER_B);
+    zassert_equal(ucLog[1], TIMER_C);
+    zassert_equal(ucLog[2], TIMER_A);
+    zassert_between_inclusive(ulFiredAt[TIMER_B], 10, 10 + LATE_MAX_MS, "B at %u ms", ulFiredAt[TIMER_B]);
+    zassert_between_inclusive(ulFiredAt[TIMER_C], 20, 20 + LATE_MAX_MS, "C at %u ms", ulFiredAt[TIMER_C]);
+    zassert_between_inclusive(ulFiredAt[TIMER_A], 30, 30 + LATE_MAX_MS, "A at %u ms", ulFiredAt[TIMER_A]);
+
+    //Flag is read once
+    zassert_true(TimerSvcExpired(&TimerA));
+    zassert_false(TimerSvcExpired(&TimerA));
+}
+
+ZTEST(timer_service, test_equal_deadlines_in_start_order)
+{
+    TimerSvcStart(&TimerC, 20, 0);
+    TimerSvcStart(&TimerA, 20, 0);
+    TimerSvcStart(&TimerB, 20, 0);
+
+    k_msleep(30);
+
+    zassert_equal(ucLogLen, 3, "%u expiries", ucLogLen);
+    zassert_equal(ucLog[0], TIMER_C);
+    zassert_equal(ucLog[1], TIMER_A);
+    zassert_equal(ucLog[2], TIMER_B);
+}
+
+ZTEST(timer_service, test_coalesced_within_slack)
+{
+    TimerA.ulSlackMs = 50;
+    TimerB.ulSlackMs = 50;
+    TimerSvcStart(&TimerA, 10, 0);
+    TimerSvcStart(&TimerB, 40, 0);
+
+    //Nothing is run before the slack of the earliest deadline runs out
+    k_msleep(55);
+    zassert_equal(ucLogLen, 0, "%u expiries", ucLogLen);
+
+    k_msleep(10);
+    zassert_equal(ucLogLen, 2, "%u expiries", ucLogLen);
+    zassert_equal(ucLog[0], TIMER_A);
+    zassert_equal(ucLog[1], TIMER_B);
+    zassert_between_inclusive(ulFiredAt[TIMER_A], 60, 60 + LATE_MAX_MS, "A at %u ms", ulFiredAt[TIMER_A]);
+    zassert_between_inclusive(ulFiredAt[TIMER_B], 60, 60 + LATE_MAX_MS, "B at %u ms", ulFiredAt[TIMER_B]);
+}
+
+ZTEST(timer_service, test_later_deadline_with_less_slack)
+{
+    TimerA.ulSlackMs = 100;
+    TimerSvcStart(&TimerA, 10, 0);
+    TimerSvcStart(&TimerB, 30, 0);
+
+    k_msleep(40);
+
+    //B cannot wait, A is taken along
+    zassert_equal(ucLogLen, 2, "%u expiries", ucLogLen);
+    zassert_between_inclusive(ulFiredAt[TIMER_A], 30, 30 + LATE_MAX_MS, "A at %u ms", ulFiredAt[TIMER_A]);
+    zassert_between_inclusive(ulFiredAt[TIMER_B], 30, 30 + LATE_MAX_MS, "B at %u ms", ulFiredAt[TIMER_B]);
+}
+
+ZTEST(timer_service, test_not_coalesced_beyond_slack)
+{
+    TimerA.ulSlackMs = 5;
+    TimerB.ulSlackMs = 50;
+    TimerSvcStart(&TimerA, 10, 0);
+    TimerSvcStart(&TimerB, 40, 0);
+
+    k_msleep(100);
+
+    zassert_equal(ucLogLen, 2, "%u expiries", ucLogLen);
+    zassert_between_inclusive(ulFiredAt[TIMER_A], 15, 15 + LATE_MAX_MS, "A at %u ms", ulFiredAt[TIMER_A]);
+    zassert_between_inclusive(ulFiredAt[TIMER_B], 90, 90 + LATE_MAX_MS, "B at %u ms", ulFiredAt[TIMER_B]);
+}
+
+ZTEST(timer_service, test_periodic_and_stop)
+{
+    TimerSvcStart(&TimerA, 10, 10);
+
+    k_msleep(55);
+    zassert_equal(TimerA.ulExpiries, 5, "%u expiries", TimerA.ulExpiries);
+    zassert_true(TimerSvcExpired(&TimerA));
+
+    TimerSvcStop(&TimerA);
+    k_msleep(30);
+    zassert_equal(TimerA.ulExpiries, 5, "%u expiries", TimerA.ulExpiries);
+    zassert_false(TimerSvcExpired(&TimerA));
+}
+
+ZTEST(timer_service, test_restart_drops_expiry)
+{
+    TimerSvcStart(&TimerA, 10, 0);
+    TimerSvcStart(&TimerB, 50, 0);
+
+    k_msleep(20);
+    TimerSvcStart(&TimerA, 100, 0);
+    zassert_false(TimerSvcExpired(&TimerA));
+
+    //Restarted timer keeps its place behind the earlier deadline
+    k_msleep(110);
+    zassert_equal(ucLogLen, 3, "%u expiries", ucLogLen);
+    zassert_equal(ucLog[1], TIMER_B);
+    zassert_equal(ucLog[2], TIMER_A);
+    zassert_between_inclusive(ulFiredAt[TIMER_A], 120, 120 + LATE_MAX_MS, "A at %u ms", ulFiredAt[TIMER_A]);
+}
+
+ZTEST_SUITE(timer_service, NULL, NULL, TimerServiceBefore, NULL, NULL);
+
+//EOF
@@ -13,10 +13,22 @@
 /************************************MACROS***************************/
 #define DEVICE_NAME             CONFIG_BT_DEVICE_NAME
 #define DEVICE_NAME_LEN         (sizeof(DEVICE_NAME) - 1)
+#define ADV_RETRY_MS            1000
 
 /************************************GLOBALS**************************/
 struct bt_le_ext_adv *adv; //Advertsisement handle
 uint8_t ucAdVertsingBuffer[ADV_BUFF_SIZE] = {0x00, 0x00, 0x00, 0x00, 0x00}; //Advertsising buffer
+static bool bSlowAdv = false;   //Slow advertising while the system sleeps
+static bool bAdvStale = false;  //Running with the other interval
+static uint32_t ulAdvRetryAt = 0;
+
+/*Connectable advertising, fast while active, slow while asleep*/
+static const struct bt_le_adv_param sFastAdvParam =
+    BT_LE_ADV_PARAM_INIT(BT_LE_ADV_OPT_CONNECTABLE, BT_GAP_ADV_FAST_INT_MIN_2,
+                         BT_GAP_ADV_FAST_INT_MAX_2, NULL);
+static const struct bt_le_adv_param sSlowAdvParam =
+    BT_LE_ADV_PARAM_INIT(BT_LE_ADV_OPT_CONNECTABLE, BT_GAP_ADV_SLOW_INT_MIN,
+                         BT_GAP_ADV_SLOW_INT_MAX, NULL);
 
 static const struct bt_data ad[] = {
 	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
@@ -99,7 +111,7 @@ int StartAdvertising(void)
 {
 	int nError = 0;
 
-	nError = bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), NULL, 0);
+	nError = bt_le_adv_start(bSlowAdv ? &sSlowAdvParam : &sFastAdvParam, ad, ARRAY_SIZE(ad), NULL, 0);
 
 	if (nError) 
     {
@@ -114,6 +126,52 @@ int StartAdvertising(void)
 }
 
 
+/**
+ * @brief      : Switch between fast and slow advertising
+ * @param [in] : bSlow - true for slow advertising
+ * @param [out]: None
+ * @return     : None
+*/
+void SetAdvertisingSlow(bool bSlow)
+{
+    if (bSlowAdv != bSlow)
+    {
+        bSlowAdv = bSlow;
+        bAdvStale = true;
+        ulAdvRetryAt = k_uptime_get_32();
+        RefreshAdvertising();
+    }
+}
+
+/**
+ * @brief      : Restart advertising with the current interval, call
+ *               periodically. Advertising resumed by the host after a
+ *               connection keeps the old interval.
+ * @param [in] : None
+ * @param [out]: None
+ * @return     : None
+*/
+void RefreshAdvertising(void)
+{
+    if (!bAdvStale || IsConnected() || (int32_t)(k_uptime_get_32() - ulAdvRetryAt) < 0)
+    {
+        return;
+    }
+
+    //Not an error if advertising is not running
+    (void)bt_le_adv_stop();
+
+    if (StartAdvertising() == 0)
+    {
+        bAdvStale = false;
+    }
+    else
+    {
+        //Connection object may not be released yet
+        ulAdvRetryAt = k_uptime_get_32() + ADV_RETRY_MS;
+    }
+}
+
 /**
  * @brief      : Getting advertising buffer 
  * @param [in] : None 
@@ -26,6 +26,8 @@ bool EnableBLE();
 uint8_t *GetAdvertisingBuffer();
 int InitExtendedAdv(void);
 int StartAdvertising(void);
+void SetAdvertisingSlow(bool bSlow);
+void RefreshAdvertising(void);
 int UpdateAdvertiseData(void);
 bool BleStopAdvertise();
 
@@ -10,6 +10,7 @@
 #include "BleService.h"
 #include "UartHandler.h"
 #include "../System/SystemHandler.h"
+#include "PerfStats.h"
 #include "zephyr/sys/printk.h"
 
 /**************************** MACROS********************************************/
@@ -28,11 +29,16 @@ static struct bt_uuid_128 sUartResponseChara = BT_UUID_INIT_128(
 
 static uint8_t ucSensorData[VND_MAX_LEN + 1] = {0x11,0x22,0x33, 0x44, 0x55};
 static uint8_t ucWriteBuf[100] = {0};
+static uint16_t usWriteLen = 0;
 static bool bNotificationEnabled = false; 
 static bool bConnected = false;
 struct bt_conn *psConnHandle = NULL;
 static bool bRcvdData = false;
 
+PERF_COUNTER_DEFINE(ble_notify_count);
+PERF_COUNTER_DEFINE(ble_notify_bytes);
+PERF_COUNTER_DEFINE(ble_notify_errors);
+
 static void MTUExchangeCb(struct bt_conn *conn, uint8_t att_err,
     					struct bt_gatt_exchange_params *params);
 static void InitiateMTUExcahnge(struct bt_conn *conn);
@@ -78,7 +84,9 @@ static ssize_t CharaWrite(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 
 	memcpy(value + offset, buf, len);
 	memset(ucWriteBuf, 0, sizeof(ucWriteBuf));
-	memcpy(ucWriteBuf, value, len);
+	//Keep room for the terminator, the buffer is printed as a string
+	usWriteLen = (len < sizeof(ucWriteBuf)) ? len : (sizeof(ucWriteBuf) - 1);
+	memcpy(ucWriteBuf, value, usWriteLen);
 	printk("\n\nInside charawrite- %s\n", ucWriteBuf);
 	bRcvdData = true;
 	SetDeviceState(BLE_CONFIG);
@@ -173,6 +181,7 @@ static void connected(struct bt_conn *conn, uint8_t err)
 {
 	bConnected = true;
 	printk("Connected\n");
+	PowerLog("BLE", "CONNECTED");
 	InitiateMTUExcahnge(conn);
 }
 
@@ -189,6 +198,7 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 	bConnected = false;
 	SetDeviceState(BLE_DISCONNECTED);
 	printk("Disconnected (reason 0x%02x)\n", reason);
+	PowerLog("BLE", IsLowPower() ? "ADV_SLOW" : "ADV_FAST");
 }
 
 /**
@@ -213,6 +223,16 @@ int LocationdataNotify(uint8_t *pucSensorData, uint16_t unLen)
     {
 	    nRetVal = bt_gatt_notify(NULL, &PetTapService.attrs[1], 
                                 pucSensorData, unLen);
+
+        if (nRetVal == 0)
+        {
+            PERF_COUNT(ble_notify_count);
+            PERF_ADD(ble_notify_bytes, unLen);
+        }
+        else
+        {
+            PERF_COUNT(ble_notify_errors);
+        }
     }
 
 	return nRetVal;
@@ -242,16 +262,18 @@ bool IsConnected()
 /**
  * @brief 	   : Get received data
  * @param [in] : None
- * @param [out]: None 
- * @return     : pointer to received data
+ * @param [out]: pucData - data written by the phone, at least 100 bytes
+ * @return     : length written by the phone
 */
-void GetRcvdData(uint8_t *pucData)
+uint16_t GetRcvdData(uint8_t *pucData)
 {
 	if (pucData)
 	{
 		memcpy(pucData, ucWriteBuf, sizeof(ucWriteBuf));
 	}
 	printk("\ngetrcvd call bk- %s \n", ucWriteBuf);
+
+	return usWriteLen;
 }
 
 /**
@@ -20,7 +20,7 @@ int LocationdataNotify(uint8_t *pucSensorData, uint16_t unLen);
 void BleSensorDataNotify(const struct bt_gatt_attr *attr, uint16_t value);
 bool IsNotificationenabled();
 bool IsConnected();
-void GetRcvdData(uint8_t *pucData);
+uint16_t GetRcvdData(uint8_t *pucData);
 bool IsDataRcvd();
 void SetRcvdDataStatus(bool bStatus);
 
@@ -14,6 +14,19 @@
 /*******************************************************TYPEDEFS***************************************************/
 
 /*******************************************************PRIVATE VARIABLES******************************************/
+static void HandleConnect(const _sCmd *psCmd);
+static void HandlePowerMode(const _sCmd *psCmd);
+
+/*Commands accepted by the 52840, indexed by opcode*/
+static const cmdExecHandler pCmdHandlers[CMD_OPCODE_MAX] = {
+    [CMD_CONNECT]       = HandleConnect,
+    [CMD_POWER_MODE]    = HandlePowerMode,
+};
+
+static const _sPacketHandlers sPacketHandlers = {
+    .pCmdHandlers       = pCmdHandlers,
+    .RespHdlr           = ProcessResponse,
+};
 
 /*******************************************************PUBLIC VARIABLES*******************************************/
 
@@ -21,50 +34,22 @@
 
 
 /**
- * @brief      : Build Packet to send
- * @param [in] : usLen - Length of the packet
- *             : PcktType - PacketType
- * @param [out]: psPacket - Packet to build
- *             : pucPayload - Payload to send
- * @return     : returns true on success
-*/
-bool BuildPacket(_sPacket *psPacket,_ePacketType PcktType, 
-                uint8_t *pucPayload, uint16_t usPayloadLen)
-{
-    bool bRetVal = false;
-    
-    if (psPacket && pucPayload)
-    {
-        psPacket->ucStartByte = START_BYTE;
-        psPacket->PacketType = PcktType;
-        memcpy(psPacket->pucPayload, pucPayload, usPayloadLen);
-        psPacket->usLen = usPayloadLen;
-        psPacket->ucEndByte = END_BYTE;
-        bRetVal = true;
-    }
-
-    return bRetVal;
-}
-
-/**
- * @brief      : Parse packet received
+ * @brief      : Process packet received
  * @param [in] : None
- * @param [out]: pucRcvdBuffer - Receieved Buffer
- *             : psPacket - Packet received
+ * @param [out]: psPacket - Packet received
  * @return     : true for success
 */
-bool ParsePacket(uint8_t *pucRcvdBuffer, _sPacket *psPacket)
+bool ProcessRcvdPacket(_sPacket *psPacket)
 {
     bool bRetVal = false;
 
-    if (pucRcvdBuffer && psPacket)
+    if (psPacket)
     {
-        printk("Inside parse packet\n\r");
-        for (int i=0; i <=sizeof(_sPacket); i++)
+        if (!PacketDispatch(psPacket, &sPacketHandlers) && psPacket->PacketType == CMD)
         {
-            printk("%02x ", pucRcvdBuffer[i]);
+            printk("ERR: Unsupported command\n\r");
         }
-        memcpy(psPacket, pucRcvdBuffer, sizeof(_sPacket));
+
         bRetVal = true;
     }
 
@@ -72,60 +57,27 @@ bool ParsePacket(uint8_t *pucRcvdBuffer, _sPacket *psPacket)
 }
 
 /**
- * @brief      : Parse packet received
- * @param [in] : None
- * @param [out]: pucRcvdBuffer - Receieved Buffer
- *             : psPacket - Packet received
- * @return     : true for success
+ * @brief      : Handle CONNECT command
+ * @param [in] : psCmd - decoded command
+ * @param [out]: None
+ * @return     : None
 */
-bool ProcessRcvdPacket(_sPacket *psPacket)
+static void HandleConnect(const _sCmd *psCmd)
 {
-    bool bRetVal = false;
-
-    if (psPacket)
-    {
-        switch (psPacket->PacketType)
-        {
-            case CMD : ProcessCmd(psPacket->pucPayload);
-                    break;
-            case RESP: ProcessResponse(psPacket->pucPayload);
-                    break;
-            case DATA: //ProcessData
-                    break;
-            case ACK:  //ProcessAcknowledge(psPacket->pucPayload);
-                    break;
-            default  :
-                    break;
-        }
-
-        bRetVal = true;
-    }
-
-    return bRetVal;
+#ifdef nRF52840
+    SetDeviceState(BLE_CONN_REQ);
+#endif
 }
 
 /**
- * @brief      : Process command
- * @param [in] : 
+ * @brief      : Handle POWER_MODE command
+ * @param [in] : psCmd - decoded command
  * @param [out]: None
- * @return     : true for success
+ * @return     : None
 */
-bool ProcessCmd(char *pcCmd)
+static void HandlePowerMode(const _sCmd *psCmd)
 {
-    bool bRetVal = false;
-
-    if (pcCmd)
-    {
-        if (strcmp(pcCmd, "CONNECT") == 0)
-        {
-#ifdef nRF52840            
-            SetDeviceState(BLE_CONN_REQ);
-#endif
-        }
-        else {
-            printk("/n In here: %s\n", pcCmd);
-        }
-    }
+    SetPowerMode(psCmd->uArgs.ePowerMode);
 }
 
 /**
@@ -145,6 +97,7 @@ bool ProcessResponse(char *pcResp)
         }
         else
         {
+            LocationResponseRcvd();
             LocationdataNotify(pcResp, strlen(pcResp));
         }
     }
@@ -14,12 +14,55 @@
 #include "../BLE/BleService.h"
 
 /*******************************************MACROS**********************************************************/
-
+#define LOCATION_PERIOD_MS      1000    //Location request while the phone listens
+#define LOCATION_TIMEOUT_MS     5000    //No response, request again
 
 /******************************************TYPEDEFS*********************************************************/
 static _eDevState DevState = BLE_IDLE;
+/*9160 sleeps, advertise slowly until a central connects*/
+static bool bLowPower = false;
+/*Last location request, one is outstanding until the 9160 responds*/
+static uint32_t ulLocationReqAt = 0;
+static bool bLocationPending = false;
 
 /*****************************************FUNCTION DEFINITION***********************************************/
+/**
+ * @brief       : Encode and send a command to 9160
+ * @param [in]  : psCmd - command to send
+ * @param [out] : none
+ * @return      : true for success
+*/
+static bool SendCmd(const _sCmd *psCmd)
+{
+    uint8_t ucPayload[DATA_SIZE] = {0};
+    _sPacket sPacket = {0};
+    uint16_t usLen = 0;
+    bool bRetVal = false;
+
+    usLen = CmdEncode(psCmd, ucPayload, sizeof(ucPayload));
+
+    if (usLen && BuildPacket(&sPacket, CMD, ucPayload, usLen))
+    {
+        bRetVal = SendPacket(&sPacket);
+    }
+
+    return bRetVal;
+}
+
+/**
+ * @brief       : Check if the next location request may be sent, the
+ *                previous one must be answered or timed out
+ * @param [in]  : None
+ * @param [out] : none
+ * @return      : true if a request is due
+*/
+static bool LocationRequestDue(void)
+{
+    uint32_t ulElapsed = k_uptime_get_32() - ulLocationReqAt;
+
+    return ulElapsed >= (bLocationPending ? LOCATION_TIMEOUT_MS : LOCATION_PERIOD_MS);
+}
+
 /**
  * @brief       : Process Device state of MASTER device
  * @param [in]  : None
@@ -28,18 +71,11 @@ static _eDevState DevState = BLE_IDLE;
 */
 void PollMsgs()
 {
-    uint32_t TimeNow = 0;
-    uint8_t ucBuff[255];
     _sPacket sPacket = {0};
 
-    if (ReadPacket(ucBuff))
+    while (ReadPacket(&sPacket))
     {
-        printk("Received packet %s\n\r", ucBuff);
-
-        if (ParsePacket(ucBuff, &sPacket))
-        {
-            ProcessRcvdPacket(&sPacket);
-        }
+        ProcessRcvdPacket(&sPacket);
     }
 }
 
@@ -47,12 +83,21 @@ void PollMsgs()
 void ProcessDeviceState()
 {
     _sPacket sPacket = {0};
-    uint8_t ucPayload[255];
+    uint8_t ucPayload[255] = {0};
+    uint16_t usLen = 0;
+    _sCmd sCmd = {0};
 
     switch(DevState)
     {
         case BLE_IDLE:
-                    //No Operation 
+                    //9160 sends no connection requests while asleep
+                    if (bLowPower && IsConnected())
+                    {
+                        sCmd.eId = CMD_POWER_MODE;
+                        sCmd.uArgs.ePowerMode = POWER_ACTIVE;
+                        SetPowerMode(POWER_ACTIVE);
+                        SendCmd(&sCmd);
+                    }
                     break;
 
         case BLE_CONN_REQ:
@@ -69,28 +114,33 @@ void ProcessDeviceState()
                         SetDeviceState(BLE_IDLE);
                         BuildPacket(&sPacket, RESP, ucPayload, strlen((char *)ucPayload));
                     }
-                    SendData((uint8_t *)&sPacket, sizeof(sPacket));
+                    SendPacket(&sPacket);
                     break;
         case BLE_CONNECTED:
-                    if (IsNotificationenabled())
+                    if (IsNotificationenabled() && LocationRequestDue())
                     {
-                        strcpy((char *)ucPayload, "LOCATION");
-                        BuildPacket(&sPacket, CMD, ucPayload, strlen((char *)ucPayload));
-                        SendData((uint8_t *)&sPacket, sizeof(sPacket));
+                        sCmd.eId = CMD_LOCATION;
+                        bLocationPending = SendCmd(&sCmd);
+                        ulLocationReqAt = k_uptime_get_32();
                     }
                     break;
 
         case BLE_DISCONNECTED:
-                    strcpy((char *)ucPayload, "DISCONNECT");
+                    sCmd.eId = CMD_DISCONNECT;
                     SetDeviceState(BLE_IDLE);
-                    BuildPacket(&sPacket, CMD, ucPayload, strlen((char *)ucPayload));
-                    SendData((uint8_t *)&sPacket, sizeof(sPacket));
+                    SendCmd(&sCmd);
                     break;
         case BLE_CONFIG:
-                    GetRcvdData(ucPayload);
-                    printk("chk- test payload- %s\n", ucPayload);
-                    BuildPacket(&sPacket, CMD, ucPayload, strlen((char *)ucPayload));
-                    SendData((uint8_t *)&sPacket, sizeof(sPacket));
+                    usLen = GetRcvdData(ucPayload);
+                    //Text written by the phone is forwarded as a binary command
+                    if (CmdDecode(ucPayload, usLen, &sCmd))
+                    {
+                        SendCmd(&sCmd);
+                    }
+                    else
+                    {
+                        printk("ERR: Invalid config- %s\n", ucPayload);
+                    }
                     SetDeviceState(BLE_CONNECTED);                  //chk
                     break;
         default        :
@@ -120,4 +170,57 @@ void SetDeviceState(_eDevState DeviceState)
     DevState = DeviceState;
 }
 
+/**
+ * @brief       : Location response received from 9160, next request may
+ *                go out after LOCATION_PERIOD_MS
+ * @param [in]  : None
+ * @param [out] : none
+ * @return      : None
+*/
+void LocationResponseRcvd(void)
+{
+    bLocationPending = false;
+}
+
+/**
+ * @brief       : Apply power mode requested by 9160
+ * @param [in]  : ePowerMode - POWER_SLEEP for slow advertising
+ * @param [out] : none
+ * @return      : None
+*/
+void SetPowerMode(_ePowerMode ePowerMode)
+{
+    bool bSleep = (ePowerMode == POWER_SLEEP);
+
+    if (bSleep != bLowPower)
+    {
+        bLowPower = bSleep;
+        SetAdvertisingSlow(bSleep);
+        PowerLog("BLE", bSleep ? "ADV_SLOW" : "ADV_FAST");
+    }
+}
+
+/**
+ * @brief       : Check if the system is asleep
+ * @param [in]  : None
+ * @param [out] : none
+ * @return      : true while advertising slowly
+*/
+bool IsLowPower(void)
+{
+    return bLowPower;
+}
+
+/**
+ * @brief       : Print a timestamped power transition, same format as 9160
+ * @param [in]  : pcDomain - domain, BLE
+ *                pcState - state entered
+ * @param [out] : none
+ * @return      : None
+*/
+void PowerLog(const char *pcDomain, const char *pcState)
+{
+    printk("PWR: t=%u %s %s\n\r", k_uptime_get_32(), pcDomain, pcState);
+}
+
 //EOF
\ No newline at end of file
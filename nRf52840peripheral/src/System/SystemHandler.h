@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include "CmdDispatch.h"
 
 /*********************************************TYPEDEFS***************************************************/
 typedef enum __eDevState
@@ -30,6 +31,10 @@ void ProcessDeviceState();
 void PollMsgs();
 _eDevState *GetDeviceState();
 void SetDeviceState(_eDevState DeviceState);
+void LocationResponseRcvd(void);
+void SetPowerMode(_ePowerMode ePowerMode);
+bool IsLowPower(void);
+void PowerLog(const char *pcDomain, const char *pcState);
 
 #endif
 
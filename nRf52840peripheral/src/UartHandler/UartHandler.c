@@ -8,6 +8,8 @@
 
 #include "UartHandler.h"
 #include "BleService.h"
+#include "PerfStats.h"
+#include "LogRate.h"
 
 /*******************************************************MACROS*****************************************************/
 
@@ -18,18 +20,33 @@
 /*******************************************************PRIVATE VARIABLES******************************************/
 /*Get UART device*/
 static const struct device *psUartDev = DEVICE_DT_GET(DT_NODELABEL(arduino_serial));
-/*Buffer for UART receive data*/
-static uint8_t cRxBuffer[BUFFER_SIZE] = {0};
-/*State of UART receive*/
-static _eUartRxState eUartRxState = START;
-/*Index of LoRa packet receive*/
-static uint16_t usRxBufferIdx = 0;
-/*Flag for LORA packet receive completion*/
-static bool bRxCmplt = false;
+/*Frame decoder fed from UART ISR*/
+static _sPacketDecoder sRxDecoder = {.eState = FRAME_START};
+/*Sequencing and retransmission towards 9160*/
+static _sLinkReliable sUartLink;
+/*Rate negotiation, follows the 9160*/
+static _sLinkBaud sUartBaud;
+#if defined(CONFIG_PETTAP_LINK_PM)
+/*Wake lines and UART suspend between transfers*/
+static _sLinkPower sUartPower;
+static const struct gpio_dt_spec sWakeOut = GPIO_DT_SPEC_GET(DT_PATH(zephyr_user), link_wake_out_gpios);
+static const struct gpio_dt_spec sWakeIn = GPIO_DT_SPEC_GET(DT_PATH(zephyr_user), link_wake_in_gpios);
+#endif
+
+K_MSGQ_DEFINE(UartMsgQueue, sizeof(_sPacket), 4, 4);
+
+PERF_COUNTER_DEFINE(uart_rx_bytes);
+PERF_COUNTER_DEFINE(uart_rx_frames);
+PERF_COUNTER_DEFINE(uart_rx_errors);
+PERF_COUNTER_DEFINE(uart_rx_drops);
+PERF_COUNTER_DEFINE(uart_tx_bytes);
+PERF_GAUGE_DEFINE(uart_rx_queue);
+PERF_HIST_DEFINE(uart_isr, "us");
 
 /*******************************************************PUBLIC VARIABLES*******************************************/
 
 /*******************************************************FUNCTION DEFINITION*****************************************/
+static bool TransmitFrame(const _sPacket *psPacket);
 
 /**
  * @brief      : Initialising Uart for communication between 9160
@@ -71,6 +88,22 @@ bool InitUart(void)
             }
         }
  
+        LinkInit(&sUartLink, TransmitFrame);
+
+        if (!LinkBaudInit(&sUartBaud, psUartDev, LINK_BAUD_SLAVE,
+                          DT_PROP(DT_NODELABEL(arduino_serial), hw_flow_control),
+                          TransmitFrame, &sRxDecoder.sStats))
+        {
+            printk("WARN: UART rate negotiation unavailable\n\r");
+        }
+
+#if defined(CONFIG_PETTAP_LINK_PM)
+        if (!LinkPowerInit(&sUartPower, psUartDev, &sWakeOut, &sWakeIn))
+        {
+            printk("WARN: Low-power link unavailable\n\r");
+        }
+#endif
+
         uart_irq_rx_enable(psUartDev);
         printk("UART initialised\n\r");
 
@@ -88,6 +121,8 @@ bool InitUart(void)
  
 void ReceptionCb(const struct device *dev, void *user_data)
 {
+    uint32_t ulStamp = PERF_STAMP();
+
     if (psUartDev)
     {
         if (!uart_irq_update(psUartDev))
@@ -102,8 +137,11 @@ void ReceptionCb(const struct device *dev, void *user_data)
  
         if (!ReadBuffer())
         {
-            printk("Uart reception failed\n\r");
+            PRINTK_RATELIMIT(LOG_RATE_ISR_MS, "Uart reception failed\n\r");
+            return;
         }
+
+        PERF_HIST_SINCE_US(uart_isr, ulStamp);
     }
    
 }
@@ -117,38 +155,39 @@ bool ReadBuffer(void)
 {
     uint8_t ucByte = 0;
     bool bRetval = false;
+    _eFrameStatus eStatus = FRAME_IN_PROGRESS;
 
-    if (uart_fifo_read(psUartDev, &ucByte, 1) == 1)
+    while (uart_fifo_read(psUartDev, &ucByte, 1) == 1)
     {
-        switch(eUartRxState)
+        bRetval = true;
+        PERF_COUNT(uart_rx_bytes);
+        eStatus = PacketDecodeByte(&sRxDecoder, ucByte);
+
+        if (eStatus == FRAME_ERROR)
         {
-            case START: if (ucByte == '*')
-                        {
-                            usRxBufferIdx = 0;
-                            memset(cRxBuffer, 0, sizeof(cRxBuffer));
-                            cRxBuffer[usRxBufferIdx++] = ucByte;
-                            eUartRxState = RCV;
-                        }
-                        break;
-
-            case RCV:   if (ucByte == '#')
-                        {
-                            cRxBuffer[usRxBufferIdx++] = ucByte;
-                            cRxBuffer[usRxBufferIdx++] = '\0';
-                            bRxCmplt = true;
-                            eUartRxState = START;
-                            printk(".\n\r");
-                        }
-                        cRxBuffer[usRxBufferIdx++] = ucByte;
-                        break;
-
-            case END:   eUartRxState = START;
-                        usRxBufferIdx = 0;
-                        break;
-
-            default:    break;            
+            PERF_COUNT(uart_rx_errors);
+        }
+
+        if (eStatus != FRAME_COMPLETE)
+        {
+            continue;
+        }
+
+        PERF_COUNT(uart_rx_frames);
+
+#if defined(CONFIG_PETTAP_LINK_PM)
+        LinkPowerActivity(&sUartPower);
+#endif
+
+        if (!LinkBaudRxFromIsr(&sUartBaud, &sRxDecoder.sPacket))
+        {
+            if (k_msgq_put(&UartMsgQueue, &sRxDecoder.sPacket, K_NO_WAIT) != 0)
+            {
+                PERF_COUNT(uart_rx_drops);
+            }
+
+            PERF_GAUGE(uart_rx_queue, k_msgq_num_used_get(&UartMsgQueue));
         }
-        bRetval = true;
     }
  
     return bRetval;
@@ -165,34 +204,126 @@ void SendData(const uint8_t *pcData, uint16_t usLength)
 
     if (pcData)
     {
+        PERF_ADD(uart_tx_bytes, usLength);
 
-        for (index = 0; index <= usLength; index++)
+        for (index = 0; index < usLength; index++)
         {
             uart_poll_out(psUartDev, (char)pcData[index]);
-            k_msleep(5);
         }
-        printk("\n\r");
     }
 }
 
+/**
+ * @brief      : Serialize packet and put it on the UART, used by the link layer
+ * @param [in] : psPacket - packet to transmit
+ * @param [out]: None
+ * @return     : true for success
+*/
+static bool TransmitFrame(const _sPacket *psPacket)
+{
+    uint8_t ucFrame[FRAME_MAX_SIZE] = {0};
+    uint16_t usLen = 0;
+
+    usLen = SerializePacket(psPacket, ucFrame, sizeof(ucFrame));
+
+    if (usLen)
+    {
+#if defined(CONFIG_PETTAP_LINK_PM)
+        LinkPowerTxBegin(&sUartPower);
+#endif
+        SendData(ucFrame, usLen);
+#if defined(CONFIG_PETTAP_LINK_PM)
+        LinkPowerActivity(&sUartPower);
+#endif
+    }
+
+    return (usLen != 0);
+}
+
+/**
+ * @brief      : Send packet to 9160, retransmitted until acknowledged
+ * @param [in] : psPacket - packet to send
+ * @param [out]: None
+ * @return     : true if queued, false when the window is full
+*/
+bool SendPacket(_sPacket *psPacket)
+{
+    return LinkSend(&sUartLink, psPacket);
+}
+
 /**
  * @brief       : Read Packet
  * @param [in]  : None
- * @param [out] : pucBuffer - Receiving buffer
+ * @param [out] : psPacket - packet received from 9160
  * @return      : true for success
 */
-bool ReadPacket(uint8_t *pucBuffer)
+bool ReadPacket(_sPacket *psPacket)
 {
     bool bRetVal = false;
 
-    if (bRxCmplt)
+    LinkBaudPoll(&sUartBaud);
+    LinkPoll(&sUartLink);
+
+#if defined(CONFIG_PETTAP_LINK_PM)
+    LinkPowerPoll(&sUartPower, !LinkIsIdle(&sUartLink));
+    LinkBaudSetIdle(&sUartBaud, LinkPowerIsSuspended(&sUartPower));
+#endif
+
+    while (!bRetVal && 0 == k_msgq_get(&UartMsgQueue, psPacket, K_NO_WAIT))
     {
-        memcpy(pucBuffer, cRxBuffer, usRxBufferIdx);
-        bRxCmplt = false;
-        bRetVal = true;
+        //ACKs and duplicates are consumed by the link layer
+        bRetVal = LinkReceive(&sUartLink, psPacket);
     }
 
     return bRetVal;
 }
 
+/**
+ * @brief       : Get statistics of the UART link
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : frame statistics of the receiver
+*/
+const _sFrameStats *GetUartFrameStats(void)
+{
+    return &sRxDecoder.sStats;
+}
+
+/**
+ * @brief       : Get statistics of the reliable link to 9160
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : link statistics
+*/
+const _sLinkStats *GetUartLinkStats(void)
+{
+    return LinkGetStats(&sUartLink);
+}
+
+/**
+ * @brief       : Get negotiated rate and error counters of the link to 9160
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : rate negotiation statistics
+*/
+const _sLinkBaudStats *GetUartBaudStats(void)
+{
+    return LinkBaudGetStats(&sUartBaud);
+}
+
+/**
+ * @brief       : Get wake latency and suspended time of the link to 9160
+ * @param [in]  : None
+ * @param [out] : None
+ * @return      : low-power link statistics, NULL when not enabled
+*/
+const _sLinkPowerStats *GetUartPowerStats(void)
+{
+#if defined(CONFIG_PETTAP_LINK_PM)
+    return LinkPowerGetStats(&sUartPower);
+#else
+    return NULL;
+#endif
+}
+
 //EOF
\ No newline at end of file
@@ -18,25 +18,22 @@
 #include <zephyr/drivers/uart.h>
 #include <zephyr/pm/device.h>
 #include <zephyr/drivers/gpio.h>
-
-/*********************************************************MACROS**************************************************/
-#define BUFFER_SIZE           1024
-
-/*********************************************************TYPEDEFS************************************************/
-
-typedef enum __eUartRxState
-{
-    START,
-    RCV,
-    END
-}_eUartRxState;
+#include "PacketFrame.h"
+#include "LinkReliable.h"
+#include "LinkBaud.h"
+#include "LinkPower.h"
 
 /*********************************************************FUNCTION DECLARATION************************************/
 bool InitUart(void);
 void ReceptionCb(const struct device *dev, void *user_data);
 bool ReadBuffer(void);
 void SendData(const uint8_t *pcData, uint16_t usLength);
-bool ReadPacket(uint8_t *pucBuffer);
+bool SendPacket(_sPacket *psPacket);
+bool ReadPacket(_sPacket *psPacket);
+const _sFrameStats *GetUartFrameStats(void);
+const _sLinkStats *GetUartLinkStats(void);
+const _sLinkBaudStats *GetUartBaudStats(void);
+const _sLinkPowerStats *GetUartPowerStats(void);
 
 #endif
 
@@ -30,6 +30,8 @@
 
 
 /*******************************MACROS****************************************/
+#define POLL_ACTIVE_MS      1       //Link and state machine poll
+#define POLL_SLEEP_MS       100     //While the 9160 sleeps
 
 /*******************************GLOBAL VARIABLES********************************/
 
@@ -64,6 +66,9 @@ int main(void)
     {
         PollMsgs();
         ProcessDeviceState();
+        RefreshAdvertising();
+        //CPU sleeps in the idle thread between polls
+        k_msleep(IsLowPower() ? POLL_SLEEP_MS : POLL_ACTIVE_MS);
     }
 
     printk("CRITICAL: Program exit");